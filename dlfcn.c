@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <dlfcn.h>
 #include <rtl.h>
+#include "rtl-async.h"
 
 static rtems_rtl_obj_t*
 dl_get_obj_from_handle (void* handle)
@@ -60,8 +61,12 @@ dlopen (const char* name, int mode)
   _rtld_debug_state();
 
   rtems_rtl_unlock ();
-  
-  return obj;
+
+  /*
+   * The handle is checked in constant time and is not valid once the object
+   * file is unloaded.
+   */
+  return obj ? obj->handle : NULL;
 }
 
 int
@@ -151,3 +156,15 @@ dlinfo (void* handle, int request, void* p)
   
   return rc;
 }
+
+int
+dlopen_async (const char* name, int mode, dl_async_callback_t callback, void* arg)
+{
+  return rtems_rtl_async_load (name, mode, callback, arg);
+}
+
+int
+dlcancel_async (int id)
+{
+  return rtems_rtl_async_cancel (id) ? 0 : -1;
+}
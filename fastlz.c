@@ -26,6 +26,8 @@
 
 #if !defined(FASTLZ__COMPRESSOR) && !defined(FASTLZ_DECOMPRESSOR)
 
+#include <string.h>
+
 /*
  * Always check for bound when decompressing.
  * Generally it is best to leave it defined.
@@ -54,6 +56,17 @@
 #define FASTLZ_INLINE
 #endif
 
+/*
+ * Control where the copy helpers are inlined so the decoder loop stays small.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 2)
+#define FASTLZ_FORCE_INLINE FASTLZ_INLINE __attribute__((always_inline))
+#define FASTLZ_NOINLINE __attribute__((noinline))
+#else
+#define FASTLZ_FORCE_INLINE FASTLZ_INLINE
+#define FASTLZ_NOINLINE
+#endif
+
 /*
  * Prevent accessing more than 8-bit at once, except on x86 architectures.
  */
@@ -90,6 +103,80 @@ int fastlz_decompress(const void* input, int length, void* output, int maxout);
 #define MAX_LEN       264  /* 256 + 8 */
 #define MAX_DISTANCE 8192
 
+/*
+ * Copy a word at a time when the source and destination alignment allows. A
+ * strict alignment target needs both on the same alignment so the copy can
+ * be aligned with a few byte copies.
+ */
+#define FASTLZ_WORD sizeof(flzuint32)
+#define FASTLZ_WORD_MASK (FASTLZ_WORD - 1)
+
+#if !defined(FASTLZ_STRICT_ALIGN)
+#define FASTLZ_WORD_COPY(op, ip) 1
+#else
+#define FASTLZ_WORD_COPY(op, ip) (((((size_t)(op)) ^ ((size_t)(ip))) & FASTLZ_WORD_MASK) == 0)
+#endif
+
+/*
+ * Matches shorter than this are the most common and are copied a byte at a
+ * time in the decoder's loop.
+ */
+#define FASTLZ_SHORT_MATCH 16
+
+/*
+ * Non-overlapping copies of this size or more are handed to memcpy.
+ */
+#define FASTLZ_BULK_COPY 64
+
+/*
+ * Copy forward. The destination can overlap the source if it is at least a
+ * word past the source.
+ */
+static FASTLZ_FORCE_INLINE void fastlz_copy(flzuint8* op, const flzuint8* ip, flzuint32 len)
+{
+  if(len >= (2 * FASTLZ_WORD) && FASTLZ_WORD_COPY(op, ip))
+  {
+#if defined(FASTLZ_STRICT_ALIGN)
+    for(; ((size_t) op) & FASTLZ_WORD_MASK; --len)
+      *op++ = *ip++;
+#endif
+    for(; len >= FASTLZ_WORD; len -= FASTLZ_WORD)
+    {
+      *((flzuint32*) op) = *((const flzuint32*) ip);
+      op += FASTLZ_WORD;
+      ip += FASTLZ_WORD;
+    }
+  }
+  for(; len; --len)
+    *op++ = *ip++;
+}
+
+/*
+ * Copy a long match. A match closer than a word repeats a short pattern. The
+ * first few repeats are copied a byte at a time until the pattern is at least
+ * a word long, then the rest is copied a word at a time from that far back.
+ * This is kept out of line so the decoder's loop stays small.
+ */
+static FASTLZ_NOINLINE void fastlz_match_copy(flzuint8* op, const flzuint8* ref, flzuint32 len)
+{
+  flzuint32 distance = op - ref;
+  if(distance >= len && len >= FASTLZ_BULK_COPY)
+    memcpy(op, ref, len);
+  else if(distance >= FASTLZ_WORD)
+    fastlz_copy(op, ref, len);
+  else
+  {
+    flzuint32 step = distance;
+    flzuint32 n;
+    while(step < FASTLZ_WORD)
+      step += distance;
+    len -= step;
+    for(n = step; n; --n)
+      *op++ = *ref++;
+    fastlz_copy(op, op - step, len);
+  }
+}
+
 #if !defined(FASTLZ_STRICT_ALIGN)
 #define FASTLZ_READU16(p) *((const flzuint16*)(p)) 
 #else
@@ -479,49 +566,29 @@ static FASTLZ_INLINE int FASTLZ_DECOMPRESSOR(const void* input, int length, void
       {
         /* optimize copy for a run */
         flzuint8 b = ref[-1];
-        *op++ = b;
-        *op++ = b;
-        *op++ = b;
-        for(; len; --len)
-          *op++ = b;
+        len += 3;
+        if(len >= FASTLZ_BULK_COPY)
+        {
+          memset(op, b, len);
+          op += len;
+        }
+        else
+          for(; len; --len)
+            *op++ = b;
       }
       else
       {
-#if !defined(FASTLZ_STRICT_ALIGN)
-        const flzuint16* p;
-        flzuint16* q;
-#endif
         /* copy from reference */
         ref--;
-        *op++ = *ref++;
-        *op++ = *ref++;
-        *op++ = *ref++;
-
-#if !defined(FASTLZ_STRICT_ALIGN)
-        /* copy a byte, so that now it's word aligned */
-        if(len & 1)
+        len += 3;
+        if(FASTLZ_EXPECT_CONDITIONAL(len < FASTLZ_SHORT_MATCH))
+          for(; len; --len)
+            *op++ = *ref++;
+        else
         {
-          *op++ = *ref++;
-          len--;
+          fastlz_match_copy(op, ref, len);
+          op += len;
         }
-
-        /* copy 16-bit at once */
-        q = (flzuint16*) op;
-        op += len;
-        p = (const flzuint16*) ref;
-        for(len>>=1; len > 4; len-=4)
-        {
-          *q++ = *p++;
-          *q++ = *p++;
-          *q++ = *p++;
-          *q++ = *p++;
-        }
-        for(; len; --len)
-          *q++ = *p++;
-#else
-        for(; len; --len)
-          *op++ = *ref++;
-#endif
       }
     }
     else
@@ -534,9 +601,9 @@ static FASTLZ_INLINE int FASTLZ_DECOMPRESSOR(const void* input, int length, void
         return 0;
 #endif
 
-      *op++ = *ip++; 
-      for(--ctrl; ctrl; ctrl--)
-        *op++ = *ip++;
+      fastlz_copy(op, ip, ctrl);
+      op += ctrl;
+      ip += ctrl;
 
       loop = FASTLZ_EXPECT_CONDITIONAL(ip < ip_limit);
       if(loop)
@@ -57,6 +57,10 @@ int	dlctl(void *, int, void *);
 #endif
 int	dlinfo(void *, int, void *);
 __aconst char *dlerror(void);
+/* RTEMS asynchronous loading. */
+typedef void (*dl_async_callback_t)(void *, const char *, void *);
+int	dlopen_async(const char *, int, dl_async_callback_t, void *);
+int	dlcancel_async(int);
 __END_DECLS
 
 /* Values for dlopen `mode'. */
@@ -19,6 +19,7 @@
 #include "config.h"
 #endif
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -354,6 +355,37 @@ rtems_rap_load (const char* name, int mode, int argc, const char* argv[])
   return true;
 }
 
+int
+rtems_rap_load_async (const char*                name,
+                      int                        mode,
+                      rtems_rtl_async_callback_t callback,
+                      void*                      arg)
+{
+  const char* path = NULL;
+  uint32_t    size = 0;
+  int         id;
+
+  if (rap_verbose)
+    printf ("rap: queuing '%s'\n", name);
+
+  /*
+   * Find the file the way rtems_rap_load does so both load the same object
+   * file.
+   */
+  if (!rtems_rtl_find_file (name, getenv ("PATH"), &path, &size))
+  {
+    rtems_rap_set_error (ENOENT, "file not found");
+    errno = ENOENT;
+    return -1;
+  }
+
+  id = rtems_rtl_async_load (path, RTLD_NOW | mode, callback, arg);
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) path);
+
+  return id;
+}
+
 bool
 rtems_rap_unload (const char* name)
 {
@@ -21,6 +21,8 @@
 #include <rtems.h>
 #include <rtems/chain.h>
 
+#include <rtl-async.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -52,6 +54,30 @@ typedef bool (*rtems_rap_iterator_t) (void* handle);
  */
 bool rtems_rap_load (const char* name, int mode, int argc, const char* argv[]);
 
+/**
+ * Queue the load of an application to the RTL's asynchronous loader. The
+ * application's file is found using the PATH environment variable the same
+ * as rtems_rap_load. The file is loaded and linked in the loader task but its
+ * entry is not called and it is not added to the list of applications. A
+ * later rtems_rap_load call uses the loaded file and calls the entry.
+ *
+ * The handle passed to the callback holds a reference to the loaded file.
+ * The caller must dlclose the handle once it is not needed, for example
+ * after rtems_rap_load has loaded the application, or the file is never
+ * unloaded.
+ *
+ * @param name The name of the application file.
+ * @param mode The mode of the load as defined by the dlopen call.
+ * @param callback The callback called when the load completes.
+ * @param arg The user argument passed to the callback.
+ * @return int The request's id. -1 if the request could not be queued and the
+ *             errno is set.
+ */
+int rtems_rap_load_async (const char*                name,
+                          int                        mode,
+                          rtems_rtl_async_callback_t callback,
+                          void*                      arg);
+
 /**
  * Unload an application.
  *
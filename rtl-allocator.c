@@ -13,17 +13,18 @@
  * @brief RTEMS Run-Time Linker Allocator
  */
 
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <rtl.h>
 #include <rtl-alloc-heap.h>
 #include <rtl-trace.h>
 
 /**
- * Tags as symbols for tracing.
+ * Tags as symbols for tracing and the statistics.
  */
-#if RTEMS_RTL_TRACE
-static const char* tag_labels[6] =
+static const char* tag_labels[RTEMS_RTL_ALLOC_TAGS] =
 {
   "OBJECT",
   "SYMBOL",
@@ -32,18 +33,86 @@ static const char* tag_labels[6] =
   "READ_WRITE",
   "READ_EXEC",
 };
+#if RTEMS_RTL_TRACE
 #define rtems_rtl_trace_tag_label(_l) tag_labels[_l]
 #else
 #define rtems_rtl_trace_tag_label(_l) ""
 #endif
 
+#if RTEMS_RTL_ALLOC_STATS
+/**
+ * The accounting header placed in front of each allocation. The union keeps
+ * the memory returned to the user aligned for any type.
+ */
+typedef union rtems_rtl_alloc_hdr_u
+{
+  struct
+  {
+    size_t                   size;  /**< The size of the user's allocation. */
+    rtems_rtl_alloc_tag_t    tag;   /**< The tag the allocation was made with. */
+    rtems_rtl_alloc_stats_t* owner; /**< The owner charged, NULL if none. */
+  } info;
+  double    align_double;           /**< Alignment only. */
+  long long align_long_long;        /**< Alignment only. */
+  void*     align_pointer;          /**< Alignment only. */
+} rtems_rtl_alloc_hdr_t;
+
+static void
+rtems_rtl_alloc_stats_charge (rtems_rtl_alloc_stats_t* stats, size_t size)
+{
+  stats->current += size;
+  if (stats->current > stats->peak)
+    stats->peak = stats->current;
+  ++stats->allocs;
+}
+
+static void
+rtems_rtl_alloc_stats_credit (rtems_rtl_alloc_stats_t* stats, size_t size)
+{
+  if (stats->current >= size)
+    stats->current -= size;
+  else
+    stats->current = 0;
+}
+
+/**
+ * An owner's statistics. The owner is held by its object file and by each
+ * allocation charged to it so the statistics are valid until the last one is
+ * deleted.
+ */
+typedef struct rtems_rtl_alloc_owner_s
+{
+  uint32_t                refs;                        /**< The references. */
+  rtems_rtl_alloc_stats_t stats[RTEMS_RTL_ALLOC_TAGS]; /**< The statistics. */
+} rtems_rtl_alloc_owner_t;
+
+static rtems_rtl_alloc_owner_t*
+rtems_rtl_alloc_owner_block (rtems_rtl_alloc_stats_t* stats)
+{
+  return (rtems_rtl_alloc_owner_t*)
+    (((uint8_t*) stats) - offsetof (rtems_rtl_alloc_owner_t, stats));
+}
+
+static void
+rtems_rtl_alloc_owner_release (rtems_rtl_alloc_stats_t* stats)
+{
+  rtems_rtl_alloc_owner_t* owner = rtems_rtl_alloc_owner_block (stats);
+  if (--owner->refs == 0)
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, owner);
+}
+#endif
+
 void
 rtems_rtl_alloc_initialise (rtems_rtl_alloc_data_t* data)
 {
   int c;
   data->allocator = rtems_rtl_alloc_heap;
   for (c = 0; c < RTEMS_RTL_ALLOC_TAGS; ++c)
+  {
     rtems_chain_initialize_empty (&data->indirects[c]);
+    memset (&data->stats[c], 0, sizeof (data->stats[c]));
+  }
+  data->owner = NULL;
 }
 
 void*
@@ -53,15 +122,42 @@ rtems_rtl_alloc_new (rtems_rtl_alloc_tag_t tag, size_t size, bool zero)
   void*             address = NULL;
 
   if (rtl)
+  {
+#if RTEMS_RTL_ALLOC_STATS
+    rtems_rtl_alloc_data_t* allocator = &rtl->allocator;
+    rtems_rtl_alloc_hdr_t*  hdr = NULL;
+    allocator->allocator (true, tag, (void**) &hdr, size + sizeof (*hdr));
+    if (hdr)
+    {
+      hdr->info.size = size;
+      hdr->info.tag = tag;
+      hdr->info.owner = allocator->owner;
+      rtems_rtl_alloc_stats_charge (&allocator->stats[tag], size);
+      if (allocator->owner)
+      {
+        rtems_rtl_alloc_stats_charge (&allocator->owner[tag], size);
+        ++rtems_rtl_alloc_owner_block (allocator->owner)->refs;
+      }
+      address = hdr + 1;
+    }
+    else
+    {
+      ++allocator->stats[tag].failed;
+      if (allocator->owner)
+        ++allocator->owner[tag].failed;
+    }
+#else
     rtl->allocator.allocator (true, tag, &address, size);
-  
+#endif
+  }
+
   rtems_rtl_unlock ();
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_ALLOCATOR))
     printf ("rtl: alloc: new: %s addr=%p size=%zu\n",
             rtems_rtl_trace_tag_label (tag), address, size);
 
-  if (zero)
+  if (zero && address)
     memset (address, 0, size);
   
   return address;
@@ -77,11 +173,116 @@ rtems_rtl_alloc_del (rtems_rtl_alloc_tag_t tag, void* address)
             rtems_rtl_trace_tag_label (tag), address);
   
   if (rtl && address)
+  {
+#if RTEMS_RTL_ALLOC_STATS
+    rtems_rtl_alloc_data_t* allocator = &rtl->allocator;
+    rtems_rtl_alloc_hdr_t*  hdr = ((rtems_rtl_alloc_hdr_t*) address) - 1;
+    /*
+     * Credit the tag the memory was allocated with. The allocation holds a
+     * reference to its owner so the owner is always valid.
+     */
+    tag = hdr->info.tag;
+    rtems_rtl_alloc_stats_credit (&allocator->stats[tag], hdr->info.size);
+    if (hdr->info.owner)
+    {
+      rtems_rtl_alloc_stats_credit (&hdr->info.owner[tag], hdr->info.size);
+      rtems_rtl_alloc_owner_release (hdr->info.owner);
+    }
+    address = hdr;
+#endif
     rtl->allocator.allocator (false, tag, &address, 0);
-  
+  }
+
   rtems_rtl_unlock ();
 }
 
+const char*
+rtems_rtl_alloc_tag_label (rtems_rtl_alloc_tag_t tag)
+{
+  if (tag < RTEMS_RTL_ALLOC_TAGS)
+    return tag_labels[tag];
+  return "INVALID";
+}
+
+bool
+rtems_rtl_alloc_stats (rtems_rtl_alloc_tag_t    tag,
+                       rtems_rtl_alloc_stats_t* stats)
+{
+#if RTEMS_RTL_ALLOC_STATS
+  rtems_rtl_data_t* rtl;
+  if (tag >= RTEMS_RTL_ALLOC_TAGS)
+    return false;
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+    return false;
+  *stats = rtl->allocator.stats[tag];
+  rtems_rtl_unlock ();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+rtems_rtl_alloc_stats_reset (void)
+{
+  rtems_rtl_data_t* rtl = rtems_rtl_lock ();
+  if (rtl)
+  {
+    int c;
+    for (c = 0; c < RTEMS_RTL_ALLOC_TAGS; ++c)
+    {
+      rtl->allocator.stats[c].peak = rtl->allocator.stats[c].current;
+      rtl->allocator.stats[c].failed = 0;
+    }
+    rtems_rtl_unlock ();
+  }
+}
+
+rtems_rtl_alloc_stats_t*
+rtems_rtl_alloc_owner (rtems_rtl_alloc_stats_t* owner)
+{
+  rtems_rtl_data_t*        rtl = rtems_rtl_lock ();
+  rtems_rtl_alloc_stats_t* previous = NULL;
+  if (rtl)
+  {
+    previous = rtl->allocator.owner;
+    rtl->allocator.owner = owner;
+    rtems_rtl_unlock ();
+  }
+  return previous;
+}
+
+rtems_rtl_alloc_stats_t*
+rtems_rtl_alloc_owner_new (void)
+{
+#if RTEMS_RTL_ALLOC_STATS
+  rtems_rtl_alloc_stats_t* previous = rtems_rtl_alloc_owner (NULL);
+  rtems_rtl_alloc_owner_t* owner;
+  owner = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                               sizeof (rtems_rtl_alloc_owner_t), true);
+  rtems_rtl_alloc_owner (previous);
+  if (owner)
+  {
+    owner->refs = 1;
+    return owner->stats;
+  }
+#endif
+  return NULL;
+}
+
+void
+rtems_rtl_alloc_owner_del (rtems_rtl_alloc_stats_t* owner)
+{
+#if RTEMS_RTL_ALLOC_STATS
+  if (owner && rtems_rtl_lock ())
+  {
+    rtems_rtl_alloc_owner_release (owner);
+    rtems_rtl_unlock ();
+  }
+#endif
+}
+
 rtems_rtl_allocator_t
 rtems_rtl_alloc_hook (rtems_rtl_allocator_t handler)
 {
@@ -138,8 +339,11 @@ rtems_rtl_alloc_indirect_del (rtems_rtl_alloc_tag_t tag,
   if (rtl && !rtems_rtl_ptr_null (handle))
   {
     rtems_chain_extract_unprotected (&handle->node);
-    rtems_rtl_alloc_del (tag, &handle->pointer);
+    rtems_rtl_alloc_del (tag, handle->pointer);
+    handle->pointer = NULL;
   }
+
+  rtems_rtl_unlock ();
 }
 
 bool
@@ -17,6 +17,7 @@
 #define _RTEMS_RTL_ALLOCATOR_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "rtl-indirect-ptr.h"
 
@@ -49,6 +50,27 @@ typedef enum rtems_rtl_alloc_tags_e rtems_rtl_alloc_tag_t;
  */
 #define RTEMS_RTL_ALLOC_TAGS ((size_t) (RTEMS_RTL_ALLOC_READ_EXEC + 1))
 
+/**
+ * Allocator accounting. The accounting places a small header in front of each
+ * allocation to hold the size so a delete knows the amount of memory being
+ * returned. Define as 0 to remove the accounting and the header.
+ */
+#if !defined (RTEMS_RTL_ALLOC_STATS)
+#define RTEMS_RTL_ALLOC_STATS 1
+#endif
+
+/**
+ * The allocation statistics. There is a set for each tag and a set for each
+ * tag held by each object file.
+ */
+typedef struct rtems_rtl_alloc_stats_s
+{
+  size_t   current; /**< The number of bytes currently allocated. */
+  size_t   peak;    /**< The high water mark of bytes allocated. */
+  uint32_t allocs;  /**< The number of allocations made. */
+  uint32_t failed;  /**< The number of allocations that failed. */
+} rtems_rtl_alloc_stats_t;
+
 /**
  * Allocator handler handles all RTL allocations. It can be hooked and
  * overridded for customised allocation schemes or memory maps.
@@ -76,6 +98,10 @@ struct rtems_rtl_alloc_data_s {
   rtems_rtl_allocator_t allocator;
   /**< The indirect pointer chains. */
   rtems_chain_control indirects[RTEMS_RTL_ALLOC_TAGS];
+  /**< The statistics for each tag. */
+  rtems_rtl_alloc_stats_t stats[RTEMS_RTL_ALLOC_TAGS];
+  /**< The object statistics charged with allocations. NULL if none. */
+  rtems_rtl_alloc_stats_t* owner;
 };
 
 typedef struct rtems_rtl_alloc_data_s rtems_rtl_alloc_data_t;
@@ -117,6 +143,59 @@ void rtems_rtl_alloc_del (rtems_rtl_alloc_tag_t tag, void* address);
  */
 rtems_rtl_allocator_t rtems_rtl_alloc_hook (rtems_rtl_allocator_t handler);
 
+/**
+ * Get the label of a tag.
+ *
+ * @param tag The tag.
+ * @return const char* The tag's label.
+ */
+const char* rtems_rtl_alloc_tag_label (rtems_rtl_alloc_tag_t tag);
+
+/**
+ * Get the allocation statistics for a tag.
+ *
+ * @param tag The tag of the statistics to get.
+ * @param stats Pointer to the statistics to fill in.
+ * @retval true The statistics have been returned.
+ * @retval false The tag is not valid or there is no accounting.
+ */
+bool rtems_rtl_alloc_stats (rtems_rtl_alloc_tag_t    tag,
+                            rtems_rtl_alloc_stats_t* stats);
+
+/**
+ * Reset the peak and failure statistics of all tags. The peak is set to the
+ * current amount of memory allocated.
+ */
+void rtems_rtl_alloc_stats_reset (void);
+
+/**
+ * Set the statistics allocations are charged to. An object file sets its
+ * statistics while it is being loaded so the memory allocated to it can be
+ * seen. A delete is credited to the owner the memory was charged to.
+ *
+ * @param owner The table of statistics indexed by tag created by
+ *              rtems_rtl_alloc_owner_new. NULL for no owner.
+ * @return rtems_rtl_alloc_stats_t* The previous owner.
+ */
+rtems_rtl_alloc_stats_t* rtems_rtl_alloc_owner (rtems_rtl_alloc_stats_t* owner);
+
+/**
+ * Create an owner's table of statistics indexed by tag. The owner is
+ * referenced by its creator and by each allocation charged to it and is
+ * released when the last reference is deleted.
+ *
+ * @return rtems_rtl_alloc_stats_t* The owner. NULL if there is no memory or
+ *                                  the statistics are disabled.
+ */
+rtems_rtl_alloc_stats_t* rtems_rtl_alloc_owner_new (void);
+
+/**
+ * Delete the creator's reference to an owner.
+ *
+ * @param owner The owner. Can be NULL.
+ */
+void rtems_rtl_alloc_owner_del (rtems_rtl_alloc_stats_t* owner);
+
 /**
  * Allocate memory to an indirect handle.
  *
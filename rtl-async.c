@@ -0,0 +1,356 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Asynchronous Loader.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rtems/libio_.h>
+
+#include <rtl.h>
+#include "rtl-async.h"
+#include "rtl-trace.h"
+
+/**
+ * A queued load request.
+ */
+typedef struct rtems_rtl_async_req_s
+{
+  int                        id;        /**< The request's id. */
+  char*                      name;      /**< The object file's name. */
+  int                        mode;      /**< The dlopen mode. */
+  rtems_rtl_async_callback_t callback;  /**< The completion callback. */
+  void*                      arg;       /**< The user argument. */
+  bool                       cancelled; /**< The request is cancelled. */
+} rtems_rtl_async_req_t;
+
+/**
+ * The loader. The queue fields are protected by the lock semaphore.
+ */
+typedef struct rtems_rtl_async_s
+{
+  bool                   open;      /**< The loader task has been created. */
+  rtems_task_priority    priority;  /**< The loader task's priority. */
+  size_t                 depth;     /**< The queue's depth. */
+  rtems_id               task;      /**< The loader task. */
+  rtems_id               lock;      /**< The queue lock. */
+  rtems_id               pending;   /**< Counts the queued requests. */
+  rtems_rtl_async_req_t* reqs;      /**< The queue. */
+  size_t                 head;      /**< The next request to load. */
+  size_t                 count;     /**< The number of queued requests. */
+  int                    next_id;   /**< The last request id. */
+  int                    current;   /**< The request loading. 0 if none. */
+  bool                   cancelled; /**< The loading request is cancelled. */
+} rtems_rtl_async_t;
+
+static rtems_rtl_async_t async = { .depth = RTEMS_RTL_ASYNC_DEPTH };
+
+static rtems_task
+rtems_rtl_async_loader (rtems_task_argument arg)
+{
+  while (true)
+  {
+    rtems_rtl_async_req_t req;
+    char                  message[RTEMS_RTL_ERROR_MAX];
+    const char*           error = NULL;
+    void*                 handle = NULL;
+
+    if (rtems_semaphore_obtain (async.pending,
+                                RTEMS_WAIT,
+                                RTEMS_NO_TIMEOUT) != RTEMS_SUCCESSFUL)
+      continue;
+
+    rtems_semaphore_obtain (async.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+    req = async.reqs[async.head];
+    async.head = (async.head + 1) % async.depth;
+    --async.count;
+    async.current = req.id;
+    async.cancelled = req.cancelled;
+    rtems_semaphore_release (async.lock);
+
+    if (!req.cancelled)
+    {
+      if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+        printf ("rtl: async: %d: loading '%s'\n", req.id, req.name);
+
+      handle = dlopen (req.name, req.mode);
+      if (!handle)
+      {
+        rtems_rtl_get_error (message, sizeof (message));
+        error = message;
+      }
+    }
+
+    rtems_semaphore_obtain (async.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+    req.cancelled = async.cancelled;
+    async.current = 0;
+    rtems_semaphore_release (async.lock);
+
+    if (req.cancelled)
+    {
+      if (handle)
+        dlclose (handle);
+      handle = NULL;
+      error = "load cancelled";
+    }
+
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: async: %d: %s\n", req.id, error ? error : "loaded");
+
+    free (req.name);
+
+    if (req.callback)
+      req.callback (handle, error, req.arg);
+  }
+}
+
+/*
+ * Create the queue and the loader task if not created. The open flag is only
+ * read with the libio lock held so a request on another processor sees the
+ * queue once the flag is set.
+ */
+static bool
+rtems_rtl_async_open (void)
+{
+  rtems_status_code sc;
+  bool              ok = true;
+
+  rtems_libio_lock ();
+
+  if (!async.open)
+  {
+    rtems_task_priority priority = async.priority;
+
+    if (priority == 0)
+    {
+      sc = rtems_task_set_priority (RTEMS_SELF, RTEMS_CURRENT_PRIORITY,
+                                    &priority);
+      if (sc != RTEMS_SUCCESSFUL)
+      {
+        rtems_libio_unlock ();
+        errno = EINVAL;
+        return false;
+      }
+    }
+
+    async.reqs = calloc (async.depth, sizeof (rtems_rtl_async_req_t));
+    if (!async.reqs)
+    {
+      rtems_libio_unlock ();
+      errno = ENOMEM;
+      return false;
+    }
+
+    sc = rtems_semaphore_create (rtems_build_name ('R', 'T', 'A', 'L'),
+                                 1, RTEMS_BINARY_SEMAPHORE | RTEMS_PRIORITY |
+                                 RTEMS_INHERIT_PRIORITY,
+                                 RTEMS_NO_PRIORITY, &async.lock);
+    if (sc == RTEMS_SUCCESSFUL)
+    {
+      sc = rtems_semaphore_create (rtems_build_name ('R', 'T', 'A', 'P'),
+                                   0, RTEMS_COUNTING_SEMAPHORE | RTEMS_PRIORITY,
+                                   RTEMS_NO_PRIORITY, &async.pending);
+      if (sc == RTEMS_SUCCESSFUL)
+      {
+        sc = rtems_task_create (rtems_build_name ('R', 'T', 'A', 'T'),
+                                priority,
+                                RTEMS_RTL_ASYNC_STACK,
+                                RTEMS_DEFAULT_MODES,
+                                RTEMS_DEFAULT_ATTRIBUTES | RTEMS_FLOATING_POINT,
+                                &async.task);
+        if (sc == RTEMS_SUCCESSFUL)
+        {
+          sc = rtems_task_start (async.task, rtems_rtl_async_loader, 0);
+          if (sc != RTEMS_SUCCESSFUL)
+            rtems_task_delete (async.task);
+        }
+        if (sc != RTEMS_SUCCESSFUL)
+          rtems_semaphore_delete (async.pending);
+      }
+      if (sc != RTEMS_SUCCESSFUL)
+        rtems_semaphore_delete (async.lock);
+    }
+
+    if (sc != RTEMS_SUCCESSFUL)
+    {
+      free (async.reqs);
+      async.reqs = NULL;
+      errno = ENOMEM;
+      ok = false;
+    }
+    else
+    {
+      async.priority = priority;
+      async.open = true;
+    }
+  }
+
+  rtems_libio_unlock ();
+
+  return ok;
+}
+
+bool
+rtems_rtl_async_configure (rtems_task_priority priority, size_t depth)
+{
+  bool ok = true;
+
+  rtems_libio_lock ();
+
+  if (async.open)
+  {
+    if (depth && (depth != async.depth))
+    {
+      errno = EBUSY;
+      ok = false;
+    }
+    else if (priority)
+    {
+      rtems_task_priority old;
+      if (rtems_task_set_priority (async.task, priority,
+                                   &old) != RTEMS_SUCCESSFUL)
+      {
+        errno = EINVAL;
+        ok = false;
+      }
+      else
+        async.priority = priority;
+    }
+  }
+  else
+  {
+    async.priority = priority;
+    if (depth)
+      async.depth = depth;
+  }
+
+  rtems_libio_unlock ();
+
+  return ok;
+}
+
+int
+rtems_rtl_async_load (const char*                name,
+                      int                        mode,
+                      rtems_rtl_async_callback_t callback,
+                      void*                      arg)
+{
+  rtems_rtl_async_req_t* req;
+  char*                  copy;
+  int                    id;
+
+  if (!name)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (!rtems_rtl_async_open ())
+    return -1;
+
+  /*
+   * The RTL allocator needs the RTL lock and a load holds it so the name is
+   * copied to the heap.
+   */
+  copy = strdup (name);
+  if (!copy)
+  {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  rtems_semaphore_obtain (async.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+
+  if (async.count >= async.depth)
+  {
+    rtems_semaphore_release (async.lock);
+    free (copy);
+    errno = EAGAIN;
+    return -1;
+  }
+
+  if (async.next_id == INT_MAX)
+    async.next_id = 0;
+  id = ++async.next_id;
+
+  req = &async.reqs[(async.head + async.count) % async.depth];
+  req->id = id;
+  req->name = copy;
+  req->mode = mode;
+  req->callback = callback;
+  req->arg = arg;
+  req->cancelled = false;
+
+  ++async.count;
+
+  rtems_semaphore_release (async.lock);
+
+  rtems_semaphore_release (async.pending);
+
+  return id;
+}
+
+bool
+rtems_rtl_async_cancel (int id)
+{
+  bool   found = false;
+  bool   open;
+  size_t r;
+
+  rtems_libio_lock ();
+  open = async.open;
+  rtems_libio_unlock ();
+
+  if (!open)
+  {
+    errno = ENOENT;
+    return false;
+  }
+
+  rtems_semaphore_obtain (async.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+
+  if (async.current == id)
+  {
+    async.cancelled = true;
+    found = true;
+  }
+  else
+  {
+    for (r = 0; r < async.count; ++r)
+    {
+      rtems_rtl_async_req_t* req = &async.reqs[(async.head + r) % async.depth];
+      if (req->id == id)
+      {
+        req->cancelled = true;
+        found = true;
+        break;
+      }
+    }
+  }
+
+  rtems_semaphore_release (async.lock);
+
+  if (!found)
+    errno = ENOENT;
+
+  return found;
+}
@@ -0,0 +1,105 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Asynchronous Loader.
+ *
+ * The asynchronous loader queues loads to a loader task so the caller does
+ * not block while an object file loads. The loader task loads the queued
+ * object files in order and calls each request's callback from the loader
+ * task once the load completes, fails or is cancelled. The object file's
+ * constructors run in the loader task.
+ *
+ * The queue is bounded and does not use the RTL lock so a request can be
+ * queued or cancelled while an object file is loading. The loader task is
+ * created by the first request and is not deleted.
+ */
+
+#if !defined (_RTEMS_RTL_ASYNC_H_)
+#define _RTEMS_RTL_ASYNC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <rtems.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The default number of requests that can be queued.
+ */
+#define RTEMS_RTL_ASYNC_DEPTH (16)
+
+/**
+ * The loader task's stack size.
+ */
+#define RTEMS_RTL_ASYNC_STACK (RTEMS_MINIMUM_STACK_SIZE * 4)
+
+/**
+ * The completion callback. The handle is the handle dlopen returns. If the
+ * load failed or was cancelled the handle is NULL and the error is the
+ * reason.
+ *
+ * @param handle The object file's handle. NULL if not loaded.
+ * @param error The error message. NULL if loaded.
+ * @param arg The user argument passed with the request.
+ */
+typedef void (*rtems_rtl_async_callback_t) (void*       handle,
+                                            const char* error,
+                                            void*       arg);
+
+/**
+ * Configure the loader task. The queue depth can only be set before the
+ * first request creates the loader task. The priority can be changed at any
+ * time.
+ *
+ * @param priority The loader task's priority. A 0 uses the priority of the
+ *                 task making the first request.
+ * @param depth The number of requests that can be queued. A 0 keeps the
+ *              current depth.
+ * @retval true The loader is configured.
+ * @retval false The depth cannot be changed or the priority is not valid.
+ *               The errno is set.
+ */
+bool rtems_rtl_async_configure (rtems_task_priority priority, size_t depth);
+
+/**
+ * Queue the load of an object file. The request fails if the queue is full.
+ *
+ * @param name The name of the object file. The name is copied.
+ * @param mode The mode of the load as defined by the dlopen call.
+ * @param callback The callback called when the request completes.
+ * @param arg The user argument passed to the callback.
+ * @return int The request's id. -1 if the request could not be queued and the
+ *             errno is set.
+ */
+int rtems_rtl_async_load (const char*                name,
+                          int                        mode,
+                          rtems_rtl_async_callback_t callback,
+                          void*                      arg);
+
+/**
+ * Cancel a request. A queued request is not loaded. A request being loaded is
+ * unloaded once the load completes. The callback is called with an error.
+ *
+ * @param id The request's id.
+ * @retval true The request is cancelled.
+ * @retval false The request is not queued or loading. The errno is set.
+ */
+bool rtems_rtl_async_cancel (int id);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,344 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Compression Benchmark.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fastlz.h"
+#include "rtl-comp-bench.h"
+#include "rtl-lz4.h"
+
+/**
+ * The codec types. These match the compression types of a RAP file.
+ */
+#define RTEMS_RTL_COMP_BENCH_NONE (0)
+#define RTEMS_RTL_COMP_BENCH_LZ77 (1)
+#define RTEMS_RTL_COMP_BENCH_LZ4  (2)
+
+/**
+ * A codec to benchmark.
+ */
+typedef struct rtems_rtl_comp_bench_codec_s
+{
+  const char* label;        /**< The label printed. */
+  int         compression;  /**< The type of compression. */
+  int         level;        /**< The compression level. */
+} rtems_rtl_comp_bench_codec_t;
+
+static const rtems_rtl_comp_bench_codec_t codecs[] =
+{
+  { "NONE",   RTEMS_RTL_COMP_BENCH_NONE, 0 },
+  { "LZ77-1", RTEMS_RTL_COMP_BENCH_LZ77, 1 },
+  { "LZ77-2", RTEMS_RTL_COMP_BENCH_LZ77, 2 },
+  { "LZ4B",   RTEMS_RTL_COMP_BENCH_LZ4,  0 }
+};
+
+#define RTEMS_RTL_COMP_BENCH_CODECS (sizeof (codecs) / sizeof (codecs[0]))
+
+static uint64_t
+rtems_rtl_comp_bench_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*
+ * Compress the data into a stream of blocks each with a 16 bit big endian
+ * size, the same as the stream in a RAP file.
+ */
+static size_t
+rtems_rtl_comp_bench_compress (const rtems_rtl_comp_bench_codec_t* codec,
+                               const uint8_t*                      data,
+                               size_t                              size,
+                               size_t                              block_size,
+                               uint8_t*                            stream)
+{
+  uint8_t* sp = stream;
+  size_t   offset;
+
+  for (offset = 0; offset < size; offset += block_size)
+  {
+    size_t length = size - offset;
+    int    out;
+
+    if (length > block_size)
+      length = block_size;
+
+    switch (codec->compression)
+    {
+      case RTEMS_RTL_COMP_BENCH_NONE:
+      default:
+        memcpy (sp + 2, data + offset, length);
+        out = length;
+        break;
+      case RTEMS_RTL_COMP_BENCH_LZ77:
+        out = fastlz_compress_level (codec->level, data + offset, length, sp + 2);
+        break;
+      case RTEMS_RTL_COMP_BENCH_LZ4:
+        out = rtems_rtl_lz4_compress (data + offset, length, sp + 2);
+        break;
+    }
+
+    sp[0] = (out >> 8) & 0xff;
+    sp[1] = out & 0xff;
+    sp += out + 2;
+  }
+
+  return sp - stream;
+}
+
+/*
+ * Decompress the stream. Returns the size of the output or 0 if a block is
+ * corrupt.
+ */
+static size_t
+rtems_rtl_comp_bench_decompress (const rtems_rtl_comp_bench_codec_t* codec,
+                                 const uint8_t*                      stream,
+                                 size_t                              stream_size,
+                                 uint8_t*                            output,
+                                 size_t                              size)
+{
+  const uint8_t* sp = stream;
+  const uint8_t* send = stream + stream_size;
+  uint8_t*       op = output;
+
+  while (sp < send)
+  {
+    size_t block = (sp[0] << 8) | sp[1];
+    int    out;
+
+    sp += 2;
+
+    switch (codec->compression)
+    {
+      case RTEMS_RTL_COMP_BENCH_NONE:
+      default:
+        memcpy (op, sp, block);
+        out = block;
+        break;
+      case RTEMS_RTL_COMP_BENCH_LZ77:
+        out = fastlz_decompress (sp, block, op, size - (op - output));
+        break;
+      case RTEMS_RTL_COMP_BENCH_LZ4:
+        out = rtems_rtl_lz4_decompress (sp, block, op, size - (op - output));
+        break;
+    }
+
+    if (out == 0)
+      return 0;
+
+    sp += block;
+    op += out;
+  }
+
+  return op - output;
+}
+
+static uint8_t*
+rtems_rtl_comp_bench_load (const char* name, size_t* size)
+{
+  FILE*    file;
+  uint8_t* data;
+  long     length;
+
+  file = fopen (name, "rb");
+  if (!file)
+  {
+    printf ("error: cannot open: %s\n", name);
+    return NULL;
+  }
+
+  if ((fseek (file, 0, SEEK_END) != 0) ||
+      ((length = ftell (file)) <= 0) ||
+      (fseek (file, 0, SEEK_SET) != 0))
+  {
+    printf ("error: cannot size: %s\n", name);
+    fclose (file);
+    return NULL;
+  }
+
+  data = malloc (length);
+  if (!data)
+  {
+    printf ("error: no memory for the file: %s\n", name);
+    fclose (file);
+    return NULL;
+  }
+
+  if (fread (data, 1, length, file) != length)
+  {
+    printf ("error: cannot read: %s\n", name);
+    free (data);
+    fclose (file);
+    return NULL;
+  }
+
+  fclose (file);
+
+  *size = length;
+
+  return data;
+}
+
+bool
+rtems_rtl_comp_bench (const char* name, size_t block_size, int runs)
+{
+  uint8_t* data;
+  uint8_t* stream;
+  uint8_t* output;
+  size_t   size = 0;
+  size_t   c;
+
+  if ((block_size < 16) || (block_size > RTEMS_RTL_COMP_BENCH_BLOCK_MAX))
+  {
+    printf ("error: invalid block size: %zu\n", block_size);
+    return false;
+  }
+
+  if (runs < 1)
+    runs = 1;
+
+  data = rtems_rtl_comp_bench_load (name, &size);
+  if (!data)
+    return false;
+
+  /*
+   * Room for the worst case of every codec.
+   */
+  stream = malloc (RTEMS_RTL_LZ4_BOUND (size) + (size / 16) +
+                   (((size / block_size) + 1) * 80));
+  output = malloc (size);
+  if (!stream || !output)
+  {
+    printf ("error: no memory for the benchmark\n");
+    free (output);
+    free (stream);
+    free (data);
+    return false;
+  }
+
+  printf ("%s: size=%zu block=%zu runs=%d\n", name, size, block_size, runs);
+  printf (" %-8s %10s %6s %10s %10s\n",
+          "codec", "stream", "ratio", "ns/block", "MB/s");
+
+  for (c = 0; c < RTEMS_RTL_COMP_BENCH_CODECS; ++c)
+  {
+    const rtems_rtl_comp_bench_codec_t* codec = &codecs[c];
+    size_t                              stream_size;
+    size_t                              blocks;
+    uint64_t                            start;
+    uint64_t                            ns;
+    uint64_t                            rate;
+    int                                 run;
+
+    stream_size = rtems_rtl_comp_bench_compress (codec, data, size,
+                                                 block_size, stream);
+
+    memset (output, 0, size);
+
+    if ((rtems_rtl_comp_bench_decompress (codec, stream, stream_size,
+                                          output, size) != size) ||
+        (memcmp (data, output, size) != 0))
+    {
+      printf ("error: %s: decompressed data does not match\n", codec->label);
+      free (output);
+      free (stream);
+      free (data);
+      return false;
+    }
+
+    start = rtems_rtl_comp_bench_now ();
+    for (run = 0; run < runs; ++run)
+      rtems_rtl_comp_bench_decompress (codec, stream, stream_size,
+                                       output, size);
+    ns = rtems_rtl_comp_bench_now () - start;
+    if (ns == 0)
+      ns = 1;
+
+    blocks = (size + block_size - 1) / block_size;
+
+    /*
+     * Bytes per nanosecond times 1000 is MB/s, times 10 for one decimal place.
+     */
+    rate = ((uint64_t) size * runs * 10000ULL) / ns;
+
+    printf (" %-8s %10zu %5zu%% %10llu %6llu.%llu\n",
+            codec->label, stream_size, (stream_size * 100) / size,
+            (unsigned long long) (ns / ((uint64_t) runs * blocks)),
+            (unsigned long long) (rate / 10),
+            (unsigned long long) (rate % 10));
+  }
+
+  free (output);
+  free (stream);
+  free (data);
+
+  return true;
+}
+
+#if RTEMS_RTL_COMP_BENCH_MAIN
+/*
+ * A host build of the benchmark:
+ *
+ *  cc -O2 -DRTEMS_RTL_COMP_BENCH_MAIN=1 -I. -o rtl-comp-bench \
+ *     rtl-comp-bench.c rtl-lz4.c fastlz.c
+ *
+ * Define FASTLZ_STRICT_ALIGN to benchmark the decoders a strict alignment
+ * target runs.
+ */
+int
+main (int argc, char* argv[])
+{
+  size_t block_size = RTEMS_RTL_COMP_BENCH_BLOCK;
+  int    runs = RTEMS_RTL_COMP_BENCH_RUNS;
+  int    arg;
+  bool   ok = true;
+
+  for (arg = 1; arg < argc; ++arg)
+  {
+    if ((argv[arg][0] == '-') && ((arg + 1) < argc))
+    {
+      switch (argv[arg][1])
+      {
+        case 'b':
+          block_size = strtoul (argv[++arg], NULL, 0);
+          continue;
+        case 'r':
+          runs = strtol (argv[++arg], NULL, 0);
+          continue;
+        default:
+          break;
+      }
+    }
+    if (argv[arg][0] == '-')
+    {
+      printf ("usage: %s [-b block] [-r runs] file ...\n", argv[0]);
+      return 1;
+    }
+    if (!rtems_rtl_comp_bench (argv[arg], block_size, runs))
+      ok = false;
+  }
+
+  return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,64 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Compression Benchmark.
+ *
+ * Compress a file the way a RAP file's stream is compressed using each of the
+ * codecs the loader supports, then time decompressing the stream. The
+ * compression ratio and decode speed of each codec are printed. The benchmark
+ * only uses standard C so it can be built for the host as well as the target.
+ */
+
+#if !defined (_RTEMS_RTL_COMP_BENCH_H_)
+#define _RTEMS_RTL_COMP_BENCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The default block size. This is the size of the loader's decompression
+ * buffer.
+ */
+#define RTEMS_RTL_COMP_BENCH_BLOCK (2048)
+
+/**
+ * The largest block size. The compressed size of a block has to fit in the
+ * 16 bit block size field.
+ */
+#define RTEMS_RTL_COMP_BENCH_BLOCK_MAX (32768)
+
+/**
+ * The default number of decode runs.
+ */
+#define RTEMS_RTL_COMP_BENCH_RUNS (10)
+
+/**
+ * Benchmark the codecs on a file.
+ *
+ * @param name The file to compress.
+ * @param block_size The size of the blocks the file is compressed in.
+ * @param runs The number of times the file is decoded.
+ * @retval true The benchmark ran and the output was verified.
+ * @retval false The file could not be read or a codec failed. An error
+ *               message has been printed.
+ */
+bool rtems_rtl_comp_bench (const char* name, size_t block_size, int runs);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker CRC32.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rtl-crc.h"
+
+/**
+ * The reflected CRC32 polynomial.
+ */
+#define RTEMS_RTL_CRC32_POLY (0xedb88320UL)
+
+/**
+ * The slicing tables. Table 0 is the byte at a time table and table N is the
+ * CRC of a byte followed by N zero bytes.
+ */
+static uint32_t crc_tables[8][256];
+
+void
+rtems_rtl_crc32_init (void)
+{
+  int i;
+  int t;
+
+  for (i = 0; i < 256; ++i)
+  {
+    uint32_t crc = i;
+    int      b;
+    for (b = 0; b < 8; ++b)
+      crc = (crc & 1) ? (crc >> 1) ^ RTEMS_RTL_CRC32_POLY : crc >> 1;
+    crc_tables[0][i] = crc;
+  }
+
+  for (i = 0; i < 256; ++i)
+  {
+    for (t = 1; t < 8; ++t)
+      crc_tables[t][i] = (crc_tables[t - 1][i] >> 8) ^
+        crc_tables[0][crc_tables[t - 1][i] & 0xff];
+  }
+}
+
+uint32_t
+rtems_rtl_crc32 (uint32_t crc, const void* data, size_t length)
+{
+  const uint8_t* p = data;
+
+  crc = ~crc;
+
+  /*
+   * The bytes are combined in order so the result does not depend on the
+   * target's byte order or alignment.
+   */
+  while (length >= 8)
+  {
+    uint32_t one = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) |
+                          ((uint32_t) p[3] << 24));
+    crc = crc_tables[7][one & 0xff] ^
+      crc_tables[6][(one >> 8) & 0xff] ^
+      crc_tables[5][(one >> 16) & 0xff] ^
+      crc_tables[4][one >> 24] ^
+      crc_tables[3][p[4]] ^
+      crc_tables[2][p[5]] ^
+      crc_tables[1][p[6]] ^
+      crc_tables[0][p[7]];
+    p += 8;
+    length -= 8;
+  }
+
+  while (length--)
+    crc = (crc >> 8) ^ crc_tables[0][(crc ^ *p++) & 0xff];
+
+  return ~crc;
+}
@@ -0,0 +1,51 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker CRC32.
+ *
+ * The CRC32 used by zip and ethernet. The CRC is calculated 8 bytes at a time
+ * with 8 tables so the checksum of data as it is loaded adds little to the
+ * load time. The code only uses standard C so host tools can use it.
+ */
+
+#if !defined (_RTEMS_RTL_CRC_H_)
+#define _RTEMS_RTL_CRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Create the CRC32 tables. The tables must be created once before a CRC is
+ * calculated. The RTL creates them when its data is initialised.
+ */
+void rtems_rtl_crc32_init (void);
+
+/**
+ * Update a CRC32 with data. The CRC of data in pieces is the same as the CRC
+ * of the data in one piece. The CRC of no data is 0.
+ *
+ * @param crc The CRC of the data so far. Use 0 to start.
+ * @param data The data.
+ * @param length The length of the data.
+ * @return uint32_t The CRC including the data.
+ */
+uint32_t rtems_rtl_crc32 (uint32_t crc, const void* data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,1037 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker ELF Digest Cache.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <rtl.h>
+#include "rtl-crc.h"
+#include "rtl-digest.h"
+#include "rtl-elf.h"
+#include "rtl-error.h"
+#include "rtl-string.h"
+#include "rtl-trace.h"
+
+/**
+ * The maximum size of a digest cache file path.
+ */
+#define RTEMS_RTL_DIGEST_PATH_MAX (256)
+
+/**
+ * The source check at the start of a digest. It is the content hash and CRC32
+ * of the ELF object file the digest is transcoded from.
+ */
+#define RTEMS_RTL_DIGEST_SOURCE "ELF,%08lx,%08lx\n"
+
+/**
+ * The RAP file version and version 2 flags of a digest. The relocation
+ * records are compact and the symbols have their hashes. The flags are the
+ * RAP loader's.
+ */
+#define RTEMS_RTL_DIGEST_VERSION (2)
+#define RTEMS_RTL_DIGEST_FLAGS   ((1 << 0) | (1 << 1))
+
+/**
+ * The RAP sections in the order the RAP loader adds them.
+ */
+#define RTEMS_RTL_DIGEST_TEXT_SEC  (0)
+#define RTEMS_RTL_DIGEST_CONST_SEC (1)
+#define RTEMS_RTL_DIGEST_CTOR_SEC  (2)
+#define RTEMS_RTL_DIGEST_DTOR_SEC  (3)
+#define RTEMS_RTL_DIGEST_DATA_SEC  (4)
+#define RTEMS_RTL_DIGEST_BSS_SEC   (5)
+#define RTEMS_RTL_DIGEST_SECS      (6)
+
+/**
+ * The sections with data in the file. The bss has no data.
+ */
+#define RTEMS_RTL_DIGEST_DATA_SECS (5)
+
+/**
+ * The block index section of the header and tail blocks.
+ */
+#define RTEMS_RTL_DIGEST_NO_SEC (0xffffffffUL)
+
+/**
+ * The size of a block. The header and tail are read through the loader's
+ * stream so their blocks cannot be bigger than the decompressor's buffer. The
+ * section blocks are the same size.
+ */
+#define RTEMS_RTL_DIGEST_BLOCK (2048)
+
+/**
+ * The size of the big endian compressed size before each block.
+ */
+#define RTEMS_RTL_DIGEST_BLOCK_PREFIX (2)
+
+/**
+ * The size of the header at the start of the stream.
+ */
+#define RTEMS_RTL_DIGEST_HEADER_SIZE \
+  ((8 + (2 * RTEMS_RTL_DIGEST_SECS)) * sizeof (uint32_t))
+
+/**
+ * The first size of a growing buffer.
+ */
+#define RTEMS_RTL_DIGEST_BUF_SIZE (256)
+
+/**
+ * A buffer that grows as data is appended.
+ */
+typedef struct rtems_rtl_digest_buf_s
+{
+  uint8_t* data;   /**< The data. */
+  size_t   size;   /**< The size of the data. */
+  size_t   space;  /**< The size of the buffer. */
+} rtems_rtl_digest_buf_t;
+
+/**
+ * Where an ELF section is placed in the digest.
+ */
+typedef struct rtems_rtl_digest_map_s
+{
+  int      rap;     /**< The RAP section or -1 if not in the digest. */
+  uint32_t offset;  /**< The offset in the RAP section. */
+} rtems_rtl_digest_map_t;
+
+/**
+ * The transcoder's state. It is allocated as the block buffer is too big for
+ * a loader's stack.
+ */
+typedef struct rtems_rtl_digest_s
+{
+  rtems_rtl_obj_t*        obj;        /**< The object file. */
+  int                     fd;         /**< The object file's descriptor. */
+  int                     out;        /**< The digest's descriptor. */
+  uint32_t                machinetype; /**< The ELF machine type. */
+  uint32_t                datatype;   /**< The ELF data type. */
+  uint32_t                class;      /**< The ELF class. */
+  rtems_rtl_obj_sect_t*   symsect;    /**< The ELF symbol table. */
+  rtems_rtl_obj_sect_t*   strsect;    /**< The ELF string table. */
+  rtems_rtl_digest_map_t* map;        /**< The ELF sections indexed by the
+                                       *   section index. */
+  uint32_t                sections;   /**< The size of the section map. */
+  uint32_t*               names;      /**< The string table offset of each ELF
+                                       *   symbol's name. 0 is not added. */
+  uint32_t                symbols;    /**< The number of ELF symbols. */
+  uint32_t                sizes[RTEMS_RTL_DIGEST_SECS];      /**< The RAP
+                                                             *   section sizes. */
+  uint32_t                alignments[RTEMS_RTL_DIGEST_SECS]; /**< The RAP
+                                                             *   section
+                                                             *   alignments. */
+  rtems_rtl_digest_buf_t  strtab;     /**< The RAP string table. */
+  rtems_rtl_digest_buf_t  symtab;     /**< The RAP symbol records. */
+  rtems_rtl_digest_buf_t  relocs;     /**< The RAP relocation records. */
+  rtems_rtl_digest_buf_t  scratch;    /**< The block index and header. */
+  uint32_t                crc;        /**< The CRC32 of the stream. */
+  size_t                  fill;       /**< The data in the block buffer. */
+  uint8_t                 block[RTEMS_RTL_DIGEST_BLOCK_PREFIX +
+                                RTEMS_RTL_DIGEST_BLOCK]; /**< The block being
+                                                          *   written. */
+} rtems_rtl_digest_t;
+
+/*
+ * The digest's name is made from the object file's modification time, offset
+ * and size so a digest is found without reading the object file.
+ */
+static bool
+rtems_rtl_digest_filename (rtems_rtl_obj_t* obj,
+                           int              fd,
+                           char*            name,
+                           size_t           size)
+{
+  const char* path = rtems_rtl_data ()->digest;
+  struct stat sb;
+  int         len;
+  if (!path || (fstat (fd, &sb) != 0))
+    return false;
+  len = snprintf (name, size, "%s/%08lx-%08lx-%08lx.rap",
+                  path, (unsigned long) sb.st_mtime,
+                  (unsigned long) obj->ooffset, (unsigned long) obj->fsize);
+  return (len > 0) && (len < size);
+}
+
+/*
+ * The source check of the object file. The content must be hashed.
+ */
+static bool
+rtems_rtl_digest_source (rtems_rtl_obj_t* obj, char* line, size_t size)
+{
+  int len;
+  len = snprintf (line, size, RTEMS_RTL_DIGEST_SOURCE,
+                  (unsigned long) obj->content_hash,
+                  (unsigned long) obj->content_crc);
+  return len == RTEMS_RTL_DIGEST_SOURCE_SIZE;
+}
+
+bool
+rtems_rtl_digest_path (const char* path)
+{
+  rtems_rtl_data_t* rtl;
+  char*             digest = NULL;
+
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+  {
+    rtems_rtl_set_error (EINVAL, "digest path cannot lock rtl");
+    return false;
+  }
+
+  if (path)
+  {
+    digest = rtems_rtl_strdup (path);
+    if (!digest)
+    {
+      rtems_rtl_set_error (ENOMEM, "no memory for digest path");
+      rtems_rtl_unlock ();
+      return false;
+    }
+  }
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) rtl->digest);
+  rtl->digest = digest;
+
+  rtems_rtl_unlock ();
+
+  return true;
+}
+
+int
+rtems_rtl_digest_open (rtems_rtl_obj_t* obj, int fd)
+{
+  char name[RTEMS_RTL_DIGEST_PATH_MAX];
+  char source[RTEMS_RTL_DIGEST_SOURCE_SIZE + 1];
+  char check[RTEMS_RTL_DIGEST_SOURCE_SIZE];
+  int  dfd;
+
+  if (!rtems_rtl_data ()->digest ||
+      ((obj->flags & RTEMS_RTL_OBJ_STREAM) != 0) ||
+      !rtems_rtl_elf_file_check (obj, fd) ||
+      !rtems_rtl_digest_filename (obj, fd, name, sizeof (name)))
+    return -1;
+
+  dfd = open (name, O_RDONLY);
+  if (dfd < 0)
+    return -1;
+
+  /*
+   * The object file is only read to check its content if there is a digest
+   * with its name.
+   */
+  if ((read (dfd, check, sizeof (check)) != sizeof (check)) ||
+      !rtems_rtl_obj_content_hash (obj, fd) ||
+      !rtems_rtl_digest_source (obj, source, sizeof (source)) ||
+      (memcmp (check, source, sizeof (check)) != 0))
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: digest: stale: %s in %s\n",
+              rtems_rtl_obj_oname (obj), name);
+    close (dfd);
+    return -1;
+  }
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: digest: found: %s in %s\n", rtems_rtl_obj_oname (obj), name);
+
+  return dfd;
+}
+
+static bool
+rtems_rtl_digest_buf_append (rtems_rtl_digest_buf_t* buf,
+                             const void*             data,
+                             size_t                  size)
+{
+  if ((buf->size + size) > buf->space)
+  {
+    size_t   space = buf->space ? buf->space : RTEMS_RTL_DIGEST_BUF_SIZE;
+    uint8_t* bigger;
+    while (space < (buf->size + size))
+      space *= 2;
+    bigger = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, space, false);
+    if (!bigger)
+      return false;
+    if (buf->size)
+      memcpy (bigger, buf->data, buf->size);
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, buf->data);
+    buf->data = bigger;
+    buf->space = space;
+  }
+  memcpy (buf->data + buf->size, data, size);
+  buf->size += size;
+  return true;
+}
+
+static bool
+rtems_rtl_digest_buf_uint32 (rtems_rtl_digest_buf_t* buf, uint32_t value)
+{
+  uint8_t bytes[sizeof (uint32_t)];
+  bytes[0] = (value >> 24) & 0xff;
+  bytes[1] = (value >> 16) & 0xff;
+  bytes[2] = (value >> 8) & 0xff;
+  bytes[3] = value & 0xff;
+  return rtems_rtl_digest_buf_append (buf, bytes, sizeof (bytes));
+}
+
+static bool
+rtems_rtl_digest_buf_varint (rtems_rtl_digest_buf_t* buf, uint32_t value)
+{
+  uint8_t bytes[5];
+  size_t  size = 0;
+  do
+  {
+    bytes[size] = value & 0x7f;
+    value >>= 7;
+    if (value)
+      bytes[size] |= 0x80;
+    ++size;
+  } while (value);
+  return rtems_rtl_digest_buf_append (buf, bytes, size);
+}
+
+static bool
+rtems_rtl_digest_buf_svarint (rtems_rtl_digest_buf_t* buf, uint32_t value)
+{
+  return rtems_rtl_digest_buf_varint (buf, (value << 1) ^ -(value >> 31));
+}
+
+static void
+rtems_rtl_digest_buf_free (rtems_rtl_digest_buf_t* buf)
+{
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, buf->data);
+  buf->data = NULL;
+  buf->size = buf->space = 0;
+}
+
+static void
+rtems_rtl_digest_free (rtems_rtl_digest_t* digest)
+{
+  rtems_rtl_digest_buf_free (&digest->strtab);
+  rtems_rtl_digest_buf_free (&digest->symtab);
+  rtems_rtl_digest_buf_free (&digest->relocs);
+  rtems_rtl_digest_buf_free (&digest->scratch);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, digest->names);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, digest->map);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, digest);
+}
+
+/*
+ * Map a loaded ELF section to a RAP section. The ctor and dtor sections are
+ * checked first as they are also const or data sections.
+ */
+static int
+rtems_rtl_digest_rap_section (const rtems_rtl_obj_sect_t* sect)
+{
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_CTOR) != 0)
+    return RTEMS_RTL_DIGEST_CTOR_SEC;
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_DTOR) != 0)
+    return RTEMS_RTL_DIGEST_DTOR_SEC;
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_TEXT) != 0)
+    return RTEMS_RTL_DIGEST_TEXT_SEC;
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_CONST) != 0)
+    return RTEMS_RTL_DIGEST_CONST_SEC;
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_DATA) != 0)
+    return RTEMS_RTL_DIGEST_DATA_SEC;
+  if ((sect->flags & RTEMS_RTL_OBJ_SECT_BSS) != 0)
+    return RTEMS_RTL_DIGEST_BSS_SEC;
+  return -1;
+}
+
+/*
+ * Place the ELF sections in the RAP sections in the order they are in the
+ * file.
+ */
+static bool
+rtems_rtl_digest_map (rtems_rtl_digest_t* digest)
+{
+  rtems_rtl_obj_t*       obj = digest->obj;
+  rtems_rtl_obj_cache_t* header;
+  rtems_chain_node*      node;
+  Elf_Ehdr               ehdr;
+  int                    r;
+
+  rtems_rtl_obj_caches (&header, NULL, NULL);
+
+  if (!rtems_rtl_obj_cache_read_byval (header, digest->fd, obj->ooffset,
+                                       &ehdr, sizeof (ehdr)))
+    return false;
+
+  digest->machinetype = ehdr.e_machine;
+  digest->datatype = ehdr.e_ident[EI_DATA];
+  digest->class = ehdr.e_ident[EI_CLASS];
+
+  digest->symsect = rtems_rtl_obj_find_section (obj, ".symtab");
+  digest->strsect = rtems_rtl_obj_find_section (obj, ".strtab");
+  if (!digest->symsect || !digest->strsect)
+    return false;
+
+  digest->symbols = digest->symsect->size / sizeof (Elf_Sym);
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+    if ((sect->section >= 0) && (sect->section >= digest->sections))
+      digest->sections = sect->section + 1;
+    node = rtems_chain_next (node);
+  }
+
+  digest->map = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                     digest->sections *
+                                     sizeof (rtems_rtl_digest_map_t),
+                                     true);
+  digest->names = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                       digest->symbols * sizeof (uint32_t),
+                                       true);
+  if ((digest->sections && !digest->map) || (digest->symbols && !digest->names))
+    return false;
+
+  for (r = 0; r < digest->sections; ++r)
+    digest->map[r].rap = -1;
+
+  for (r = 0; r < RTEMS_RTL_DIGEST_SECS; ++r)
+  {
+    digest->sizes[r] = 0;
+    digest->alignments[r] = 1;
+
+    node = rtems_chain_first (&obj->sections);
+    while (!rtems_chain_is_tail (&obj->sections, node))
+    {
+      rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+      if ((sect->section >= 0) && (rtems_rtl_digest_rap_section (sect) == r))
+      {
+        rtems_rtl_digest_map_t* map = &digest->map[sect->section];
+        uint32_t                alignment = sect->alignment ? sect->alignment : 1;
+        if ((alignment & (alignment - 1)) != 0)
+          return false;
+        map->rap = r;
+        map->offset = (digest->sizes[r] + alignment - 1) & ~(alignment - 1);
+        digest->sizes[r] = map->offset + sect->size;
+        if (alignment > digest->alignments[r])
+          digest->alignments[r] = alignment;
+      }
+      node = rtems_chain_next (node);
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Add an ELF symbol's name to the string table once. The string table starts
+ * with an empty name so an offset of 0 means the name has not been added. A
+ * relocation that does not resolve a symbol references the empty name.
+ */
+static bool
+rtems_rtl_digest_name (rtems_rtl_digest_t* digest,
+                       uint32_t            index,
+                       const Elf_Sym*      sym,
+                       uint32_t*           offset)
+{
+  if (digest->names[index] == 0)
+  {
+    rtems_rtl_obj_cache_t* strings;
+    const char*            name;
+    size_t                 len = RTEMS_RTL_ELF_STRING_MAX;
+    off_t                  off;
+
+    rtems_rtl_obj_caches (NULL, &strings, NULL);
+
+    off = digest->obj->ooffset + digest->strsect->offset + sym->st_name;
+
+    if (!rtems_rtl_obj_cache_read (strings, digest->fd, off,
+                                   (void**) &name, &len))
+      return false;
+
+    digest->names[index] = digest->strtab.size;
+
+    if (!rtems_rtl_digest_buf_append (&digest->strtab, name, strlen (name) + 1))
+      return false;
+  }
+
+  *offset = digest->names[index];
+
+  return true;
+}
+
+static bool
+rtems_rtl_digest_read_sym (rtems_rtl_digest_t* digest,
+                           uint32_t            index,
+                           Elf_Sym*            sym)
+{
+  rtems_rtl_obj_cache_t* symbols;
+  off_t                  off;
+
+  rtems_rtl_obj_caches (&symbols, NULL, NULL);
+
+  off = digest->obj->ooffset + digest->symsect->offset + (index * sizeof (*sym));
+
+  return rtems_rtl_obj_cache_read_byval (symbols, digest->fd, off,
+                                         sym, sizeof (*sym));
+}
+
+/*
+ * The symbols the ELF loader exports as hashed symbol records.
+ */
+static bool
+rtems_rtl_digest_symbols (rtems_rtl_digest_t* digest)
+{
+  uint32_t s;
+
+  for (s = 0; s < digest->symbols; ++s)
+  {
+    Elf_Sym sym;
+
+    if (!rtems_rtl_digest_read_sym (digest, s, &sym))
+      return false;
+
+    if (((ELF_ST_TYPE (sym.st_info) == STT_OBJECT) ||
+         (ELF_ST_TYPE (sym.st_info) == STT_FUNC)) &&
+        ((ELF_ST_BIND (sym.st_info) == STB_GLOBAL) ||
+         (ELF_ST_BIND (sym.st_info) == STB_WEAK)))
+    {
+      const rtems_rtl_digest_map_t* map;
+      uint32_t                      name;
+
+      if ((sym.st_shndx >= digest->sections) ||
+          (digest->map[sym.st_shndx].rap < 0))
+        return false;
+
+      map = &digest->map[sym.st_shndx];
+
+      if (!rtems_rtl_digest_name (digest, s, &sym, &name))
+        return false;
+
+      if (!rtems_rtl_digest_buf_uint32 (&digest->symtab,
+                                        (map->rap << 16) | sym.st_info) ||
+          !rtems_rtl_digest_buf_uint32 (&digest->symtab, name) ||
+          !rtems_rtl_digest_buf_uint32 (&digest->symtab,
+                                        map->offset + sym.st_value) ||
+          !rtems_rtl_digest_buf_uint32 (&digest->symtab,
+                                        rtems_rtl_symbol_hash ((const char*)
+                                                               digest->strtab.data + name)))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * The RAP section the relocations in a section apply to. Relocations for
+ * sections not loaded are ignored the same as the ELF loader ignores them.
+ */
+static int
+rtems_rtl_digest_reloc_target (const rtems_rtl_digest_t*   digest,
+                               const rtems_rtl_obj_sect_t* sect)
+{
+  if ((sect->flags & (RTEMS_RTL_OBJ_SECT_REL | RTEMS_RTL_OBJ_SECT_RELA)) == 0)
+    return -1;
+  if (sect->info >= digest->sections)
+    return -1;
+  return digest->map[sect->info].rap;
+}
+
+/*
+ * Convert an ELF relocation record to a compact RAP relocation record. The
+ * record references the symbol the same way the ELF relocator does. A
+ * symbol with no type is found by name and any other symbol is section
+ * relative. The RAP relocator does not pass the symbol's type so a symbol
+ * with a processor specific type cannot be converted.
+ */
+static bool
+rtems_rtl_digest_reloc (rtems_rtl_digest_t*         digest,
+                        const rtems_rtl_obj_sect_t* sect,
+                        uint32_t                    target,
+                        bool                        is_rela,
+                        uint32_t                    record,
+                        uint32_t*                   offset)
+{
+  rtems_rtl_obj_cache_t*  relocs;
+  rtems_rtl_digest_buf_t* buf = &digest->relocs;
+  uint8_t                 relbuf[sizeof (Elf_Rela)];
+  const Elf_Rela*         rela = (const Elf_Rela*) relbuf;
+  const Elf_Rel*          rel = (const Elf_Rel*) relbuf;
+  size_t                  reloc_size;
+  Elf_Sym                 sym;
+  Elf_Word                info;
+  uint32_t                roffset;
+  uint32_t                addend;
+  uint32_t                type;
+  off_t                   off;
+
+  rtems_rtl_obj_caches (NULL, NULL, &relocs);
+
+  reloc_size = is_rela ? sizeof (Elf_Rela) : sizeof (Elf_Rel);
+
+  off = digest->obj->ooffset + sect->offset + (record * reloc_size);
+
+  if (!rtems_rtl_obj_cache_read_byval (relocs, digest->fd, off,
+                                       relbuf, reloc_size))
+    return false;
+
+  info = is_rela ? rela->r_info : rel->r_info;
+  roffset = target + (is_rela ? rela->r_offset : rel->r_offset);
+  addend = is_rela ? rela->r_addend : 0;
+  type = ELF_R_TYPE (info);
+
+  if ((ELF_R_SYM (info) >= digest->symbols) ||
+      !rtems_rtl_digest_read_sym (digest, ELF_R_SYM (info), &sym))
+    return false;
+
+  if (!rtems_rtl_elf_rel_resolve_sym (type) ||
+      (ELF_ST_TYPE (sym.st_info) == STT_NOTYPE))
+  {
+    uint32_t name = 0;
+
+    if (rtems_rtl_elf_rel_resolve_sym (type) &&
+        !rtems_rtl_digest_name (digest, ELF_R_SYM (info), &sym, &name))
+      return false;
+
+    if (!rtems_rtl_digest_buf_varint (buf, (type << 2) | 2) ||
+        !rtems_rtl_digest_buf_svarint (buf, roffset - *offset) ||
+        (is_rela && !rtems_rtl_digest_buf_svarint (buf, addend)) ||
+        !rtems_rtl_digest_buf_varint (buf, name))
+      return false;
+  }
+  else
+  {
+    const rtems_rtl_digest_map_t* map;
+
+    if ((ELF_ST_TYPE (sym.st_info) >= STT_LOPROC) ||
+        (sym.st_shndx >= digest->sections) ||
+        (digest->map[sym.st_shndx].rap < 0))
+      return false;
+
+    map = &digest->map[sym.st_shndx];
+
+    if (!rtems_rtl_digest_buf_varint (buf, type << 2) ||
+        !rtems_rtl_digest_buf_svarint (buf, roffset - *offset) ||
+        !rtems_rtl_digest_buf_varint (buf, map->rap) ||
+        !rtems_rtl_digest_buf_svarint (buf, map->offset + sym.st_value + addend))
+      return false;
+  }
+
+  *offset = roffset;
+
+  return true;
+}
+
+/*
+ * The compact relocation records of each RAP section. A RAP section's
+ * records either all have addends or none do.
+ */
+static bool
+rtems_rtl_digest_relocs (rtems_rtl_digest_t* digest)
+{
+  rtems_rtl_obj_t*  obj = digest->obj;
+  int               rela[RTEMS_RTL_DIGEST_SECS];
+  uint32_t          counts[RTEMS_RTL_DIGEST_SECS];
+  rtems_chain_node* node;
+  int               r;
+
+  for (r = 0; r < RTEMS_RTL_DIGEST_SECS; ++r)
+  {
+    rela[r] = -1;
+    counts[r] = 0;
+  }
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+    int                   is_rela;
+
+    r = rtems_rtl_digest_reloc_target (digest, sect);
+    if (r >= 0)
+    {
+      is_rela = (sect->flags & RTEMS_RTL_OBJ_SECT_RELA) != 0;
+      if (rela[r] < 0)
+        rela[r] = is_rela;
+      else if (rela[r] != is_rela)
+        return false;
+      counts[r] += sect->size / (is_rela ? sizeof (Elf_Rela) : sizeof (Elf_Rel));
+    }
+
+    node = rtems_chain_next (node);
+  }
+
+  for (r = 0; r < RTEMS_RTL_DIGEST_SECS; ++r)
+  {
+    uint32_t offset = 0;
+
+    if (!rtems_rtl_digest_buf_varint (&digest->relocs,
+                                      (counts[r] << 1) | (rela[r] > 0 ? 1 : 0)))
+      return false;
+
+    node = rtems_chain_first (&obj->sections);
+    while (!rtems_chain_is_tail (&obj->sections, node))
+    {
+      rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+
+      if (rtems_rtl_digest_reloc_target (digest, sect) == r)
+      {
+        bool     is_rela = rela[r] > 0;
+        uint32_t target = digest->map[sect->info].offset;
+        uint32_t records;
+        uint32_t record;
+
+        records = sect->size / (is_rela ? sizeof (Elf_Rela) : sizeof (Elf_Rel));
+
+        for (record = 0; record < records; ++record)
+        {
+          if (!rtems_rtl_digest_reloc (digest, sect, target, is_rela,
+                                       record, &offset))
+            return false;
+        }
+      }
+
+      node = rtems_chain_next (node);
+    }
+  }
+
+  return true;
+}
+
+static bool
+rtems_rtl_digest_write (int fd, const void* buffer, size_t size)
+{
+  const uint8_t* data = buffer;
+  while (size)
+  {
+    ssize_t w = write (fd, data, size);
+    if (w <= 0)
+      return false;
+    data += w;
+    size -= w;
+  }
+  return true;
+}
+
+/*
+ * Write the block in the buffer with its size. The data is not compressed.
+ */
+static bool
+rtems_rtl_digest_flush (rtems_rtl_digest_t* digest)
+{
+  if (digest->fill)
+  {
+    uint8_t* data = digest->block + RTEMS_RTL_DIGEST_BLOCK_PREFIX;
+    digest->block[0] = (digest->fill >> 8) & 0xff;
+    digest->block[1] = digest->fill & 0xff;
+    digest->crc = rtems_rtl_crc32 (digest->crc, data, digest->fill);
+    if (!rtems_rtl_digest_write (digest->out, digest->block,
+                                 RTEMS_RTL_DIGEST_BLOCK_PREFIX + digest->fill))
+      return false;
+    digest->fill = 0;
+  }
+  return true;
+}
+
+/*
+ * Add data to the blocks. A NULL data pointer adds zeros.
+ */
+static bool
+rtems_rtl_digest_emit (rtems_rtl_digest_t* digest, const void* data, size_t size)
+{
+  const uint8_t* in = data;
+  while (size)
+  {
+    uint8_t* out = digest->block + RTEMS_RTL_DIGEST_BLOCK_PREFIX + digest->fill;
+    size_t   len = RTEMS_RTL_DIGEST_BLOCK - digest->fill;
+    if (len > size)
+      len = size;
+    if (in)
+    {
+      memcpy (out, in, len);
+      in += len;
+    }
+    else
+      memset (out, 0, len);
+    digest->fill += len;
+    size -= len;
+    if ((digest->fill == RTEMS_RTL_DIGEST_BLOCK) && !rtems_rtl_digest_flush (digest))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Add data read from the object file to the blocks. The file is read straight
+ * into the block buffer.
+ */
+static bool
+rtems_rtl_digest_emit_file (rtems_rtl_digest_t* digest, off_t offset, size_t size)
+{
+  if (lseek (digest->fd, offset, SEEK_SET) != offset)
+    return false;
+  while (size)
+  {
+    uint8_t* out = digest->block + RTEMS_RTL_DIGEST_BLOCK_PREFIX + digest->fill;
+    size_t   len = RTEMS_RTL_DIGEST_BLOCK - digest->fill;
+    ssize_t  r;
+    if (len > size)
+      len = size;
+    r = read (digest->fd, out, len);
+    if (r <= 0)
+      return false;
+    digest->fill += r;
+    size -= r;
+    if ((digest->fill == RTEMS_RTL_DIGEST_BLOCK) && !rtems_rtl_digest_flush (digest))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Add a RAP section's data. The ELF sections are copied to their offsets and
+ * the gaps the alignment leaves are zero.
+ */
+static bool
+rtems_rtl_digest_emit_section (rtems_rtl_digest_t* digest, int r)
+{
+  rtems_rtl_obj_t*  obj = digest->obj;
+  rtems_chain_node* node;
+  uint32_t          offset = 0;
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+
+    if ((sect->section >= 0) && (digest->map[sect->section].rap == r))
+    {
+      const rtems_rtl_digest_map_t* map = &digest->map[sect->section];
+      if (!rtems_rtl_digest_emit (digest, NULL, map->offset - offset) ||
+          !rtems_rtl_digest_emit_file (digest, obj->ooffset + sect->offset,
+                                       sect->size))
+        return false;
+      offset = map->offset + sect->size;
+    }
+
+    node = rtems_chain_next (node);
+  }
+
+  return rtems_rtl_digest_flush (digest);
+}
+
+/*
+ * Write the version 2 flags and block index. The blocks are the header, the
+ * sections with data and the tail of string table, symbols and relocation
+ * records.
+ */
+static bool
+rtems_rtl_digest_index (rtems_rtl_digest_t* digest)
+{
+  rtems_rtl_digest_buf_t* buf = &digest->scratch;
+  uint32_t                sizes[RTEMS_RTL_DIGEST_DATA_SECS + 2];
+  uint32_t                sections[RTEMS_RTL_DIGEST_DATA_SECS + 2];
+  uint32_t                blocks = 0;
+  uint32_t                offset = 0;
+  int                     p;
+
+  sizes[0] = RTEMS_RTL_DIGEST_HEADER_SIZE;
+  sections[0] = RTEMS_RTL_DIGEST_NO_SEC;
+  for (p = 0; p < RTEMS_RTL_DIGEST_DATA_SECS; ++p)
+  {
+    sizes[p + 1] = digest->sizes[p];
+    sections[p + 1] = p;
+  }
+  sizes[p + 1] = digest->strtab.size + digest->symtab.size + digest->relocs.size;
+  sections[p + 1] = RTEMS_RTL_DIGEST_NO_SEC;
+
+  for (p = 0; p < (RTEMS_RTL_DIGEST_DATA_SECS + 2); ++p)
+    blocks += (sizes[p] + RTEMS_RTL_DIGEST_BLOCK - 1) / RTEMS_RTL_DIGEST_BLOCK;
+
+  buf->size = 0;
+
+  if (!rtems_rtl_digest_buf_uint32 (buf, RTEMS_RTL_DIGEST_FLAGS) ||
+      !rtems_rtl_digest_buf_uint32 (buf, blocks))
+    return false;
+
+  for (p = 0; p < (RTEMS_RTL_DIGEST_DATA_SECS + 2); ++p)
+  {
+    uint32_t soffset;
+    for (soffset = 0; soffset < sizes[p]; soffset += RTEMS_RTL_DIGEST_BLOCK)
+    {
+      uint32_t size = sizes[p] - soffset;
+      if (size > RTEMS_RTL_DIGEST_BLOCK)
+        size = RTEMS_RTL_DIGEST_BLOCK;
+      if (!rtems_rtl_digest_buf_uint32 (buf, offset) ||
+          !rtems_rtl_digest_buf_uint32 (buf, size) ||
+          !rtems_rtl_digest_buf_uint32 (buf, size) ||
+          !rtems_rtl_digest_buf_uint32 (buf, sections[p]))
+        return false;
+      offset += RTEMS_RTL_DIGEST_BLOCK_PREFIX + size;
+    }
+  }
+
+  return rtems_rtl_digest_write (digest->out, buf->data, buf->size);
+}
+
+/*
+ * Write the source check and the RAP file. The RAP header line holds the
+ * CRC32 of the stream so it is written last. Until it is written the file is
+ * not a RAP file and a digest that is partly written is not loaded.
+ */
+static bool
+rtems_rtl_digest_write_file (rtems_rtl_digest_t* digest)
+{
+  rtems_rtl_digest_buf_t* buf = &digest->scratch;
+  char                    line[64];
+  uint32_t                length;
+  int                     len;
+  int                     r;
+
+  if (!rtems_rtl_digest_source (digest->obj, line, sizeof (line)) ||
+      !rtems_rtl_digest_write (digest->out, line, RTEMS_RTL_DIGEST_SOURCE_SIZE))
+    return false;
+
+  length = RTEMS_RTL_DIGEST_HEADER_SIZE +
+    digest->strtab.size + digest->symtab.size + digest->relocs.size;
+  for (r = 0; r < RTEMS_RTL_DIGEST_DATA_SECS; ++r)
+    length += digest->sizes[r];
+
+  len = snprintf (line, sizeof (line), "RAP,%08lu,%04d,NONE,%08lx\n",
+                  (unsigned long) length, RTEMS_RTL_DIGEST_VERSION, 0UL);
+  if ((len <= 0) || (len >= sizeof (line)))
+    return false;
+
+  memset (line, 0, len);
+
+  if (!rtems_rtl_digest_write (digest->out, line, len) ||
+      !rtems_rtl_digest_index (digest))
+    return false;
+
+  /*
+   * uint32_t: machinetype, datatype, class
+   * uint32_t: init, fini, symtab_size, strtab_size, relocs_size
+   * 6 x { uint32_t: size, uint32_t: alignment }
+   */
+  buf->size = 0;
+
+  if (!rtems_rtl_digest_buf_uint32 (buf, digest->machinetype) ||
+      !rtems_rtl_digest_buf_uint32 (buf, digest->datatype) ||
+      !rtems_rtl_digest_buf_uint32 (buf, digest->class) ||
+      !rtems_rtl_digest_buf_uint32 (buf, 0) ||
+      !rtems_rtl_digest_buf_uint32 (buf, 0) ||
+      !rtems_rtl_digest_buf_uint32 (buf, digest->symtab.size) ||
+      !rtems_rtl_digest_buf_uint32 (buf, digest->strtab.size) ||
+      !rtems_rtl_digest_buf_uint32 (buf, digest->relocs.size))
+    return false;
+
+  for (r = 0; r < RTEMS_RTL_DIGEST_SECS; ++r)
+  {
+    if (!rtems_rtl_digest_buf_uint32 (buf, digest->sizes[r]) ||
+        !rtems_rtl_digest_buf_uint32 (buf, digest->alignments[r]))
+      return false;
+  }
+
+  if (!rtems_rtl_digest_emit (digest, buf->data, buf->size) ||
+      !rtems_rtl_digest_flush (digest))
+    return false;
+
+  for (r = 0; r < RTEMS_RTL_DIGEST_DATA_SECS; ++r)
+  {
+    if (!rtems_rtl_digest_emit_section (digest, r))
+      return false;
+  }
+
+  if (!rtems_rtl_digest_emit (digest, digest->strtab.data, digest->strtab.size) ||
+      !rtems_rtl_digest_emit (digest, digest->symtab.data, digest->symtab.size) ||
+      !rtems_rtl_digest_emit (digest, digest->relocs.data, digest->relocs.size) ||
+      !rtems_rtl_digest_flush (digest))
+    return false;
+
+  if (snprintf (line, sizeof (line), "RAP,%08lu,%04d,NONE,%08lx\n",
+                (unsigned long) length, RTEMS_RTL_DIGEST_VERSION,
+                (unsigned long) digest->crc) != len)
+    return false;
+
+  return (lseek (digest->out, RTEMS_RTL_DIGEST_SOURCE_SIZE,
+                SEEK_SET) == RTEMS_RTL_DIGEST_SOURCE_SIZE) &&
+    rtems_rtl_digest_write (digest->out, line, len);
+}
+
+void
+rtems_rtl_digest_store (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_digest_t* digest;
+  char                name[RTEMS_RTL_DIGEST_PATH_MAX];
+  bool                ok;
+
+  /*
+   * The RAP loader has no trampolines and does not hold unresolved externals.
+   */
+  if (obj->unresolved || (obj->tramp_brk != obj->tramp_base) ||
+      ((obj->flags & RTEMS_RTL_OBJ_STREAM) != 0) ||
+      !rtems_rtl_obj_content_hash (obj, fd) ||
+      !rtems_rtl_digest_filename (obj, fd, name, sizeof (name)))
+    return;
+
+  digest = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                sizeof (rtems_rtl_digest_t), true);
+  if (!digest)
+    return;
+
+  digest->obj = obj;
+  digest->fd = fd;
+  digest->out = -1;
+
+  if (!rtems_rtl_digest_buf_append (&digest->strtab, "", 1) ||
+      !rtems_rtl_digest_map (digest) ||
+      !rtems_rtl_digest_symbols (digest) ||
+      !rtems_rtl_digest_relocs (digest))
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: digest: cannot transcode: %s\n", rtems_rtl_obj_oname (obj));
+    rtems_rtl_digest_free (digest);
+    return;
+  }
+
+  digest->out = open (name, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (digest->out < 0)
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: digest: cannot create: %s\n", name);
+    rtems_rtl_digest_free (digest);
+    return;
+  }
+
+  ok = rtems_rtl_digest_write_file (digest);
+
+  close (digest->out);
+
+  if (!ok)
+  {
+    /*
+     * Do not leave a partial entry in the cache.
+     */
+    unlink (name);
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: digest: write failed: %s\n", name);
+  }
+  else if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: digest: stored: %s in %s\n", rtems_rtl_obj_oname (obj), name);
+
+  rtems_rtl_digest_free (digest);
+}
@@ -0,0 +1,84 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker ELF Digest Cache.
+ *
+ * The digest cache holds a RAP file transcoded from each ELF object file
+ * after it is loaded. An object file is found in the cache using its
+ * modification time, offset and size. The digest starts with the content hash
+ * and CRC32 of the object file it is transcoded from and is only loaded if
+ * they match the object file's. Later loads of the object file load the
+ * digest with the RAP loader which reads the file forward in large blocks
+ * rather than seeking around the ELF symbol and string tables. The digest holds the
+ * section images, the exported symbols with their hashes and compact
+ * relocation records so it loads and relocates the same as the ELF file.
+ *
+ * A digest that fails to load is ignored and the ELF file is loaded. The
+ * digest is replaced after the ELF file loads. Object files with unresolved
+ * externals, that use trampolines or have relocations a RAP file cannot hold
+ * are not stored.
+ */
+
+#if !defined (_RTEMS_RTL_DIGEST_H_)
+#define _RTEMS_RTL_DIGEST_H_
+
+#include <stdbool.h>
+
+#include <rtl-obj-fwd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The size of the source check at the start of a digest. The RAP file follows
+ * it.
+ */
+#define RTEMS_RTL_DIGEST_SOURCE_SIZE (22)
+
+/**
+ * Set the digest cache directory. The directory must exist. A NULL path
+ * disables the digest cache. The cache is disabled by default.
+ *
+ * @param path The digest cache directory.
+ * @retval true The digest cache path has been set.
+ * @retval false The path could not be set. The RTL error is set.
+ */
+bool rtems_rtl_digest_path (const char* path);
+
+/**
+ * Open the digest of an ELF object file. The object file's content hash is
+ * only taken if a digest is found to check the digest is for the object file.
+ * Nothing is done if the digest cache is disabled, the object file is being
+ * streamed or it is not an ELF file.
+ *
+ * @param obj The object file's descriptor.
+ * @param fd The object file's file descriptor.
+ * @return int The digest's file descriptor or -1 if there is no digest.
+ */
+int rtems_rtl_digest_open (rtems_rtl_obj_t* obj, int fd);
+
+/**
+ * Transcode the loaded ELF object file to a RAP file and store it in the
+ * digest cache. The object file's sections, symbols and relocation records
+ * are read from the file. A failure to store is not an error.
+ *
+ * @param obj The object file's descriptor.
+ * @param fd The object file's file descriptor.
+ */
+void rtems_rtl_digest_store (rtems_rtl_obj_t* obj, int fd);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -27,8 +27,10 @@
 #include <unistd.h>
 
 #include <rtl.h>
+#include "rtl-digest.h"
 #include "rtl-elf.h"
 #include "rtl-error.h"
+#include "rtl-prelink.h"
 #include "rtl-trace.h"
 #include "rtl-unresolved.h"
 
@@ -39,6 +41,11 @@
 #define REL_R_INFO   (1)
 #define REL_R_ADDEND (2)
 
+/**
+ * The number of decoded relocation records applied as a block.
+ */
+#define RTEMS_RTL_ELF_RELOC_BLOCK (16)
+
 /**
  * The ELF format signature.
  */
@@ -80,6 +87,8 @@ rtems_rtl_elf_find_symbol (rtems_rtl_obj_t* obj,
       return false;
     }
 
+    rtems_rtl_batch_resolved (symbol);
+
     *value = (Elf_Word) symbol->value;
     return true;
   }
@@ -95,6 +104,289 @@ rtems_rtl_elf_find_symbol (rtems_rtl_obj_t* obj,
   return true;
 }
 
+/*
+ * Find the lazy binding record for a symbol. The records are sorted by symbol
+ * index.
+ */
+static rtems_rtl_elf_lazy_t*
+rtems_rtl_elf_lazy_find (rtems_rtl_obj_t* obj, Elf_Word symbol)
+{
+  rtems_rtl_elf_lazy_t* table = obj->lazy_table;
+  size_t                lower = 0;
+  size_t                upper = obj->lazy_syms;
+
+  while (lower < upper)
+  {
+    size_t mid = lower + ((upper - lower) / 2);
+    if (table[mid].symbol == symbol)
+      return &table[mid];
+    if (table[mid].symbol < symbol)
+      lower = mid + 1;
+    else
+      upper = mid;
+  }
+
+  return NULL;
+}
+
+/*
+ * Create the lazy binding records for the symbols in the map. The records and
+ * the symbol names are a single allocation. The map is walked in symbol order
+ * so the records are sorted.
+ */
+static bool
+rtems_rtl_elf_lazy_table (rtems_rtl_obj_t*      obj,
+                          int                   fd,
+                          rtems_rtl_obj_sect_t* symsect,
+                          const uint8_t*        map,
+                          size_t                syms,
+                          size_t                count)
+{
+  rtems_rtl_obj_cache_t* symbols;
+  rtems_rtl_obj_cache_t* strings;
+  rtems_rtl_obj_sect_t*  strtab;
+  rtems_rtl_elf_lazy_t*  table;
+  char*                  names;
+  size_t                 names_size = 0;
+  size_t                 l;
+  int                    pass;
+
+  strtab = rtems_rtl_obj_find_section (obj, ".strtab");
+  if (!strtab)
+  {
+    rtems_rtl_set_error (EINVAL, "no .strtab section");
+    return false;
+  }
+
+  rtems_rtl_obj_caches (&symbols, &strings, NULL);
+
+  if (!symbols || !strings)
+    return false;
+
+  table = NULL;
+  names = NULL;
+
+  /*
+   * The first pass sizes the names and the second copies them.
+   */
+  for (pass = 0; pass < 2; ++pass)
+  {
+    Elf_Word symbol;
+
+    if (pass == 1)
+    {
+      table = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                   (count * sizeof (rtems_rtl_elf_lazy_t)) +
+                                   names_size,
+                                   true);
+      if (!table)
+      {
+        rtems_rtl_set_error (ENOMEM, "no memory for lazy binding table");
+        return false;
+      }
+      names = (char*) (table + count);
+    }
+
+    l = 0;
+
+    for (symbol = 0; symbol < syms; ++symbol)
+    {
+      Elf_Sym sym;
+      char*   name;
+      size_t  len;
+      off_t   off;
+
+      if ((map[symbol / 8] & (1 << (symbol % 8))) == 0)
+        continue;
+
+      off = obj->ooffset + symsect->offset + (symbol * sizeof (sym));
+
+      if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
+                                           &sym, sizeof (sym)))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, table);
+        return false;
+      }
+
+      off = obj->ooffset + strtab->offset + sym.st_name;
+      len = RTEMS_RTL_ELF_STRING_MAX;
+
+      if (!rtems_rtl_obj_cache_read (strings, fd, off, (void**) &name, &len))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, table);
+        return false;
+      }
+
+      len = strnlen (name, len) + 1;
+
+      if (pass == 0)
+        names_size += len;
+      else
+      {
+        memcpy (names, name, len - 1);
+        names[len - 1] = '\0';
+        table[l].obj = obj;
+        table[l].name = names;
+        table[l].symbol = symbol;
+        names += len;
+      }
+
+      ++l;
+    }
+  }
+
+  obj->lazy_table = table;
+  obj->lazy_syms = count;
+
+  return true;
+}
+
+/*
+ * Write the lazy binding stubs. The stubs are at the start of the trampoline
+ * area in the order of the records.
+ */
+static void
+rtems_rtl_elf_lazy_stubs (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_elf_lazy_t* table = obj->lazy_table;
+  uint8_t*              stub = obj->tramp_base;
+  size_t                stub_size = rtems_rtl_elf_rel_lazy_size ();
+  size_t                l;
+
+  for (l = 0; l < obj->lazy_syms; ++l, stub += stub_size)
+    rtems_rtl_elf_rel_lazy_stub (&table[l], stub);
+
+  /*
+   * A lazy call is not relocated so a call to an object file loaded earlier
+   * in a set is noted here to order the constructors.
+   */
+  if (rtems_rtl_data ()->batch)
+    for (l = 0; l < obj->lazy_syms; ++l)
+      rtems_rtl_batch_resolved (rtems_rtl_symbol_global_find (table[l].name));
+
+  rtems_rtl_obj_sync_mark (obj, obj->tramp_base, obj->lazy_size);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: lazy: stubs: %zi at %p in %s\n",
+            obj->lazy_syms, obj->tramp_base, rtems_rtl_obj_oname (obj));
+}
+
+void*
+rtems_rtl_elf_lazy_bind (rtems_rtl_elf_lazy_t* lazy)
+{
+  rtems_rtl_obj_sym_t* symbol;
+
+  rtems_rtl_lock ();
+
+  symbol = rtems_rtl_symbol_global_find (lazy->name);
+  if (!symbol)
+  {
+    rtems_rtl_set_error (ENOENT, "lazy bind: symbol not found: %s", lazy->name);
+    rtems_rtl_unlock ();
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+      printf ("rtl: lazy: %s: symbol not found: %s\n",
+              rtems_rtl_obj_oname (lazy->obj), lazy->name);
+    rtems_fatal (RTEMS_FATAL_SOURCE_APPLICATION, RTEMS_RTL_ELF_LAZY_FATAL);
+  }
+
+  /*
+   * Another caller can bind the symbol at the same time. The store is a single
+   * word and both store the same value.
+   */
+  lazy->target = symbol->value;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: lazy: bind: %s=%p in %s\n",
+            lazy->name, lazy->target, rtems_rtl_obj_oname (lazy->obj));
+
+  rtems_rtl_unlock ();
+
+  return lazy->target;
+}
+
+/**
+ * Apply a block of decoded relocation records. The records are grouped by
+ * type with a stable sort so each run of a type is passed to the
+ * architecture's handler for that type in a single call. Types without a
+ * handler are applied a record at a time. The records in a relocation
+ * section are independent of each other so the order they are applied in
+ * does not matter.
+ */
+static bool
+rtems_rtl_elf_relocate_block (rtems_rtl_obj_t*             obj,
+                              const rtems_rtl_obj_sect_t*  targetsect,
+                              bool                         is_rela,
+                              rtems_rtl_elf_reloc_t*       relocs,
+                              size_t                       count)
+{
+  const rtems_rtl_elf_reloc_handler_t* handlers;
+  size_t                               handler_count = 0;
+  size_t                               r;
+
+  handlers = rtems_rtl_elf_reloc_handlers (is_rela, &handler_count);
+
+  for (r = 1; r < count; ++r)
+  {
+    rtems_rtl_elf_reloc_t reloc = relocs[r];
+    size_t                i = r;
+    while ((i > 0) &&
+           (ELF_R_TYPE (relocs[i - 1].info) > ELF_R_TYPE (reloc.info)))
+    {
+      relocs[i] = relocs[i - 1];
+      --i;
+    }
+    relocs[i] = reloc;
+  }
+
+  r = 0;
+  while (r < count)
+  {
+    Elf_Word type = ELF_R_TYPE (relocs[r].info);
+    size_t   run = 1;
+
+    while (((r + run) < count) && (ELF_R_TYPE (relocs[r + run].info) == type))
+      ++run;
+
+    if (handlers && (type < handler_count) && handlers[type])
+    {
+      if (!handlers[type] (obj, targetsect, &relocs[r], run))
+        return false;
+    }
+    else
+    {
+      size_t i;
+      for (i = r; i < (r + run); ++i)
+      {
+        if (is_rela)
+        {
+          Elf_Rela rela;
+          rela.r_offset = relocs[i].offset;
+          rela.r_info = relocs[i].info;
+          rela.r_addend = relocs[i].addend;
+          if (!rtems_rtl_elf_relocate_rela (obj, &rela, targetsect, NULL,
+                                            relocs[i].syminfo,
+                                            relocs[i].symvalue))
+            return false;
+        }
+        else
+        {
+          Elf_Rel rel;
+          rel.r_offset = relocs[i].offset;
+          rel.r_info = relocs[i].info;
+          if (!rtems_rtl_elf_relocate_rel (obj, &rel, targetsect, NULL,
+                                           relocs[i].syminfo,
+                                           relocs[i].symvalue))
+            return false;
+        }
+      }
+    }
+
+    r += run;
+  }
+
+  return true;
+}
+
 static bool
 rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
                          int                   fd,
@@ -107,6 +399,9 @@ rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
   rtems_rtl_obj_sect_t*  targetsect;
   rtems_rtl_obj_sect_t*  symsect;
   rtems_rtl_obj_sect_t*  strtab;
+  rtems_rtl_elf_reloc_t  block[RTEMS_RTL_ELF_RELOC_BLOCK];
+  size_t                 blocked;
+  bool                   trace;
   bool                   is_rela;
   size_t                 reloc_size;
   int                    reloc;
@@ -148,17 +443,21 @@ rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
              RTEMS_RTL_OBJ_SECT_RELA) ? true : false;
   reloc_size = is_rela ? sizeof (Elf_Rela) : sizeof (Elf_Rel);
 
+  blocked = 0;
+  trace = rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC);
+
   for (reloc = 0; reloc < (sect->size / reloc_size); ++reloc)
   {
-    uint8_t         relbuf[reloc_size];
-    const Elf_Rela* rela = (const Elf_Rela*) relbuf;
-    const Elf_Rel*  rel = (const Elf_Rel*) relbuf;
-    Elf_Sym         sym;
-    const char*     symname = NULL;
-    off_t           off;
-    Elf_Word        type;
-    Elf_Word        symvalue = 0;
-    bool            relocate;
+    uint8_t               relbuf[reloc_size];
+    const Elf_Rela*       rela = (const Elf_Rela*) relbuf;
+    const Elf_Rel*        rel = (const Elf_Rel*) relbuf;
+    Elf_Sym               sym;
+    const char*           symname = NULL;
+    off_t                 off;
+    Elf_Word              info;
+    Elf_Word              symvalue = 0;
+    rtems_rtl_elf_lazy_t* lazy;
+    bool                  relocate;
 
     off = obj->ooffset + sect->offset + (reloc * reloc_size);
 
@@ -166,12 +465,9 @@ rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
                                          &relbuf[0], reloc_size))
       return false;
 
-    if (is_rela)
-      off = (obj->ooffset + symsect->offset +
-             (ELF_R_SYM (rela->r_info) * sizeof (sym)));
-    else
-      off = (obj->ooffset + symsect->offset +
-             (ELF_R_SYM (rel->r_info) * sizeof (sym)));
+    info = is_rela ? rela->r_info : rel->r_info;
+
+    off = (obj->ooffset + symsect->offset + (ELF_R_SYM (info) * sizeof (sym)));
 
     if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
                                          &sym, sizeof (sym)))
@@ -197,14 +493,26 @@ rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
      * having unresolved externals and store the externals. The load of an
      * object after this one may provide the unresolved externals.
      */
-    if (is_rela)
-      type = ELF_R_TYPE(rela->r_info);
-    else
-      type = ELF_R_TYPE(rel->r_info);
-
     relocate = true;
 
-    if (rtems_rtl_elf_rel_resolve_sym (type))
+    /*
+     * A call to an external function in an object file bound lazily branches
+     * to the symbol's stub and the symbol is not looked up.
+     */
+    if (obj->lazy_syms &&
+        (ELF_ST_TYPE (sym.st_info) == STT_NOTYPE) &&
+        rtems_rtl_elf_rel_lazy (ELF_R_TYPE (info)))
+      lazy = rtems_rtl_elf_lazy_find (obj, ELF_R_SYM (info));
+    else
+      lazy = NULL;
+
+    if (lazy)
+    {
+      symvalue = (Elf_Word) (((uint8_t*) obj->tramp_base) +
+                             ((lazy - (rtems_rtl_elf_lazy_t*) obj->lazy_table) *
+                              rtems_rtl_elf_rel_lazy_size ()));
+    }
+    else if (rtems_rtl_elf_rel_resolve_sym (ELF_R_TYPE (info)))
     {
       if (!rtems_rtl_elf_find_symbol (obj, &sym, symname, &symvalue))
       {
@@ -240,29 +548,40 @@ rtems_rtl_elf_relocator (rtems_rtl_obj_t*      obj,
 
     if (relocate)
     {
-      if (is_rela)
+      rtems_rtl_elf_reloc_t* r = &block[blocked++];
+
+      r->offset = is_rela ? rela->r_offset : rel->r_offset;
+      r->info = info;
+      r->addend = is_rela ? rela->r_addend : 0;
+      r->symvalue = symvalue;
+      r->syminfo = sym.st_info;
+
+      if (trace)
       {
-        if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+        if (is_rela)
           printf ("rtl: rela: sym:%s(%-2d)=%08lx type:%-2d off:%08lx addend:%d\n",
-                  symname, (int) ELF_R_SYM (rela->r_info), symvalue,
-                  (int) ELF_R_TYPE (rela->r_info), rela->r_offset, (int) rela->r_addend);
-        if (!rtems_rtl_elf_relocate_rela (obj, rela, targetsect,
-                                          symname, sym.st_info, symvalue))
-          return false;
+                  symname, (int) ELF_R_SYM (info), symvalue,
+                  (int) ELF_R_TYPE (info), r->offset, (int) r->addend);
+        else
+          printf ("rtl: rel: sym:%s(%-2d)=%08lx type:%-2d off:%08lx\n",
+                  symname, (int) ELF_R_SYM (info), symvalue,
+                  (int) ELF_R_TYPE (info), r->offset);
       }
-      else
+
+      if (blocked == RTEMS_RTL_ELF_RELOC_BLOCK)
       {
-        if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-          printf ("rtl: rel: sym:%s(%-2d)=%08lx type:%-2d off:%08lx\n",
-                  symname, (int) ELF_R_SYM (rel->r_info), symvalue,
-                  (int) ELF_R_TYPE (rel->r_info), rel->r_offset);
-        if (!rtems_rtl_elf_relocate_rel (obj, rel, targetsect,
-                                         symname, sym.st_info, symvalue))
+        if (!rtems_rtl_elf_relocate_block (obj, targetsect, is_rela,
+                                           block, blocked))
           return false;
+        blocked = 0;
       }
     }
   }
 
+  if (blocked &&
+      !rtems_rtl_elf_relocate_block (obj, targetsect, is_rela, block, blocked))
+    return false;
+
   /*
    * Set the unresolved externals status if there are unresolved externals.
    */
@@ -318,6 +637,14 @@ rtems_rtl_obj_relocate_unresolved (rtems_rtl_unresolv_reloc_t* reloc,
       return false;
   }
 
+  /*
+   * The patched word is synchronized with the other fixups for the object once
+   * all the unresolved relocations have been resolved.
+   */
+  rtems_rtl_obj_sync_mark (reloc->obj,
+                           sect->base + reloc->rel[REL_R_OFFSET],
+                           sizeof (Elf_Addr));
+
   if (reloc->obj->unresolved)
   {
     --reloc->obj->unresolved;
@@ -445,7 +772,7 @@ rtems_rtl_elf_symbols (rtems_rtl_obj_t*      obj,
       if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
                                            &symbol, sizeof (symbol)))
       {
-        free (obj->global_table);
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_SYMBOL, obj->global_table);
         obj->global_table = NULL;
         obj->global_syms = 0;
         obj->global_size = 0;
@@ -467,7 +794,7 @@ rtems_rtl_elf_symbols (rtems_rtl_obj_t*      obj,
         symsect = rtems_rtl_obj_find_section_by_index (obj, symbol.st_shndx);
         if (!symsect)
         {
-          free (obj->global_table);
+          rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_SYMBOL, obj->global_table);
           obj->global_table = NULL;
           obj->global_syms = 0;
           obj->global_size = 0;
@@ -510,6 +837,12 @@ rtems_rtl_elf_loader (rtems_rtl_obj_t*      obj,
   uint8_t* base_offset;
   size_t   len;
 
+  /*
+   * A staged load reads the sections in the read stage.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_DEFER) != 0)
+    return true;
+
   if (lseek (fd, obj->ooffset + sect->offset, SEEK_SET) < 0)
   {
     rtems_rtl_set_error (errno, "section load seek failed");
@@ -534,6 +867,410 @@ rtems_rtl_elf_loader (rtems_rtl_obj_t*      obj,
   return true;
 }
 
+/*
+ * The prefixes of the sections the compiler creates for each function or
+ * object.
+ */
+static const char* const gc_prefixes[] =
+{
+  ".text.", ".rodata.", ".data.", ".bss."
+};
+
+#define RTEMS_RTL_ELF_GC_LOAD (RTEMS_RTL_OBJ_SECT_TEXT  | \
+                               RTEMS_RTL_OBJ_SECT_CONST | \
+                               RTEMS_RTL_OBJ_SECT_DATA  | \
+                               RTEMS_RTL_OBJ_SECT_BSS)
+
+/*
+ * A section is collected if the compiler created it for a function or object.
+ * Other sections can hold code or data that is reached without a relocation.
+ */
+static bool
+rtems_rtl_elf_gc_collectable (const rtems_rtl_obj_sect_t* sect)
+{
+  size_t p;
+  if ((sect->flags & (RTEMS_RTL_OBJ_SECT_CTOR | RTEMS_RTL_OBJ_SECT_DTOR)) != 0)
+    return false;
+  for (p = 0; p < (sizeof (gc_prefixes) / sizeof (gc_prefixes[0])); ++p)
+    if (strncmp (sect->name, gc_prefixes[p], strlen (gc_prefixes[p])) == 0)
+      return true;
+  return false;
+}
+
+/**
+ * Remove the loadable sections that cannot be reached. The sections that are
+ * not collectable and the sections holding exported symbols are live. The
+ * relocation records of each live section are followed and the sections of
+ * the symbols they reference are live. The sections that are not live are
+ * erased before anything is allocated so they are not allocated, loaded or
+ * relocated. Their relocation records are ignored because their target
+ * section is not found.
+ */
+static bool
+rtems_rtl_elf_gc_sections (rtems_rtl_obj_t* obj, int fd, Elf_Ehdr* ehdr)
+{
+  rtems_rtl_obj_cache_t* symbols;
+  rtems_rtl_obj_cache_t* relocs;
+  rtems_rtl_obj_sect_t*  symsect;
+  rtems_rtl_obj_sect_t** sects;
+  rtems_rtl_obj_sect_t** relsects;
+  int*                   work;
+  uint8_t*               live;
+  rtems_chain_node*      node;
+  size_t                 shnum = ehdr->e_shnum;
+  size_t                 pending = 0;
+  size_t                 removed = 0;
+  size_t                 removed_size = 0;
+  size_t                 syms;
+  int                    section;
+  int                    sym;
+
+  symsect = rtems_rtl_obj_find_section (obj, ".symtab");
+  if (!symsect || (shnum == 0))
+    return true;
+
+  rtems_rtl_obj_caches (&symbols, NULL, &relocs);
+
+  if (!symbols || !relocs)
+    return false;
+
+  /*
+   * One allocation holds the section tables, the work list and the live map.
+   */
+  sects = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                               shnum * ((2 * sizeof (rtems_rtl_obj_sect_t*)) +
+                                        sizeof (int) + sizeof (uint8_t)),
+                               true);
+  if (!sects)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for section collection");
+    return false;
+  }
+
+  relsects = sects + shnum;
+  work = (int*) (relsects + shnum);
+  live = (uint8_t*) (work + shnum);
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+    node = rtems_chain_next (node);
+    if ((sect->section < 0) || (sect->section >= shnum))
+      continue;
+    if ((sect->flags & (RTEMS_RTL_OBJ_SECT_REL | RTEMS_RTL_OBJ_SECT_RELA)) != 0)
+    {
+      if ((sect->info >= 0) && (sect->info < shnum))
+        relsects[sect->info] = sect;
+    }
+    else if ((sect->flags & RTEMS_RTL_ELF_GC_LOAD) != 0)
+    {
+      sects[sect->section] = sect;
+      if (!rtems_rtl_elf_gc_collectable (sect))
+      {
+        live[sect->section] = 1;
+        work[pending++] = sect->section;
+      }
+    }
+  }
+
+  /*
+   * The sections holding the symbols added to the global symbol table.
+   */
+  syms = symsect->size / sizeof (Elf_Sym);
+
+  for (sym = 0; sym < syms; ++sym)
+  {
+    Elf_Sym symbol;
+    off_t   off;
+
+    off = obj->ooffset + symsect->offset + (sym * sizeof (symbol));
+
+    if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
+                                         &symbol, sizeof (symbol)))
+    {
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sects);
+      return false;
+    }
+
+    if (((ELF_ST_TYPE (symbol.st_info) == STT_OBJECT) ||
+         (ELF_ST_TYPE (symbol.st_info) == STT_FUNC)) &&
+        ((ELF_ST_BIND (symbol.st_info) == STB_GLOBAL) ||
+         (ELF_ST_BIND (symbol.st_info) == STB_WEAK)) &&
+        (symbol.st_shndx < shnum) &&
+        sects[symbol.st_shndx] && !live[symbol.st_shndx])
+    {
+      live[symbol.st_shndx] = 1;
+      work[pending++] = symbol.st_shndx;
+    }
+  }
+
+  /*
+   * Follow the relocation records of the live sections.
+   */
+  while (pending)
+  {
+    rtems_rtl_obj_sect_t* sect = relsects[work[--pending]];
+    size_t                reloc_size;
+    int                   reloc;
+
+    if (!sect)
+      continue;
+
+    reloc_size = ((sect->flags & RTEMS_RTL_OBJ_SECT_RELA) ==
+                  RTEMS_RTL_OBJ_SECT_RELA) ? sizeof (Elf_Rela) : sizeof (Elf_Rel);
+
+    for (reloc = 0; reloc < (sect->size / reloc_size); ++reloc)
+    {
+      Elf_Rel  rel;
+      Elf_Sym  symbol;
+      Elf_Word index;
+      off_t    off;
+
+      /*
+       * The info field is in the same place in both record types.
+       */
+      off = obj->ooffset + sect->offset + (reloc * reloc_size);
+
+      if (!rtems_rtl_obj_cache_read_byval (relocs, fd, off,
+                                           &rel, sizeof (rel)))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sects);
+        return false;
+      }
+
+      index = ELF_R_SYM (rel.r_info);
+      if (index >= syms)
+        continue;
+
+      off = obj->ooffset + symsect->offset + (index * sizeof (symbol));
+
+      if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
+                                           &symbol, sizeof (symbol)))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sects);
+        return false;
+      }
+
+      if ((symbol.st_shndx < shnum) &&
+          sects[symbol.st_shndx] && !live[symbol.st_shndx])
+      {
+        live[symbol.st_shndx] = 1;
+        work[pending++] = symbol.st_shndx;
+      }
+    }
+  }
+
+  for (section = 0; section < shnum; ++section)
+  {
+    if (sects[section] && !live[section])
+    {
+      if (rtems_rtl_trace (RTEMS_RTL_TRACE_SECTION))
+        printf ("rtl: gc: %-2d: %s (%zi)\n",
+                section, sects[section]->name, sects[section]->size);
+      ++removed;
+      removed_size += sects[section]->size;
+      rtems_rtl_obj_erase_section (obj, sects[section]);
+    }
+  }
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sects);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: gc: removed %zi sections (%zi bytes) from %s\n",
+            removed, removed_size, rtems_rtl_obj_oname (obj));
+
+  return true;
+}
+
+/**
+ * Reserve the trampoline area. Only branches to external symbols can be out
+ * of range because the object's text is allocated as a single block. A
+ * trampoline's target is the symbol plus the branch's addend so each external
+ * symbol referenced by a branch is counted once for the addend first seen and
+ * again for each branch with a different addend. The addend of a REL record is
+ * in the instruction so the instruction is the key. The instruction is read
+ * through the symbols cache because a symbol is only read the first time it
+ * is referenced. If the object file is bound lazily each external symbol
+ * referenced by a call gets a lazy binding stub instead. The stubs are in the
+ * trampoline area so they are in range of the calls.
+ */
+static bool
+rtems_rtl_elf_tramp_reserve (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_obj_cache_t* symbols;
+  rtems_rtl_obj_cache_t* relocs;
+  rtems_rtl_obj_sect_t*  symsect;
+  rtems_chain_node*      node;
+  uint8_t*               referenced;
+  uint8_t*               lazy;
+  Elf_Word*              keys;
+  size_t                 syms;
+  size_t                 map_size;
+  size_t                 tramp_size;
+  size_t                 lazy_size = 0;
+  size_t                 tramps = 0;
+  size_t                 lazies = 0;
+
+  tramp_size = rtems_rtl_elf_rel_tramp_max_size ();
+
+  if ((obj->flags & RTEMS_RTL_OBJ_LAZY) != 0)
+    lazy_size = rtems_rtl_elf_rel_lazy_size ();
+
+  if ((tramp_size == 0) && (lazy_size == 0))
+    return true;
+
+  symsect = rtems_rtl_obj_find_section (obj, ".symtab");
+  if (!symsect)
+    return true;
+
+  rtems_rtl_obj_caches (&symbols, NULL, &relocs);
+
+  if (!symbols || !relocs)
+    return false;
+
+  syms = symsect->size / sizeof (Elf_Sym);
+  map_size = (syms / 8) + 1;
+
+  /*
+   * The addend keys of the branches, the symbols referenced by branches and by
+   * lazy calls are in one allocation. The keys are first so they are aligned.
+   */
+  keys = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                              (syms * sizeof (Elf_Word)) + (map_size * 2),
+                              true);
+  if (!keys)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for trampoline symbol map");
+    return false;
+  }
+
+  referenced = (uint8_t*) (keys + syms);
+  lazy = referenced + map_size;
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+    rtems_rtl_obj_sect_t* targetsect;
+    bool                  is_rela;
+    size_t                reloc_size;
+    int                   reloc;
+
+    node = rtems_chain_next (node);
+
+    if ((sect->flags & (RTEMS_RTL_OBJ_SECT_REL | RTEMS_RTL_OBJ_SECT_RELA)) == 0)
+      continue;
+
+    targetsect = rtems_rtl_obj_find_section_by_index (obj, sect->info);
+    if (!targetsect || ((targetsect->flags & RTEMS_RTL_OBJ_SECT_TEXT) == 0))
+      continue;
+
+    is_rela = ((sect->flags & RTEMS_RTL_OBJ_SECT_RELA) ==
+               RTEMS_RTL_OBJ_SECT_RELA) ? true : false;
+    reloc_size = is_rela ? sizeof (Elf_Rela) : sizeof (Elf_Rel);
+
+    for (reloc = 0; reloc < (sect->size / reloc_size); ++reloc)
+    {
+      Elf_Rela rela;
+      Elf_Sym  sym;
+      Elf_Word symbol;
+      Elf_Word type;
+      Elf_Word key;
+      uint8_t* map;
+      off_t    off;
+
+      /*
+       * The offset and info fields are in the same place in both record types.
+       */
+      off = obj->ooffset + sect->offset + (reloc * reloc_size);
+
+      if (!rtems_rtl_obj_cache_read_byval (relocs, fd, off,
+                                           &rela, reloc_size))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, keys);
+        return false;
+      }
+
+      type = ELF_R_TYPE (rela.r_info);
+
+      if (lazy_size && rtems_rtl_elf_rel_lazy (type))
+        map = lazy;
+      else if (tramp_size && rtems_rtl_elf_rel_tramp (type))
+        map = referenced;
+      else
+        continue;
+
+      symbol = ELF_R_SYM (rela.r_info);
+      if (symbol >= syms)
+        continue;
+
+      if (map == referenced)
+      {
+        if (is_rela)
+          key = rela.r_addend;
+        else
+        {
+          off = obj->ooffset + targetsect->offset + rela.r_offset;
+          if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
+                                               &key, sizeof (key)))
+          {
+            rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, keys);
+            return false;
+          }
+        }
+
+        if ((map[symbol / 8] & (1 << (symbol % 8))) != 0)
+        {
+          if (key != keys[symbol])
+            ++tramps;
+          continue;
+        }
+
+        keys[symbol] = key;
+      }
+      else if ((map[symbol / 8] & (1 << (symbol % 8))) != 0)
+        continue;
+
+      off = obj->ooffset + symsect->offset + (symbol * sizeof (sym));
+
+      if (!rtems_rtl_obj_cache_read_byval (symbols, fd, off,
+                                           &sym, sizeof (sym)))
+      {
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, keys);
+        return false;
+      }
+
+      if (ELF_ST_TYPE (sym.st_info) == STT_NOTYPE)
+      {
+        map[symbol / 8] |= 1 << (symbol % 8);
+        if (map == lazy)
+          ++lazies;
+        else
+          ++tramps;
+      }
+    }
+  }
+
+  if (lazies &&
+      !rtems_rtl_elf_lazy_table (obj, fd, symsect, lazy, syms, lazies))
+  {
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, keys);
+    return false;
+  }
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, keys);
+
+  obj->lazy_size = lazies * lazy_size;
+  obj->tramp_size = (tramps * tramp_size) + obj->lazy_size;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: tramp: reserve: %zi (%zi, lazy:%zi) in %s\n",
+            obj->tramp_size, tramps, lazies, rtems_rtl_obj_oname (obj));
+
+  return true;
+}
+
 static bool
 rtems_rtl_elf_parse_sections (rtems_rtl_obj_t* obj, int fd, Elf_Ehdr* ehdr)
 {
@@ -694,12 +1431,55 @@ rtems_rtl_elf_file_check (rtems_rtl_obj_t* obj, int fd)
   return true;
 }
 
+/*
+ * Link an object file once its sections have been read. The symbols are
+ * loaded and made global and the sections are relocated.
+ */
+static bool
+rtems_rtl_elf_link (rtems_rtl_obj_t* obj, int fd, Elf_Ehdr* ehdr)
+{
+  if (obj->lazy_syms)
+    rtems_rtl_elf_lazy_stubs (obj);
+
+  if (!rtems_rtl_obj_load_symbols (obj, fd, rtems_rtl_elf_symbols, ehdr))
+    return false;
+
+  /*
+   * Sections restored from the prelink cache are already relocated.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_PRELINKED) == 0)
+  {
+    if (!rtems_rtl_obj_relocate (obj, fd, rtems_rtl_elf_relocator, ehdr))
+      return false;
+
+    rtems_rtl_prelink_store (obj);
+  }
+
+  /*
+   * The digest is transcoded from the file so it can be stored if the
+   * sections were restored from the prelink cache.
+   */
+  rtems_rtl_digest_store (obj, fd);
+
+  return true;
+}
+
 bool
 rtems_rtl_elf_file_load (rtems_rtl_obj_t* obj, int fd)
 {
   rtems_rtl_obj_cache_t* header;
   Elf_Ehdr               ehdr;
 
+  /*
+   * The sections, symbols and relocation records are read in the order the
+   * file's headers reference them which needs a file that can seek.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_STREAM) != 0)
+  {
+    rtems_rtl_set_error (ESPIPE, "ELF files cannot be streamed");
+    return false;
+  }
+
   rtems_rtl_obj_caches (&header, NULL, NULL);
 
   if (!rtems_rtl_obj_cache_read_byval (header, fd, obj->ooffset,
@@ -756,20 +1536,103 @@ rtems_rtl_elf_file_load (rtems_rtl_obj_t* obj, int fd)
   if (!rtems_rtl_elf_parse_sections (obj, fd, &ehdr))
     return false;
 
+  /*
+   * Collect the unreferenced sections before the trampolines are counted and
+   * the section memory is allocated.
+   */
+  if (rtems_rtl_data ()->gc_sections &&
+      !rtems_rtl_elf_gc_sections (obj, fd, &ehdr))
+    return false;
+
   obj->entry = (void*)(uintptr_t) ehdr.e_entry;
 
-  if (!rtems_rtl_obj_load_sections (obj, fd, rtems_rtl_elf_loader, &ehdr))
+  if (!rtems_rtl_elf_tramp_reserve (obj, fd))
     return false;
 
-  if (!rtems_rtl_obj_load_symbols (obj, fd, rtems_rtl_elf_symbols, &ehdr))
+  /*
+   * The prelink key is taken before the object's symbols are added to the
+   * global symbol table.
+   */
+  if (!rtems_rtl_prelink_key (obj, fd))
     return false;
 
-  if (!rtems_rtl_obj_relocate (obj, fd, rtems_rtl_elf_relocator, &ehdr))
+  if (!rtems_rtl_obj_load_sections (obj, fd, rtems_rtl_elf_loader, &ehdr))
     return false;
 
+  /*
+   * A staged load links the object file once the sections have been read.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_DEFER) != 0)
+  {
+    obj->flags |= RTEMS_RTL_OBJ_DEFERRED;
+    return true;
+  }
+
+  return rtems_rtl_elf_link (obj, fd, &ehdr);
+}
+
+bool
+rtems_rtl_elf_file_read (rtems_rtl_obj_t* obj, int fd, int* error)
+{
+  rtems_chain_node* node;
+
+  /*
+   * Sections restored from the prelink cache are not read.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_PRELINKED) != 0)
+    return true;
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
+
+    if (((sect->flags & RTEMS_RTL_OBJ_SECT_LOAD) != 0) &&
+        sect->base && (sect->size != 0))
+    {
+      uint8_t* base = sect->base;
+      size_t   len = sect->size;
+
+      if (lseek (fd, obj->ooffset + sect->offset, SEEK_SET) < 0)
+      {
+        *error = errno;
+        return false;
+      }
+
+      while (len)
+      {
+        ssize_t r = read (fd, base, len);
+        if (r <= 0)
+        {
+          *error = r < 0 ? errno : EIO;
+          return false;
+        }
+        base += r;
+        len -= r;
+      }
+    }
+
+    node = rtems_chain_next (node);
+  }
+
   return true;
 }
 
+bool
+rtems_rtl_elf_file_link (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_obj_cache_t* header;
+  Elf_Ehdr               ehdr;
+
+  rtems_rtl_obj_caches (&header, NULL, NULL);
+
+  if (!rtems_rtl_obj_cache_read_byval (header, fd, obj->ooffset,
+                                       &ehdr, sizeof (ehdr)))
+    return false;
+
+  return rtems_rtl_elf_link (obj, fd, &ehdr);
+}
+
 rtems_rtl_loader_format_t*
 rtems_rtl_elf_file_sig (void)
 {
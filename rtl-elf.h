@@ -54,6 +54,37 @@ extern "C" {
  */
 #define RTEMS_RTL_ELF_STRING_MAX (256)
 
+/**
+ * A decoded relocation record. The relocator decodes REL and RELA records into
+ * this form with the symbol resolved so records can be grouped by type and
+ * passed in blocks to the architecture's relocation handlers.
+ */
+typedef struct rtems_rtl_elf_reloc_s
+{
+  Elf_Addr  offset;    /**< The offset in the target section. */
+  Elf_Word  info;      /**< The relocation info, symbol index and type. */
+  Elf_Sword addend;    /**< The addend, always 0 for REL records. */
+  Elf_Word  symvalue;  /**< The symbol's value if referenced. */
+  Elf_Byte  syminfo;   /**< The ELF symbol info field. */
+} rtems_rtl_elf_reloc_t;
+
+/**
+ * Architecture specific relocation type handler. The handler applies a block
+ * of relocation records all of the same type to the target section. The
+ * handler does not trace, tracing is performed by the caller.
+ *
+ * @param obj The object file being relocated.
+ * @param sect The section of the object file the relocations are for.
+ * @param relocs The decoded relocation records.
+ * @param count The number of records in the block.
+ * @retval true The relocations have been applied.
+ * @retval false A relocation could not be applied. The RTL error is set.
+ */
+typedef bool (*rtems_rtl_elf_reloc_handler_t) (rtems_rtl_obj_t*             obj,
+                                               const rtems_rtl_obj_sect_t*  sect,
+                                               const rtems_rtl_elf_reloc_t* relocs,
+                                               size_t                       count);
+
 /**
  * Architecture specific handler to check is a relocation record's type is
  * required to resolve a symbol.
@@ -64,6 +95,102 @@ extern "C" {
  */
 bool rtems_rtl_elf_rel_resolve_sym (Elf_Word type);
 
+/**
+ * Architecture specific handler to return the maximum size of a trampoline
+ * or veneer. A branch relocation that cannot reach its target is redirected
+ * to a trampoline placed after the object's text. A size of 0 means the
+ * architecture does not use trampolines.
+ *
+ * @return size_t The maximum size of a trampoline.
+ */
+size_t rtems_rtl_elf_rel_tramp_max_size (void);
+
+/**
+ * Architecture specific handler to check if a relocation record's type may
+ * need a trampoline because its displacement has a limited range.
+ *
+ * @param type The type field in the relocation record.
+ * @retval true The relocation record may need a trampoline.
+ * @retval false The relocation record never needs a trampoline.
+ */
+bool rtems_rtl_elf_rel_tramp (Elf_Word type);
+
+/**
+ * A lazy binding record. A call to an external function in an object file
+ * loaded with RTLD_LAZY branches to a stub that jumps to the record's target.
+ * The target is the architecture's lazy entry until the symbol is bound on the
+ * first call. The records are in data memory so the stubs are not modified.
+ */
+typedef struct rtems_rtl_elf_lazy_s
+{
+  void*            target;  /**< The call target. Must be first. */
+  rtems_rtl_obj_t* obj;     /**< The object file calling the symbol. */
+  const char*      name;    /**< The symbol's name. */
+  Elf_Word         symbol;  /**< The symbol's index in the symbol table. */
+} rtems_rtl_elf_lazy_t;
+
+/**
+ * The fatal error code reported with the application fatal source when a
+ * lazy binding record's symbol cannot be found.
+ */
+#define RTEMS_RTL_ELF_LAZY_FATAL rtems_build_name ('R', 'T', 'L', 'Z')
+
+/**
+ * Architecture specific handler to return the size of a lazy binding stub. A
+ * size of 0 means the architecture does not bind lazily.
+ * @return size_t The size of a lazy binding stub.
+ */
+size_t rtems_rtl_elf_rel_lazy_size (void);
+
+/**
+ * Architecture specific handler to check if a relocation record's type is a
+ * call that can be bound lazily.
+ * @param type The type field in the relocation record.
+ * @retval true The relocation record can branch to a lazy binding stub.
+ * @retval false The relocation record's symbol is resolved when loaded.
+ */
+bool rtems_rtl_elf_rel_lazy (Elf_Word type);
+
+/**
+ * Architecture specific handler to write a lazy binding stub. The stub jumps
+ * to the lazy binding record's target and the handler sets the target to the
+ * architecture's lazy entry. The entry calls @ref rtems_rtl_elf_lazy_bind
+ * with the record.
+ * @param lazy The lazy binding record.
+ * @param stub The stub's memory.
+ */
+void rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub);
+
+/**
+ * Bind a lazy binding record's symbol. The architecture's lazy entry calls
+ * this on the first call to the symbol. The symbol is found in the global
+ * symbol table and later calls branch to it directly from the stub. A call to
+ * a symbol that cannot be found is fatal as there is no way to return an
+ * error to the caller. The fatal code is @ref RTEMS_RTL_ELF_LAZY_FATAL.
+ *
+ * The RTL is locked to find the symbol. The lock cannot be taken in an
+ * interrupt and a task can block on it while another task loads an object
+ * file, so an object file called from an interrupt handler or a real-time
+ * path must be loaded with RTLD_NOW.
+ *
+ * @param lazy The lazy binding record.
+ * @return void* The symbol's address.
+ */
+void* rtems_rtl_elf_lazy_bind (rtems_rtl_elf_lazy_t* lazy);
+
+/**
+ * Architecture specific relocation handler table indexed by the relocation
+ * type. A NULL entry or a type outside the table is applied a record at a
+ * time with the architecture's REL or RELA relocation handler.
+ *
+ * @param rela True for the RELA record handlers else the REL record handlers.
+ * @param count Return the number of entries in the table.
+ * @return const rtems_rtl_elf_reloc_handler_t* The handler table. NULL if the
+ *                                              architecture has no table.
+ */
+const rtems_rtl_elf_reloc_handler_t* rtems_rtl_elf_reloc_handlers (bool    rela,
+                                                                   size_t* count);
+
 /**
  * Architecture specific relocation handler compiled in for a specific
  * architecture by the build system. The handler applies the relocation
@@ -78,7 +205,7 @@ bool rtems_rtl_elf_rel_resolve_sym (Elf_Word type);
  * @retval bool The relocation has been applied.
  * @retval bool The relocation could not be applied.
  */
-bool rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
+bool rtems_rtl_elf_relocate_rel (rtems_rtl_obj_t*            obj,
                                  const Elf_Rel*              rel,
                                  const rtems_rtl_obj_sect_t* sect,
                                  const char*                 symname,
@@ -99,7 +226,7 @@ bool rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
  * @retval bool The relocation has been applied.
  * @retval bool The relocation could not be applied.
  */
-bool rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
+bool rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*            obj,
                                   const Elf_Rela*             rela,
                                   const rtems_rtl_obj_sect_t* sect,
                                   const char*                 symname,
@@ -144,6 +271,29 @@ bool rtems_rtl_elf_file_check (rtems_rtl_obj_t* obj, int fd);
  */
 bool rtems_rtl_elf_file_load (rtems_rtl_obj_t* obj, int fd);
 
+/**
+ * Read the sections of an object file whose load was deferred. The RTL is not
+ * used so a work pool worker can read the sections.
+ *
+ * @param obj The object file.
+ * @param fd The file descriptor.
+ * @param error The errno of a failure is returned here.
+ * @retval true The sections have been read.
+ * @retval false A section could not be read.
+ */
+bool rtems_rtl_elf_file_read (rtems_rtl_obj_t* obj, int fd, int* error);
+
+/**
+ * Link an object file whose load was deferred once its sections have been
+ * read. The symbols are loaded and the object file is relocated.
+ *
+ * @param obj The object file.
+ * @param fd The file descriptor.
+ * @retval true The object file is linked.
+ * @retval false The link failed. The RTL error has been set.
+ */
+bool rtems_rtl_elf_file_link (rtems_rtl_obj_t* obj, int fd);
+
 /**
  * The ELF format signature handler.
  *
@@ -18,11 +18,15 @@
 #endif
 
 #include <errno.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include <rtems/libio_.h>
 
@@ -30,12 +34,234 @@
 #include "rtl-find-file.h"
 #include "rtl-error.h"
 #include "rtl-string.h"
+#include "rtl-sym.h"
 #include "rtl-trace.h"
 
 #if WAF_BUILD
 #define rtems_filesystem_is_delimiter rtems_filesystem_is_separator
 #endif
 
+/**
+ * The number of directory listings held in the cache. The oldest is dropped
+ * when a new listing is read.
+ */
+#define RTEMS_RTL_FIND_FILE_DIRS (16)
+
+/**
+ * A directory listing hash table slot. The name is the offset of the name in
+ * the listing. A 0 is an empty slot.
+ */
+typedef struct
+{
+  uint32_t hash; /**< The hash of the name. */
+  uint32_t name; /**< The offset of the name. */
+} rtems_rtl_find_slot_t;
+
+/**
+ * A cached directory listing. A directory that does not exist has an empty
+ * listing so a search path with a missing directory does not stat it.
+ */
+typedef struct
+{
+  rtems_chain_node       node;     /**< The cache's chain node. */
+  bool                   exists;   /**< The directory exists. */
+  time_t                 mtime;    /**< The directory's modification time. */
+  bool                   racy;     /**< Listed in the mtime's second. */
+  size_t                 path_len; /**< The length of the directory's path. */
+  size_t                 mask;     /**< The hash table mask. */
+  rtems_rtl_find_slot_t* slots;    /**< The hash table of names. */
+  const char*            names;    /**< The path then the names. */
+} rtems_rtl_find_dir_t;
+
+static void
+rtems_rtl_find_dir_del (rtems_rtl_find_dir_t* dir)
+{
+  rtems_rtl_alloc_stats_t* owner;
+  rtems_chain_extract (&dir->node);
+  owner = rtems_rtl_alloc_owner (NULL);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, dir);
+  rtems_rtl_alloc_owner (owner);
+}
+
+/*
+ * Read a directory's listing into the cache. The names are counted then read
+ * into a single allocation. A name added between the passes is not held and
+ * the directory's mtime will not match when it is next checked. The mtime has
+ * a one second resolution so a name added in the second the listing is read
+ * does not change it. A listing read in the second of the mtime is racy and is
+ * read again when it is next checked.
+ */
+static rtems_rtl_find_dir_t*
+rtems_rtl_find_dir_read (rtems_chain_control* dirs,
+                         const char*          path,
+                         size_t               path_len)
+{
+  rtems_rtl_alloc_stats_t* owner;
+  rtems_rtl_find_dir_t*    dir;
+  struct stat              sb;
+  DIR*                     dp = NULL;
+  struct dirent*           de;
+  rtems_chain_node*        node;
+  size_t                   count = 0;
+  size_t                   size = path_len + 1;
+  size_t                   slots = 1;
+  size_t                   offset;
+  size_t                   n;
+  time_t                   now = time (NULL);
+
+  if ((stat (path, &sb) == 0) && S_ISDIR (sb.st_mode))
+  {
+    dp = opendir (path);
+    if (!dp)
+      return NULL;
+    while ((de = readdir (dp)) != NULL)
+    {
+      ++count;
+      size += strlen (de->d_name) + 1;
+    }
+    rewinddir (dp);
+  }
+
+  while (slots < (count * 2))
+    slots <<= 1;
+
+  owner = rtems_rtl_alloc_owner (NULL);
+  dir = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                             sizeof (rtems_rtl_find_dir_t) +
+                             (slots * sizeof (rtems_rtl_find_slot_t)) + size,
+                             true);
+  rtems_rtl_alloc_owner (owner);
+
+  if (!dir)
+  {
+    if (dp)
+      closedir (dp);
+    return NULL;
+  }
+
+  dir->exists = dp != NULL;
+  dir->mtime = dp ? sb.st_mtime : 0;
+  dir->racy = dp && (sb.st_mtime >= now);
+  dir->path_len = path_len;
+  dir->mask = slots - 1;
+  dir->slots = (rtems_rtl_find_slot_t*) (dir + 1);
+  dir->names = (const char*) (dir->slots + slots);
+
+  memcpy ((char*) dir->names, path, path_len);
+
+  offset = path_len + 1;
+  n = 0;
+
+  while (dp && (n < count) && ((de = readdir (dp)) != NULL))
+  {
+    size_t   len = strlen (de->d_name) + 1;
+    uint32_t hash = rtems_rtl_symbol_hash (de->d_name);
+    size_t   s;
+
+    if ((offset + len) > size)
+      break;
+
+    s = hash & dir->mask;
+    while (dir->slots[s].name)
+      s = (s + 1) & dir->mask;
+
+    memcpy ((char*) dir->names + offset, de->d_name, len);
+    dir->slots[s].hash = hash;
+    dir->slots[s].name = offset;
+
+    offset += len;
+    ++n;
+  }
+
+  if (dp)
+    closedir (dp);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: find-file: list: %s (%zu)\n", path, n);
+
+  rtems_chain_append (dirs, &dir->node);
+
+  n = 0;
+  node = rtems_chain_first (dirs);
+  while (!rtems_chain_is_tail (dirs, node))
+  {
+    ++n;
+    node = rtems_chain_next (node);
+  }
+
+  if (n > RTEMS_RTL_FIND_FILE_DIRS)
+    rtems_rtl_find_dir_del ((rtems_rtl_find_dir_t*) rtems_chain_first (dirs));
+
+  return dir;
+}
+
+/*
+ * Return the directory's listing reading it if not cached. If validate is
+ * true the directory is checked and a listing that is out of date is read
+ * again.
+ */
+static rtems_rtl_find_dir_t*
+rtems_rtl_find_dir (rtems_chain_control* dirs,
+                    const char*          path,
+                    size_t               path_len,
+                    bool                 validate)
+{
+  rtems_chain_node* node = rtems_chain_first (dirs);
+
+  while (!rtems_chain_is_tail (dirs, node))
+  {
+    rtems_rtl_find_dir_t* dir = (rtems_rtl_find_dir_t*) node;
+    if ((dir->path_len == path_len) &&
+        (memcmp (dir->names, path, path_len) == 0))
+    {
+      if (validate)
+      {
+        struct stat sb;
+        bool        exists = stat (path, &sb) == 0;
+        if ((exists != dir->exists) ||
+            (exists && (dir->racy || (sb.st_mtime != dir->mtime))))
+        {
+          rtems_rtl_find_dir_del (dir);
+          break;
+        }
+      }
+      return dir;
+    }
+    node = rtems_chain_next (node);
+  }
+
+  return rtems_rtl_find_dir_read (dirs, path, path_len);
+}
+
+static bool
+rtems_rtl_find_dir_has (rtems_rtl_find_dir_t* dir, const char* name)
+{
+  uint32_t hash = rtems_rtl_symbol_hash (name);
+  size_t   s = hash & dir->mask;
+
+  while (dir->slots[s].name)
+  {
+    if ((dir->slots[s].hash == hash) &&
+        (strcmp (dir->names + dir->slots[s].name, name) == 0))
+      return true;
+    s = (s + 1) & dir->mask;
+  }
+
+  return false;
+}
+
+void
+rtems_rtl_find_file_flush (void)
+{
+  rtems_rtl_data_t* rtl = rtems_rtl_data ();
+  if (rtl)
+  {
+    while (!rtems_chain_is_empty (&rtl->find_dirs))
+      rtems_rtl_find_dir_del (
+        (rtems_rtl_find_dir_t*) rtems_chain_first (&rtl->find_dirs));
+  }
+}
+
 bool
 rtems_rtl_find_file (const char*  name,
                      const char*  paths,
@@ -54,51 +280,111 @@ rtems_rtl_find_file (const char*  name,
   }
   else if (paths)
   {
-    const char* start;
-    const char* end;
-    int         len;
-    char*       fname;
+    rtems_rtl_data_t* rtl;
+    const char*       start;
+    const char*       end;
+    size_t            longest = 0;
+    int               len;
+    char*             fname;
+    bool              listed;
+    int               pass;
 
-    start = paths;
-    end = start + strlen (paths);
+    end = paths + strlen (paths);
     len = strlen (name);
 
-    while (!*file_name && (start != end))
+    /*
+     * Allocate the longest path fragment, separator, name, terminating nul
+     * once. The buffer is the file name returned if the file is found.
+     */
+    for (start = paths; start < end; ++start)
     {
       const char* delimiter = strchr (start, ':');
-
       if (delimiter == NULL)
         delimiter = end;
+      if ((delimiter - start) > longest)
+        longest = delimiter - start;
+      start = delimiter;
+    }
 
+    fname = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                 longest + 1 + len + 1, true);
+    if (!fname)
+    {
+      rtems_rtl_set_error (ENOMEM, "no memory searching for file");
+      return false;
+    }
+
+    /*
+     * Only an absolute path's directory is listed. A relative path depends on
+     * the task's current directory. A name with a path is looked for with
+     * stat.
+     */
+    rtl = rtems_rtl_lock ();
+
+    listed = false;
+
+    for (pass = 0; !*file_name && (pass < 2); ++pass)
+    {
       /*
-       * Allocate the path fragment, separator, name, terminating nul. Form the
-       * path then see if the stat call works.
+       * The second pass checks the listings used by the first pass are up to
+       * date and only happens if the file is not found.
        */
+      if ((pass == 1) && !listed)
+        break;
 
-      fname = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
-                                   (delimiter - start) + 1 + len + 1, true);
-      if (!fname)
+      start = paths;
+
+      while (!*file_name && (start != end))
       {
-        rtems_rtl_set_error (ENOMEM, "no memory searching for file");
-        return false;
-      }
+        const char*           delimiter = strchr (start, ':');
+        rtems_rtl_find_dir_t* dir = NULL;
+        size_t                plen;
 
-      memcpy (fname, start, delimiter - start);
-      fname[delimiter - start] = '/';
-      memcpy (fname + (delimiter - start) + 1, name, len);
+        if (delimiter == NULL)
+          delimiter = end;
 
-      if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
-        printf ("rtl: find-file: path: %s\n", fname);
+        plen = delimiter - start;
 
-      if (stat (fname, &sb) < 0)
-        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, fname);
-      else
-        *file_name = fname;
+        memcpy (fname, start, plen);
+        fname[plen] = '\0';
 
-      start = delimiter;
-      if (start != end)
-        ++start;
+        if (rtl && (plen > 0) && rtems_filesystem_is_delimiter (fname[0]) &&
+            (strchr (name, '/') == NULL))
+          dir = rtems_rtl_find_dir (&rtl->find_dirs, fname, plen, pass == 1);
+
+        start = delimiter;
+        if (start != end)
+          ++start;
+
+        if (dir)
+        {
+          listed = true;
+          if (!rtems_rtl_find_dir_has (dir, name))
+            continue;
+        }
+        else if (pass == 1)
+        {
+          continue;
+        }
+
+        fname[plen] = '/';
+        memcpy (fname + plen + 1, name, len + 1);
+
+        if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+          printf ("rtl: find-file: path: %s\n", fname);
+
+        if (stat (fname, &sb) == 0)
+          *file_name = fname;
+        else if (dir)
+          rtems_rtl_find_dir_del (dir);
+      }
     }
+
+    if (rtl)
+      rtems_rtl_unlock ();
+
+    if (!*file_name)
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, fname);
   }
 
   if (!*file_name)
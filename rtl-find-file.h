@@ -26,6 +26,11 @@ extern "C" {
 /**
  * Find a file on disk given a name and a path.
  *
+ * The listings of the absolute directories in the path are cached so a
+ * directory that does not hold the file is not searched with a stat call. A
+ * listing is checked against the directory's modification time when a file is
+ * not found and is read again if it has changed.
+ *
  * @param name The file name to find. Can be relative or absolute.
  * @param paths The paths to search.
  * @param file_name Place the full path in this location if found.
@@ -38,6 +43,14 @@ bool rtems_rtl_find_file (const char*  name,
                           const char** file_name,
                           uint32_t*    size);
 
+/**
+ * Flush the cached search path directory listings. The listings are read
+ * again when next searched.
+ *
+ * Assumes the RTL has been locked.
+ */
+void rtems_rtl_find_file_flush (void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,373 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker LZ4 Block Codec.
+ *
+ * A sequence is a token, the literals and a match. The token's upper 4 bits
+ * are the literal length and the lower 4 bits are the match length less the
+ * minimum match. A length of 15 is followed by bytes that are added to it
+ * until a byte is not 255. The match is a 16 bit little endian offset back
+ * into the output. The last sequence has literals only.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rtl-lz4.h"
+
+/**
+ * The shortest match.
+ */
+#define RTEMS_RTL_LZ4_MINMATCH (4)
+
+/**
+ * The last bytes of the input are always literals.
+ */
+#define RTEMS_RTL_LZ4_LASTLITERALS (5)
+
+/**
+ * A match cannot start in the last bytes of the input.
+ */
+#define RTEMS_RTL_LZ4_MFLIMIT (12)
+
+/**
+ * The largest offset of a match.
+ */
+#define RTEMS_RTL_LZ4_MAX_OFFSET (65535)
+
+/**
+ * The size of the compressor's hash table.
+ */
+#define RTEMS_RTL_LZ4_HASH_LOG (12)
+
+/**
+ * The amount of data copied at a time. Wide copies can write this far past the
+ * end of a copy so they are only used when there is space.
+ */
+#define RTEMS_RTL_LZ4_COPY (8)
+
+static inline uint32_t
+rtems_rtl_lz4_read32 (const uint8_t* p)
+{
+  uint32_t value;
+  memcpy (&value, p, sizeof (value));
+  return value;
+}
+
+static inline uint32_t
+rtems_rtl_lz4_hash (uint32_t value)
+{
+  return ((uint32_t) (value * 2654435761U)) >> (32 - RTEMS_RTL_LZ4_HASH_LOG);
+}
+
+/*
+ * Copy a word at a time. Can write up to RTEMS_RTL_LZ4_COPY - 1 bytes past the
+ * end. The memcpy of a constant size is a single unaligned safe load and store
+ * on targets that support it.
+ */
+static inline void
+rtems_rtl_lz4_wild_copy (uint8_t* dst, const uint8_t* src, size_t length)
+{
+  uint8_t* end = dst + length;
+  do
+  {
+    memcpy (dst, src, RTEMS_RTL_LZ4_COPY);
+    dst += RTEMS_RTL_LZ4_COPY;
+    src += RTEMS_RTL_LZ4_COPY;
+  } while (dst < end);
+}
+
+static uint8_t*
+rtems_rtl_lz4_length (uint8_t* op, size_t length)
+{
+  while (length >= 255)
+  {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = length;
+  return op;
+}
+
+static uint8_t*
+rtems_rtl_lz4_sequence (uint8_t*       op,
+                        const uint8_t* literals,
+                        size_t         literal_length,
+                        size_t         offset,
+                        size_t         match_length)
+{
+  uint8_t* token = op++;
+
+  if (literal_length >= 15)
+  {
+    *token = 15 << 4;
+    op = rtems_rtl_lz4_length (op, literal_length - 15);
+  }
+  else
+    *token = literal_length << 4;
+
+  memcpy (op, literals, literal_length);
+  op += literal_length;
+
+  if (offset)
+  {
+    *op++ = offset & 0xff;
+    *op++ = (offset >> 8) & 0xff;
+
+    if (match_length >= 15)
+    {
+      *token |= 15;
+      op = rtems_rtl_lz4_length (op, match_length - 15);
+    }
+    else
+      *token |= match_length;
+  }
+
+  return op;
+}
+
+int
+rtems_rtl_lz4_compress_prefix (const void* input,
+                               int         prefix,
+                               int         length,
+                               void*       output)
+{
+  const uint8_t* base = input;
+  const uint8_t* ip = base + prefix;
+  const uint8_t* anchor = ip;
+  const uint8_t* iend = ip + length;
+  uint8_t*       op = output;
+  int32_t        table[1 << RTEMS_RTL_LZ4_HASH_LOG];
+
+  memset (table, 0xff, sizeof (table));
+
+  /*
+   * Hash the part of the prefix a match can reach. Later positions replace
+   * earlier ones so the closest match is found.
+   */
+  if (prefix >= RTEMS_RTL_LZ4_MINMATCH)
+  {
+    const uint8_t* p = base;
+    if (prefix > RTEMS_RTL_LZ4_MAX_OFFSET)
+      p = ip - RTEMS_RTL_LZ4_MAX_OFFSET;
+    for (; p <= (ip - RTEMS_RTL_LZ4_MINMATCH); ++p)
+      table[rtems_rtl_lz4_hash (rtems_rtl_lz4_read32 (p))] = p - base;
+  }
+
+  if (length > RTEMS_RTL_LZ4_MFLIMIT)
+  {
+    const uint8_t* mflimit = iend - RTEMS_RTL_LZ4_MFLIMIT;
+    const uint8_t* matchlimit = iend - RTEMS_RTL_LZ4_LASTLITERALS;
+
+    while (ip < mflimit)
+    {
+      const uint8_t* match;
+      const uint8_t* mp;
+      const uint8_t* p;
+      uint32_t       sequence = rtems_rtl_lz4_read32 (ip);
+      uint32_t       hash = rtems_rtl_lz4_hash (sequence);
+      int32_t        ref = table[hash];
+
+      table[hash] = ip - base;
+
+      if ((ref < 0) ||
+          (((ip - base) - ref) > RTEMS_RTL_LZ4_MAX_OFFSET) ||
+          (rtems_rtl_lz4_read32 (base + ref) != sequence))
+      {
+        ++ip;
+        continue;
+      }
+
+      match = base + ref;
+
+      while ((ip > anchor) && (match > base) && (ip[-1] == match[-1]))
+      {
+        --ip;
+        --match;
+      }
+
+      p = ip + RTEMS_RTL_LZ4_MINMATCH;
+      mp = match + RTEMS_RTL_LZ4_MINMATCH;
+      while ((p < matchlimit) && (*p == *mp))
+      {
+        ++p;
+        ++mp;
+      }
+
+      op = rtems_rtl_lz4_sequence (op, anchor, ip - anchor, ip - match,
+                                   (p - ip) - RTEMS_RTL_LZ4_MINMATCH);
+
+      ip = p;
+      anchor = ip;
+    }
+  }
+
+  op = rtems_rtl_lz4_sequence (op, anchor, iend - anchor, 0, 0);
+
+  return op - (uint8_t*) output;
+}
+
+int
+rtems_rtl_lz4_compress (const void* input, int length, void* output)
+{
+  return rtems_rtl_lz4_compress_prefix (input, 0, length, output);
+}
+
+int
+rtems_rtl_lz4_decompress_dict (const void* input, int length,
+                               void* output, int maxout,
+                               const void* dict, int dict_size)
+{
+  const uint8_t* ip = input;
+  const uint8_t* iend = ip + length;
+  uint8_t*       op = output;
+  uint8_t*       oend = op + maxout;
+
+  if (length == 0)
+    return 0;
+
+  while (true)
+  {
+    const uint8_t* match;
+    size_t         len;
+    size_t         offset;
+    uint8_t        token;
+    uint8_t        b;
+
+    if (ip >= iend)
+      return 0;
+
+    token = *ip++;
+
+    len = token >> 4;
+    if (len == 15)
+    {
+      do
+      {
+        if (ip >= iend)
+          return 0;
+        b = *ip++;
+        len += b;
+      } while (b == 255);
+    }
+
+    if ((len > (iend - ip)) || (len > (oend - op)))
+      return 0;
+
+    if (len)
+    {
+      if (((iend - ip) >= (len + RTEMS_RTL_LZ4_COPY)) &&
+          ((oend - op) >= (len + RTEMS_RTL_LZ4_COPY)))
+        rtems_rtl_lz4_wild_copy (op, ip, len);
+      else
+        memcpy (op, ip, len);
+      op += len;
+      ip += len;
+    }
+
+    /*
+     * The last sequence has no match.
+     */
+    if (ip == iend)
+      break;
+
+    if ((iend - ip) < 2)
+      return 0;
+
+    offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+
+    if ((offset == 0) || (offset > ((op - (uint8_t*) output) + dict_size)))
+      return 0;
+
+    len = token & 15;
+    if (len == 15)
+    {
+      do
+      {
+        if (ip >= iend)
+          return 0;
+        b = *ip++;
+        len += b;
+      } while (b == 255);
+    }
+
+    len += RTEMS_RTL_LZ4_MINMATCH;
+
+    if (len > (oend - op))
+      return 0;
+
+    /*
+     * A match before the start of the output is in the dictionary. The match
+     * can run from the end of the dictionary into the output.
+     */
+    if (offset > (op - (uint8_t*) output))
+    {
+      size_t back = offset - (op - (uint8_t*) output);
+      size_t n = back < len ? back : len;
+      memcpy (op, (const uint8_t*) dict + dict_size - back, n);
+      op += n;
+      len -= n;
+      if (len == 0)
+        continue;
+    }
+
+    match = op - offset;
+
+    if ((oend - op) < (len + RTEMS_RTL_LZ4_COPY))
+    {
+      while (len--)
+        *op++ = *match++;
+    }
+    else
+    {
+      /*
+       * A match closer than a word repeats a short pattern. Copy the pattern
+       * a byte at a time until it is at least a word long then copy words from
+       * that far back.
+       */
+      if (offset < RTEMS_RTL_LZ4_COPY)
+      {
+        size_t step = offset;
+        size_t n;
+        while (step < RTEMS_RTL_LZ4_COPY)
+          step += offset;
+        if (step > len)
+          step = len;
+        for (n = step; n; --n)
+          *op++ = *match++;
+        len -= step;
+        match = op - step;
+      }
+      if (len)
+      {
+        rtems_rtl_lz4_wild_copy (op, match, len);
+        op += len;
+      }
+    }
+  }
+
+  return op - (uint8_t*) output;
+}
+
+int
+rtems_rtl_lz4_decompress (const void* input, int length,
+                          void* output, int maxout)
+{
+  return rtems_rtl_lz4_decompress_dict (input, length, output, maxout, NULL, 0);
+}
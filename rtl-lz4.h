@@ -0,0 +1,101 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker LZ4 Block Codec.
+ *
+ * A codec using the LZ4 block format. The token format has no control bits
+ * to decode and literals and matches are copied a word at a time so it
+ * decodes faster than FastLZ for a small loss in compression ratio.
+ */
+
+#if !defined (_RTEMS_RTL_LZ4_H_)
+#define _RTEMS_RTL_LZ4_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The worst case size of the compressed output for an input length.
+ */
+#define RTEMS_RTL_LZ4_BOUND(_l) ((_l) + ((_l) / 255) + 16)
+
+/**
+ * The largest dictionary. A match can only reach this far back so a larger
+ * dictionary is not used.
+ */
+#define RTEMS_RTL_LZ4_DICT_MAX (65535)
+
+/**
+ * Compress a block of data. The output buffer must be at least
+ * RTEMS_RTL_LZ4_BOUND of the length in size. The input and output buffers
+ * cannot overlap.
+ *
+ * @param input The data to compress.
+ * @param length The length of the data.
+ * @param output The buffer the compressed data is written to.
+ * @return int The size of the compressed data.
+ */
+int rtems_rtl_lz4_compress (const void* input, int length, void* output);
+
+/**
+ * Compress a block of data with a dictionary. The dictionary is the prefix
+ * bytes before the data in the input buffer and matches can refer back into
+ * it. The data is decompressed with the same dictionary.
+ *
+ * @param input The dictionary followed by the data to compress.
+ * @param prefix The size of the dictionary.
+ * @param length The length of the data following the dictionary.
+ * @param output The buffer the compressed data is written to.
+ * @return int The size of the compressed data.
+ */
+int rtems_rtl_lz4_compress_prefix (const void* input,
+                                   int         prefix,
+                                   int         length,
+                                   void*       output);
+
+/**
+ * Decompress a block of data. The decompression does not write past the end
+ * of the output buffer. The input and output buffers cannot overlap.
+ *
+ * @param input The compressed data.
+ * @param length The length of the compressed data.
+ * @param output The buffer the data is decompressed into.
+ * @param maxout The size of the output buffer.
+ * @return int The size of the decompressed data. If 0 the data is corrupt or
+ *             the output buffer is too small.
+ */
+int rtems_rtl_lz4_decompress (const void* input, int length,
+                              void* output, int maxout);
+
+/**
+ * Decompress a block of data compressed with a dictionary. The dictionary must
+ * be the one the block was compressed with.
+ *
+ * @param input The compressed data.
+ * @param length The length of the compressed data.
+ * @param output The buffer the data is decompressed into.
+ * @param maxout The size of the output buffer.
+ * @param dict The dictionary. Can be NULL if the size is 0.
+ * @param dict_size The size of the dictionary.
+ * @return int The size of the decompressed data. If 0 the data is corrupt, the
+ *             output buffer is too small or a match is outside the dictionary.
+ */
+int rtems_rtl_lz4_decompress_dict (const void* input, int length,
+                                   void* output, int maxout,
+                                   const void* dict, int dict_size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -46,8 +46,273 @@ rtems_rtl_elf_rel_resolve_sym (Elf_Word type)
   return true;
 }
 
+/*
+ * The ARM trampoline loads the PC from the word following the instruction:
+ *
+ *   ldr pc, [pc, #-4]
+ *   .word target
+ *
+ * The load interworks so a Thumb target with bit 0 set is supported.
+ */
+#define ARM_TRAMP_LDR_PC (0xe51ff004)
+#define ARM_TRAMP_SIZE   (2 * sizeof (uint32_t))
+
+size_t
+rtems_rtl_elf_rel_tramp_max_size (void)
+{
+  return ARM_TRAMP_SIZE;
+}
+
+bool
+rtems_rtl_elf_rel_tramp (Elf_Word type)
+{
+  return type == R_TYPE(PC24);
+}
+
+/*
+ * The ARM lazy binding stub loads the address of its record into ip and jumps
+ * to the record's target:
+ *
+ *   ldr ip, [pc, #0]
+ *   ldr pc, [ip]
+ *   .word record
+ *
+ * The target is the lazy entry until the symbol is bound. The entry is
+ * called with the caller's arguments in r0-r3 and the return address in lr.
+ * It saves them, binds the symbol and jumps to the symbol with them restored.
+ */
+#define ARM_LAZY_LDR_IP_PC (0xe59fc000)
+#define ARM_LAZY_LDR_PC_IP (0xe59cf000)
+#define ARM_LAZY_SIZE      (3 * sizeof (uint32_t))
+
+void rtems_rtl_elf_lazy_entry (void);
+
+__asm__ (
+"	.text\n"
+"	.align	2\n"
+"	.syntax	unified\n"
+"	.arm\n"
+"	.type	rtems_rtl_elf_lazy_entry, %function\n"
+"rtems_rtl_elf_lazy_entry:\n"
+"	push	{r0-r3, ip, lr}\n"
+#if defined (__ARM_PCS_VFP)
+"	vpush	{d0-d7}\n"
+#endif
+"	mov	r0, ip\n"
+"	bl	rtems_rtl_elf_lazy_bind\n"
+"	mov	ip, r0\n"
+#if defined (__ARM_PCS_VFP)
+"	vpop	{d0-d7}\n"
+#endif
+"	pop	{r0-r3}\n"
+"	ldr	lr, [sp, #4]\n"
+"	add	sp, sp, #8\n"
+"	bx	ip\n"
+"	.size	rtems_rtl_elf_lazy_entry, . - rtems_rtl_elf_lazy_entry\n"
+);
+
+size_t
+rtems_rtl_elf_rel_lazy_size (void)
+{
+  return ARM_LAZY_SIZE;
+}
+
 bool
-rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_rel_lazy (Elf_Word type)
+{
+  return type == R_TYPE(PC24);
+}
+
+void
+rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub)
+{
+  uint32_t* code = stub;
+  code[0] = ARM_LAZY_LDR_IP_PC;
+  code[1] = ARM_LAZY_LDR_PC_IP;
+  code[2] = (uint32_t) lazy;
+  lazy->target = (void*) rtems_rtl_elf_lazy_entry;
+}
+
+/*
+ * Apply a PC24 branch relocation, word32 S - P + A. A branch that cannot reach
+ * its target is redirected to a trampoline.
+ */
+static bool
+arm_reloc_pc24 (rtems_rtl_obj_t*            obj,
+                Elf_Addr*                   where,
+                const Elf_Byte              syminfo,
+                const Elf_Word              symvalue)
+{
+  Elf32_Sword addend;
+  Elf_Addr    tmp;
+
+  /*
+   * Extract addend and sign-extend if needed.
+   */
+  addend = *where;
+  if (addend & 0x00800000)
+    addend |= 0xff000000;
+
+  tmp = symvalue - (Elf_Addr)where + (addend << 2);
+
+  if ((tmp & 0xfe000000) != 0xfe000000 &&
+      (tmp & 0xfe000000) != 0) {
+    /*
+     * Out of range so branch to a trampoline. The trampoline is at the
+     * branch target so remove the addend's pipeline offset from the
+     * trampoline's target.
+     */
+    uint32_t tramp[2];
+    void*    tramp_addr;
+
+    tramp[0] = ARM_TRAMP_LDR_PC;
+    tramp[1] = symvalue + (addend << 2) + 8;
+    if (ELF_ST_TYPE(syminfo) == STT_ARM_TFUNC)
+      tramp[1] |= 1;
+
+    tramp_addr = rtems_rtl_obj_tramp_add (obj, tramp, ARM_TRAMP_SIZE);
+    if (tramp_addr)
+      tmp = (Elf_Addr) tramp_addr - (Elf_Addr)where - 8;
+
+    if (!tramp_addr ||
+        ((tmp & 0xfe000000) != 0xfe000000 &&
+         (tmp & 0xfe000000) != 0)) {
+      rtems_rtl_set_error (EINVAL,
+                           "R_ARM_PC24 in %s relocation @ %p failed " \
+                           "(displacement %ld (%#lx) out of range)",
+                           rtems_rtl_obj_oname (obj), where, (long) tmp, (long) tmp);
+      return false;
+    }
+  }
+
+  tmp >>= 2;
+  *where = (*where & 0xff000000) | (tmp & 0x00ffffff);
+  return true;
+}
+
+/*
+ * Apply an ABS32 or GLOB_DAT relocation, word32 B + S + A.
+ */
+static inline Elf_Addr
+arm_reloc_abs32 (const rtems_rtl_obj_sect_t* sect,
+                 Elf_Addr*                   where,
+                 const Elf_Byte              syminfo,
+                 const Elf_Word              symvalue)
+{
+  Elf_Addr tmp;
+  if (__predict_true(RELOC_ALIGNED_P(where))) {
+    tmp = *where + (Elf_Addr)sect->base + symvalue;
+    /* Set the Thumb bit, if needed.  */
+    if (ELF_ST_TYPE(syminfo) == STT_ARM_TFUNC)
+      tmp |= 1;
+    *where = tmp;
+  } else {
+    tmp = load_ptr(where) + symvalue;
+    /* Set the Thumb bit, if needed.  */
+    if (ELF_ST_TYPE(syminfo) == STT_ARM_TFUNC)
+      tmp |= 1;
+    store_ptr(where, tmp);
+  }
+  return tmp;
+}
+
+/*
+ * Apply a RELATIVE relocation, word32 B + A.
+ */
+static inline Elf_Addr
+arm_reloc_relative (const rtems_rtl_obj_sect_t* sect,
+                    Elf_Addr*                   where)
+{
+  Elf_Addr tmp;
+  if (__predict_true(RELOC_ALIGNED_P(where))) {
+    tmp = *where + (Elf_Addr)sect->base;
+    *where = tmp;
+  } else {
+    tmp = load_ptr(where) + (Elf_Addr)sect->base;
+    store_ptr(where, tmp);
+  }
+  return tmp;
+}
+
+/*
+ * The REL type handlers apply a block of records of the same type.
+ */
+static bool
+arm_rel_none (rtems_rtl_obj_t*             obj,
+              const rtems_rtl_obj_sect_t*  sect,
+              const rtems_rtl_elf_reloc_t* relocs,
+              size_t                       count)
+{
+  return true;
+}
+
+static bool
+arm_rel_pc24 (rtems_rtl_obj_t*             obj,
+              const rtems_rtl_obj_sect_t*  sect,
+              const rtems_rtl_elf_reloc_t* relocs,
+              size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    if (!arm_reloc_pc24 (obj, where, relocs[r].syminfo, relocs[r].symvalue))
+      return false;
+  }
+  return true;
+}
+
+static bool
+arm_rel_abs32 (rtems_rtl_obj_t*             obj,
+               const rtems_rtl_obj_sect_t*  sect,
+               const rtems_rtl_elf_reloc_t* relocs,
+               size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    arm_reloc_abs32 (sect, where, relocs[r].syminfo, relocs[r].symvalue);
+  }
+  return true;
+}
+
+static bool
+arm_rel_relative (rtems_rtl_obj_t*             obj,
+                  const rtems_rtl_obj_sect_t*  sect,
+                  const rtems_rtl_elf_reloc_t* relocs,
+                  size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+    arm_reloc_relative (sect, (Elf_Addr*) (sect->base + relocs[r].offset));
+  return true;
+}
+
+static const rtems_rtl_elf_reloc_handler_t arm_rel_handlers[] =
+{
+  [R_TYPE(NONE)]     = arm_rel_none,
+  [R_TYPE(PC24)]     = arm_rel_pc24,
+  [R_TYPE(ABS32)]    = arm_rel_abs32,
+  [R_TYPE(COPY)]     = arm_rel_none,
+  [R_TYPE(GLOB_DAT)] = arm_rel_abs32,
+  [R_TYPE(RELATIVE)] = arm_rel_relative
+};
+
+const rtems_rtl_elf_reloc_handler_t*
+rtems_rtl_elf_reloc_handlers (bool rela, size_t* count)
+{
+  if (rela)
+  {
+    *count = 0;
+    return NULL;
+  }
+  *count = sizeof (arm_rel_handlers) / sizeof (arm_rel_handlers[0]);
+  return arm_rel_handlers;
+}
+
+bool
+rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*            obj,
                              const Elf_Rela*             rela,
                              const rtems_rtl_obj_sect_t* sect,
                              const char*                 symname,
@@ -59,7 +324,7 @@ rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
 }
 
 bool
-rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rel (rtems_rtl_obj_t*            obj,
                             const Elf_Rel*              rel,
                             const rtems_rtl_obj_sect_t* sect,
                             const char*                 symname,
@@ -75,66 +340,24 @@ rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
 		case R_TYPE(NONE):
 			break;
 
-#if 1 /* XXX should not occur */
-		case R_TYPE(PC24): {	/* word32 S - P + A */
-			Elf32_Sword addend;
-
-			/*
-			 * Extract addend and sign-extend if needed.
-			 */
-			addend = *where;
-			if (addend & 0x00800000)
-				addend |= 0xff000000;
-
-			tmp = (Elf_Addr)sect->base + symvalue
-        - (Elf_Addr)where + (addend << 2);
-
-      if ((tmp & 0xfe000000) != 0xfe000000 &&
-			    (tmp & 0xfe000000) != 0) {
-        rtems_rtl_set_error (EINVAL,
-                             "R_ARM_PC24 in %s relocation @ %p failed " \
-                             "(displacement %ld (%#lx) out of range)",
-                             rtems_rtl_obj_oname (obj), where, (long) tmp, (long) tmp);
+		case R_TYPE(PC24):	/* word32 S - P + A */
+			if (!arm_reloc_pc24 (obj, where, syminfo, symvalue))
 				return false;
-			}
-
-			tmp >>= 2;
-			*where = (*where & 0xff000000) | (tmp & 0x00ffffff);
       if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
         printf ("rtl: PC24 %p @ %p in %s",
                 (void *)*where, where, rtems_rtl_obj_oname (obj));
 			break;
-		}
-#endif
 
 		case R_TYPE(ABS32):	/* word32 B + S + A */
 		case R_TYPE(GLOB_DAT):	/* word32 B + S */
-			if (__predict_true(RELOC_ALIGNED_P(where))) {
-				tmp = *where + (Elf_Addr)sect->base + symvalue;
-				/* Set the Thumb bit, if needed.  */
-				if (ELF_ST_TYPE(syminfo) == STT_ARM_TFUNC)
-          tmp |= 1;
-				*where = tmp;
-			} else {
-				tmp = load_ptr(where) + symvalue;
-				/* Set the Thumb bit, if needed.  */
-				if (ELF_ST_TYPE(syminfo) == STT_ARM_TFUNC)
-				    tmp |= 1;
-				store_ptr(where, tmp);
-			}
+			tmp = arm_reloc_abs32 (sect, where, syminfo, symvalue);
       if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
         printf ("rtl: ABS32/GLOB_DAT %p @ %p in %s",
                 (void *)tmp, where, rtems_rtl_obj_oname (obj));
 			break;
 
 		case R_TYPE(RELATIVE):	/* word32 B + A */
-			if (__predict_true(RELOC_ALIGNED_P(where))) {
-				tmp = *where + (Elf_Addr)sect->base;
-				*where = tmp;
-			} else {
-				tmp = load_ptr(where) + (Elf_Addr)sect->base;
-				store_ptr(where, tmp);
-			}
+			tmp = arm_reloc_relative (sect, where);
       if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
         printf ("rtl: RELATIVE in %s --> %p",
                 rtems_rtl_obj_oname (obj), (void *)tmp);
@@ -22,8 +22,114 @@ rtems_rtl_elf_rel_resolve_sym (Elf_Word type)
   return true;
 }
 
+size_t
+rtems_rtl_elf_rel_tramp_max_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_tramp (Elf_Word type)
+{
+  return false;
+}
+
+size_t
+rtems_rtl_elf_rel_lazy_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_lazy (Elf_Word type)
+{
+  return false;
+}
+
+void
+rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub)
+{
+}
+
+/*
+ * The REL type handlers apply a block of records of the same type.
+ */
+static bool
+i386_rel_none (rtems_rtl_obj_t*             obj,
+               const rtems_rtl_obj_sect_t*  sect,
+               const rtems_rtl_elf_reloc_t* relocs,
+               size_t                       count)
+{
+  return true;
+}
+
+static bool
+i386_rel_pc32 (rtems_rtl_obj_t*             obj,
+               const rtems_rtl_obj_sect_t*  sect,
+               const rtems_rtl_elf_reloc_t* relocs,
+               size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    *where += (Elf_Addr) relocs[r].symvalue - (Elf_Addr) where;
+  }
+  return true;
+}
+
+static bool
+i386_rel_32 (rtems_rtl_obj_t*             obj,
+             const rtems_rtl_obj_sect_t*  sect,
+             const rtems_rtl_elf_reloc_t* relocs,
+             size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    *where += (Elf_Addr) relocs[r].symvalue;
+  }
+  return true;
+}
+
+static bool
+i386_rel_relative (rtems_rtl_obj_t*             obj,
+                   const rtems_rtl_obj_sect_t*  sect,
+                   const rtems_rtl_elf_reloc_t* relocs,
+                   size_t                       count)
+{
+  const Elf_Addr base = (Elf_Addr) sect->base;
+  size_t         r;
+  for (r = 0; r < count; ++r)
+    *((Elf_Addr*) (sect->base + relocs[r].offset)) += base;
+  return true;
+}
+
+static const rtems_rtl_elf_reloc_handler_t i386_rel_handlers[] =
+{
+  [R_TYPE(NONE)]     = i386_rel_none,
+  [R_TYPE(32)]       = i386_rel_32,
+  [R_TYPE(PC32)]     = i386_rel_pc32,
+  [R_TYPE(GOT32)]    = i386_rel_32,
+  [R_TYPE(GLOB_DAT)] = i386_rel_32,
+  [R_TYPE(RELATIVE)] = i386_rel_relative
+};
+
+const rtems_rtl_elf_reloc_handler_t*
+rtems_rtl_elf_reloc_handlers (bool rela, size_t* count)
+{
+  if (rela)
+  {
+    *count = 0;
+    return NULL;
+  }
+  *count = sizeof (i386_rel_handlers) / sizeof (i386_rel_handlers[0]);
+  return i386_rel_handlers;
+}
+
 bool
-rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*            obj,
                              const Elf_Rela*             rel,
                              const rtems_rtl_obj_sect_t* sect,
                              const char*                 symname,
@@ -35,7 +141,7 @@ rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
 }
 
 bool
-rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rel (rtems_rtl_obj_t*            obj,
                             const Elf_Rel*              rel,
                             const rtems_rtl_obj_sect_t* sect,
                             const char*                 symname,
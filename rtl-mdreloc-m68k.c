@@ -22,8 +22,115 @@ rtems_rtl_elf_rel_resolve_sym (Elf_Word type)
   return true;
 }
 
+size_t
+rtems_rtl_elf_rel_tramp_max_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_tramp (Elf_Word type)
+{
+  return false;
+}
+
+size_t
+rtems_rtl_elf_rel_lazy_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_lazy (Elf_Word type)
+{
+  return false;
+}
+
+void
+rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub)
+{
+}
+
+/*
+ * The RELA type handlers apply a block of records of the same type.
+ */
+static bool
+m68k_rela_none (rtems_rtl_obj_t*             obj,
+                const rtems_rtl_obj_sect_t*  sect,
+                const rtems_rtl_elf_reloc_t* relocs,
+                size_t                       count)
+{
+  return true;
+}
+
+static bool
+m68k_rela_pc32 (rtems_rtl_obj_t*             obj,
+                const rtems_rtl_obj_sect_t*  sect,
+                const rtems_rtl_elf_reloc_t* relocs,
+                size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    Elf_Addr  target = (Elf_Addr) relocs[r].symvalue + relocs[r].addend;
+    *where += target - (Elf_Addr) where;
+  }
+  return true;
+}
+
+static bool
+m68k_rela_32 (rtems_rtl_obj_t*             obj,
+              const rtems_rtl_obj_sect_t*  sect,
+              const rtems_rtl_elf_reloc_t* relocs,
+              size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr*) (sect->base + relocs[r].offset);
+    *where = (Elf_Addr) relocs[r].symvalue + relocs[r].addend;
+  }
+  return true;
+}
+
+static bool
+m68k_rela_relative (rtems_rtl_obj_t*             obj,
+                    const rtems_rtl_obj_sect_t*  sect,
+                    const rtems_rtl_elf_reloc_t* relocs,
+                    size_t                       count)
+{
+  const Elf_Addr base = (Elf_Addr) sect->base;
+  size_t         r;
+  for (r = 0; r < count; ++r)
+    *((Elf_Addr*) (sect->base + relocs[r].offset)) += base + relocs[r].addend;
+  return true;
+}
+
+static const rtems_rtl_elf_reloc_handler_t m68k_rela_handlers[] =
+{
+  [R_TYPE(NONE)]     = m68k_rela_none,
+  [R_TYPE(32)]       = m68k_rela_32,
+  [R_TYPE(PC32)]     = m68k_rela_pc32,
+  [R_TYPE(GOT32)]    = m68k_rela_32,
+  [R_TYPE(GLOB_DAT)] = m68k_rela_32,
+  [R_TYPE(RELATIVE)] = m68k_rela_relative
+};
+
+const rtems_rtl_elf_reloc_handler_t*
+rtems_rtl_elf_reloc_handlers (bool rela, size_t* count)
+{
+  if (!rela)
+  {
+    *count = 0;
+    return NULL;
+  }
+  *count = sizeof (m68k_rela_handlers) / sizeof (m68k_rela_handlers[0]);
+  return m68k_rela_handlers;
+}
+
 bool
-rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*            obj,
                              const Elf_Rela*             rela,
                              const rtems_rtl_obj_sect_t* sect,
                              const char*                 symnane,
@@ -92,11 +199,11 @@ rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
       return false;
   }
 
-  return false;
+  return true;
 }
 
 bool
-rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rel (rtems_rtl_obj_t*            obj,
                             const Elf_Rel*              rel,
                             const rtems_rtl_obj_sect_t* sect,
                             const char*                 symname,
@@ -64,6 +64,42 @@
 #define PLTCALL_SIZE    20
 #define PLTRESOLVE_SIZE 24
 
+size_t
+rtems_rtl_elf_rel_tramp_max_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_tramp (Elf_Word type)
+{
+  return false;
+}
+
+size_t
+rtems_rtl_elf_rel_lazy_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_lazy (Elf_Word type)
+{
+  return false;
+}
+
+void
+rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub)
+{
+}
+
+const rtems_rtl_elf_reloc_handler_t*
+rtems_rtl_elf_reloc_handlers (bool rela, size_t* count)
+{
+  *count = 0;
+  return NULL;
+}
+
 bool
 rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*      obj,
                              const Elf_Rela*       rela,
@@ -138,8 +138,157 @@ rtems_rtl_elf_rel_resolve_sym (Elf_Word type)
   return RELOC_RESOLVE_SYMBOL (type) ? true : false;
 }
 
+size_t
+rtems_rtl_elf_rel_tramp_max_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_tramp (Elf_Word type)
+{
+  return false;
+}
+
+size_t
+rtems_rtl_elf_rel_lazy_size (void)
+{
+  return 0;
+}
+
+bool
+rtems_rtl_elf_rel_lazy (Elf_Word type)
+{
+  return false;
+}
+
+void
+rtems_rtl_elf_rel_lazy_stub (rtems_rtl_elf_lazy_t* lazy, void* stub)
+{
+}
+
+/*
+ * The RELA type handlers apply a block of records of the same type. The
+ * type's flags, mask and shift are loaded once for the block.
+ */
+static bool
+sparc_rela_none (rtems_rtl_obj_t*             obj,
+                 const rtems_rtl_obj_sect_t*  sect,
+                 const rtems_rtl_elf_reloc_t* relocs,
+                 size_t                       count)
+{
+  return true;
+}
+
+static bool
+sparc_rela_relative (rtems_rtl_obj_t*             obj,
+                     const rtems_rtl_obj_sect_t*  sect,
+                     const rtems_rtl_elf_reloc_t* relocs,
+                     size_t                       count)
+{
+  size_t r;
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr *) (sect->base + relocs[r].offset);
+    *where += (Elf_Addr)(sect->base + relocs[r].addend);
+  }
+  return true;
+}
+
+static bool
+sparc_rela_value (rtems_rtl_obj_t*             obj,
+                  const rtems_rtl_obj_sect_t*  sect,
+                  const rtems_rtl_elf_reloc_t* relocs,
+                  size_t                       count)
+{
+  const Elf_Word type = ELF_R_TYPE (relocs[0].info);
+  const bool     resolve = RELOC_RESOLVE_SYMBOL (type);
+  const bool     pc_relative = RELOC_PC_RELATIVE (type);
+  const bool     base_relative = RELOC_BASE_RELATIVE (type);
+  const bool     unaligned = RELOC_UNALIGNED (type);
+  const Elf_Word mask = RELOC_VALUE_BITMASK (type);
+  const int      shift = RELOC_VALUE_RIGHTSHIFT (type);
+  size_t         r;
+
+  for (r = 0; r < count; ++r)
+  {
+    Elf_Addr* where = (Elf_Addr *) (sect->base + relocs[r].offset);
+    Elf_Word  value = relocs[r].addend;
+
+    if (resolve)
+      value += relocs[r].symvalue;
+    if (pc_relative)
+      value -= (Elf_Word)where;
+    if (base_relative)
+      value += (Elf_Word)(sect->base + *where);
+
+    value >>= shift;
+    value &= mask;
+
+    if (unaligned) {
+      Elf_Addr tmp = 0;
+      char *ptr = (char *)where;
+      int i, size = RELOC_TARGET_SIZE (type) / 8;
+
+      for (i=0; i<size; i++)
+        tmp = (tmp << 8) | ptr[i];
+
+      tmp &= ~mask;
+      tmp |= value;
+
+      for (i=0; i<size; i++)
+        ptr[i] = ((tmp >> (8*i)) & 0xff);
+    } else {
+      *where &= ~mask;
+      *where |= value;
+    }
+  }
+
+  return true;
+}
+
+static const rtems_rtl_elf_reloc_handler_t sparc_rela_handlers[] =
+{
+  [R_TYPE(NONE)]     = sparc_rela_none,
+  [R_TYPE(8)]        = sparc_rela_value,
+  [R_TYPE(16)]       = sparc_rela_value,
+  [R_TYPE(32)]       = sparc_rela_value,
+  [R_TYPE(DISP8)]    = sparc_rela_value,
+  [R_TYPE(DISP16)]   = sparc_rela_value,
+  [R_TYPE(DISP32)]   = sparc_rela_value,
+  [R_TYPE(WDISP30)]  = sparc_rela_value,
+  [R_TYPE(WDISP22)]  = sparc_rela_value,
+  [R_TYPE(HI22)]     = sparc_rela_value,
+  [R_TYPE(22)]       = sparc_rela_value,
+  [R_TYPE(13)]       = sparc_rela_value,
+  [R_TYPE(LO10)]     = sparc_rela_value,
+  [R_TYPE(GOT10)]    = sparc_rela_value,
+  [R_TYPE(GOT13)]    = sparc_rela_value,
+  [R_TYPE(GOT22)]    = sparc_rela_value,
+  [R_TYPE(PC10)]     = sparc_rela_value,
+  [R_TYPE(PC22)]     = sparc_rela_value,
+  [R_TYPE(WPLT30)]   = sparc_rela_value,
+  [R_TYPE(COPY)]     = sparc_rela_none,
+  [R_TYPE(GLOB_DAT)] = sparc_rela_value,
+  [R_TYPE(JMP_SLOT)] = sparc_rela_none,
+  [R_TYPE(RELATIVE)] = sparc_rela_relative,
+  [R_TYPE(UA32)]     = sparc_rela_value
+};
+
+const rtems_rtl_elf_reloc_handler_t*
+rtems_rtl_elf_reloc_handlers (bool rela, size_t* count)
+{
+  if (!rela)
+  {
+    *count = 0;
+    return NULL;
+  }
+  *count = sizeof (sparc_rela_handlers) / sizeof (sparc_rela_handlers[0]);
+  return sparc_rela_handlers;
+}
+
 bool
-rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rela (rtems_rtl_obj_t*            obj,
                              const Elf_Rela*             rela,
                              const rtems_rtl_obj_sect_t* sect,
                              const char*                 symname,
@@ -248,7 +397,7 @@ rtems_rtl_elf_relocate_rela (const rtems_rtl_obj_t*      obj,
 }
 
 bool
-rtems_rtl_elf_relocate_rel (const rtems_rtl_obj_t*      obj,
+rtems_rtl_elf_relocate_rel (rtems_rtl_obj_t*            obj,
                             const Elf_Rel*              rel,
                             const rtems_rtl_obj_sect_t* sect,
                             const char*                 symname,
@@ -34,6 +34,8 @@ rtems_rtl_obj_cache_open (rtems_rtl_obj_cache_t* cache, size_t size)
   cache->offset    = 0;
   cache->size      = size;
   cache->level     = 0;
+  cache->stream    = false;
+  cache->eof       = false;
   cache->buffer    = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, size, false);
   if (!cache->buffer)
   {
@@ -50,6 +52,8 @@ rtems_rtl_obj_cache_close (rtems_rtl_obj_cache_t* cache)
   cache->fd        = -1;
   cache->file_size = 0;
   cache->level     = 0;
+  cache->stream    = false;
+  cache->eof       = false;
 }
 
 void
@@ -58,6 +62,97 @@ rtems_rtl_obj_cache_flush (rtems_rtl_obj_cache_t* cache)
   cache->fd        = -1;
   cache->file_size = -1;
   cache->level     = 0;
+  cache->stream    = false;
+  cache->eof       = false;
+}
+
+void
+rtems_rtl_obj_cache_stream (rtems_rtl_obj_cache_t* cache, int fd)
+{
+  rtems_rtl_obj_cache_flush (cache);
+  cache->fd     = fd;
+  cache->offset = 0;
+  cache->stream = true;
+}
+
+/*
+ * Read a stream. The data before the offset is dropped from the buffer and the
+ * buffer is filled from the file until the data is present or the end of the
+ * stream is reached.
+ */
+static bool
+rtems_rtl_obj_cache_read_stream (rtems_rtl_obj_cache_t* cache,
+                                 off_t                  offset,
+                                 void**                 buffer,
+                                 size_t*                length)
+{
+  if (offset < cache->offset)
+  {
+    rtems_rtl_set_error (ESPIPE, "stream read before the buffer: offset=%i base=%i",
+                         (int) offset, (int) cache->offset);
+    return false;
+  }
+
+  while (true)
+  {
+    off_t end = cache->offset + cache->level;
+
+    if ((offset + *length) <= end)
+    {
+      *buffer = cache->buffer + (offset - cache->offset);
+      return true;
+    }
+
+    if (cache->eof)
+    {
+      if (offset > end)
+      {
+        rtems_rtl_set_error (EINVAL, "offset past end of stream: offset=%i size=%i",
+                             (int) offset, (int) end);
+        return false;
+      }
+      *buffer = cache->buffer + (offset - cache->offset);
+      *length = end - offset;
+      return true;
+    }
+
+    if (offset >= end)
+    {
+      cache->offset = end;
+      cache->level = 0;
+    }
+    else if (offset > cache->offset)
+    {
+      size_t skip = offset - cache->offset;
+      memmove (cache->buffer, cache->buffer + skip, cache->level - skip);
+      cache->offset = offset;
+      cache->level -= skip;
+    }
+
+    /*
+     * A POSIX read of a pipe or socket returns the data that has arrived so
+     * keep reading until the buffer is full or the stream ends.
+     */
+    while (cache->level < cache->size)
+    {
+      ssize_t r = read (cache->fd,
+                        cache->buffer + cache->level,
+                        cache->size - cache->level);
+      if (r < 0)
+      {
+        rtems_rtl_set_error (errno, "stream read failed");
+        return false;
+      }
+      if (r == 0)
+      {
+        cache->eof = true;
+        break;
+      }
+      cache->level += r;
+    }
+  }
+
+  return false;
 }
 
 bool
@@ -75,6 +170,9 @@ rtems_rtl_obj_cache_read (rtems_rtl_obj_cache_t* cache,
     return false;
   }
 
+  if (cache->stream && (fd == cache->fd))
+    return rtems_rtl_obj_cache_read_stream (cache, offset, buffer, length);
+
   if (offset > cache->file_size)
   {
     rtems_rtl_set_error (EINVAL, "offset past end of file: offset=%i size=%i",
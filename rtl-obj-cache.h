@@ -33,6 +33,11 @@
  *
  * You can have more than one cache for a single file all looking at different
  * parts of the file.
+ *
+ * A cache can stream a file that cannot seek such as a pipe or a socket. The
+ * file is read forward only and the data in the buffer is kept until a read
+ * moves past it. A read can reference data at or after the start of the
+ * buffer and data being skipped is read and discarded.
  */
 
 #if !defined (_RTEMS_RTL_OBJ_CACHE_H_)
@@ -59,6 +64,8 @@ typedef struct rtems_rtl_obj_cache_s
   size_t   level;     /**< The amount of data in the cache. A file can be
                        * smaller than the cache file. */
   uint8_t* buffer;    /**< The buffer */
+  bool     stream;    /**< The file is read forward only. */
+  bool     eof;       /**< The end of the stream has been read. */
 } rtems_rtl_obj_cache_t;
 
 /**
@@ -86,6 +93,17 @@ void rtems_rtl_obj_cache_close (rtems_rtl_obj_cache_t* cache);
  */
 void rtems_rtl_obj_cache_flush (rtems_rtl_obj_cache_t* cache);
 
+/**
+ * Stream a file through the cache. The file is read forward only and is never
+ * seeked so it can be a pipe or a socket. Stream reads start at offset 0 and
+ * a read cannot reference data before the start of the buffer. A flush ends
+ * the stream.
+ *
+ * @param cache The cache to stream the file through.
+ * @param fd The file descriptor. Must be an open file.
+ */
+void rtems_rtl_obj_cache_stream (rtems_rtl_obj_cache_t* cache, int fd);
+
 /**
  * Read data by reference. The length contains the amount of data that should
  * be available in the cache and referenced by the buffer handle. It must be
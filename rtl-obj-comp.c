@@ -27,6 +27,7 @@
 #include <rtl-error.h>
 
 #include "fastlz.h"
+#include "rtl-lz4.h"
 
 #include <stdio.h>
 
@@ -40,6 +41,7 @@ rtems_rtl_obj_comp_open (rtems_rtl_obj_comp_t*  comp,
   comp->offset = 0;
   comp->size   = size;
   comp->level  = 0;
+  comp->head   = 0;
   comp->buffer = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, size, false);
   if (!comp->buffer)
   {
@@ -47,6 +49,9 @@ rtems_rtl_obj_comp_open (rtems_rtl_obj_comp_t*  comp,
     return false;
   }
   comp->read = 0;
+  comp->crc = 0;
+  comp->dict = NULL;
+  comp->dict_size = 0;
   return true;
 }
 
@@ -58,9 +63,13 @@ rtems_rtl_obj_comp_close (rtems_rtl_obj_comp_t* comp)
   comp->fd = -1;
   comp->compression = RTEMS_RTL_COMP_LZ77;
   comp->level = 0;
+  comp->head = 0;
   comp->size = 0;
   comp->offset = 0;
   comp->read = 0;
+  comp->crc = 0;
+  comp->dict = NULL;
+  comp->dict_size = 0;
 }
 
 void
@@ -75,7 +84,99 @@ rtems_rtl_obj_comp_set (rtems_rtl_obj_comp_t*  comp,
   comp->compression = compression;
   comp->offset = offset;
   comp->level = 0;
+  comp->head = 0;
   comp->read = 0;
+  comp->crc = 0;
+  comp->dict = NULL;
+  comp->dict_size = 0;
+}
+
+void
+rtems_rtl_obj_comp_seek (rtems_rtl_obj_comp_t* comp, off_t offset)
+{
+  comp->offset = offset;
+  comp->level = 0;
+  comp->head = 0;
+}
+
+/*
+ * Decompress the next block in the stream into the output. The output must be
+ * large enough to hold the block.
+ */
+static bool
+rtems_rtl_obj_comp_block (rtems_rtl_obj_comp_t* comp,
+                          uint8_t*              output,
+                          size_t                size,
+                          size_t*               decompressed)
+{
+  uint8_t* input = NULL;
+  uint16_t block_size;
+  size_t   in_length = sizeof (block_size);
+  int      out_length;
+
+  if (!rtems_rtl_obj_cache_read (comp->cache, comp->fd, comp->offset,
+                                 (void**) &input, &in_length))
+    return false;
+
+  block_size = (input[0] << 8) | input[1];
+
+  comp->offset += sizeof (block_size);
+
+  in_length = block_size;
+
+  if (!rtems_rtl_obj_cache_read (comp->cache, comp->fd, comp->offset,
+                                 (void**) &input, &in_length))
+    return false;
+
+  if (in_length != block_size)
+  {
+    rtems_rtl_set_error (EIO, "compressed read failed: bs=%u in=%u",
+                         block_size, in_length);
+    return false;
+  }
+
+  switch (comp->compression)
+  {
+    case RTEMS_RTL_COMP_NONE:
+      if (in_length > size)
+      {
+        rtems_rtl_set_error (EIO, "block larger than the output");
+        return false;
+      }
+      memcpy (output, input, in_length);
+      out_length = in_length;
+      break;
+
+    case RTEMS_RTL_COMP_LZ77:
+      out_length = fastlz_decompress (input, in_length, output, size);
+      if (out_length == 0)
+      {
+        rtems_rtl_set_error (EBADF, "decompression failed");
+        return false;
+      }
+      break;
+
+    case RTEMS_RTL_COMP_LZ4:
+      out_length = rtems_rtl_lz4_decompress_dict (input, in_length,
+                                                  output, size,
+                                                  comp->dict, comp->dict_size);
+      if (out_length == 0)
+      {
+        rtems_rtl_set_error (EBADF, "decompression failed");
+        return false;
+      }
+      break;
+
+    default:
+      rtems_rtl_set_error (EINVAL, "bad compression type");
+      return false;
+  }
+
+  comp->offset += block_size;
+
+  *decompressed = out_length;
+
+  return true;
 }
 
 bool
@@ -84,6 +185,7 @@ rtems_rtl_obj_comp_read (rtems_rtl_obj_comp_t* comp,
                          size_t                length)
 {
   uint8_t* bin = buffer;
+  size_t   total = length;
 
   if (!comp->cache)
   {
@@ -94,86 +196,59 @@ rtems_rtl_obj_comp_read (rtems_rtl_obj_comp_t* comp,
   if (comp->fd != comp->cache->fd)
   {
     comp->level = 0;
+    comp->head = 0;
   }
 
   while (length)
   {
     size_t buffer_level;
 
-    buffer_level = length > comp->level ? comp->level : length;
+    buffer_level = comp->level - comp->head;
+    if (buffer_level > length)
+      buffer_level = length;
 
     if (buffer_level)
     {
-      memcpy (bin, comp->buffer, buffer_level);
-
-      if ((comp->level - buffer_level) != 0)
-      {
-        memmove (comp->buffer,
-                 comp->buffer + buffer_level,
-                 comp->level - buffer_level);
-      }
+      memcpy (bin, comp->buffer + comp->head, buffer_level);
 
       bin += buffer_level;
       length -= buffer_level;
-      comp->level -= buffer_level;
+      comp->head += buffer_level;
       comp->read += buffer_level;
     }
 
     if (length)
     {
-      uint8_t* input = NULL;
-      uint16_t block_size;
-      size_t   in_length = sizeof (block_size);
-      int      decompressed;
-
-      if (!rtems_rtl_obj_cache_read (comp->cache, comp->fd, comp->offset,
-                                     (void**) &input, &in_length))
-        return false;
-
-      block_size = (input[0] << 8) | input[1];
-
-      comp->offset += sizeof (block_size);
-
-      in_length = block_size;
-
-      if (!rtems_rtl_obj_cache_read (comp->cache, comp->fd, comp->offset,
-                                     (void**) &input, &in_length))
-        return false;
-
-      if (in_length != block_size)
+      size_t decompressed;
+
+      /*
+       * A block is never larger than the buffer so if the remaining data
+       * requested can hold the buffer decompress the block directly into the
+       * caller's memory. Only small reads and the end of a large read are
+       * staged in the buffer.
+       */
+      if (length >= comp->size)
       {
-        rtems_rtl_set_error (EIO, "compressed read failed: bs=%u in=%u",
-                             block_size, in_length);
-        return false;
-      }
+        if (!rtems_rtl_obj_comp_block (comp, bin, length, &decompressed))
+          return false;
 
-      switch (comp->compression)
+        bin += decompressed;
+        length -= decompressed;
+        comp->read += decompressed;
+      }
+      else
       {
-        case RTEMS_RTL_COMP_NONE:
-          memcpy (comp->buffer, input, in_length);
-          decompressed = in_length;
-          break;
-
-        case RTEMS_RTL_COMP_LZ77:
-          decompressed = fastlz_decompress (input, in_length,
-                                            comp->buffer, comp->size);
-          if (decompressed == 0)
-          {
-            rtems_rtl_set_error (EBADF, "decompression failed");
-            return false;
-          }
-          break;
-
-        default:
-          rtems_rtl_set_error (EINVAL, "bad compression type");
+        if (!rtems_rtl_obj_comp_block (comp, comp->buffer, comp->size,
+                                       &decompressed))
           return false;
-      }
 
-      comp->offset += block_size;
-
-      comp->level = decompressed;
+        comp->level = decompressed;
+        comp->head = 0;
+      }
     }
   }
 
+  comp->crc = rtems_rtl_crc32 (comp->crc, buffer, total);
+
   return true;
 }
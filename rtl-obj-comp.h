@@ -24,6 +24,7 @@
 #define _RTEMS_RTL_OBJ_COMP_H_
 
 #include <rtl-obj-cache.h>
+#include "rtl-crc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,7 @@ extern "C" {
  */
 #define RTEMS_RTL_COMP_NONE (0)
 #define RTEMS_RTL_COMP_LZ77 (1)
+#define RTEMS_RTL_COMP_LZ4  (2)
 
 /**
  * The compressed file.
@@ -52,8 +54,12 @@ typedef struct rtems_rtl_obj_cpmp_s
   off_t                  offset;      /**< The base offset of the buffer. */
   size_t                 size;        /**< The size of the output buffer. */
   size_t                 level;       /**< The amount of data in the buffer. */
+  size_t                 head;        /**< The read cursor in the buffer. */
   uint8_t*               buffer;      /**< The buffer */
   uint32_t               read;        /**< The amount of data read. */
+  uint32_t               crc;         /**< The CRC32 of the data read. */
+  const uint8_t*         dict;        /**< The LZ4 dictionary or NULL. */
+  size_t                 dict_size;   /**< The size of the dictionary. */
 } rtems_rtl_obj_comp_t;
 
 /**
@@ -64,6 +70,33 @@ static inline uint32_t rtems_rtl_obj_comp_input (rtems_rtl_obj_comp_t* comp)
   return comp->read;
 }
 
+/**
+ * Return the amount of decompressed data in the buffer not yet read.
+ */
+static inline size_t rtems_rtl_obj_comp_buffered (rtems_rtl_obj_comp_t* comp)
+{
+  return comp->level - comp->head;
+}
+
+/**
+ * Return the CRC32 of the data read from the stream.
+ */
+static inline uint32_t rtems_rtl_obj_comp_crc (rtems_rtl_obj_comp_t* comp)
+{
+  return comp->crc;
+}
+
+/**
+ * Add data that is part of the stream but was not read through the
+ * compressor to the stream's CRC32. The data must be added in stream order.
+ */
+static inline void rtems_rtl_obj_comp_crc_add (rtems_rtl_obj_comp_t* comp,
+                                               const void*           data,
+                                               size_t                length)
+{
+  comp->crc = rtems_rtl_crc32 (comp->crc, data, length);
+}
+
 /**
  * Open a compressor allocating the output buffer.
  *
@@ -97,6 +130,31 @@ void rtems_rtl_obj_comp_set (rtems_rtl_obj_comp_t*  comp,
                              int                    compression,
                              off_t                  offset);
 
+/**
+ * Set the dictionary LZ4 blocks are decompressed with. Setting the compressor
+ * clears the dictionary.
+ *
+ * @param comp The compressor to set the dictionary of.
+ * @param dict The dictionary. NULL for no dictionary.
+ * @param size The size of the dictionary.
+ */
+static inline void rtems_rtl_obj_comp_dictionary (rtems_rtl_obj_comp_t* comp,
+                                                  const uint8_t*        dict,
+                                                  size_t                size)
+{
+  comp->dict = dict;
+  comp->dict_size = dict ? size : 0;
+}
+
+/**
+ * Move the compressed stream to the start of a block in the file. Any data in
+ * the buffer is discarded.
+ *
+ * @param comp The compressor to move.
+ * @param offset The offset in the file of the block.
+ */
+void rtems_rtl_obj_comp_seek (rtems_rtl_obj_comp_t* comp, off_t offset);
+
 /**
  * Read decompressed data. The length contains the amount of data that should
  * be available in the cache and referenced by the buffer handle. It must be
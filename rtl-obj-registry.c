@@ -0,0 +1,405 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Object Registry.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <rtl.h>
+#include "rtl-error.h"
+#include "rtl-obj-registry.h"
+
+/**
+ * The handle is the slot index in the lower bits and the slot's generation in
+ * the upper bits. The generation is never 0 so a handle is never NULL and it
+ * does not reach the top bit so it cannot be one of the RTLD_* handles.
+ */
+#define RTEMS_RTL_OBJ_HANDLE_INDEX_BITS (16)
+#define RTEMS_RTL_OBJ_HANDLE_INDEX_MASK ((1UL << RTEMS_RTL_OBJ_HANDLE_INDEX_BITS) - 1)
+#define RTEMS_RTL_OBJ_HANDLE_GENERATIONS (0x3fffUL)
+
+/**
+ * A name cursor returns the characters of a registry name one at a time. An
+ * archive name is followed by a ':' and the member name.
+ */
+typedef struct
+{
+  const char* s;      /**< The next character. */
+  const char* tail;   /**< The member name following the archive name. */
+  bool        member; /**< The cursor is in the member name. */
+  int         prev;   /**< The last character returned, -1 at the start. */
+} rtems_rtl_obj_registry_cursor_t;
+
+static void
+rtems_rtl_obj_registry_name (rtems_rtl_obj_registry_cursor_t* cursor,
+                             const char*                      name)
+{
+  cursor->s = name;
+  cursor->tail = NULL;
+  cursor->member = false;
+  cursor->prev = -1;
+}
+
+static void
+rtems_rtl_obj_registry_obj_name (rtems_rtl_obj_registry_cursor_t* cursor,
+                                 rtems_rtl_obj_t*                 obj)
+{
+  if (rtems_rtl_obj_aname_valid (obj))
+  {
+    rtems_rtl_obj_registry_name (cursor, obj->aname);
+    cursor->tail = obj->oname;
+  }
+  else
+  {
+    rtems_rtl_obj_registry_name (cursor, obj->oname);
+  }
+}
+
+/*
+ * Return the next character of the name or -1 at the end. The '@' of an
+ * archive offset ends the member name.
+ */
+static int
+rtems_rtl_obj_registry_next (rtems_rtl_obj_registry_cursor_t* cursor)
+{
+  while (true)
+  {
+    int c = (unsigned char) *cursor->s;
+
+    if ((c == '\0') || (cursor->member && (c == '@')))
+    {
+      if (cursor->tail == NULL)
+        return -1;
+      cursor->s = cursor->tail;
+      cursor->tail = NULL;
+      cursor->member = true;
+      c = ':';
+    }
+    else if (!cursor->member && (c == ':'))
+    {
+      cursor->member = true;
+      ++cursor->s;
+    }
+    else
+    {
+      bool start = ((cursor->prev < 0) ||
+                    (cursor->prev == '/') || (cursor->prev == ':'));
+      if ((c == '/') && (cursor->prev == '/'))
+      {
+        ++cursor->s;
+        continue;
+      }
+      if (start && (c == '.') && (cursor->s[1] == '/'))
+      {
+        cursor->s += 2;
+        continue;
+      }
+      ++cursor->s;
+    }
+
+    cursor->prev = c;
+    return c;
+  }
+}
+
+static uint32_t
+rtems_rtl_obj_registry_hash (rtems_rtl_obj_registry_cursor_t cursor)
+{
+  uint32_t hash = 2166136261UL;
+  int      c;
+  while ((c = rtems_rtl_obj_registry_next (&cursor)) >= 0)
+  {
+    hash ^= (uint32_t) c;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static bool
+rtems_rtl_obj_registry_compare (rtems_rtl_obj_registry_cursor_t a,
+                                rtems_rtl_obj_registry_cursor_t b)
+{
+  while (true)
+  {
+    int c = rtems_rtl_obj_registry_next (&a);
+    if (c != rtems_rtl_obj_registry_next (&b))
+      return false;
+    if (c < 0)
+      return true;
+  }
+}
+
+static rtems_rtl_obj_t*
+rtems_rtl_obj_registry_lookup (rtems_rtl_obj_registry_t*              registry,
+                               const rtems_rtl_obj_registry_cursor_t* name)
+{
+  uint32_t         hash = rtems_rtl_obj_registry_hash (*name);
+  rtems_rtl_obj_t* obj = registry->buckets[hash % registry->nbuckets];
+
+  while (obj)
+  {
+    if (obj->name_hash == hash)
+    {
+      rtems_rtl_obj_registry_cursor_t other;
+      rtems_rtl_obj_registry_obj_name (&other, obj);
+      if (rtems_rtl_obj_registry_compare (*name, other))
+        return obj;
+    }
+    obj = obj->registry_next;
+  }
+
+  return NULL;
+}
+
+static void
+rtems_rtl_obj_registry_init_slots (rtems_rtl_obj_slot_t* slots,
+                                   size_t                first,
+                                   size_t                count)
+{
+  size_t s;
+  for (s = first; s < count; ++s)
+  {
+    slots[s].obj = NULL;
+    slots[s].generation = 1;
+    slots[s].next = s + 1;
+  }
+}
+
+/*
+ * Double the number of buckets when the chains get long. The registry still
+ * works if there is no memory so a failure is ignored.
+ */
+static void
+rtems_rtl_obj_registry_rehash (rtems_rtl_obj_registry_t* registry)
+{
+  rtems_rtl_alloc_stats_t* owner;
+  rtems_rtl_obj_t**        buckets;
+  size_t                   nbuckets = registry->nbuckets * 2;
+  size_t                   b;
+
+  owner = rtems_rtl_alloc_owner (NULL);
+  buckets = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                 nbuckets * sizeof (rtems_rtl_obj_t*),
+                                 true);
+  rtems_rtl_alloc_owner (owner);
+
+  if (!buckets)
+    return;
+
+  for (b = 0; b < registry->nbuckets; ++b)
+  {
+    rtems_rtl_obj_t* obj = registry->buckets[b];
+    while (obj)
+    {
+      rtems_rtl_obj_t* next = obj->registry_next;
+      rtems_rtl_obj_t** bucket = &buckets[obj->name_hash % nbuckets];
+      obj->registry_next = *bucket;
+      *bucket = obj;
+      obj = next;
+    }
+  }
+
+  owner = rtems_rtl_alloc_owner (NULL);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, registry->buckets);
+  rtems_rtl_alloc_owner (owner);
+
+  registry->buckets = buckets;
+  registry->nbuckets = nbuckets;
+}
+
+static bool
+rtems_rtl_obj_registry_grow (rtems_rtl_obj_registry_t* registry)
+{
+  rtems_rtl_alloc_stats_t* owner;
+  rtems_rtl_obj_slot_t*    slots;
+  size_t                   nslots = registry->nslots * 2;
+
+  if (nslots > (RTEMS_RTL_OBJ_HANDLE_INDEX_MASK + 1))
+    nslots = RTEMS_RTL_OBJ_HANDLE_INDEX_MASK + 1;
+
+  if (nslots == registry->nslots)
+    return false;
+
+  owner = rtems_rtl_alloc_owner (NULL);
+  slots = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                               nslots * sizeof (rtems_rtl_obj_slot_t),
+                               false);
+  if (slots)
+  {
+    memcpy (slots, registry->slots,
+            registry->nslots * sizeof (rtems_rtl_obj_slot_t));
+    rtems_rtl_obj_registry_init_slots (slots, registry->nslots, nslots);
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, registry->slots);
+  }
+  rtems_rtl_alloc_owner (owner);
+
+  if (!slots)
+    return false;
+
+  registry->free = registry->nslots;
+  registry->slots = slots;
+  registry->nslots = nslots;
+
+  return true;
+}
+
+bool
+rtems_rtl_obj_registry_open (rtems_rtl_obj_registry_t* registry,
+                             size_t                    buckets,
+                             size_t                    slots)
+{
+  registry->buckets = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                           buckets * sizeof (rtems_rtl_obj_t*),
+                                           true);
+  if (!registry->buckets)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for object registry");
+    return false;
+  }
+
+  registry->slots = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                         slots * sizeof (rtems_rtl_obj_slot_t),
+                                         false);
+  if (!registry->slots)
+  {
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, registry->buckets);
+    rtems_rtl_set_error (ENOMEM, "no memory for object handles");
+    return false;
+  }
+
+  rtems_rtl_obj_registry_init_slots (registry->slots, 0, slots);
+
+  registry->nbuckets = buckets;
+  registry->count = 0;
+  registry->nslots = slots;
+  registry->free = 0;
+
+  return true;
+}
+
+void
+rtems_rtl_obj_registry_close (rtems_rtl_obj_registry_t* registry)
+{
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, registry->slots);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, registry->buckets);
+}
+
+bool
+rtems_rtl_obj_registry_add (rtems_rtl_obj_registry_t* registry,
+                            rtems_rtl_obj_t*          obj)
+{
+  rtems_rtl_obj_registry_cursor_t name;
+  rtems_rtl_obj_slot_t*           slot;
+  rtems_rtl_obj_t**               bucket;
+  size_t                          index;
+
+  if ((registry->free >= registry->nslots) &&
+      !rtems_rtl_obj_registry_grow (registry))
+  {
+    rtems_rtl_set_error (ENOMEM, "no free object handles");
+    return false;
+  }
+
+  index = registry->free;
+  slot = &registry->slots[index];
+  registry->free = slot->next;
+
+  slot->obj = obj;
+  obj->handle = (void*) (((uintptr_t) slot->generation <<
+                          RTEMS_RTL_OBJ_HANDLE_INDEX_BITS) | index);
+
+  rtems_rtl_obj_registry_obj_name (&name, obj);
+  obj->name_hash = rtems_rtl_obj_registry_hash (name);
+
+  bucket = &registry->buckets[obj->name_hash % registry->nbuckets];
+  obj->registry_next = *bucket;
+  *bucket = obj;
+
+  ++registry->count;
+  if (registry->count > (registry->nbuckets * 2))
+    rtems_rtl_obj_registry_rehash (registry);
+
+  return true;
+}
+
+void
+rtems_rtl_obj_registry_remove (rtems_rtl_obj_registry_t* registry,
+                               rtems_rtl_obj_t*          obj)
+{
+  rtems_rtl_obj_slot_t* slot;
+  rtems_rtl_obj_t**     link;
+  size_t                index;
+
+  if (rtems_rtl_obj_registry_handle (registry, obj->handle) != obj)
+    return;
+
+  index = (uintptr_t) obj->handle & RTEMS_RTL_OBJ_HANDLE_INDEX_MASK;
+  slot = &registry->slots[index];
+
+  slot->obj = NULL;
+  slot->generation = (slot->generation % RTEMS_RTL_OBJ_HANDLE_GENERATIONS) + 1;
+  slot->next = registry->free;
+  registry->free = index;
+
+  link = &registry->buckets[obj->name_hash % registry->nbuckets];
+  while (*link)
+  {
+    if (*link == obj)
+    {
+      *link = obj->registry_next;
+      break;
+    }
+    link = &(*link)->registry_next;
+  }
+
+  obj->registry_next = NULL;
+  obj->handle = NULL;
+
+  --registry->count;
+}
+
+rtems_rtl_obj_t*
+rtems_rtl_obj_registry_find (rtems_rtl_obj_registry_t* registry,
+                             const char*               name)
+{
+  rtems_rtl_obj_registry_cursor_t cursor;
+  rtems_rtl_obj_registry_name (&cursor, name);
+  return rtems_rtl_obj_registry_lookup (registry, &cursor);
+}
+
+rtems_rtl_obj_t*
+rtems_rtl_obj_registry_match (rtems_rtl_obj_registry_t* registry,
+                              rtems_rtl_obj_t*          obj)
+{
+  rtems_rtl_obj_registry_cursor_t cursor;
+  rtems_rtl_obj_registry_obj_name (&cursor, obj);
+  return rtems_rtl_obj_registry_lookup (registry, &cursor);
+}
+
+rtems_rtl_obj_t*
+rtems_rtl_obj_registry_handle (rtems_rtl_obj_registry_t* registry,
+                               void*                     handle)
+{
+  uintptr_t value = (uintptr_t) handle;
+  size_t    index = value & RTEMS_RTL_OBJ_HANDLE_INDEX_MASK;
+  if ((index < registry->nslots) &&
+      (registry->slots[index].generation ==
+       (value >> RTEMS_RTL_OBJ_HANDLE_INDEX_BITS)))
+    return registry->slots[index].obj;
+  return NULL;
+}
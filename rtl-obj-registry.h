@@ -0,0 +1,140 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Object Registry.
+ *
+ * The registry indexes the loaded object files by name and hands out the
+ * handles returned by dlopen. The name is the archive and member or the object
+ * file name as passed to dlopen with any archive offset removed, repeated '/'
+ * collapsed and any './' path components removed. Names are hashed and
+ * compared a character at a time so a lookup does not allocate memory.
+ *
+ * A handle is an index into a table of slots tagged with the slot's
+ * generation. The generation changes when an object file is unloaded so a
+ * stale handle does not match an object file later loaded into the slot.
+ */
+
+#if !defined (_RTEMS_RTL_OBJ_REGISTRY_H_)
+#define _RTEMS_RTL_OBJ_REGISTRY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <rtl-obj-fwd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A handle slot. A free slot is linked to the next free slot.
+ */
+typedef struct rtems_rtl_obj_slot_s
+{
+  rtems_rtl_obj_t* obj;        /**< The object file. NULL if free. */
+  uint32_t         generation; /**< The slot's generation. */
+  uint32_t         next;       /**< The next free slot. */
+} rtems_rtl_obj_slot_t;
+
+/**
+ * The object registry.
+ */
+typedef struct rtems_rtl_obj_registry_s
+{
+  rtems_rtl_obj_t**     buckets;  /**< The name hash table. */
+  size_t                nbuckets; /**< The number of buckets. */
+  size_t                count;    /**< The number of object files. */
+  rtems_rtl_obj_slot_t* slots;    /**< The handle slots. */
+  size_t                nslots;   /**< The number of slots. */
+  size_t                free;     /**< The first free slot. Equal to the
+                                   *   number of slots if there is none. */
+} rtems_rtl_obj_registry_t;
+
+/**
+ * Open a registry.
+ *
+ * @param registry The registry to open.
+ * @param buckets The initial number of buckets in the hash table.
+ * @param slots The initial number of handle slots.
+ * @retval true The registry is open.
+ * @retval false The registry could not be created. The RTL error is set.
+ */
+bool rtems_rtl_obj_registry_open (rtems_rtl_obj_registry_t* registry,
+                                  size_t                    buckets,
+                                  size_t                    slots);
+
+/**
+ * Close the registry.
+ *
+ * @param registry The registry to close.
+ */
+void rtems_rtl_obj_registry_close (rtems_rtl_obj_registry_t* registry);
+
+/**
+ * Add an object file to the registry and give it a handle. The object file's
+ * names must be set.
+ *
+ * @param registry The registry.
+ * @param obj The object file to add.
+ * @retval true The object file has been added.
+ * @retval false There are no free handles. The RTL error is set.
+ */
+bool rtems_rtl_obj_registry_add (rtems_rtl_obj_registry_t* registry,
+                                 rtems_rtl_obj_t*          obj);
+
+/**
+ * Remove an object file from the registry. The object file's handle is no
+ * longer valid. Nothing is done if the object file is not in the registry.
+ *
+ * @param registry The registry.
+ * @param obj The object file to remove.
+ */
+void rtems_rtl_obj_registry_remove (rtems_rtl_obj_registry_t* registry,
+                                    rtems_rtl_obj_t*          obj);
+
+/**
+ * Find an object file by the name passed to dlopen.
+ *
+ * @param registry The registry.
+ * @param name The name of the object file.
+ * @return rtems_rtl_obj_t* The object file. NULL if not found.
+ */
+rtems_rtl_obj_t* rtems_rtl_obj_registry_find (rtems_rtl_obj_registry_t* registry,
+                                              const char*               name);
+
+/**
+ * Find an object file in the registry with the same names as an object file
+ * that is not in the registry.
+ *
+ * @param registry The registry.
+ * @param obj The object file with the names to find.
+ * @return rtems_rtl_obj_t* The object file. NULL if not found.
+ */
+rtems_rtl_obj_t* rtems_rtl_obj_registry_match (rtems_rtl_obj_registry_t* registry,
+                                               rtems_rtl_obj_t*          obj);
+
+/**
+ * Return the object file for a handle.
+ *
+ * @param registry The registry.
+ * @param handle The handle.
+ * @return rtems_rtl_obj_t* The object file. NULL if the handle is not valid.
+ */
+rtems_rtl_obj_t* rtems_rtl_obj_registry_handle (rtems_rtl_obj_registry_t* registry,
+                                                void*                     handle);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
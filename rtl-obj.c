@@ -21,14 +21,18 @@
 #include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/stat.h>
 
 #include <rtems/libio_.h>
 
 #include <rtl.h>
 #include <rtl-chain-iterator.h>
 #include <rtl-obj.h>
+#include "rtl-crc.h"
+#include "rtl-digest.h"
 #include "rtl-error.h"
 #include "rtl-find-file.h"
+#include "rtl-prelink.h"
 #include "rtl-string.h"
 #include "rtl-trace.h"
 
@@ -72,6 +76,7 @@ rtems_rtl_obj_alloc (void)
      * Initialise the chains.
      */
     rtems_chain_initialize_empty (&obj->sections);
+    obj->alloc = rtems_rtl_alloc_owner_new ();
   }
   return obj;
 }
@@ -97,10 +102,14 @@ rtems_rtl_obj_free (rtems_rtl_obj_t* obj)
   }
   if (!rtems_chain_is_node_off_chain (&obj->link))
     rtems_chain_extract (&obj->link);
+  rtems_rtl_obj_registry_remove (&rtems_rtl_data ()->registry, obj);
   rtems_rtl_alloc_module_del (&obj->text_base, &obj->const_base,
                               &obj->data_base, &obj->bss_base);
   rtems_rtl_symbol_obj_erase (obj);
+  rtems_rtl_obj_erase_sections (obj);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, obj->lazy_table);
   rtems_rtl_obj_free_names (obj);
+  rtems_rtl_alloc_owner_del (obj->alloc);
   rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, obj);
   return true;
 }
@@ -378,6 +387,37 @@ rtems_rtl_obj_find_file (rtems_rtl_obj_t* obj, const char* name)
   return true;
 }
 
+bool
+rtems_rtl_obj_stream_file (rtems_rtl_obj_t* obj, const char* name)
+{
+  size_t len = strlen (name);
+  char*  fname;
+
+  if (!rtems_rtl_obj_parse_name (obj, name))
+    return false;
+
+  if (rtems_rtl_obj_aname_valid (obj))
+  {
+    rtems_rtl_set_error (EINVAL, "an archive cannot be streamed");
+    return false;
+  }
+
+  fname = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, len + 1, true);
+  if (!fname)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for object file name");
+    return false;
+  }
+
+  memcpy (fname, name, len);
+
+  obj->fname = fname;
+  obj->fsize = 0;
+  obj->flags |= RTEMS_RTL_OBJ_STREAM;
+
+  return true;
+}
+
 bool
 rtems_rtl_obj_add_section (rtems_rtl_obj_t* obj,
                            int              section,
@@ -413,6 +453,14 @@ rtems_rtl_obj_add_section (rtems_rtl_obj_t* obj,
   return true;
 }
 
+void
+rtems_rtl_obj_erase_section (rtems_rtl_obj_t* obj, rtems_rtl_obj_sect_t* sect)
+{
+  rtems_chain_extract (&sect->node);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) sect->name);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sect);
+}
+
 void
 rtems_rtl_obj_erase_sections (rtems_rtl_obj_t* obj)
 {
@@ -420,11 +468,8 @@ rtems_rtl_obj_erase_sections (rtems_rtl_obj_t* obj)
   while (!rtems_chain_is_tail (&obj->sections, node))
   {
     rtems_rtl_obj_sect_t* sect = (rtems_rtl_obj_sect_t*) node;
-    rtems_chain_node*     next_node = rtems_chain_next (node);
-    rtems_chain_extract (node);
-    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) sect->name);
-    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, sect);
-    node = next_node;
+    node = rtems_chain_next (node);
+    rtems_rtl_obj_erase_section (obj, sect);
   }
 }
 
@@ -556,6 +601,97 @@ rtems_rtl_obj_load_symbols (rtems_rtl_obj_t*             obj,
   return rtems_rtl_obj_section_handler (mask, obj, fd, handler, data);
 }
 
+void
+rtems_rtl_obj_sync_mark (rtems_rtl_obj_t* obj,
+                         const void*      address,
+                         size_t           size)
+{
+  uint8_t* start = (uint8_t*) address;
+  uint8_t* end = start + size;
+  uint8_t* text = obj->text_base;
+
+  if (!text || (start < text) || (end > (text + obj->text_size)))
+    return;
+
+  if (!obj->sync_start || (start < (uint8_t*) obj->sync_start))
+    obj->sync_start = start;
+  if (!obj->sync_end || (end > (uint8_t*) obj->sync_end))
+    obj->sync_end = end;
+}
+
+void
+rtems_rtl_obj_synchronize_cache (rtems_rtl_obj_t* obj)
+{
+  if (obj->sync_start && (obj->sync_end > obj->sync_start))
+  {
+    size_t size = (uint8_t*) obj->sync_end - (uint8_t*) obj->sync_start;
+
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD_SECT))
+      printf ("rtl: sync cache: %p (%zi) in %s\n",
+              obj->sync_start, size, rtems_rtl_obj_oname (obj));
+
+    rtems_cache_flush_multiple_data_lines (obj->sync_start, size);
+    rtems_cache_invalidate_multiple_instruction_lines (obj->sync_start, size);
+
+    /*
+     * The text has changed so its checksum is updated.
+     */
+    obj->checksum = rtems_rtl_crc32 (0, obj->text_base, obj->text_size);
+  }
+
+  obj->sync_start = obj->sync_end = NULL;
+}
+
+bool
+rtems_rtl_obj_verify_text (const rtems_rtl_obj_t* obj)
+{
+  if (!obj->text_base || (obj->checksum == 0))
+    return true;
+  return rtems_rtl_crc32 (0, obj->text_base, obj->text_size) == obj->checksum;
+}
+
+void*
+rtems_rtl_obj_tramp_add (rtems_rtl_obj_t* obj,
+                         const void*      tramp,
+                         size_t           size)
+{
+  uint8_t* base = obj->tramp_base;
+  uint8_t* brk = obj->tramp_brk;
+  uint8_t* t;
+
+  if (!base || (size == 0))
+    return NULL;
+
+  /*
+   * The lazy binding stubs are at the start of the area.
+   */
+  base += obj->lazy_size;
+
+  /*
+   * All trampolines in an object are the same size so a trampoline with the
+   * same code and data is the same target.
+   */
+  for (t = base; (t + size) <= brk; t += size)
+  {
+    if (memcmp (t, tramp, size) == 0)
+      return t;
+  }
+
+  if ((brk + size) > (base + obj->tramp_size))
+    return NULL;
+
+  memcpy (brk, tramp, size);
+  obj->tramp_brk = brk + size;
+
+  rtems_rtl_obj_sync_mark (obj, brk, size);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: tramp: %p (%zi) in %s\n",
+            brk, size, rtems_rtl_obj_oname (obj));
+
+  return brk;
+}
+
 static size_t
 rtems_rtl_obj_sections_loader (uint32_t                     mask,
                                rtems_rtl_obj_t*             obj,
@@ -585,7 +721,7 @@ rtems_rtl_obj_sections_loader (uint32_t                     mask,
 
       if ((sect->flags & RTEMS_RTL_OBJ_SECT_LOAD) == RTEMS_RTL_OBJ_SECT_LOAD)
       {
-        if (!handler (obj, fd, sect, data))
+        if (handler && !handler (obj, fd, sect, data))
         {
           sect->base = 0;
           return false;
@@ -613,17 +749,22 @@ rtems_rtl_obj_sections_loader (uint32_t                     mask,
 }
 
 bool
-rtems_rtl_obj_load_sections (rtems_rtl_obj_t*             obj,
-                             int                          fd,
-                             rtems_rtl_obj_sect_handler_t handler,
-                             void*                        data)
+rtems_rtl_obj_alloc_sections (rtems_rtl_obj_t* obj)
 {
   size_t text_size;
   size_t const_size;
   size_t data_size;
   size_t bss_size;
+  size_t tramp_offset;
 
-  text_size  = rtems_rtl_obj_text_size (obj) + rtems_rtl_obj_const_alignment (obj);
+  /*
+   * The trampolines follow the text sections and are word aligned.
+   */
+  tramp_offset = rtems_rtl_obj_text_size (obj);
+  if (obj->tramp_size)
+    tramp_offset = (tramp_offset + sizeof (uint32_t) - 1) & ~(sizeof (uint32_t) - 1);
+
+  text_size  = tramp_offset + obj->tramp_size + rtems_rtl_obj_const_alignment (obj);
   const_size = rtems_rtl_obj_const_size (obj) + rtems_rtl_obj_data_alignment (obj);
   data_size  = rtems_rtl_obj_data_size (obj) + rtems_rtl_obj_bss_alignment (obj);
   bss_size   = rtems_rtl_obj_bss_size (obj);
@@ -644,6 +785,20 @@ rtems_rtl_obj_load_sections (rtems_rtl_obj_t*             obj,
 
   obj->exec_size = text_size + const_size + data_size + bss_size;
 
+  if (obj->tramp_size)
+  {
+    obj->tramp_base = ((uint8_t*) obj->text_base) + tramp_offset;
+    obj->tramp_brk = ((uint8_t*) obj->tramp_base) + obj->lazy_size;
+  }
+
+  /*
+   * All the text is written by the load and relocations so it is all
+   * synchronized once loaded.
+   */
+  obj->text_size = tramp_offset + obj->tramp_size;
+  obj->sync_start = obj->text_base;
+  obj->sync_end = ((uint8_t*) obj->text_base) + obj->text_size;
+
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD_SECT))
   {
     printf ("rtl: load sect: text  - b:%p s:%zi a:%" PRIu32 "\n",
@@ -656,6 +811,55 @@ rtems_rtl_obj_load_sections (rtems_rtl_obj_t*             obj,
             obj->bss_base, bss_size, rtems_rtl_obj_bss_alignment (obj));
   }
 
+  return true;
+}
+
+/*
+ * Release the section memory of a failed load.
+ */
+static void
+rtems_rtl_obj_release_sections (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_alloc_module_del (&obj->text_base, &obj->const_base,
+                              &obj->data_base, &obj->bss_base);
+  obj->exec_size = 0;
+  obj->tramp_base = obj->tramp_brk = NULL;
+  obj->text_size = 0;
+  obj->sync_start = obj->sync_end = NULL;
+}
+
+bool
+rtems_rtl_obj_load_sections (rtems_rtl_obj_t*             obj,
+                             int                          fd,
+                             rtems_rtl_obj_sect_handler_t handler,
+                             void*                        data)
+{
+  if (!rtems_rtl_obj_alloc_sections (obj))
+    return false;
+
+  /*
+   * The prelink cache holds the text, const and data relocated for these
+   * addresses. The section bases are set without loading the sections and
+   * the bss is zeroed by its loader.
+   */
+  if (rtems_rtl_prelink_restore (obj))
+  {
+    obj->flags |= RTEMS_RTL_OBJ_PRELINKED;
+    if (!rtems_rtl_obj_sections_loader (RTEMS_RTL_OBJ_SECT_TEXT,
+                                        obj, fd, obj->text_base, NULL, NULL) ||
+        !rtems_rtl_obj_sections_loader (RTEMS_RTL_OBJ_SECT_CONST,
+                                        obj, fd, obj->const_base, NULL, NULL) ||
+        !rtems_rtl_obj_sections_loader (RTEMS_RTL_OBJ_SECT_DATA,
+                                        obj, fd, obj->data_base, NULL, NULL) ||
+        !rtems_rtl_obj_sections_loader (RTEMS_RTL_OBJ_SECT_BSS,
+                                        obj, fd, obj->bss_base, handler, data))
+    {
+      rtems_rtl_obj_release_sections (obj);
+      return false;
+    }
+    return true;
+  }
+
   /*
    * Load all text then data then bss sections in seperate operations so each
    * type of section is grouped together.
@@ -669,9 +873,7 @@ rtems_rtl_obj_load_sections (rtems_rtl_obj_t*             obj,
       !rtems_rtl_obj_sections_loader (RTEMS_RTL_OBJ_SECT_BSS,
                                       obj, fd, obj->bss_base, handler, data))
   {
-    rtems_rtl_alloc_module_del (&obj->text_base, &obj->const_base,
-                                &obj->data_base, &obj->bss_base);
-    obj->exec_size = 0;
+    rtems_rtl_obj_release_sections (obj);
     return false;
   }
 
@@ -690,7 +892,7 @@ rtems_rtl_obj_run_cdtors (rtems_rtl_obj_t* obj, uint32_t mask)
       rtems_rtl_cdtor_t* handler;
       size_t             handlers = sect->size / sizeof (rtems_rtl_cdtor_t);
       int                c;
-      for (c = 0, handler = sect->base; c < handlers; ++c)
+      for (c = 0, handler = sect->base; c < handlers; ++c, ++handler)
         if (*handler)
           (*handler) ();
     }
@@ -938,11 +1140,141 @@ rtems_rtl_obj_archive_find (rtems_rtl_obj_t* obj, int fd)
   return false;
 }
 
+/**
+ * FNV-1a hash of a block of data.
+ */
+static uint32_t
+rtems_rtl_obj_fnv1a (uint32_t hash, const uint8_t* data, size_t size)
+{
+  while (size--)
+  {
+    hash ^= *data++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+bool
+rtems_rtl_obj_content_hash (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_obj_cache_t* cache;
+  uint32_t               hash = 2166136261UL;
+  uint32_t               crc = 0;
+  off_t                  off = obj->ooffset;
+  off_t                  end = obj->ooffset + obj->fsize;
+
+  if (obj->content_hash)
+    return true;
+
+  rtems_rtl_obj_caches (NULL, NULL, &cache);
+  if (!cache)
+    return false;
+
+  while (off < end)
+  {
+    uint8_t* data;
+    size_t   len = cache->size;
+
+    if ((end - off) < len)
+      len = end - off;
+
+    if (!rtems_rtl_obj_cache_read (cache, fd, off, (void**) &data, &len))
+      return false;
+
+    if (len == 0)
+    {
+      rtems_rtl_set_error (EIO, "content hash short read");
+      return false;
+    }
+
+    hash = rtems_rtl_obj_fnv1a (hash, data, len);
+    crc = rtems_rtl_crc32 (crc, data, len);
+    off += len;
+  }
+
+  /*
+   * Zero means not hashed.
+   */
+  if (hash == 0)
+    hash = 1;
+
+  obj->content_hash = hash;
+  obj->content_crc = crc;
+
+  return true;
+}
+
+#if RTEMS_RTL_RAP_LOADER && RTEMS_RTL_ELF_LOADER
+/*
+ * Load the object file's digest with the RAP loader. The object file's offset
+ * and size are the RAP file's in the digest while it loads.
+ */
+static bool
+rtems_rtl_obj_digest_load (rtems_rtl_obj_t* obj, int dfd)
+{
+  struct stat sb;
+  off_t       ooffset = obj->ooffset;
+  size_t      fsize = obj->fsize;
+  bool        ok = false;
+
+  if ((fstat (dfd, &sb) == 0) && (sb.st_size > RTEMS_RTL_DIGEST_SOURCE_SIZE))
+  {
+    obj->ooffset = RTEMS_RTL_DIGEST_SOURCE_SIZE;
+    obj->fsize = sb.st_size - RTEMS_RTL_DIGEST_SOURCE_SIZE;
+    ok = rtems_rtl_rap_file_check (obj, dfd) && rtems_rtl_rap_file_load (obj, dfd);
+    obj->ooffset = ooffset;
+    obj->fsize = fsize;
+  }
+
+  /*
+   * The caches hold the digest's data. A failed load reads the object file
+   * next.
+   */
+  rtems_rtl_obj_caches_flush ();
+  close (dfd);
+
+  return ok;
+}
+
+/*
+ * Remove what a failed digest load added to the object so the object file
+ * can be loaded.
+ */
+static void
+rtems_rtl_obj_digest_discard (rtems_rtl_obj_t* obj)
+{
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: digest: load failed: %s: %s\n",
+            rtems_rtl_obj_oname (obj), rtems_rtl_data ()->last_error);
+  rtems_rtl_symbol_obj_erase (obj);
+  rtems_rtl_obj_release_sections (obj);
+  rtems_rtl_obj_erase_sections (obj);
+  obj->unresolved = 0;
+  obj->flags &= ~(RTEMS_RTL_OBJ_UNRESOLVED | RTEMS_RTL_OBJ_PRELINKED);
+}
+#endif
+
 bool
 rtems_rtl_obj_file_load (rtems_rtl_obj_t* obj, int fd)
 {
   int l;
 
+#if RTEMS_RTL_RAP_LOADER && RTEMS_RTL_ELF_LOADER
+  /*
+   * An ELF object file transcoded by an earlier load is loaded from its
+   * digest. The ELF file is loaded if the digest cannot be.
+   */
+  {
+    int dfd = rtems_rtl_digest_open (obj, fd);
+    if (dfd >= 0)
+    {
+      if (rtems_rtl_obj_digest_load (obj, dfd))
+        return true;
+      rtems_rtl_obj_digest_discard (obj);
+    }
+  }
+#endif
+
   for (l = 0; l < (sizeof (loaders) / sizeof (rtems_rtl_loader_table_t)); ++l)
   {
     if (loaders[l].check (obj, fd))
@@ -953,23 +1285,35 @@ rtems_rtl_obj_file_load (rtems_rtl_obj_t* obj, int fd)
   return false;
 }
 
-bool
-rtems_rtl_obj_load (rtems_rtl_obj_t* obj)
+/*
+ * Open the object file's file. An error is set if the file cannot be opened.
+ */
+static int
+rtems_rtl_obj_open (rtems_rtl_obj_t* obj)
 {
   int fd;
 
   if (!rtems_rtl_obj_fname_valid (obj))
   {
     rtems_rtl_set_error (ENOMEM, "invalid object file name path");
-    return false;
+    return -1;
   }
 
   fd = open (rtems_rtl_obj_fname (obj), O_RDONLY);
   if (fd < 0)
-  {
     rtems_rtl_set_error (ENOMEM, "opening for object file");
+
+  return fd;
+}
+
+bool
+rtems_rtl_obj_load (rtems_rtl_obj_t* obj)
+{
+  int fd;
+
+  fd = rtems_rtl_obj_open (obj);
+  if (fd < 0)
     return false;
-  }
 
   /*
    * Find the object file in the archive if it is an archive that
@@ -1001,6 +1345,120 @@ rtems_rtl_obj_load (rtems_rtl_obj_t* obj)
 
   close (fd);
 
+  /*
+   * The text has been loaded and relocated. Make the instruction cache
+   * coherent with the data cache before any code in the object is run. A
+   * deferred load is made coherent when it ends.
+   */
+  if ((obj->flags & RTEMS_RTL_OBJ_DEFERRED) == 0)
+    rtems_rtl_obj_synchronize_cache (obj);
+
+  return true;
+}
+
+bool
+rtems_rtl_obj_load_begin (rtems_rtl_obj_t* obj)
+{
+  bool ok;
+  obj->flags |= RTEMS_RTL_OBJ_DEFER;
+  ok = rtems_rtl_obj_load (obj);
+  obj->flags &= ~RTEMS_RTL_OBJ_DEFER;
+  return ok;
+}
+
+bool
+rtems_rtl_obj_load_read (rtems_rtl_obj_t* obj, int* error)
+{
+#if RTEMS_RTL_ELF_LOADER
+  int  fd;
+  bool ok;
+
+  if ((obj->flags & RTEMS_RTL_OBJ_DEFERRED) == 0)
+    return true;
+
+  fd = open (rtems_rtl_obj_fname (obj), O_RDONLY);
+  if (fd < 0)
+  {
+    *error = errno;
+    return false;
+  }
+
+  ok = rtems_rtl_elf_file_read (obj, fd, error);
+
+  close (fd);
+
+  return ok;
+#else
+  return true;
+#endif
+}
+
+bool
+rtems_rtl_obj_load_end (rtems_rtl_obj_t* obj)
+{
+#if RTEMS_RTL_ELF_LOADER
+  int  fd;
+  bool ok;
+
+  if ((obj->flags & RTEMS_RTL_OBJ_DEFERRED) == 0)
+    return true;
+
+  fd = rtems_rtl_obj_open (obj);
+  if (fd < 0)
+    return false;
+
+  ok = rtems_rtl_elf_file_link (obj, fd);
+
+  rtems_rtl_obj_caches_flush ();
+
+  close (fd);
+
+  if (!ok)
+    return false;
+
+  obj->flags &= ~RTEMS_RTL_OBJ_DEFERRED;
+
+  rtems_rtl_obj_synchronize_cache (obj);
+#endif
+
+  return true;
+}
+
+bool
+rtems_rtl_obj_load_stream (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_obj_cache_t* cache;
+
+  if ((obj->flags & RTEMS_RTL_OBJ_STREAM) == 0)
+  {
+    rtems_rtl_set_error (EINVAL, "object is not a stream");
+    return false;
+  }
+
+  /*
+   * The format loaders read the file using the symbols cache. Streaming the
+   * cache lets the checks probe the header and the loader read forward from
+   * it without a seek.
+   */
+  rtems_rtl_obj_caches (&cache, NULL, NULL);
+  if (!cache)
+  {
+    rtems_rtl_set_error (ENOMEM, "no cache to stream with");
+    return false;
+  }
+
+  rtems_rtl_obj_cache_stream (cache, fd);
+
+  if (!rtems_rtl_obj_file_load (obj, fd))
+  {
+    rtems_rtl_obj_caches_flush ();
+    return false;
+  }
+
+  rtems_rtl_obj_caches_flush ();
+
+  rtems_rtl_obj_synchronize_cache (obj);
+
   return true;
 }
 
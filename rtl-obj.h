@@ -18,6 +18,7 @@
 
 #include <rtems.h>
 #include <rtems/chain.h>
+#include <rtl-allocator.h>
 #include <rtl-sym.h>
 #include <rtl-unresolved.h>
 
@@ -125,6 +126,19 @@ struct rtems_rtl_obj_sect_s
                                            *   be unloaded. */
 #define RTEMS_RTL_OBJ_UNRESOLVED (1 << 1) /**< The object file has unresolved
                                            *   external symbols. */
+#define RTEMS_RTL_OBJ_PRELINKED  (1 << 2) /**< The object file's sections were
+                                           *   restored relocated from the
+                                           *   prelink cache. */
+#define RTEMS_RTL_OBJ_STREAM     (1 << 3) /**< The object file is read forward
+                                           *   only from a stream. */
+#define RTEMS_RTL_OBJ_LAZY       (1 << 4) /**< Bind calls to external
+                                           *   functions on the first call. */
+#define RTEMS_RTL_OBJ_DEFER      (1 << 5) /**< Leave the sections to be read
+                                           *   by a later stage of the load
+                                           *   if the format can. */
+#define RTEMS_RTL_OBJ_DEFERRED   (1 << 6) /**< The sections are not read and
+                                           *   the object file is not
+                                           *   linked. */
 
 /**
  * RTL Object. There is one for each object module loaded plus one for the base
@@ -133,6 +147,10 @@ struct rtems_rtl_obj_sect_s
 struct rtems_rtl_obj_s
 {
   rtems_chain_node     link;         /**< The node's link in the chain. */
+  rtems_rtl_obj_t*     registry_next; /**< The next object file in the
+                                      *   registry's hash bucket. */
+  uint32_t             name_hash;    /**< The hash of the registry name. */
+  void*                handle;       /**< The handle returned by dlopen. */
   uint32_t             flags;        /**< The status of the object file. */
   uint32_t             users;        /**< References to the object file. */
   const char*          fname;        /**< The file name for the object. */
@@ -160,9 +178,40 @@ struct rtems_rtl_obj_s
   size_t               bss_size;     /**< The size of the bss section. */
   size_t               exec_size;    /**< The amount of executable memory
                                       * allocated */
+  void*                tramp_base;   /**< The trampoline area. It follows the
+                                      * text in memory. */
+  size_t               tramp_size;   /**< The size of the trampoline area. */
+  void*                tramp_brk;    /**< The next free trampoline. */
+  size_t               lazy_size;    /**< The size of the lazy binding stubs
+                                      * at the start of the trampoline
+                                      * area. */
+  void*                lazy_table;   /**< The lazy binding records. */
+  size_t               lazy_syms;    /**< The number of lazy binding
+                                      * records. */
+  size_t               text_size;    /**< The size of the text and trampolines
+                                      * in memory. */
+  void*                sync_start;   /**< The start of the text modified since
+                                      * the caches were last synchronized. */
+  void*                sync_end;     /**< The end of the modified text. */
+  uint32_t             content_hash; /**< The hash of the object file's
+                                      * content. A zero means the content has
+                                      * not been hashed. */
+  uint32_t             content_crc;  /**< The CRC32 of the object file's
+                                      * content. Valid if the content has been
+                                      * hashed. */
+  uint32_t             prelink_hash; /**< The hash of the object file's
+                                      * content. A zero means the object is
+                                      * not in the prelink cache. */
+  uint32_t             prelink_globals; /**< The global symbol table signature
+                                      * when the object was loaded. */
   void*                entry;        /**< The entry point of the module. */
-  uint32_t             checksum;     /**< The checksum of the text sections. A
-                                      * zero means do not checksum. */
+  uint32_t             checksum;     /**< The CRC32 of the text and
+                                      * trampolines. A zero means do not
+                                      * checksum. */
+  rtems_rtl_alloc_stats_t* alloc;     /**< The memory allocated to the
+                                      * object file when it was loaded
+                                      * indexed by tag. NULL if not
+                                      * recorded. */
 };
 
 /**
@@ -285,6 +334,18 @@ bool rtems_rtl_obj_unresolved (rtems_rtl_obj_t* obj);
  */
 bool rtems_rtl_obj_file_load (rtems_rtl_obj_t* obj, int fd);
 
+/**
+ * Hash the object file's content. The hash is an FNV-1a hash of the object
+ * file's data and is only taken once. The CRC32 of the data is taken with the
+ * hash. The caches that use the content to find an object file share the hash.
+ *
+ * @param obj The object file's descriptor.
+ * @param fd The object file's file descriptor.
+ * @retval true The content hash is set.
+ * @retval false The object file could not be read. The RTL error is set.
+ */
+bool rtems_rtl_obj_content_hash (rtems_rtl_obj_t* obj, int fd);
+
 /**
  * Check of the name matches the object file's object name.
  *
@@ -305,6 +366,17 @@ bool rtems_rtl_match_name (rtems_rtl_obj_t* obj, const char* name);
  */
 bool rtems_rtl_obj_find_file (rtems_rtl_obj_t* obj, const char* name);
 
+/**
+ * Name an object file read from a stream. The name is the object name and the
+ * file name. A stream cannot be an archive and its size is not known.
+ *
+ * @param obj The object file's descriptor.
+ * @param name The name of the object file.
+ * @retval true The object has been named.
+ * @retval false The name is not valid. The RTL error has been set.
+ */
+bool rtems_rtl_obj_stream_file (rtems_rtl_obj_t* obj, const char* name);
+
 /**
  * Add a section to the object descriptor.
  *
@@ -330,6 +402,15 @@ bool rtems_rtl_obj_add_section (rtems_rtl_obj_t* obj,
                                 int              info,
                                 uint32_t         flags);
 
+/**
+ * Erase a section from the object file descriptor.
+ *
+ * @param obj The object file's descriptor.
+ * @param sect The section to erase.
+ */
+void rtems_rtl_obj_erase_section (rtems_rtl_obj_t*      obj,
+                                  rtems_rtl_obj_sect_t* sect);
+
 /**
  * Erase the object file descriptor's sections.
  *
@@ -494,6 +575,67 @@ bool rtems_rtl_obj_load_symbols (rtems_rtl_obj_t*             obj,
                                  rtems_rtl_obj_sect_handler_t handler,
                                  void*                        data);
 
+/**
+ * Add a trampoline to the object file's trampoline area. Trampolines with
+ * identical code and data are shared so a target is only given one
+ * trampoline. The trampoline area is sized by the format loader before the
+ * sections are loaded.
+ *
+ * @param obj The object file's descriptor.
+ * @param tramp The trampoline's code and data.
+ * @param size The size of the trampoline.
+ * @retval NULL There is no space for the trampoline.
+ * @return void* The address of the trampoline.
+ */
+void* rtems_rtl_obj_tramp_add (rtems_rtl_obj_t* obj,
+                               const void*      tramp,
+                               size_t           size);
+
+/**
+ * Mark a range of the object file's text as modified. Ranges are coalesced
+ * into a single range that is synchronized with the instruction cache by the
+ * next call to @ref rtems_rtl_obj_synchronize_cache. Addresses outside the
+ * text and trampolines are ignored.
+ *
+ * @param obj The object file's descriptor.
+ * @param address The address of the modified text.
+ * @param size The size of the modified text.
+ */
+void rtems_rtl_obj_sync_mark (rtems_rtl_obj_t* obj,
+                              const void*      address,
+                              size_t           size);
+
+/**
+ * Synchronize the data and instruction caches for the text modified since the
+ * last call. The data cache is flushed and the instruction cache invalidated
+ * with one call each for the range. Nothing is done if no text has been
+ * modified.
+ *
+ * @param obj The object file's descriptor.
+ */
+void rtems_rtl_obj_synchronize_cache (rtems_rtl_obj_t* obj);
+
+/**
+ * Verify the object file's text has not changed since it was last
+ * synchronized. The checksum of the text is updated each time the caches are
+ * synchronized.
+ *
+ * @param obj The object file's descriptor.
+ * @retval true The text matches its checksum or there is no checksum.
+ * @retval false The text does not match its checksum.
+ */
+bool rtems_rtl_obj_verify_text (const rtems_rtl_obj_t* obj);
+
+/**
+ * Allocate the memory for the sections and set the base addresses of the
+ * text, const, data, bss and trampolines. The sections are not loaded.
+ *
+ * @param obj The object file's descriptor.
+ * @retval true The memory has been allocated.
+ * @retval false There is no memory. The RTL error has been set.
+ */
+bool rtems_rtl_obj_alloc_sections (rtems_rtl_obj_t* obj);
+
 /**
  * Load the sections that have been allocated memory in the target. The bss
  * type section does not load any data, it is set to 0. The text and data
@@ -541,6 +683,53 @@ void rtems_rtl_obj_run_dtors (rtems_rtl_obj_t* obj);
  */
 bool rtems_rtl_obj_load (rtems_rtl_obj_t* obj);
 
+/**
+ * Begin a staged load of the object file. The object file is parsed and its
+ * sections are allocated. A format that can defers reading the sections and
+ * linking the object file to @ref rtems_rtl_obj_load_read and
+ * @ref rtems_rtl_obj_load_end and other formats are loaded in full. The file
+ * is not held open between the stages.
+ *
+ * @param obj The object file's descriptor.
+ * @retval true The object file has been parsed or loaded.
+ * @retval false The load failed. The RTL error has been set.
+ */
+bool rtems_rtl_obj_load_begin (rtems_rtl_obj_t* obj);
+
+/**
+ * Read the deferred sections of an object file. The call does not use the RTL
+ * so it can be made by a work pool worker while the RTL is locked. Different
+ * object files can be read at the same time.
+ *
+ * @param obj The object file's descriptor.
+ * @param error The errno of a failure is returned here.
+ * @retval true The sections have been read or there was nothing to read.
+ * @retval false The read failed. The RTL error is not set.
+ */
+bool rtems_rtl_obj_load_read (rtems_rtl_obj_t* obj, int* error);
+
+/**
+ * End a staged load of the object file. The object file's symbols are loaded
+ * and it is relocated once its sections have been read.
+ *
+ * @param obj The object file's descriptor.
+ * @retval true The object file has been loaded.
+ * @retval false The load failed. The RTL error has been set.
+ */
+bool rtems_rtl_obj_load_end (rtems_rtl_obj_t* obj);
+
+/**
+ * Load the object file from a stream. The stream is read forward only so it
+ * can be a pipe or a socket. Only formats that can be loaded in one pass such
+ * as RAP can be streamed. The stream is not closed.
+ *
+ * @param obj The object file's descriptor.
+ * @param fd The file descriptor of the stream.
+ * @retval true The object file has been loaded.
+ * @retval false The load failed. The RTL error has been set.
+ */
+bool rtems_rtl_obj_load_stream (rtems_rtl_obj_t* obj, int fd);
+
 /**
  * Unload the object file, erasing all symbols and releasing all memory.
  *
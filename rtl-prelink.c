@@ -0,0 +1,288 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Prelink Cache.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <rtl.h>
+#include "rtl-error.h"
+#include "rtl-prelink.h"
+#include "rtl-string.h"
+#include "rtl-trace.h"
+
+/**
+ * The prelink cache file signature, "RTLP".
+ */
+#define RTEMS_RTL_PRELINK_MAGIC   (0x524c5450UL)
+
+/**
+ * The version of the prelink cache file format.
+ */
+#define RTEMS_RTL_PRELINK_VERSION (1)
+
+/**
+ * The maximum size of a prelink cache file path.
+ */
+#define RTEMS_RTL_PRELINK_PATH_MAX (256)
+
+/**
+ * The prelink cache file header. The relocated text, const and data images
+ * follow in that order. The file is only read on the target that wrote it so
+ * the header is in the target's byte order.
+ */
+typedef struct rtems_rtl_prelink_header_s
+{
+  uint32_t  magic;       /**< The file signature. */
+  uint32_t  version;     /**< The file format version. */
+  uint32_t  hash;        /**< The object file's content hash. */
+  uint32_t  fsize;       /**< The object file's size. */
+  uint32_t  globals;     /**< The global symbol table's signature. */
+  uintptr_t text_base;   /**< The text load address. */
+  uintptr_t const_base;  /**< The const load address. */
+  uintptr_t data_base;   /**< The data load address. */
+  uint32_t  text_size;   /**< The text image size, including trampolines. */
+  uint32_t  const_size;  /**< The const image size. */
+  uint32_t  data_size;   /**< The data image size. */
+  uint32_t  tramp_used;  /**< The size of the trampolines used. */
+} rtems_rtl_prelink_header_t;
+
+static bool
+rtems_rtl_prelink_filename (rtems_rtl_obj_t* obj, char* name, size_t size)
+{
+  const char* path = rtems_rtl_data ()->prelink;
+  int         len;
+  if (!path)
+    return false;
+  len = snprintf (name, size, "%s/%08lx.rpl",
+                  path, (unsigned long) obj->prelink_hash);
+  return (len > 0) && (len < size);
+}
+
+/*
+ * Fill the header with the object file's current state.
+ */
+static void
+rtems_rtl_prelink_header (rtems_rtl_obj_t*            obj,
+                          rtems_rtl_prelink_header_t* header)
+{
+  memset (header, 0, sizeof (*header));
+  header->magic = RTEMS_RTL_PRELINK_MAGIC;
+  header->version = RTEMS_RTL_PRELINK_VERSION;
+  header->hash = obj->prelink_hash;
+  header->fsize = obj->fsize;
+  header->globals = obj->prelink_globals;
+  header->text_base = (uintptr_t) obj->text_base;
+  header->const_base = (uintptr_t) obj->const_base;
+  header->data_base = (uintptr_t) obj->data_base;
+  header->text_size = obj->text_size;
+  header->const_size = rtems_rtl_obj_const_size (obj);
+  header->data_size = rtems_rtl_obj_data_size (obj);
+  if (obj->tramp_base)
+    header->tramp_used = (uint8_t*) obj->tramp_brk - (uint8_t*) obj->tramp_base;
+}
+
+bool
+rtems_rtl_prelink_path (const char* path)
+{
+  rtems_rtl_data_t* rtl;
+  char*             prelink = NULL;
+
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+  {
+    rtems_rtl_set_error (EINVAL, "prelink path cannot lock rtl");
+    return false;
+  }
+
+  if (path)
+  {
+    prelink = rtems_rtl_strdup (path);
+    if (!prelink)
+    {
+      rtems_rtl_set_error (ENOMEM, "no memory for prelink path");
+      rtems_rtl_unlock ();
+      return false;
+    }
+  }
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) rtl->prelink);
+  rtl->prelink = prelink;
+
+  rtems_rtl_unlock ();
+
+  return true;
+}
+
+bool
+rtems_rtl_prelink_key (rtems_rtl_obj_t* obj, int fd)
+{
+  obj->prelink_hash = 0;
+
+  if (!rtems_rtl_data ()->prelink)
+    return true;
+
+  if (!rtems_rtl_obj_content_hash (obj, fd))
+    return false;
+
+  obj->prelink_hash = obj->content_hash;
+  obj->prelink_globals = rtems_rtl_symbol_global_signature ();
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: prelink: key: %s hash=%08lx globals=%08lx\n",
+            rtems_rtl_obj_oname (obj), (unsigned long) obj->prelink_hash,
+            (unsigned long) obj->prelink_globals);
+
+  return true;
+}
+
+static bool
+rtems_rtl_prelink_read (int fd, void* buffer, size_t size)
+{
+  uint8_t* data = buffer;
+  while (size)
+  {
+    ssize_t r = read (fd, data, size);
+    if (r <= 0)
+      return false;
+    data += r;
+    size -= r;
+  }
+  return true;
+}
+
+static bool
+rtems_rtl_prelink_write (int fd, const void* buffer, size_t size)
+{
+  const uint8_t* data = buffer;
+  while (size)
+  {
+    ssize_t w = write (fd, data, size);
+    if (w <= 0)
+      return false;
+    data += w;
+    size -= w;
+  }
+  return true;
+}
+
+bool
+rtems_rtl_prelink_restore (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_prelink_header_t expected;
+  rtems_rtl_prelink_header_t header;
+  char                       name[RTEMS_RTL_PRELINK_PATH_MAX];
+  int                        fd;
+
+  if (!obj->prelink_hash ||
+      !rtems_rtl_prelink_filename (obj, name, sizeof (name)))
+    return false;
+
+  fd = open (name, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  rtems_rtl_prelink_header (obj, &expected);
+
+  if (!rtems_rtl_prelink_read (fd, &header, sizeof (header)))
+  {
+    close (fd);
+    return false;
+  }
+
+  /*
+   * The trampolines used is not known until the object is relocated.
+   */
+  expected.tramp_used = header.tramp_used;
+
+  if ((memcmp (&header, &expected, sizeof (header)) != 0) ||
+      (header.tramp_used > obj->tramp_size))
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: prelink: stale: %s\n", rtems_rtl_obj_oname (obj));
+    close (fd);
+    return false;
+  }
+
+  if (!rtems_rtl_prelink_read (fd, obj->text_base, header.text_size) ||
+      !rtems_rtl_prelink_read (fd, obj->const_base, header.const_size) ||
+      !rtems_rtl_prelink_read (fd, obj->data_base, header.data_size))
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: prelink: read failed: %s\n", name);
+    close (fd);
+    return false;
+  }
+
+  close (fd);
+
+  if (obj->tramp_base)
+    obj->tramp_brk = ((uint8_t*) obj->tramp_base) + header.tramp_used;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: prelink: restored: %s from %s\n",
+            rtems_rtl_obj_oname (obj), name);
+
+  return true;
+}
+
+void
+rtems_rtl_prelink_store (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_prelink_header_t header;
+  char                       name[RTEMS_RTL_PRELINK_PATH_MAX];
+  int                        fd;
+
+  if (!obj->prelink_hash || obj->unresolved ||
+      !rtems_rtl_prelink_filename (obj, name, sizeof (name)))
+    return;
+
+  fd = open (name, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: prelink: cannot create: %s\n", name);
+    return;
+  }
+
+  rtems_rtl_prelink_header (obj, &header);
+
+  if (!rtems_rtl_prelink_write (fd, &header, sizeof (header)) ||
+      !rtems_rtl_prelink_write (fd, obj->text_base, header.text_size) ||
+      !rtems_rtl_prelink_write (fd, obj->const_base, header.const_size) ||
+      !rtems_rtl_prelink_write (fd, obj->data_base, header.data_size))
+  {
+    /*
+     * Do not leave a partial entry in the cache.
+     */
+    close (fd);
+    unlink (name);
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: prelink: write failed: %s\n", name);
+    return;
+  }
+
+  close (fd);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: prelink: stored: %s in %s\n", rtems_rtl_obj_oname (obj), name);
+}
@@ -0,0 +1,84 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Prelink Cache.
+ *
+ * The prelink cache holds the relocated section images of object files in a
+ * directory. An object file is found in the cache using a hash of its
+ * content. The cached images are used if the global symbol table's signature
+ * and the addresses the sections are loaded at are the same as when the images
+ * were stored. The images are copied into place and the object file's
+ * relocation records are not processed. Any difference and the object file is
+ * loaded and relocated and the cache entry replaced.
+ *
+ * Only object files with no unresolved externals are stored.
+ */
+
+#if !defined (_RTEMS_RTL_PRELINK_H_)
+#define _RTEMS_RTL_PRELINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <rtl-obj-fwd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Set the prelink cache directory. The directory must exist. A NULL path
+ * disables the prelink cache. The cache is disabled by default.
+ *
+ * @param path The prelink cache directory.
+ * @retval true The prelink cache path has been set.
+ * @retval false The path could not be set. The RTL error is set.
+ */
+bool rtems_rtl_prelink_path (const char* path);
+
+/**
+ * Calculate the prelink key of the object file. The object file's content is
+ * hashed and the global symbol table's signature is taken. Nothing is done if
+ * the prelink cache is disabled.
+ *
+ * @param obj The object file's descriptor.
+ * @param fd The object file's file descriptor.
+ * @retval true The key has been calculated or the cache is disabled.
+ * @retval false The object file could not be read. The RTL error is set.
+ */
+bool rtems_rtl_prelink_key (rtems_rtl_obj_t* obj, int fd);
+
+/**
+ * Restore the object file's relocated section images from the prelink
+ * cache. The section memory has been allocated. If the images cannot be
+ * restored the sections are loaded and relocated as normal.
+ *
+ * @param obj The object file's descriptor.
+ * @retval true The section images have been restored.
+ * @retval false There is no matching cache entry.
+ */
+bool rtems_rtl_prelink_restore (rtems_rtl_obj_t* obj);
+
+/**
+ * Store the object file's relocated section images in the prelink cache. An
+ * object file with unresolved externals is not stored. A failure to store
+ * is not an error.
+ *
+ * @param obj The object file's descriptor.
+ */
+void rtems_rtl_prelink_store (rtems_rtl_obj_t* obj);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,2291 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker RAP Packer.
+ *
+ * A host tool that converts a 32 bit relocatable ELF object file into a RAP
+ * file the RAP loader can load. The allocated sections of the object file are
+ * merged into the 6 RAP sections. Only the symbols the object exports are
+ * placed in the RAP symbol table. Relocations against local symbols and
+ * against global symbols the object defines are turned into section relative
+ * relocations so the loader does not look them up. The relocations of each
+ * section are sorted by type and then offset so the loader runs the same
+ * relocation handler over neighbouring addresses.
+ *
+ * The compression level and block size can be set for each section or tuned.
+ * Tuning compresses each section at each level and block size and times the
+ * decompression. The combination with the lowest estimated load time for the
+ * read rate of the target's media is selected. The packer reports the size
+ * and decode time of each part of the file.
+ *
+ * A set of modules built from the same code shares byte sequences each
+ * module's blocks compress on their own. The packer can train a dictionary
+ * from the loaded data of a set of object files and pack LZ4 files with it.
+ * Each block is compressed with the dictionary in front of it so blocks can
+ * still be decompressed on their own. The target loads the dictionary before
+ * loading the modules.
+ *
+ * The packer only uses standard C. It is not part of the target build. A host
+ * build is:
+ *
+ *  cc -O2 -I. -o rtl-rap-pack rtl-rap-pack.c rtl-crc.c rtl-lz4.c fastlz.c
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fastlz.h"
+#include "rtl-crc.h"
+#include "rtl-lz4.h"
+
+/**
+ * The ELF definitions the packer uses. The host may not have an elf.h so the
+ * values are defined here.
+ */
+#define RTEMS_RTL_RAP_PACK_EI_CLASS   (4)
+#define RTEMS_RTL_RAP_PACK_EI_DATA    (5)
+#define RTEMS_RTL_RAP_PACK_CLASS32    (1)
+#define RTEMS_RTL_RAP_PACK_DATA2LSB   (1)
+#define RTEMS_RTL_RAP_PACK_DATA2MSB   (2)
+#define RTEMS_RTL_RAP_PACK_ET_REL     (1)
+#define RTEMS_RTL_RAP_PACK_EM_SPARC   (2)
+#define RTEMS_RTL_RAP_PACK_EM_SPARC32PLUS (18)
+
+#define RTEMS_RTL_RAP_PACK_SHT_PROGBITS   (1)
+#define RTEMS_RTL_RAP_PACK_SHT_SYMTAB     (2)
+#define RTEMS_RTL_RAP_PACK_SHT_RELA       (4)
+#define RTEMS_RTL_RAP_PACK_SHT_NOBITS     (8)
+#define RTEMS_RTL_RAP_PACK_SHT_REL        (9)
+#define RTEMS_RTL_RAP_PACK_SHT_INIT_ARRAY (14)
+#define RTEMS_RTL_RAP_PACK_SHT_FINI_ARRAY (15)
+
+#define RTEMS_RTL_RAP_PACK_SHF_WRITE     (1 << 0)
+#define RTEMS_RTL_RAP_PACK_SHF_ALLOC     (1 << 1)
+#define RTEMS_RTL_RAP_PACK_SHF_EXECINSTR (1 << 2)
+
+#define RTEMS_RTL_RAP_PACK_SHN_UNDEF  (0)
+#define RTEMS_RTL_RAP_PACK_SHN_LORESERVE (0xff00)
+#define RTEMS_RTL_RAP_PACK_SHN_COMMON (0xfff2)
+
+#define RTEMS_RTL_RAP_PACK_STB_LOCAL  (0)
+#define RTEMS_RTL_RAP_PACK_STB_WEAK   (2)
+#define RTEMS_RTL_RAP_PACK_STV_DEFAULT   (0)
+#define RTEMS_RTL_RAP_PACK_STV_PROTECTED (3)
+
+#define RTEMS_RTL_RAP_PACK_EHDR_SIZE  (52)
+#define RTEMS_RTL_RAP_PACK_SHDR_SIZE  (40)
+#define RTEMS_RTL_RAP_PACK_SYM_SIZE   (16)
+#define RTEMS_RTL_RAP_PACK_REL_SIZE   (8)
+#define RTEMS_RTL_RAP_PACK_RELA_SIZE  (12)
+
+/**
+ * The RAP section indexes. These match the loader.
+ */
+#define RTEMS_RTL_RAP_PACK_TEXT_SEC  (0)
+#define RTEMS_RTL_RAP_PACK_CONST_SEC (1)
+#define RTEMS_RTL_RAP_PACK_CTOR_SEC  (2)
+#define RTEMS_RTL_RAP_PACK_DTOR_SEC  (3)
+#define RTEMS_RTL_RAP_PACK_DATA_SEC  (4)
+#define RTEMS_RTL_RAP_PACK_BSS_SEC   (5)
+#define RTEMS_RTL_RAP_PACK_SECS      (6)
+
+/**
+ * The sections with data in the file. The bss section has no data.
+ */
+#define RTEMS_RTL_RAP_PACK_DATA_SECS (5)
+
+/**
+ * The block index section of a block that does not hold section data.
+ */
+#define RTEMS_RTL_RAP_PACK_NO_SEC (0xffffffffUL)
+
+/**
+ * The version 2 flags for compact relocations, symbol hashes and a
+ * dictionary.
+ */
+#define RTEMS_RTL_RAP_PACK_FLAG_COMPACT_RELOCS (1 << 0)
+#define RTEMS_RTL_RAP_PACK_FLAG_SYMBOL_HASHES  (1 << 1)
+#define RTEMS_RTL_RAP_PACK_FLAG_DICTIONARY     (1 << 2)
+
+/**
+ * The size of a version 2 block index entry.
+ */
+#define RTEMS_RTL_RAP_PACK_BLOCK_ENTRY (4 * sizeof (uint32_t))
+
+/**
+ * The compression types. These match the loader.
+ */
+#define RTEMS_RTL_RAP_PACK_COMP_NONE (0)
+#define RTEMS_RTL_RAP_PACK_COMP_LZ77 (1)
+#define RTEMS_RTL_RAP_PACK_COMP_LZ4  (2)
+
+/**
+ * The largest block read through the loader's decompression stream. This is
+ * the size of the loader's decompression buffer and file cache. The header,
+ * symbols and relocations are read through the stream as are the sections of
+ * a version 1 file. The compressed size of the block has to fit as well.
+ */
+#define RTEMS_RTL_RAP_PACK_STREAM_BLOCK (2048)
+
+/**
+ * The largest block of a version 2 section. The compressed size has to fit in
+ * the 16 bit block size field.
+ */
+#define RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX (32768)
+
+/**
+ * The smallest block size.
+ */
+#define RTEMS_RTL_RAP_PACK_BLOCK_MIN (256)
+
+/**
+ * The largest compressed block.
+ */
+#define RTEMS_RTL_RAP_PACK_CSIZE_MAX (65535)
+
+/**
+ * The loader's buffer for a symbol name appended to a relocation record.
+ */
+#define RTEMS_RTL_RAP_PACK_SYMNAME_MAX (1024)
+
+/**
+ * The largest string table offset a relocation record can hold.
+ */
+#define RTEMS_RTL_RAP_PACK_STRTAB_MAX (1UL << 22)
+
+/**
+ * A symbol with no name in the string table.
+ */
+#define RTEMS_RTL_RAP_PACK_NO_NAME (0xffffffffUL)
+
+/**
+ * The default number of timed decode runs.
+ */
+#define RTEMS_RTL_RAP_PACK_RUNS (20)
+
+/**
+ * The default read rate of the target's media in KBytes per second.
+ */
+#define RTEMS_RTL_RAP_PACK_RATE (1024)
+
+/**
+ * The default size of a trained dictionary.
+ */
+#define RTEMS_RTL_RAP_PACK_DICT_SIZE (16384)
+
+/**
+ * The size of the segments of the samples a dictionary is made from and the
+ * size of the sequences counted to score the segments.
+ */
+#define RTEMS_RTL_RAP_PACK_DICT_SEGMENT (64)
+#define RTEMS_RTL_RAP_PACK_DICT_KMER    (8)
+
+/**
+ * The size of the table counting the sequences. The count is approximate as
+ * sequences with the same hash are counted together.
+ */
+#define RTEMS_RTL_RAP_PACK_DICT_HASH_LOG (20)
+
+/**
+ * The parts of a RAP file. Each part starts in a new block.
+ */
+#define RTEMS_RTL_RAP_PACK_HEADER_PART (0)
+#define RTEMS_RTL_RAP_PACK_TAIL_PART   (RTEMS_RTL_RAP_PACK_DATA_SECS + 1)
+#define RTEMS_RTL_RAP_PACK_PARTS       (RTEMS_RTL_RAP_PACK_DATA_SECS + 2)
+
+static const char* rap_sections[RTEMS_RTL_RAP_PACK_SECS] =
+{
+  ".text", ".const", ".ctor", ".dtor", ".data", ".bss"
+};
+
+/**
+ * The block sizes tried when tuning a section.
+ */
+static const size_t tune_blocks[] =
+{
+  512, 1024, 2048, 4096, 8192, 16384, 32768
+};
+
+#define RTEMS_RTL_RAP_PACK_TUNE_BLOCKS (sizeof (tune_blocks) / sizeof (tune_blocks[0]))
+
+/**
+ * A growable buffer.
+ */
+typedef struct rtems_rtl_rap_pack_buf_s
+{
+  uint8_t* data;      /**< The data. */
+  size_t   size;      /**< The size of the data. */
+  size_t   capacity;  /**< The size of the buffer. */
+} rtems_rtl_rap_pack_buf_t;
+
+/**
+ * An ELF section.
+ */
+typedef struct rtems_rtl_rap_pack_sect_s
+{
+  const char* name;        /**< The section's name. */
+  uint32_t    type;        /**< The section type. */
+  uint32_t    flags;       /**< The section flags. */
+  uint32_t    offset;      /**< The offset of the data in the file. */
+  uint32_t    size;        /**< The size of the section. */
+  uint32_t    link;        /**< The link field. */
+  uint32_t    info;        /**< The info field. */
+  uint32_t    alignment;   /**< The alignment. */
+  int         rap;         /**< The RAP section or -1 if not loaded. */
+  uint32_t    rap_offset;  /**< The offset in the RAP section. */
+} rtems_rtl_rap_pack_sect_t;
+
+/**
+ * An ELF symbol.
+ */
+typedef struct rtems_rtl_rap_pack_sym_s
+{
+  const char* name;       /**< The symbol's name. */
+  uint32_t    value;      /**< The ELF value. */
+  uint32_t    size;       /**< The ELF size. */
+  uint8_t     info;       /**< The binding and type. */
+  uint8_t     other;      /**< The visibility. */
+  uint16_t    shndx;      /**< The ELF section index. */
+  int         rap;        /**< The RAP section or -1 if not defined. */
+  uint32_t    rap_value;  /**< The value in the RAP section. */
+  bool        exported;   /**< The symbol is in the RAP symbol table. */
+  uint32_t    strtab;     /**< The RAP string table offset of the name. */
+} rtems_rtl_rap_pack_sym_t;
+
+/**
+ * A RAP relocation record.
+ */
+typedef struct rtems_rtl_rap_pack_reloc_s
+{
+  uint32_t    info;        /**< The RAP info field. */
+  uint32_t    offset;      /**< The offset in the RAP section. */
+  uint32_t    addend;      /**< The addend. */
+  bool        has_addend;  /**< The record has an addend field. */
+  const char* name;        /**< The appended symbol name or NULL. */
+  size_t      order;       /**< The order in the ELF file. */
+} rtems_rtl_rap_pack_reloc_t;
+
+/**
+ * A part of the RAP file compressed as a run of blocks.
+ */
+typedef struct rtems_rtl_rap_pack_part_s
+{
+  const char*              label;       /**< The label printed. */
+  uint32_t                 section;     /**< The section or NO_SEC. */
+  rtems_rtl_rap_pack_buf_t raw;         /**< The uncompressed data. */
+  int                      level;       /**< The compression level. */
+  size_t                   block_size;  /**< The block size. */
+  rtems_rtl_rap_pack_buf_t packed;      /**< The blocks with their sizes. */
+  uint32_t*                sizes;       /**< The size of each block. */
+  uint32_t                 blocks;      /**< The number of blocks. */
+  uint64_t                 decode_ns;   /**< The time to decode the part. */
+} rtems_rtl_rap_pack_part_t;
+
+/**
+ * The packer.
+ */
+typedef struct rtems_rtl_rap_pack_s
+{
+  const char*                 input;        /**< The input file name. */
+  const char*                 output;       /**< The output file name. */
+  int                         version;      /**< The RAP version. */
+  int                         compression;  /**< The compression. */
+  int                         level;        /**< The default level. */
+  size_t                      block_size;   /**< The default block size. */
+  int                         levels[RTEMS_RTL_RAP_PACK_DATA_SECS];
+  size_t                      block_sizes[RTEMS_RTL_RAP_PACK_DATA_SECS];
+  bool                        fixed_relocs; /**< Fixed size relocations. */
+  bool                        compact_relocs; /**< Compact relocations. */
+  bool                        no_hashes;    /**< No symbol hashes. */
+  bool                        symbol_hashes; /**< Symbol hashes. */
+  bool                        tune;         /**< Tune the sections. */
+  int                         runs;         /**< The timed decode runs. */
+  unsigned long               rate;         /**< The read rate in KB/s. */
+  double                      scale;        /**< Target to host decode time. */
+  bool                        verbose;      /**< Print the details. */
+  uint8_t*                    image;        /**< The ELF file. */
+  size_t                      image_size;   /**< The ELF file's size. */
+  bool                        big_endian;   /**< The ELF file is big endian. */
+  uint32_t                    machinetype;  /**< The ELF machine type. */
+  uint32_t                    datatype;     /**< The ELF data type. */
+  uint32_t                    class;        /**< The ELF class. */
+  rtems_rtl_rap_pack_sect_t*  sects;        /**< The ELF sections. */
+  uint32_t                    nsects;       /**< The number of sections. */
+  rtems_rtl_rap_pack_sym_t*   syms;         /**< The ELF symbols. */
+  uint32_t                    nsyms;        /**< The number of symbols. */
+  uint32_t                    symtab;       /**< The symbol table section. */
+  uint32_t                    sizes[RTEMS_RTL_RAP_PACK_SECS];
+  uint32_t                    alignments[RTEMS_RTL_RAP_PACK_SECS];
+  rtems_rtl_rap_pack_buf_t    strtab;       /**< The RAP string table. */
+  rtems_rtl_rap_pack_buf_t    symbols;      /**< The RAP symbol table. */
+  rtems_rtl_rap_pack_buf_t    relocs;       /**< The RAP relocation records. */
+  rtems_rtl_rap_pack_reloc_t* sect_relocs[RTEMS_RTL_RAP_PACK_SECS];
+  size_t                      sect_nrelocs[RTEMS_RTL_RAP_PACK_SECS];
+  int                         sect_rela[RTEMS_RTL_RAP_PACK_SECS];
+  rtems_rtl_rap_pack_part_t   parts[RTEMS_RTL_RAP_PACK_PARTS];
+  uint8_t*                    scratch;      /**< Compressor output. */
+  uint8_t*                    decoded;      /**< Decompressor output. */
+  rtems_rtl_rap_pack_buf_t    dict;         /**< The dictionary. */
+  uint32_t                    dict_crc;     /**< The dictionary's CRC32. */
+  uint8_t*                    dict_input;   /**< The dictionary followed by
+                                             *   the block compressed. */
+} rtems_rtl_rap_pack_t;
+
+static void
+rtems_rtl_rap_pack_error (const char* format, ...)
+{
+  va_list ap;
+  va_start (ap, format);
+  fprintf (stderr, "error: ");
+  vfprintf (stderr, format, ap);
+  fprintf (stderr, "\n");
+  va_end (ap);
+}
+
+static uint64_t
+rtems_rtl_rap_pack_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static bool
+rtems_rtl_rap_pack_buf_append (rtems_rtl_rap_pack_buf_t* buf,
+                               const void*               data,
+                               size_t                    size)
+{
+  if ((buf->size + size) > buf->capacity)
+  {
+    size_t   capacity = buf->capacity ? buf->capacity : 1024;
+    uint8_t* bigger;
+    while (capacity < (buf->size + size))
+      capacity *= 2;
+    bigger = realloc (buf->data, capacity);
+    if (!bigger)
+    {
+      rtems_rtl_rap_pack_error ("no memory");
+      return false;
+    }
+    buf->data = bigger;
+    buf->capacity = capacity;
+  }
+  if (data)
+    memcpy (buf->data + buf->size, data, size);
+  else
+    memset (buf->data + buf->size, 0, size);
+  buf->size += size;
+  return true;
+}
+
+static bool
+rtems_rtl_rap_pack_buf_uint32 (rtems_rtl_rap_pack_buf_t* buf, uint32_t value)
+{
+  uint8_t be[4];
+  be[0] = (value >> 24) & 0xff;
+  be[1] = (value >> 16) & 0xff;
+  be[2] = (value >> 8) & 0xff;
+  be[3] = value & 0xff;
+  return rtems_rtl_rap_pack_buf_append (buf, be, sizeof (be));
+}
+
+static void
+rtems_rtl_rap_pack_buf_free (rtems_rtl_rap_pack_buf_t* buf)
+{
+  free (buf->data);
+  buf->data = NULL;
+  buf->size = 0;
+  buf->capacity = 0;
+}
+
+static uint32_t
+rtems_rtl_rap_pack_align (uint32_t value, uint32_t alignment)
+{
+  if (alignment < 2)
+    return value;
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint16_t
+rtems_rtl_rap_pack_get16 (const rtems_rtl_rap_pack_t* pack, const uint8_t* p)
+{
+  if (pack->big_endian)
+    return (p[0] << 8) | p[1];
+  return (p[1] << 8) | p[0];
+}
+
+static uint32_t
+rtems_rtl_rap_pack_get32 (const rtems_rtl_rap_pack_t* pack, const uint8_t* p)
+{
+  if (pack->big_endian)
+    return (((uint32_t) p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  return (((uint32_t) p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+static bool
+rtems_rtl_rap_pack_in_image (const rtems_rtl_rap_pack_t* pack,
+                             uint32_t                    offset,
+                             uint32_t                    size)
+{
+  return (offset <= pack->image_size) && (size <= (pack->image_size - offset));
+}
+
+static const char*
+rtems_rtl_rap_pack_string (const rtems_rtl_rap_pack_t* pack,
+                           uint32_t                    section,
+                           uint32_t                    offset)
+{
+  const rtems_rtl_rap_pack_sect_t* sect;
+
+  if (section >= pack->nsects)
+    return NULL;
+
+  sect = &pack->sects[section];
+
+  if ((offset >= sect->size) ||
+      (memchr (pack->image + sect->offset + offset, '\0',
+               sect->size - offset) == NULL))
+    return NULL;
+
+  return (const char*) pack->image + sect->offset + offset;
+}
+
+static bool
+rtems_rtl_rap_pack_file_load (const char* name, uint8_t** data, size_t* size)
+{
+  FILE* file;
+  long  length;
+
+  file = fopen (name, "rb");
+  if (!file)
+  {
+    rtems_rtl_rap_pack_error ("cannot open: %s", name);
+    return false;
+  }
+
+  if ((fseek (file, 0, SEEK_END) != 0) ||
+      ((length = ftell (file)) <= 0) ||
+      (fseek (file, 0, SEEK_SET) != 0))
+  {
+    rtems_rtl_rap_pack_error ("cannot size: %s", name);
+    fclose (file);
+    return false;
+  }
+
+  *data = malloc (length);
+  if (!*data)
+  {
+    rtems_rtl_rap_pack_error ("no memory for the file: %s", name);
+    fclose (file);
+    return false;
+  }
+
+  if (fread (*data, 1, length, file) != length)
+  {
+    rtems_rtl_rap_pack_error ("cannot read: %s", name);
+    fclose (file);
+    return false;
+  }
+
+  fclose (file);
+
+  *size = length;
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_pack_read (rtems_rtl_rap_pack_t* pack)
+{
+  return rtems_rtl_rap_pack_file_load (pack->input,
+                                       &pack->image, &pack->image_size);
+}
+
+/*
+ * Map an allocated ELF section to a RAP section. The ctor and dtor sections
+ * are found by name the same way the ELF loader finds them.
+ */
+static int
+rtems_rtl_rap_pack_rap_section (const rtems_rtl_rap_pack_sect_t* sect)
+{
+  if ((sect->flags & RTEMS_RTL_RAP_PACK_SHF_ALLOC) == 0)
+    return -1;
+
+  switch (sect->type)
+  {
+    case RTEMS_RTL_RAP_PACK_SHT_INIT_ARRAY:
+      return RTEMS_RTL_RAP_PACK_CTOR_SEC;
+    case RTEMS_RTL_RAP_PACK_SHT_FINI_ARRAY:
+      return RTEMS_RTL_RAP_PACK_DTOR_SEC;
+    case RTEMS_RTL_RAP_PACK_SHT_PROGBITS:
+      if ((strcmp (sect->name, ".ctors") == 0) ||
+          (strncmp (sect->name, ".ctors.", 7) == 0))
+        return RTEMS_RTL_RAP_PACK_CTOR_SEC;
+      if ((strcmp (sect->name, ".dtors") == 0) ||
+          (strncmp (sect->name, ".dtors.", 7) == 0))
+        return RTEMS_RTL_RAP_PACK_DTOR_SEC;
+      if ((sect->flags & RTEMS_RTL_RAP_PACK_SHF_EXECINSTR) != 0)
+        return RTEMS_RTL_RAP_PACK_TEXT_SEC;
+      if ((sect->flags & RTEMS_RTL_RAP_PACK_SHF_WRITE) != 0)
+        return RTEMS_RTL_RAP_PACK_DATA_SEC;
+      return RTEMS_RTL_RAP_PACK_CONST_SEC;
+    case RTEMS_RTL_RAP_PACK_SHT_NOBITS:
+      if ((sect->flags & RTEMS_RTL_RAP_PACK_SHF_WRITE) != 0)
+        return RTEMS_RTL_RAP_PACK_BSS_SEC;
+      break;
+    default:
+      break;
+  }
+
+  return -1;
+}
+
+/*
+ * Load the section headers and place each allocated section in its RAP
+ * section.
+ */
+static bool
+rtems_rtl_rap_pack_sections (rtems_rtl_rap_pack_t* pack)
+{
+  const uint8_t* ehdr = pack->image;
+  uint32_t       shoff;
+  uint32_t       shstrndx;
+  uint32_t       s;
+  int            r;
+
+  if ((pack->image_size < RTEMS_RTL_RAP_PACK_EHDR_SIZE) ||
+      (memcmp (ehdr, "\177ELF", 4) != 0))
+  {
+    rtems_rtl_rap_pack_error ("not an ELF file: %s", pack->input);
+    return false;
+  }
+
+  if (ehdr[RTEMS_RTL_RAP_PACK_EI_CLASS] != RTEMS_RTL_RAP_PACK_CLASS32)
+  {
+    rtems_rtl_rap_pack_error ("not a 32 bit ELF file: %s", pack->input);
+    return false;
+  }
+
+  switch (ehdr[RTEMS_RTL_RAP_PACK_EI_DATA])
+  {
+    case RTEMS_RTL_RAP_PACK_DATA2LSB:
+      pack->big_endian = false;
+      break;
+    case RTEMS_RTL_RAP_PACK_DATA2MSB:
+      pack->big_endian = true;
+      break;
+    default:
+      rtems_rtl_rap_pack_error ("invalid ELF data type: %s", pack->input);
+      return false;
+  }
+
+  if (rtems_rtl_rap_pack_get16 (pack, ehdr + 16) != RTEMS_RTL_RAP_PACK_ET_REL)
+  {
+    rtems_rtl_rap_pack_error ("not a relocatable object file: %s", pack->input);
+    return false;
+  }
+
+  pack->class = ehdr[RTEMS_RTL_RAP_PACK_EI_CLASS];
+  pack->datatype = ehdr[RTEMS_RTL_RAP_PACK_EI_DATA];
+  pack->machinetype = rtems_rtl_rap_pack_get16 (pack, ehdr + 18);
+
+  shoff = rtems_rtl_rap_pack_get32 (pack, ehdr + 32);
+  pack->nsects = rtems_rtl_rap_pack_get16 (pack, ehdr + 48);
+  shstrndx = rtems_rtl_rap_pack_get16 (pack, ehdr + 50);
+
+  if ((rtems_rtl_rap_pack_get16 (pack, ehdr + 46) != RTEMS_RTL_RAP_PACK_SHDR_SIZE) ||
+      !rtems_rtl_rap_pack_in_image (pack, shoff,
+                                    pack->nsects * RTEMS_RTL_RAP_PACK_SHDR_SIZE) ||
+      (shstrndx >= pack->nsects))
+  {
+    rtems_rtl_rap_pack_error ("invalid section headers: %s", pack->input);
+    return false;
+  }
+
+  pack->sects = calloc (pack->nsects, sizeof (rtems_rtl_rap_pack_sect_t));
+  if (!pack->sects)
+  {
+    rtems_rtl_rap_pack_error ("no memory for the sections");
+    return false;
+  }
+
+  for (s = 0; s < pack->nsects; ++s)
+  {
+    rtems_rtl_rap_pack_sect_t* sect = &pack->sects[s];
+    const uint8_t*             shdr;
+
+    shdr = pack->image + shoff + (s * RTEMS_RTL_RAP_PACK_SHDR_SIZE);
+
+    sect->type = rtems_rtl_rap_pack_get32 (pack, shdr + 4);
+    sect->flags = rtems_rtl_rap_pack_get32 (pack, shdr + 8);
+    sect->offset = rtems_rtl_rap_pack_get32 (pack, shdr + 16);
+    sect->size = rtems_rtl_rap_pack_get32 (pack, shdr + 20);
+    sect->link = rtems_rtl_rap_pack_get32 (pack, shdr + 24);
+    sect->info = rtems_rtl_rap_pack_get32 (pack, shdr + 28);
+    sect->alignment = rtems_rtl_rap_pack_get32 (pack, shdr + 32);
+    sect->rap = -1;
+
+    if ((sect->type != RTEMS_RTL_RAP_PACK_SHT_NOBITS) &&
+        !rtems_rtl_rap_pack_in_image (pack, sect->offset, sect->size))
+    {
+      rtems_rtl_rap_pack_error ("invalid section: %lu", (unsigned long) s);
+      return false;
+    }
+  }
+
+  for (s = 0; s < pack->nsects; ++s)
+  {
+    rtems_rtl_rap_pack_sect_t* sect = &pack->sects[s];
+    const uint8_t*             shdr;
+
+    shdr = pack->image + shoff + (s * RTEMS_RTL_RAP_PACK_SHDR_SIZE);
+
+    sect->name = rtems_rtl_rap_pack_string (pack, shstrndx,
+                                            rtems_rtl_rap_pack_get32 (pack, shdr));
+    if (!sect->name)
+      sect->name = "";
+
+    if (sect->type == RTEMS_RTL_RAP_PACK_SHT_SYMTAB)
+      pack->symtab = s;
+
+    sect->rap = rtems_rtl_rap_pack_rap_section (sect);
+
+    if ((sect->rap < 0) &&
+        ((sect->flags & RTEMS_RTL_RAP_PACK_SHF_ALLOC) != 0) &&
+        (sect->size != 0))
+      printf ("warning: section not loaded: %s\n", sect->name);
+  }
+
+  /*
+   * Place the sections in the order they appear in the file.
+   */
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_SECS; ++r)
+  {
+    pack->sizes[r] = 0;
+    pack->alignments[r] = 1;
+
+    for (s = 0; s < pack->nsects; ++s)
+    {
+      rtems_rtl_rap_pack_sect_t* sect = &pack->sects[s];
+      if (sect->rap == r)
+      {
+        uint32_t alignment = sect->alignment ? sect->alignment : 1;
+        if ((alignment & (alignment - 1)) != 0)
+        {
+          rtems_rtl_rap_pack_error ("invalid alignment: %s", sect->name);
+          return false;
+        }
+        sect->rap_offset = rtems_rtl_rap_pack_align (pack->sizes[r], alignment);
+        pack->sizes[r] = sect->rap_offset + sect->size;
+        if (alignment > pack->alignments[r])
+          pack->alignments[r] = alignment;
+        if (pack->verbose)
+          printf ("%-8s <- %-20s offset=%-8lu size=%lu\n",
+                  rap_sections[r], sect->name,
+                  (unsigned long) sect->rap_offset,
+                  (unsigned long) sect->size);
+      }
+    }
+  }
+
+  if (pack->symtab == 0)
+  {
+    rtems_rtl_rap_pack_error ("no symbol table: %s", pack->input);
+    return false;
+  }
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_pack_strtab_add (rtems_rtl_rap_pack_t*     pack,
+                               rtems_rtl_rap_pack_sym_t* sym)
+{
+  if (sym->strtab == RTEMS_RTL_RAP_PACK_NO_NAME)
+  {
+    sym->strtab = pack->strtab.size;
+    if (!rtems_rtl_rap_pack_buf_append (&pack->strtab,
+                                        sym->name, strlen (sym->name) + 1))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * The hash of a symbol's name. This is the loader's global symbol table hash
+ * in rtl-sym.c.
+ */
+static uint32_t
+rtems_rtl_rap_pack_hash (const char* s)
+{
+  uint32_t      h = 5381;
+  unsigned char c;
+  for (c = *s; c != '\0'; c = *++s)
+    h = h * 33 + c;
+  return h;
+}
+
+/*
+ * Load the symbols and create the RAP symbol table. Only the global and weak
+ * symbols the object defines that are not hidden are exported. Common
+ * symbols are allocated in the bss section.
+ */
+static bool
+rtems_rtl_rap_pack_symbols (rtems_rtl_rap_pack_t* pack)
+{
+  const rtems_rtl_rap_pack_sect_t* symtab = &pack->sects[pack->symtab];
+  uint32_t                         s;
+
+  pack->nsyms = symtab->size / RTEMS_RTL_RAP_PACK_SYM_SIZE;
+
+  pack->syms = calloc (pack->nsyms ? pack->nsyms : 1,
+                       sizeof (rtems_rtl_rap_pack_sym_t));
+  if (!pack->syms)
+  {
+    rtems_rtl_rap_pack_error ("no memory for the symbols");
+    return false;
+  }
+
+  for (s = 0; s < pack->nsyms; ++s)
+  {
+    rtems_rtl_rap_pack_sym_t* sym = &pack->syms[s];
+    const uint8_t*            esym;
+
+    esym = pack->image + symtab->offset + (s * RTEMS_RTL_RAP_PACK_SYM_SIZE);
+
+    sym->name = rtems_rtl_rap_pack_string (pack, symtab->link,
+                                           rtems_rtl_rap_pack_get32 (pack, esym));
+    if (!sym->name)
+      sym->name = "";
+    sym->value = rtems_rtl_rap_pack_get32 (pack, esym + 4);
+    sym->size = rtems_rtl_rap_pack_get32 (pack, esym + 8);
+    sym->info = esym[12];
+    sym->other = esym[13];
+    sym->shndx = rtems_rtl_rap_pack_get16 (pack, esym + 14);
+    sym->rap = -1;
+    sym->strtab = RTEMS_RTL_RAP_PACK_NO_NAME;
+
+    if (sym->shndx == RTEMS_RTL_RAP_PACK_SHN_COMMON)
+    {
+      uint32_t alignment = sym->value ? sym->value : 1;
+      sym->rap = RTEMS_RTL_RAP_PACK_BSS_SEC;
+      sym->rap_value =
+        rtems_rtl_rap_pack_align (pack->sizes[RTEMS_RTL_RAP_PACK_BSS_SEC],
+                                  alignment);
+      pack->sizes[RTEMS_RTL_RAP_PACK_BSS_SEC] = sym->rap_value + sym->size;
+      if (alignment > pack->alignments[RTEMS_RTL_RAP_PACK_BSS_SEC])
+        pack->alignments[RTEMS_RTL_RAP_PACK_BSS_SEC] = alignment;
+    }
+    else if ((sym->shndx != RTEMS_RTL_RAP_PACK_SHN_UNDEF) &&
+             (sym->shndx < RTEMS_RTL_RAP_PACK_SHN_LORESERVE) &&
+             (sym->shndx < pack->nsects) &&
+             (pack->sects[sym->shndx].rap >= 0))
+    {
+      sym->rap = pack->sects[sym->shndx].rap;
+      sym->rap_value = pack->sects[sym->shndx].rap_offset + sym->value;
+    }
+
+    sym->exported = (s != 0) &&
+      (sym->rap >= 0) &&
+      ((sym->info >> 4) != RTEMS_RTL_RAP_PACK_STB_LOCAL) &&
+      (((sym->other & 3) == RTEMS_RTL_RAP_PACK_STV_DEFAULT) ||
+       ((sym->other & 3) == RTEMS_RTL_RAP_PACK_STV_PROTECTED)) &&
+      (sym->name[0] != '\0');
+
+    if (sym->exported)
+    {
+      if (!rtems_rtl_rap_pack_strtab_add (pack, sym))
+        return false;
+
+      if (!rtems_rtl_rap_pack_buf_uint32 (&pack->symbols,
+                                          (sym->rap << 16) | sym->info) ||
+          !rtems_rtl_rap_pack_buf_uint32 (&pack->symbols, sym->strtab) ||
+          !rtems_rtl_rap_pack_buf_uint32 (&pack->symbols, sym->rap_value))
+        return false;
+
+      if (pack->symbol_hashes &&
+          !rtems_rtl_rap_pack_buf_uint32 (&pack->symbols,
+                                          rtems_rtl_rap_pack_hash (sym->name)))
+        return false;
+
+      if (pack->verbose)
+        printf ("sym: %-30s %-8s 0x%08lx\n", sym->name, rap_sections[sym->rap],
+                (unsigned long) sym->rap_value);
+    }
+  }
+
+  return true;
+}
+
+static int
+rtems_rtl_rap_pack_reloc_compare (const void* a, const void* b)
+{
+  const rtems_rtl_rap_pack_reloc_t* ra = a;
+  const rtems_rtl_rap_pack_reloc_t* rb = b;
+  if ((ra->info & 0xff) != (rb->info & 0xff))
+    return (ra->info & 0xff) < (rb->info & 0xff) ? -1 : 1;
+  if (ra->offset != rb->offset)
+    return ra->offset < rb->offset ? -1 : 1;
+  return ra->order < rb->order ? -1 : 1;
+}
+
+/*
+ * Convert an ELF relocation to a RAP relocation record. Symbols the object
+ * defines that cannot be overridden become section relative so the loader
+ * does not look them up. Weak and undefined symbols are referenced by name.
+ */
+static bool
+rtems_rtl_rap_pack_reloc (rtems_rtl_rap_pack_t*       pack,
+                          const uint8_t*              erel,
+                          bool                        is_rela,
+                          uint32_t                    rap_offset,
+                          rtems_rtl_rap_pack_reloc_t* reloc)
+{
+  rtems_rtl_rap_pack_sym_t* sym;
+  uint32_t                  info;
+  uint32_t                  symndx;
+  uint32_t                  type;
+  uint32_t                  addend = 0;
+
+  info = rtems_rtl_rap_pack_get32 (pack, erel + 4);
+  symndx = info >> 8;
+  type = info & 0xff;
+
+  if (is_rela)
+    addend = rtems_rtl_rap_pack_get32 (pack, erel + 8);
+
+  if ((symndx == 0) || (symndx >= pack->nsyms))
+  {
+    rtems_rtl_rap_pack_error ("relocation without a symbol: type=%lu",
+                              (unsigned long) type);
+    return false;
+  }
+
+  sym = &pack->syms[symndx];
+
+  reloc->offset = rap_offset + rtems_rtl_rap_pack_get32 (pack, erel);
+  reloc->name = NULL;
+
+  if ((sym->rap >= 0) &&
+      ((sym->info >> 4) != RTEMS_RTL_RAP_PACK_STB_WEAK))
+  {
+    reloc->info = (sym->rap << 8) | type;
+    reloc->addend = sym->rap_value + addend;
+    reloc->has_addend = true;
+    return true;
+  }
+
+  if ((sym->shndx != RTEMS_RTL_RAP_PACK_SHN_UNDEF) && (sym->rap < 0))
+  {
+    rtems_rtl_rap_pack_error ("symbol in a section not loaded: %s", sym->name);
+    return false;
+  }
+
+  reloc->addend = addend;
+  reloc->has_addend = is_rela;
+
+  /*
+   * The loader only reads a name appended to a fixed size record if the
+   * relocation type resolves a symbol. SPARC has types that do not so the name
+   * is placed in the string table. A name too long for the loader's buffer is
+   * placed in the string table. Compact relocations always use the string
+   * table because the loader caches the symbols it finds by string table
+   * offset and a name referenced more than once is only held once.
+   */
+  if ((sym->strtab == RTEMS_RTL_RAP_PACK_NO_NAME) &&
+      (strlen (sym->name) < RTEMS_RTL_RAP_PACK_SYMNAME_MAX) &&
+      !pack->compact_relocs &&
+      (pack->machinetype != RTEMS_RTL_RAP_PACK_EM_SPARC) &&
+      (pack->machinetype != RTEMS_RTL_RAP_PACK_EM_SPARC32PLUS))
+  {
+    reloc->info = (1UL << 31) | (strlen (sym->name) << 8) | type;
+    reloc->name = sym->name;
+    return true;
+  }
+
+  if (!rtems_rtl_rap_pack_strtab_add (pack, sym))
+    return false;
+
+  if (sym->strtab >= RTEMS_RTL_RAP_PACK_STRTAB_MAX)
+  {
+    rtems_rtl_rap_pack_error ("string table too big for relocations");
+    return false;
+  }
+
+  reloc->info = (3UL << 30) | (sym->strtab << 8) | type;
+
+  return true;
+}
+
+/*
+ * Write a section's relocations as fixed size records:
+ *
+ *  uint32_t: header, bit 31 is set if the records have an addend
+ *  header x { uint32_t: info, uint32_t: offset, [uint32_t: addend], [name] }
+ */
+static bool
+rtems_rtl_rap_pack_relocs_fixed (rtems_rtl_rap_pack_t* pack, int r)
+{
+  const rtems_rtl_rap_pack_reloc_t* relocs = pack->sect_relocs[r];
+  size_t                            count = pack->sect_nrelocs[r];
+  bool                              is_rela = pack->sect_rela[r] > 0;
+  size_t                            e;
+
+  if (!rtems_rtl_rap_pack_buf_uint32 (&pack->relocs,
+                                      (is_rela ? (1UL << 31) : 0) | count))
+    return false;
+
+  for (e = 0; e < count; ++e)
+  {
+    const rtems_rtl_rap_pack_reloc_t* reloc = &relocs[e];
+
+    if (!rtems_rtl_rap_pack_buf_uint32 (&pack->relocs, reloc->info) ||
+        !rtems_rtl_rap_pack_buf_uint32 (&pack->relocs, reloc->offset))
+      return false;
+
+    if ((reloc->has_addend || is_rela) &&
+        !rtems_rtl_rap_pack_buf_uint32 (&pack->relocs, reloc->addend))
+      return false;
+
+    if (reloc->name &&
+        !rtems_rtl_rap_pack_buf_append (&pack->relocs,
+                                        reloc->name, strlen (reloc->name)))
+      return false;
+  }
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_pack_buf_varint (rtems_rtl_rap_pack_buf_t* buf, uint32_t value)
+{
+  uint8_t bytes[5];
+  size_t  size = 0;
+  do
+  {
+    bytes[size] = value & 0x7f;
+    value >>= 7;
+    if (value)
+      bytes[size] |= 0x80;
+    ++size;
+  } while (value);
+  return rtems_rtl_rap_pack_buf_append (buf, bytes, size);
+}
+
+static bool
+rtems_rtl_rap_pack_buf_svarint (rtems_rtl_rap_pack_buf_t* buf, uint32_t value)
+{
+  return rtems_rtl_rap_pack_buf_varint (buf,
+                                        (value << 1) ^ -(value >> 31));
+}
+
+/*
+ * Write a section's relocations as compact records. The loader documents the
+ * format.
+ */
+static bool
+rtems_rtl_rap_pack_relocs_compact (rtems_rtl_rap_pack_t* pack, int r)
+{
+  const rtems_rtl_rap_pack_reloc_t* relocs = pack->sect_relocs[r];
+  size_t                            count = pack->sect_nrelocs[r];
+  bool                              is_rela = pack->sect_rela[r] > 0;
+  uint32_t                          offset = 0;
+  size_t                            e;
+
+  if (!rtems_rtl_rap_pack_buf_varint (&pack->relocs,
+                                      (count << 1) | (is_rela ? 1 : 0)))
+    return false;
+
+  for (e = 0; e < count; ++e)
+  {
+    const rtems_rtl_rap_pack_reloc_t* reloc = &relocs[e];
+    uint32_t                          type = reloc->info & 0xff;
+    bool                              ok;
+
+    if ((reloc->info & (1UL << 31)) == 0)
+    {
+      ok = rtems_rtl_rap_pack_buf_varint (&pack->relocs, type << 2) &&
+        rtems_rtl_rap_pack_buf_svarint (&pack->relocs, reloc->offset - offset) &&
+        rtems_rtl_rap_pack_buf_varint (&pack->relocs, (reloc->info >> 8) & 0x7fffff) &&
+        rtems_rtl_rap_pack_buf_svarint (&pack->relocs, reloc->addend);
+    }
+    else
+    {
+      uint32_t form = reloc->name ? 1 : 2;
+      ok = rtems_rtl_rap_pack_buf_varint (&pack->relocs, (type << 2) | form) &&
+        rtems_rtl_rap_pack_buf_svarint (&pack->relocs, reloc->offset - offset);
+      if (ok && is_rela)
+        ok = rtems_rtl_rap_pack_buf_svarint (&pack->relocs, reloc->addend);
+      if (ok)
+        ok = rtems_rtl_rap_pack_buf_varint (&pack->relocs,
+                                            (reloc->info >> 8) & 0x3fffff);
+      if (ok && reloc->name)
+        ok = rtems_rtl_rap_pack_buf_append (&pack->relocs,
+                                            reloc->name, strlen (reloc->name));
+    }
+
+    if (!ok)
+      return false;
+
+    offset = reloc->offset;
+  }
+
+  return true;
+}
+
+/*
+ * Convert the relocations of the loaded sections, sort them and create the
+ * RAP relocation records.
+ */
+static bool
+rtems_rtl_rap_pack_relocs (rtems_rtl_rap_pack_t* pack)
+{
+  uint32_t s;
+  int      r;
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_SECS; ++r)
+    pack->sect_rela[r] = -1;
+
+  for (s = 0; s < pack->nsects; ++s)
+  {
+    const rtems_rtl_rap_pack_sect_t* sect = &pack->sects[s];
+    const rtems_rtl_rap_pack_sect_t* target;
+    rtems_rtl_rap_pack_reloc_t*      relocs;
+    bool                             is_rela;
+    size_t                           entry;
+    size_t                           count;
+    size_t                           e;
+
+    if ((sect->type != RTEMS_RTL_RAP_PACK_SHT_REL) &&
+        (sect->type != RTEMS_RTL_RAP_PACK_SHT_RELA))
+      continue;
+
+    if ((sect->info >= pack->nsects) || (sect->link != pack->symtab))
+    {
+      rtems_rtl_rap_pack_error ("invalid relocation section: %s", sect->name);
+      return false;
+    }
+
+    target = &pack->sects[sect->info];
+
+    if (target->rap < 0)
+      continue;
+
+    is_rela = sect->type == RTEMS_RTL_RAP_PACK_SHT_RELA;
+    entry = is_rela ? RTEMS_RTL_RAP_PACK_RELA_SIZE : RTEMS_RTL_RAP_PACK_REL_SIZE;
+    count = sect->size / entry;
+
+    if (pack->sect_rela[target->rap] < 0)
+      pack->sect_rela[target->rap] = is_rela;
+    else if (pack->sect_rela[target->rap] != is_rela)
+    {
+      rtems_rtl_rap_pack_error ("mixed rel and rela relocations: %s",
+                                rap_sections[target->rap]);
+      return false;
+    }
+
+    relocs = realloc (pack->sect_relocs[target->rap],
+                      (pack->sect_nrelocs[target->rap] + count) *
+                      sizeof (rtems_rtl_rap_pack_reloc_t));
+    if (!relocs && count)
+    {
+      rtems_rtl_rap_pack_error ("no memory for relocations");
+      return false;
+    }
+    pack->sect_relocs[target->rap] = relocs;
+
+    for (e = 0; e < count; ++e)
+    {
+      const uint8_t*              erel = pack->image + sect->offset + (e * entry);
+      rtems_rtl_rap_pack_reloc_t* reloc;
+
+      /*
+       * A linker removes a duplicate relocation by making it a none
+       * relocation with no symbol. The none type is 0 on all targets.
+       */
+      if (rtems_rtl_rap_pack_get32 (pack, erel + 4) == 0)
+        continue;
+
+      reloc = &relocs[pack->sect_nrelocs[target->rap]];
+      if (!rtems_rtl_rap_pack_reloc (pack, erel, is_rela,
+                                     target->rap_offset, reloc))
+        return false;
+      reloc->order = pack->sect_nrelocs[target->rap];
+      ++pack->sect_nrelocs[target->rap];
+    }
+  }
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_SECS; ++r)
+  {
+    qsort (pack->sect_relocs[r], pack->sect_nrelocs[r],
+           sizeof (rtems_rtl_rap_pack_reloc_t),
+           rtems_rtl_rap_pack_reloc_compare);
+
+    if (pack->compact_relocs)
+    {
+      if (!rtems_rtl_rap_pack_relocs_compact (pack, r))
+        return false;
+    }
+    else
+    {
+      if (!rtems_rtl_rap_pack_relocs_fixed (pack, r))
+        return false;
+    }
+
+    if (pack->verbose && pack->sect_nrelocs[r])
+      printf ("relocs: %-8s %s count=%zu\n",
+              rap_sections[r], pack->sect_rela[r] > 0 ? "rela" : "rel",
+              pack->sect_nrelocs[r]);
+  }
+
+  if (pack->verbose)
+    printf ("relocs: %s size=%zu\n",
+            pack->compact_relocs ? "compact" : "fixed", pack->relocs.size);
+
+  return true;
+}
+
+/*
+ * Create the data of each part of the file.
+ */
+static bool
+rtems_rtl_rap_pack_layout (rtems_rtl_rap_pack_t* pack)
+{
+  rtems_rtl_rap_pack_part_t* part;
+  uint32_t                   s;
+  int                        r;
+
+  /*
+   * uint32_t: machinetype, datatype, class
+   * uint32_t: init, fini, symtab_size, strtab_size, relocs_size
+   * 6 x { uint32_t: size, uint32_t: alignment }
+   */
+  part = &pack->parts[RTEMS_RTL_RAP_PACK_HEADER_PART];
+  part->label = "header";
+  part->section = RTEMS_RTL_RAP_PACK_NO_SEC;
+
+  if (!rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->machinetype) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->datatype) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->class) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, 0) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, 0) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->symbols.size) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->strtab.size) ||
+      !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->relocs.size))
+    return false;
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_SECS; ++r)
+  {
+    if (!rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->sizes[r]) ||
+        !rtems_rtl_rap_pack_buf_uint32 (&part->raw, pack->alignments[r]))
+      return false;
+  }
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+  {
+    part = &pack->parts[r + 1];
+    part->label = rap_sections[r];
+    part->section = r;
+
+    if (!rtems_rtl_rap_pack_buf_append (&part->raw, NULL, pack->sizes[r]))
+      return false;
+
+    for (s = 0; s < pack->nsects; ++s)
+    {
+      const rtems_rtl_rap_pack_sect_t* sect = &pack->sects[s];
+      if (sect->rap == r)
+        memcpy (part->raw.data + sect->rap_offset,
+                pack->image + sect->offset, sect->size);
+    }
+  }
+
+  part = &pack->parts[RTEMS_RTL_RAP_PACK_TAIL_PART];
+  part->label = "tail";
+  part->section = RTEMS_RTL_RAP_PACK_NO_SEC;
+
+  if (!rtems_rtl_rap_pack_buf_append (&part->raw,
+                                      pack->strtab.data, pack->strtab.size) ||
+      !rtems_rtl_rap_pack_buf_append (&part->raw,
+                                      pack->symbols.data, pack->symbols.size) ||
+      !rtems_rtl_rap_pack_buf_append (&part->raw,
+                                      pack->relocs.data, pack->relocs.size))
+    return false;
+
+  return true;
+}
+
+/*
+ * The largest block of a part. The header, symbols and relocations and all of
+ * a version 1 file are read through the loader's stream.
+ */
+static size_t
+rtems_rtl_rap_pack_block_max (const rtems_rtl_rap_pack_t*      pack,
+                              const rtems_rtl_rap_pack_part_t* part)
+{
+  if ((pack->version < 2) || (part->section == RTEMS_RTL_RAP_PACK_NO_SEC))
+    return RTEMS_RTL_RAP_PACK_STREAM_BLOCK;
+  return RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX;
+}
+
+/*
+ * Compress a part into blocks. A block that does not compress to fit the
+ * loader's limit is halved.
+ */
+static bool
+rtems_rtl_rap_pack_compress (rtems_rtl_rap_pack_t*      pack,
+                             rtems_rtl_rap_pack_part_t* part,
+                             int                        level,
+                             size_t                     block_size)
+{
+  size_t csize_max = RTEMS_RTL_RAP_PACK_CSIZE_MAX;
+  size_t offset;
+
+  if (rtems_rtl_rap_pack_block_max (pack, part) == RTEMS_RTL_RAP_PACK_STREAM_BLOCK)
+    csize_max = RTEMS_RTL_RAP_PACK_STREAM_BLOCK;
+
+  part->level = level;
+  part->block_size = block_size;
+  part->packed.size = 0;
+  part->blocks = 0;
+
+  free (part->sizes);
+  part->sizes = malloc (((part->raw.size / RTEMS_RTL_RAP_PACK_BLOCK_MIN) + 1) *
+                        sizeof (uint32_t));
+  if (!part->sizes)
+  {
+    rtems_rtl_rap_pack_error ("no memory for the blocks");
+    return false;
+  }
+
+  for (offset = 0; offset < part->raw.size; )
+  {
+    const uint8_t* input = part->raw.data + offset;
+    size_t         length = part->raw.size - offset;
+    uint8_t        prefix[2];
+    int            out = 0;
+
+    if (length > block_size)
+      length = block_size;
+
+    while (true)
+    {
+      switch (pack->compression)
+      {
+        case RTEMS_RTL_RAP_PACK_COMP_NONE:
+        default:
+          memcpy (pack->scratch, input, length);
+          out = length;
+          break;
+        case RTEMS_RTL_RAP_PACK_COMP_LZ77:
+          out = fastlz_compress_level (level, input, length, pack->scratch);
+          break;
+        case RTEMS_RTL_RAP_PACK_COMP_LZ4:
+          if (pack->dict.size)
+          {
+            memcpy (pack->dict_input + pack->dict.size, input, length);
+            out = rtems_rtl_lz4_compress_prefix (pack->dict_input,
+                                                 pack->dict.size, length,
+                                                 pack->scratch);
+          }
+          else
+            out = rtems_rtl_lz4_compress (input, length, pack->scratch);
+          break;
+      }
+
+      if (out <= csize_max)
+        break;
+
+      length /= 2;
+
+      if (length < RTEMS_RTL_RAP_PACK_BLOCK_MIN)
+      {
+        rtems_rtl_rap_pack_error ("%s: block does not compress", part->label);
+        return false;
+      }
+    }
+
+    prefix[0] = (out >> 8) & 0xff;
+    prefix[1] = out & 0xff;
+
+    if (!rtems_rtl_rap_pack_buf_append (&part->packed, prefix, sizeof (prefix)) ||
+        !rtems_rtl_rap_pack_buf_append (&part->packed, pack->scratch, out))
+      return false;
+
+    part->sizes[part->blocks++] = length;
+    offset += length;
+  }
+
+  return true;
+}
+
+/*
+ * Decompress a part the way the loader does. Returns false if the output does
+ * not match the input.
+ */
+static bool
+rtems_rtl_rap_pack_decompress (rtems_rtl_rap_pack_t*            pack,
+                               const rtems_rtl_rap_pack_part_t* part)
+{
+  const uint8_t* ip = part->packed.data;
+  uint8_t*       op = pack->decoded;
+  uint32_t       b;
+
+  for (b = 0; b < part->blocks; ++b)
+  {
+    size_t csize = (ip[0] << 8) | ip[1];
+    int    out;
+
+    ip += 2;
+
+    switch (pack->compression)
+    {
+      case RTEMS_RTL_RAP_PACK_COMP_NONE:
+      default:
+        memcpy (op, ip, csize);
+        out = csize;
+        break;
+      case RTEMS_RTL_RAP_PACK_COMP_LZ77:
+        out = fastlz_decompress (ip, csize, op, part->sizes[b]);
+        break;
+      case RTEMS_RTL_RAP_PACK_COMP_LZ4:
+        out = rtems_rtl_lz4_decompress_dict (ip, csize, op, part->sizes[b],
+                                             pack->dict.data, pack->dict.size);
+        break;
+    }
+
+    if (out != part->sizes[b])
+      return false;
+
+    ip += csize;
+    op += out;
+  }
+
+  return true;
+}
+
+/*
+ * Compress the part and time decoding it. The decoded data is checked.
+ */
+static bool
+rtems_rtl_rap_pack_measure (rtems_rtl_rap_pack_t*      pack,
+                            rtems_rtl_rap_pack_part_t* part,
+                            int                        level,
+                            size_t                     block_size)
+{
+  uint64_t start;
+  int      run;
+
+  if (!rtems_rtl_rap_pack_compress (pack, part, level, block_size))
+    return false;
+
+  if (!rtems_rtl_rap_pack_decompress (pack, part) ||
+      (memcmp (pack->decoded, part->raw.data, part->raw.size) != 0))
+  {
+    rtems_rtl_rap_pack_error ("%s: decompressed data does not match",
+                              part->label);
+    return false;
+  }
+
+  start = rtems_rtl_rap_pack_now ();
+  for (run = 0; run < pack->runs; ++run)
+    rtems_rtl_rap_pack_decompress (pack, part);
+  part->decode_ns = (rtems_rtl_rap_pack_now () - start) / pack->runs;
+
+  return true;
+}
+
+/*
+ * The size of a part in the file including its block index entries.
+ */
+static size_t
+rtems_rtl_rap_pack_part_size (const rtems_rtl_rap_pack_t*      pack,
+                              const rtems_rtl_rap_pack_part_t* part)
+{
+  size_t size = part->packed.size;
+  if (pack->version >= 2)
+    size += part->blocks * RTEMS_RTL_RAP_PACK_BLOCK_ENTRY;
+  return size;
+}
+
+/*
+ * The estimated time in microseconds to load a part on the target. This is the
+ * time to read the part at the media's read rate plus the host decode time
+ * scaled to the target.
+ */
+static double
+rtems_rtl_rap_pack_load_us (const rtems_rtl_rap_pack_t*      pack,
+                            const rtems_rtl_rap_pack_part_t* part)
+{
+  double read_us;
+  double decode_us;
+  read_us = (rtems_rtl_rap_pack_part_size (pack, part) * 1000000.0) /
+    (pack->rate * 1024.0);
+  decode_us = (part->decode_ns * pack->scale) / 1000.0;
+  return read_us + decode_us;
+}
+
+static void
+rtems_rtl_rap_pack_report_line (const rtems_rtl_rap_pack_t*      pack,
+                                const rtems_rtl_rap_pack_part_t* part,
+                                const char*                      mark)
+{
+  size_t size = rtems_rtl_rap_pack_part_size (pack, part);
+  printf (" %-8s %5d %6zu %8zu %8zu %6lu %5zu%% %10.1f %10.1f%s\n",
+          part->label, part->level, part->block_size,
+          part->raw.size, size, (unsigned long) part->blocks,
+          part->raw.size ? (size * 100) / part->raw.size : 0,
+          part->decode_ns / 1000.0, rtems_rtl_rap_pack_load_us (pack, part),
+          mark);
+}
+
+static void
+rtems_rtl_rap_pack_report_title (void)
+{
+  printf (" %-8s %5s %6s %8s %8s %6s %6s %10s %10s\n",
+          "part", "level", "block", "size", "packed", "blocks", "ratio",
+          "decode-us", "load-us");
+}
+
+/*
+ * Try each level and block size on a section and select the one with the
+ * lowest estimated load time.
+ */
+static bool
+rtems_rtl_rap_pack_tune (rtems_rtl_rap_pack_t*      pack,
+                         rtems_rtl_rap_pack_part_t* part)
+{
+  int    level_min = 0;
+  int    level_max = 0;
+  int    best_level = 0;
+  size_t best_block = 0;
+  double best_us = 0;
+  int    level;
+  size_t b;
+
+  if (pack->compression == RTEMS_RTL_RAP_PACK_COMP_LZ77)
+  {
+    level_min = 1;
+    level_max = 2;
+  }
+
+  for (level = level_min; level <= level_max; ++level)
+  {
+    for (b = 0; b < RTEMS_RTL_RAP_PACK_TUNE_BLOCKS; ++b)
+    {
+      double us;
+
+      if (tune_blocks[b] > rtems_rtl_rap_pack_block_max (pack, part))
+        break;
+
+      if (!rtems_rtl_rap_pack_measure (pack, part, level, tune_blocks[b]))
+        return false;
+
+      us = rtems_rtl_rap_pack_load_us (pack, part);
+
+      rtems_rtl_rap_pack_report_line (pack, part, "");
+
+      if ((best_block == 0) || (us < best_us))
+      {
+        best_level = level;
+        best_block = tune_blocks[b];
+        best_us = us;
+      }
+
+      /*
+       * Only one block size is needed if the section fits in a block.
+       */
+      if (tune_blocks[b] >= part->raw.size)
+        break;
+    }
+  }
+
+  if (!rtems_rtl_rap_pack_measure (pack, part, best_level, best_block))
+    return false;
+
+  rtems_rtl_rap_pack_report_line (pack, part, " *");
+
+  return true;
+}
+
+/*
+ * Compress each part using the set or tuned level and block size.
+ */
+static bool
+rtems_rtl_rap_pack_parts (rtems_rtl_rap_pack_t* pack)
+{
+  int p;
+
+  if (pack->tune)
+  {
+    printf ("tune: rate=%luKB/s scale=%.2f runs=%d\n",
+            pack->rate, pack->scale, pack->runs);
+    rtems_rtl_rap_pack_report_title ();
+  }
+
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_PARTS; ++p)
+  {
+    rtems_rtl_rap_pack_part_t* part = &pack->parts[p];
+    int                        level = pack->level;
+    size_t                     block_size = pack->block_size;
+    size_t                     block_max;
+
+    if (part->raw.size == 0)
+      continue;
+
+    if (part->section != RTEMS_RTL_RAP_PACK_NO_SEC)
+    {
+      if (pack->tune &&
+          (pack->levels[part->section] < 0) &&
+          (pack->block_sizes[part->section] == 0))
+      {
+        if (!rtems_rtl_rap_pack_tune (pack, part))
+          return false;
+        continue;
+      }
+
+      if (pack->levels[part->section] >= 0)
+        level = pack->levels[part->section];
+      if (pack->block_sizes[part->section] != 0)
+        block_size = pack->block_sizes[part->section];
+    }
+
+    block_max = rtems_rtl_rap_pack_block_max (pack, part);
+    if (block_size > block_max)
+      block_size = block_max;
+
+    if (!rtems_rtl_rap_pack_measure (pack, part, level, block_size))
+      return false;
+  }
+
+  return true;
+}
+
+static const char*
+rtems_rtl_rap_pack_comp_label (int compression)
+{
+  switch (compression)
+  {
+    case RTEMS_RTL_RAP_PACK_COMP_NONE:
+    default:
+      return "NONE";
+    case RTEMS_RTL_RAP_PACK_COMP_LZ77:
+      return "LZ77";
+    case RTEMS_RTL_RAP_PACK_COMP_LZ4:
+      return "LZ4B";
+  }
+}
+
+/*
+ * Write the RAP file. Version 2 files have the block index after the header.
+ */
+static bool
+rtems_rtl_rap_pack_write (rtems_rtl_rap_pack_t* pack)
+{
+  rtems_rtl_rap_pack_buf_t out = { 0 };
+  char                     header[64];
+  uint32_t                 length = 0;
+  uint32_t                 checksum = 0;
+  uint32_t                 blocks = 0;
+  uint32_t                 offset = 0;
+  FILE*                    file;
+  int                      p;
+  bool                     ok = true;
+
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_PARTS; ++p)
+  {
+    length += pack->parts[p].raw.size;
+    blocks += pack->parts[p].blocks;
+    checksum = rtems_rtl_crc32 (checksum,
+                                pack->parts[p].raw.data, pack->parts[p].raw.size);
+  }
+
+  /*
+   * The checksum is the CRC32 of the decompressed stream.
+   */
+  snprintf (header, sizeof (header), "RAP,%08lu,%04d,%s,%08lx\n",
+            (unsigned long) length, pack->version,
+            rtems_rtl_rap_pack_comp_label (pack->compression),
+            (unsigned long) checksum);
+
+  ok = rtems_rtl_rap_pack_buf_append (&out, header, strlen (header));
+
+  if (ok && (pack->version >= 2))
+  {
+    uint32_t flags = 0;
+
+    if (pack->compact_relocs)
+      flags |= RTEMS_RTL_RAP_PACK_FLAG_COMPACT_RELOCS;
+    if (pack->symbol_hashes)
+      flags |= RTEMS_RTL_RAP_PACK_FLAG_SYMBOL_HASHES;
+    if (pack->dict.size)
+      flags |= RTEMS_RTL_RAP_PACK_FLAG_DICTIONARY;
+
+    ok = rtems_rtl_rap_pack_buf_uint32 (&out, flags) &&
+      rtems_rtl_rap_pack_buf_uint32 (&out, blocks);
+
+    if (ok && pack->dict.size)
+      ok = rtems_rtl_rap_pack_buf_uint32 (&out, pack->dict_crc);
+
+    for (p = 0; ok && (p < RTEMS_RTL_RAP_PACK_PARTS); ++p)
+    {
+      const rtems_rtl_rap_pack_part_t* part = &pack->parts[p];
+      const uint8_t*                   bp = part->packed.data;
+      uint32_t                         b;
+
+      for (b = 0; ok && (b < part->blocks); ++b)
+      {
+        uint32_t csize = (bp[0] << 8) | bp[1];
+        ok = rtems_rtl_rap_pack_buf_uint32 (&out, offset) &&
+          rtems_rtl_rap_pack_buf_uint32 (&out, csize) &&
+          rtems_rtl_rap_pack_buf_uint32 (&out, part->sizes[b]) &&
+          rtems_rtl_rap_pack_buf_uint32 (&out, part->section);
+        bp += 2 + csize;
+        offset += 2 + csize;
+      }
+    }
+  }
+
+  for (p = 0; ok && (p < RTEMS_RTL_RAP_PACK_PARTS); ++p)
+    ok = rtems_rtl_rap_pack_buf_append (&out,
+                                        pack->parts[p].packed.data,
+                                        pack->parts[p].packed.size);
+
+  if (!ok)
+  {
+    rtems_rtl_rap_pack_buf_free (&out);
+    return false;
+  }
+
+  file = fopen (pack->output, "wb");
+  if (!file)
+  {
+    rtems_rtl_rap_pack_error ("cannot create: %s", pack->output);
+    rtems_rtl_rap_pack_buf_free (&out);
+    return false;
+  }
+
+  if ((fwrite (out.data, 1, out.size, file) != out.size) ||
+      (fclose (file) != 0))
+  {
+    rtems_rtl_rap_pack_error ("cannot write: %s", pack->output);
+    rtems_rtl_rap_pack_buf_free (&out);
+    return false;
+  }
+
+  printf ("%s: %s: version=%d %s%s size=%lu packed=%zu blocks=%lu crc=%08lx\n",
+          pack->input, pack->output, pack->version,
+          rtems_rtl_rap_pack_comp_label (pack->compression),
+          pack->dict.size ? " dict" : "",
+          (unsigned long) length, out.size, (unsigned long) blocks,
+          (unsigned long) checksum);
+
+  rtems_rtl_rap_pack_report_title ();
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_PARTS; ++p)
+  {
+    if (pack->parts[p].raw.size)
+      rtems_rtl_rap_pack_report_line (pack, &pack->parts[p], "");
+  }
+
+  rtems_rtl_rap_pack_buf_free (&out);
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_pack (rtems_rtl_rap_pack_t* pack)
+{
+  size_t largest = RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX;
+  int    p;
+
+  if (!rtems_rtl_rap_pack_read (pack) ||
+      !rtems_rtl_rap_pack_sections (pack) ||
+      !rtems_rtl_rap_pack_symbols (pack) ||
+      !rtems_rtl_rap_pack_relocs (pack) ||
+      !rtems_rtl_rap_pack_layout (pack))
+    return false;
+
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_PARTS; ++p)
+  {
+    if (pack->parts[p].raw.size > largest)
+      largest = pack->parts[p].raw.size;
+  }
+
+  pack->scratch = malloc (RTEMS_RTL_LZ4_BOUND (RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX) +
+                          (RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX / 16) + 66);
+  pack->decoded = malloc (largest);
+  if (pack->dict.size)
+    pack->dict_input = malloc (pack->dict.size +
+                               RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX);
+  if (!pack->scratch || !pack->decoded ||
+      (pack->dict.size && !pack->dict_input))
+  {
+    rtems_rtl_rap_pack_error ("no memory for compression");
+    return false;
+  }
+
+  if (pack->dict.size)
+    memcpy (pack->dict_input, pack->dict.data, pack->dict.size);
+
+  if (!rtems_rtl_rap_pack_parts (pack))
+    return false;
+
+  return rtems_rtl_rap_pack_write (pack);
+}
+
+static void
+rtems_rtl_rap_pack_free (rtems_rtl_rap_pack_t* pack)
+{
+  int p;
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_PARTS; ++p)
+  {
+    rtems_rtl_rap_pack_buf_free (&pack->parts[p].raw);
+    rtems_rtl_rap_pack_buf_free (&pack->parts[p].packed);
+    free (pack->parts[p].sizes);
+  }
+  for (p = 0; p < RTEMS_RTL_RAP_PACK_SECS; ++p)
+    free (pack->sect_relocs[p]);
+  rtems_rtl_rap_pack_buf_free (&pack->strtab);
+  rtems_rtl_rap_pack_buf_free (&pack->symbols);
+  rtems_rtl_rap_pack_buf_free (&pack->relocs);
+  rtems_rtl_rap_pack_buf_free (&pack->dict);
+  free (pack->dict_input);
+  free (pack->decoded);
+  free (pack->scratch);
+  free (pack->syms);
+  free (pack->sects);
+  free (pack->image);
+}
+
+/*
+ * Load a dictionary to pack with.
+ */
+static bool
+rtems_rtl_rap_pack_dict_load (rtems_rtl_rap_pack_t* pack, const char* name)
+{
+  uint8_t* data = NULL;
+  size_t   size = 0;
+
+  if (!rtems_rtl_rap_pack_file_load (name, &data, &size))
+    return false;
+
+  if (size > RTEMS_RTL_LZ4_DICT_MAX)
+  {
+    rtems_rtl_rap_pack_error ("dictionary too big: %s", name);
+    free (data);
+    return false;
+  }
+
+  pack->dict.data = data;
+  pack->dict.size = size;
+  pack->dict.capacity = size;
+  pack->dict_crc = rtems_rtl_crc32 (0, data, size);
+
+  return true;
+}
+
+static uint32_t
+rtems_rtl_rap_pack_dict_hash (const uint8_t* p)
+{
+  uint64_t value = 0;
+  int      b;
+  for (b = 0; b < RTEMS_RTL_RAP_PACK_DICT_KMER; ++b)
+    value = (value << 8) | p[b];
+  return (uint32_t) ((value * 0x9e3779b97f4a7c15ULL) >>
+                     (64 - RTEMS_RTL_RAP_PACK_DICT_HASH_LOG));
+}
+
+/**
+ * A segment of the samples a dictionary is made from.
+ */
+typedef struct rtems_rtl_rap_pack_segment_s
+{
+  size_t   offset;  /**< The offset of the segment in the samples. */
+  uint64_t score;   /**< The segment's score. */
+} rtems_rtl_rap_pack_segment_t;
+
+static int
+rtems_rtl_rap_pack_segment_compare (const void* a, const void* b)
+{
+  const rtems_rtl_rap_pack_segment_t* sa = a;
+  const rtems_rtl_rap_pack_segment_t* sb = b;
+  if (sa->score != sb->score)
+    return sa->score > sb->score ? -1 : 1;
+  return sa->offset < sb->offset ? -1 : 1;
+}
+
+/*
+ * Train a dictionary from the data each object file has in a RAP file. The
+ * sequences of bytes are counted once for each file they appear in. The data
+ * is split into segments and each segment is scored by how often its
+ * sequences appear in other files. The highest scoring segments that are not
+ * the same as a segment already taken are placed in the dictionary with the
+ * best last, closest to the data being compressed.
+ */
+static bool
+rtems_rtl_rap_pack_train (const rtems_rtl_rap_pack_t* options,
+                          const char**                inputs,
+                          int                         count,
+                          const char*                 output,
+                          size_t                      dict_size)
+{
+  rtems_rtl_rap_pack_buf_t      samples = { 0 };
+  size_t*                       starts;
+  uint16_t*                     counts;
+  int32_t*                      seen;
+  rtems_rtl_rap_pack_segment_t* segments;
+  size_t                        nsegments = 0;
+  size_t*                       taken;
+  size_t                        ntaken = 0;
+  size_t                        s;
+  FILE*                         file;
+  int                           i;
+  bool                          ok = true;
+
+  starts = malloc ((count + 1) * sizeof (size_t));
+  counts = calloc (1 << RTEMS_RTL_RAP_PACK_DICT_HASH_LOG, sizeof (uint16_t));
+  seen = malloc ((1 << RTEMS_RTL_RAP_PACK_DICT_HASH_LOG) * sizeof (int32_t));
+  if (!starts || !counts || !seen)
+  {
+    rtems_rtl_rap_pack_error ("no memory for training");
+    free (seen);
+    free (counts);
+    free (starts);
+    return false;
+  }
+
+  memset (seen, 0xff, (1 << RTEMS_RTL_RAP_PACK_DICT_HASH_LOG) * sizeof (int32_t));
+
+  for (i = 0; ok && (i < count); ++i)
+  {
+    rtems_rtl_rap_pack_t pack = *options;
+    int                  p;
+
+    pack.input = inputs[i];
+
+    ok = rtems_rtl_rap_pack_read (&pack) &&
+      rtems_rtl_rap_pack_sections (&pack) &&
+      rtems_rtl_rap_pack_symbols (&pack) &&
+      rtems_rtl_rap_pack_relocs (&pack) &&
+      rtems_rtl_rap_pack_layout (&pack);
+
+    starts[i] = samples.size;
+
+    for (p = 0; ok && (p < RTEMS_RTL_RAP_PACK_PARTS); ++p)
+      ok = rtems_rtl_rap_pack_buf_append (&samples,
+                                          pack.parts[p].raw.data,
+                                          pack.parts[p].raw.size);
+
+    rtems_rtl_rap_pack_free (&pack);
+  }
+
+  starts[count] = samples.size;
+
+  segments = malloc (((samples.size / RTEMS_RTL_RAP_PACK_DICT_SEGMENT) + 1) *
+                     sizeof (rtems_rtl_rap_pack_segment_t));
+  taken = malloc (((dict_size / RTEMS_RTL_RAP_PACK_DICT_SEGMENT) + 1) *
+                  sizeof (size_t));
+  if (ok && (!segments || !taken))
+  {
+    rtems_rtl_rap_pack_error ("no memory for training");
+    ok = false;
+  }
+
+  /*
+   * Count each sequence once for each file it is in.
+   */
+  for (i = 0; ok && (i < count); ++i)
+  {
+    for (s = starts[i];
+         (s + RTEMS_RTL_RAP_PACK_DICT_KMER) <= starts[i + 1];
+         ++s)
+    {
+      uint32_t hash = rtems_rtl_rap_pack_dict_hash (samples.data + s);
+      if ((seen[hash] != i) && (counts[hash] < 0xffff))
+      {
+        seen[hash] = i;
+        ++counts[hash];
+      }
+    }
+  }
+
+  for (i = 0; ok && (i < count); ++i)
+  {
+    size_t offset;
+    for (offset = starts[i];
+         (offset + RTEMS_RTL_RAP_PACK_DICT_SEGMENT) <= starts[i + 1];
+         offset += RTEMS_RTL_RAP_PACK_DICT_SEGMENT)
+    {
+      uint64_t score = 0;
+      for (s = 0;
+           s <= (RTEMS_RTL_RAP_PACK_DICT_SEGMENT - RTEMS_RTL_RAP_PACK_DICT_KMER);
+           ++s)
+        score += counts[rtems_rtl_rap_pack_dict_hash (samples.data + offset + s)] - 1;
+      if (score)
+      {
+        segments[nsegments].offset = offset;
+        segments[nsegments].score = score;
+        ++nsegments;
+      }
+    }
+  }
+
+  if (ok)
+    qsort (segments, nsegments, sizeof (rtems_rtl_rap_pack_segment_t),
+           rtems_rtl_rap_pack_segment_compare);
+
+  for (s = 0;
+       ok && (s < nsegments) &&
+         (((ntaken + 1) * RTEMS_RTL_RAP_PACK_DICT_SEGMENT) <= dict_size);
+       ++s)
+  {
+    const uint8_t* segment = samples.data + segments[s].offset;
+    size_t         t;
+    for (t = 0; t < ntaken; ++t)
+      if (memcmp (segment, samples.data + taken[t],
+                  RTEMS_RTL_RAP_PACK_DICT_SEGMENT) == 0)
+        break;
+    if (t == ntaken)
+      taken[ntaken++] = segments[s].offset;
+  }
+
+  if (ok)
+  {
+    file = fopen (output, "wb");
+    if (!file)
+    {
+      rtems_rtl_rap_pack_error ("cannot create: %s", output);
+      ok = false;
+    }
+    else
+    {
+      size_t t;
+      for (t = ntaken; ok && (t > 0); --t)
+        ok = fwrite (samples.data + taken[t - 1], 1,
+                     RTEMS_RTL_RAP_PACK_DICT_SEGMENT,
+                     file) == RTEMS_RTL_RAP_PACK_DICT_SEGMENT;
+      if ((fclose (file) != 0) || !ok)
+      {
+        rtems_rtl_rap_pack_error ("cannot write: %s", output);
+        ok = false;
+      }
+    }
+  }
+
+  if (ok)
+    printf ("%s: files=%d samples=%zu segments=%zu size=%zu\n",
+            output, count, samples.size, nsegments,
+            ntaken * RTEMS_RTL_RAP_PACK_DICT_SEGMENT);
+
+  free (taken);
+  free (segments);
+  free (seen);
+  free (counts);
+  free (starts);
+  rtems_rtl_rap_pack_buf_free (&samples);
+
+  return ok;
+}
+
+/*
+ * Parse a section setting of the form section=level[,block].
+ */
+static bool
+rtems_rtl_rap_pack_section_option (rtems_rtl_rap_pack_t* pack, const char* arg)
+{
+  const char* value = strchr (arg, '=');
+  char*       end;
+  int         r;
+
+  if (value)
+  {
+    for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+    {
+      const char* name = rap_sections[r] + 1;
+      if ((strlen (name) == (value - arg)) &&
+          (strncmp (name, arg, value - arg) == 0))
+      {
+        ++value;
+        if (*value != ',')
+        {
+          pack->levels[r] = strtol (value, &end, 0);
+          value = end;
+        }
+        if (*value == ',')
+        {
+          pack->block_sizes[r] = strtoul (value + 1, &end, 0);
+          value = end;
+        }
+        if (*value == '\0')
+          return true;
+        break;
+      }
+    }
+  }
+
+  rtems_rtl_rap_pack_error ("invalid section setting: %s", arg);
+  return false;
+}
+
+static void
+rtems_rtl_rap_pack_usage (const char* argv0)
+{
+  printf ("usage: %s [options] -o output.rap input.o\n"
+          "       %s [options] -D output.dict input.o ...\n"
+          " -1           : write a version 1 file (default version 2)\n"
+          " -w           : write fixed size relocation records (version 2\n"
+          "                writes compact records)\n"
+          " -u           : write symbols without name hashes (version 2\n"
+          "                writes the hashes)\n"
+          " -c codec     : none, lz77 or lz4 (default lz77)\n"
+          " -d dict      : compress with a dictionary (version 2 and lz4)\n"
+          " -D dict      : train a dictionary from the input files\n"
+          " -m size      : the size of a trained dictionary (default %d)\n"
+          " -l level     : the LZ77 compression level, 1 or 2 (default 2)\n"
+          " -b block     : the block size (default %d)\n"
+          " -s sect=l,b  : the level and block size of text, const, ctor,\n"
+          "                dtor or data, eg -s text=1,8192 or -s data=,4096\n"
+          " -t           : tune the sections not set with -s\n"
+          " -r rate      : the target's read rate in KB/s (default %d)\n"
+          " -x scale     : the target's decode time over the host's (default 1)\n"
+          " -n runs      : the timed decode runs (default %d)\n"
+          " -v           : verbose\n",
+          argv0, argv0, RTEMS_RTL_RAP_PACK_DICT_SIZE,
+          RTEMS_RTL_RAP_PACK_STREAM_BLOCK,
+          RTEMS_RTL_RAP_PACK_RATE, RTEMS_RTL_RAP_PACK_RUNS);
+}
+
+int
+main (int argc, char* argv[])
+{
+  rtems_rtl_rap_pack_t pack;
+  const char**         inputs;
+  int                  ninputs = 0;
+  const char*          dict = NULL;
+  const char*          train = NULL;
+  size_t               dict_size = RTEMS_RTL_RAP_PACK_DICT_SIZE;
+  bool                 ok;
+  int                  arg;
+  int                  r;
+
+  rtems_rtl_crc32_init ();
+
+  memset (&pack, 0, sizeof (pack));
+  pack.version = 2;
+  pack.compression = RTEMS_RTL_RAP_PACK_COMP_LZ77;
+  pack.level = 2;
+  pack.block_size = RTEMS_RTL_RAP_PACK_STREAM_BLOCK;
+  pack.runs = RTEMS_RTL_RAP_PACK_RUNS;
+  pack.rate = RTEMS_RTL_RAP_PACK_RATE;
+  pack.scale = 1.0;
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+    pack.levels[r] = -1;
+
+  inputs = malloc (argc * sizeof (const char*));
+  if (!inputs)
+  {
+    rtems_rtl_rap_pack_error ("no memory");
+    return 1;
+  }
+
+  for (arg = 1; arg < argc; ++arg)
+  {
+    const char* opt = argv[arg];
+
+    if (opt[0] != '-')
+    {
+      inputs[ninputs++] = opt;
+      continue;
+    }
+
+    switch (opt[1])
+    {
+      case '1':
+        pack.version = 1;
+        continue;
+      case 'w':
+        pack.fixed_relocs = true;
+        continue;
+      case 'u':
+        pack.no_hashes = true;
+        continue;
+      case 't':
+        pack.tune = true;
+        continue;
+      case 'v':
+        pack.verbose = true;
+        continue;
+      default:
+        break;
+    }
+
+    if ((arg + 1) >= argc)
+    {
+      rtems_rtl_rap_pack_usage (argv[0]);
+      return 1;
+    }
+
+    ++arg;
+
+    switch (opt[1])
+    {
+      case 'o':
+        pack.output = argv[arg];
+        break;
+      case 'd':
+        dict = argv[arg];
+        break;
+      case 'D':
+        train = argv[arg];
+        break;
+      case 'm':
+        dict_size = strtoul (argv[arg], NULL, 0);
+        break;
+      case 'c':
+        if (strcmp (argv[arg], "none") == 0)
+          pack.compression = RTEMS_RTL_RAP_PACK_COMP_NONE;
+        else if (strcmp (argv[arg], "lz77") == 0)
+          pack.compression = RTEMS_RTL_RAP_PACK_COMP_LZ77;
+        else if (strcmp (argv[arg], "lz4") == 0)
+          pack.compression = RTEMS_RTL_RAP_PACK_COMP_LZ4;
+        else
+        {
+          rtems_rtl_rap_pack_error ("invalid codec: %s", argv[arg]);
+          return 1;
+        }
+        break;
+      case 'l':
+        pack.level = strtol (argv[arg], NULL, 0);
+        break;
+      case 'b':
+        pack.block_size = strtoul (argv[arg], NULL, 0);
+        break;
+      case 's':
+        if (!rtems_rtl_rap_pack_section_option (&pack, argv[arg]))
+          return 1;
+        break;
+      case 'r':
+        pack.rate = strtoul (argv[arg], NULL, 0);
+        break;
+      case 'x':
+        pack.scale = strtod (argv[arg], NULL);
+        break;
+      case 'n':
+        pack.runs = strtol (argv[arg], NULL, 0);
+        break;
+      default:
+        rtems_rtl_rap_pack_usage (argv[0]);
+        return 1;
+    }
+  }
+
+  if (train ? (ninputs == 0) : ((ninputs != 1) || !pack.output))
+  {
+    rtems_rtl_rap_pack_usage (argv[0]);
+    return 1;
+  }
+
+  pack.input = inputs[0];
+
+  pack.compact_relocs = (pack.version >= 2) && !pack.fixed_relocs;
+  pack.symbol_hashes = (pack.version >= 2) && !pack.no_hashes;
+
+  if (pack.compression != RTEMS_RTL_RAP_PACK_COMP_LZ77)
+  {
+    pack.level = 0;
+    for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+      if (pack.levels[r] >= 0)
+        pack.levels[r] = 0;
+  }
+  else
+  {
+    if ((pack.level < 1) || (pack.level > 2))
+    {
+      rtems_rtl_rap_pack_error ("invalid level: %d", pack.level);
+      return 1;
+    }
+    for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+    {
+      if ((pack.levels[r] == 0) || (pack.levels[r] > 2))
+      {
+        rtems_rtl_rap_pack_error ("invalid level: %s", rap_sections[r]);
+        return 1;
+      }
+    }
+  }
+
+  if ((pack.block_size < RTEMS_RTL_RAP_PACK_BLOCK_MIN) ||
+      (pack.block_size > RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX))
+  {
+    rtems_rtl_rap_pack_error ("invalid block size: %zu", pack.block_size);
+    return 1;
+  }
+
+  for (r = 0; r < RTEMS_RTL_RAP_PACK_DATA_SECS; ++r)
+  {
+    if ((pack.block_sizes[r] != 0) &&
+        ((pack.block_sizes[r] < RTEMS_RTL_RAP_PACK_BLOCK_MIN) ||
+         (pack.block_sizes[r] > RTEMS_RTL_RAP_PACK_SECT_BLOCK_MAX)))
+    {
+      rtems_rtl_rap_pack_error ("invalid block size: %s", rap_sections[r]);
+      return 1;
+    }
+  }
+
+  if ((pack.runs < 1) || (pack.rate == 0) || (pack.scale <= 0))
+  {
+    rtems_rtl_rap_pack_usage (argv[0]);
+    return 1;
+  }
+
+  if (train)
+  {
+    if ((dict_size < RTEMS_RTL_RAP_PACK_DICT_SEGMENT) ||
+        (dict_size > RTEMS_RTL_LZ4_DICT_MAX))
+    {
+      rtems_rtl_rap_pack_error ("invalid dictionary size: %zu", dict_size);
+      return 1;
+    }
+    ok = rtems_rtl_rap_pack_train (&pack, inputs, ninputs, train, dict_size);
+    free (inputs);
+    return ok ? 0 : 1;
+  }
+
+  free (inputs);
+
+  if (dict)
+  {
+    if ((pack.version < 2) ||
+        (pack.compression != RTEMS_RTL_RAP_PACK_COMP_LZ4))
+    {
+      rtems_rtl_rap_pack_error ("a dictionary needs version 2 and lz4");
+      return 1;
+    }
+    if (!rtems_rtl_rap_pack_dict_load (&pack, dict))
+      return 1;
+  }
+
+  ok = rtems_rtl_rap_pack (&pack);
+
+  rtems_rtl_rap_pack_free (&pack);
+
+  return ok ? 0 : 1;
+}
@@ -33,6 +33,10 @@
 #include "rtl-rap.h"
 #include "rtl-trace.h"
 #include "rtl-unresolved.h"
+#include "rtl-work.h"
+
+#include "fastlz.h"
+#include "rtl-lz4.h"
 
 /**
  * The offsets in the unresolved array.
@@ -41,6 +45,62 @@
 #define REL_R_INFO   (1)
 #define REL_R_ADDEND (2)
 
+/**
+ * The RAP file versions. Version 2 adds a block index after the header. The
+ * index is not compressed and is big endian:
+ *
+ *  uint32_t: flags
+ *  uint32_t: blocks
+ *  blocks x { uint32_t: offset, uint32_t: csize,
+ *             uint32_t: size, uint32_t: section }
+ *
+ * If the dictionary flag is set the blocks value is followed by:
+ *
+ *  uint32_t: dictionary CRC32
+ *
+ * The blocks follow the index and are the same compressed stream as version
+ * 1 with the header ending at a block boundary and each section starting in a
+ * new block.
+ *
+ * The checksum in the header of both versions is the CRC32 of the
+ * decompressed stream. A checksum of 0 is not checked.
+ */
+#define RTEMS_RTL_RAP_VERSION_1 (1)
+#define RTEMS_RTL_RAP_VERSION_2 (2)
+
+/**
+ * The version 2 flags. The compact relocations flag means the relocation
+ * table uses variable length fields. The symbol hashes flag means each symbol
+ * record has a fourth word holding the hash of the symbol's name. The
+ * dictionary flag means the LZ4 blocks are compressed with the dictionary
+ * loaded by rtems_rtl_rap_dictionary.
+ */
+#define RTEMS_RTL_RAP_FLAG_COMPACT_RELOCS (1 << 0)
+#define RTEMS_RTL_RAP_FLAG_SYMBOL_HASHES  (1 << 1)
+#define RTEMS_RTL_RAP_FLAG_DICTIONARY     (1 << 2)
+
+/**
+ * The version 2 flags supported.
+ */
+#define RTEMS_RTL_RAP_FLAGS (RTEMS_RTL_RAP_FLAG_COMPACT_RELOCS | \
+                             RTEMS_RTL_RAP_FLAG_SYMBOL_HASHES | \
+                             RTEMS_RTL_RAP_FLAG_DICTIONARY)
+
+/**
+ * The block index section of a block that does not hold section data.
+ */
+#define RTEMS_RTL_RAP_NO_SEC (0xffffffffUL)
+
+/**
+ * The size of the size field in front of each compressed block.
+ */
+#define RTEMS_RTL_RAP_BLOCK_PREFIX (2)
+
+/**
+ * The size of a block index entry in the file.
+ */
+#define RTEMS_RTL_RAP_BLOCK_ENTRY (4 * sizeof (uint32_t))
+
 /**
  * The ELF format signature.
  */
@@ -92,6 +152,60 @@ typedef struct rtems_rtl_rap_section_s
   uint32_t alignment;  /**< The alignment of the section. */
 } rtems_rtl_rap_section_t;
 
+/**
+ * A block in the block index of a version 2 RAP file. Section data starts in a
+ * new block so the blocks of a section can be decompressed directly into the
+ * section's memory in any order. The blocks of a section are next to each
+ * other in the index and in the file.
+ */
+typedef struct rtems_rtl_rap_block_s
+{
+  uint32_t offset;     /**< The offset of the block from the first block. */
+  uint32_t csize;      /**< The compressed size of the block. */
+  uint32_t size;       /**< The decompressed size of the block. */
+  uint32_t section;    /**< The section the block's data is part of. */
+  uint32_t soffset;    /**< The offset of the block's data in the section. */
+} rtems_rtl_rap_block_t;
+
+/**
+ * The number of blocks read and decompressed at a time. The caller and each
+ * worker have a few blocks a batch and the compressed blocks of a batch are
+ * read into a buffer held for the load.
+ */
+#define RTEMS_RTL_RAP_BLOCK_BATCH ((RTEMS_RTL_WORK_MAX_WORKERS + 1) * 4)
+
+/**
+ * The size of the buffer a symbol name appended to a relocation record is
+ * read into.
+ */
+#define RTEMS_RTL_RAP_SYMNAME_SIZE (1024)
+
+/**
+ * The number of entries in the relocation symbol cache.
+ */
+#define RTEMS_RTL_RAP_SYMCACHE_SIZE (64)
+
+/**
+ * The string table offset of a symbol name not in the string table.
+ */
+#define RTEMS_RTL_RAP_NO_STRTAB (0xffffffffUL)
+
+/**
+ * The largest compact relocation record less an appended name.
+ */
+#define RTEMS_RTL_RAP_COMPACT_MAX (5 * 5)
+
+/**
+ * A relocation symbol cache entry. The cache is direct mapped using the string
+ * table offset of the symbol's name so each symbol referenced by name is
+ * looked up once a load.
+ */
+typedef struct rtems_rtl_rap_symcache_s
+{
+  uint32_t             strtab;  /**< The string table offset of the name. */
+  rtems_rtl_obj_sym_t* symbol;  /**< The symbol. */
+} rtems_rtl_rap_symcache_t;
+
 /**
  * The RAP loader.
  */
@@ -99,6 +213,15 @@ typedef struct rtems_rtl_rap_s
 {
   rtems_rtl_obj_cache_t*  file;         /**< The file cache for the RAP file. */
   rtems_rtl_obj_comp_t*   decomp;       /**< The decompression streamer. */
+  off_t                   blocks_base;  /**< The file offset of the blocks. */
+  uint32_t                flags;        /**< The version 2 flags. */
+  uint32_t                blocks;       /**< The number of blocks. */
+  rtems_rtl_rap_block_t*  block_index;  /**< The version 2 block index. */
+  uint8_t*                blocks_buffer; /**< The compressed blocks
+                                         *   buffer. */
+  size_t                  blocks_buffer_size; /**< The blocks buffer size. */
+  const uint8_t*          dict;         /**< The dictionary or NULL. */
+  size_t                  dict_size;    /**< The size of the dictionary. */
   uint32_t                length;       /**< The file length. */
   uint32_t                version;      /**< The RAP file version. */
   uint32_t                compression;  /**< The type of compression. */
@@ -114,6 +237,11 @@ typedef struct rtems_rtl_rap_s
   uint32_t                strtab_size;  /**< The string table size. */
   uint32_t                relocs_size;  /**< The relocation table size. */
   uint32_t                symbols;      /**< The number of symbols. */
+  char*                   symname;      /**< The relocation symbol name. */
+  rtems_rtl_rap_symcache_t* symcache;   /**< The relocation symbol cache. */
+  uint8_t*                relocs;       /**< The compact relocation buffer. */
+  size_t                  relocs_buffer_size; /**< The relocation buffer
+                                               *   size. */
 } rtems_rtl_rap_t;
 
 /**
@@ -199,6 +327,232 @@ rtems_rtl_rap_read_uint32 (rtems_rtl_obj_comp_t* comp, uint32_t* value)
   return true;
 }
 
+/**
+ * The section blocks being decompressed.
+ */
+typedef struct rtems_rtl_rap_block_job_s
+{
+  int                          compression; /**< The type of compression. */
+  const rtems_rtl_rap_block_t* blocks;      /**< The section's blocks. */
+  const uint8_t*               input;       /**< The compressed blocks. */
+  uint8_t*                     base;        /**< The section's memory. */
+  const uint8_t*               dict;        /**< The dictionary or NULL. */
+  size_t                       dict_size;   /**< The size of the dictionary. */
+} rtems_rtl_rap_block_job_t;
+
+/*
+ * Decompress a block into the section. This is a work handler so it can be run
+ * by a worker and cannot call the RTL.
+ */
+static bool
+rtems_rtl_rap_block_decompress (void* data, size_t item)
+{
+  rtems_rtl_rap_block_job_t*   job = data;
+  const rtems_rtl_rap_block_t* block = &job->blocks[item];
+  const uint8_t*               input;
+  uint8_t*                     output;
+
+  input = job->input + (block->offset - job->blocks[0].offset);
+  output = job->base + block->soffset;
+
+  if (((input[0] << 8) | input[1]) != block->csize)
+    return false;
+
+  input += RTEMS_RTL_RAP_BLOCK_PREFIX;
+
+  switch (job->compression)
+  {
+    case RTEMS_RTL_COMP_NONE:
+      if (block->csize != block->size)
+        return false;
+      memcpy (output, input, block->size);
+      break;
+    case RTEMS_RTL_COMP_LZ77:
+      if (fastlz_decompress (input, block->csize,
+                             output, block->size) != block->size)
+        return false;
+      break;
+    case RTEMS_RTL_COMP_LZ4:
+      if (rtems_rtl_lz4_decompress_dict (input, block->csize,
+                                         output, block->size,
+                                         job->dict,
+                                         job->dict_size) != block->size)
+        return false;
+      break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+/*
+ * Read the compressed blocks of a section. A file is read directly into the
+ * input buffer. A stream cannot seek so the blocks are read through the cache
+ * a cache buffer at a time.
+ */
+static bool
+rtems_rtl_rap_read_blocks (rtems_rtl_rap_t* rap,
+                           rtems_rtl_obj_t* obj,
+                           int              fd,
+                           off_t            offset,
+                           uint8_t*         input,
+                           size_t           span)
+{
+  if ((obj->flags & RTEMS_RTL_OBJ_STREAM) != 0)
+  {
+    while (span)
+    {
+      size_t len = span;
+
+      if (len > rap->file->size)
+        len = rap->file->size;
+
+      if (!rtems_rtl_obj_cache_read_byval (rap->file, fd, offset, input, len))
+        return false;
+
+      input += len;
+      offset += len;
+      span -= len;
+    }
+
+    return true;
+  }
+
+  if (lseek (fd, offset, SEEK_SET) < 0)
+  {
+    rtems_rtl_set_error (errno, "section blocks seek failed");
+    return false;
+  }
+
+  while (span)
+  {
+    ssize_t r = read (fd, input, span);
+    if (r <= 0)
+    {
+      rtems_rtl_set_error (errno, "section blocks read failed");
+      return false;
+    }
+    input += r;
+    span -= r;
+  }
+
+  return true;
+}
+
+/*
+ * Load a section from a version 2 file. The section's compressed blocks are
+ * read a batch at a time and each batch is decompressed in parallel straight
+ * into the section. The buffer the batches are read into is held for the load
+ * and only grows if a batch is larger. The stream is then moved to the block
+ * following the section.
+ */
+static bool
+rtems_rtl_rap_load_blocks (rtems_rtl_rap_t*      rap,
+                           rtems_rtl_obj_t*      obj,
+                           int                   fd,
+                           rtems_rtl_obj_sect_t* sect)
+{
+  rtems_rtl_rap_block_job_t    job;
+  const rtems_rtl_rap_block_t* last;
+  uint32_t                     first;
+  uint32_t                     count;
+  uint32_t                     batch;
+  uint32_t                     b;
+
+  for (first = 0; first < rap->blocks; ++first)
+    if (rap->block_index[first].section == sect->section)
+      break;
+
+  for (count = 0; (first + count) < rap->blocks; ++count)
+    if (rap->block_index[first + count].section != sect->section)
+      break;
+
+  if (count == 0)
+  {
+    if (sect->size)
+    {
+      rtems_rtl_set_error (EINVAL, "no blocks for section: %s", sect->name);
+      return false;
+    }
+    return true;
+  }
+
+  last = &rap->block_index[first + count - 1];
+
+  if ((last->soffset + last->size) != sect->size)
+  {
+    rtems_rtl_set_error (EINVAL, "section blocks size mismatch: %s", sect->name);
+    return false;
+  }
+
+  if (rtems_rtl_obj_comp_buffered (rap->decomp))
+  {
+    rtems_rtl_set_error (EINVAL, "section not block aligned: %s", sect->name);
+    return false;
+  }
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD_SECT))
+    printf ("rtl: rap: %s: blocks=%lu first=%lu\n", sect->name, count, first);
+
+  job.compression = rap->compression;
+  job.base = sect->base;
+  job.dict = rap->dict;
+  job.dict_size = rap->dict_size;
+
+  for (b = 0; b < count; b += batch)
+  {
+    const rtems_rtl_rap_block_t* blocks = &rap->block_index[first + b];
+    const rtems_rtl_rap_block_t* end;
+    size_t                       span;
+
+    batch = count - b;
+    if (batch > RTEMS_RTL_RAP_BLOCK_BATCH)
+      batch = RTEMS_RTL_RAP_BLOCK_BATCH;
+
+    end = &blocks[batch - 1];
+    span = (end->offset + RTEMS_RTL_RAP_BLOCK_PREFIX + end->csize) -
+      blocks->offset;
+
+    if (span > rap->blocks_buffer_size)
+    {
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, rap->blocks_buffer);
+      rap->blocks_buffer_size = 0;
+      rap->blocks_buffer = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                                span, false);
+      if (!rap->blocks_buffer)
+      {
+        rtems_rtl_set_error (ENOMEM,
+                             "no memory for section blocks: %s", sect->name);
+        return false;
+      }
+      rap->blocks_buffer_size = span;
+    }
+
+    if (!rtems_rtl_rap_read_blocks (rap, obj, fd,
+                                    rap->blocks_base + blocks->offset,
+                                    rap->blocks_buffer, span))
+      return false;
+
+    job.blocks = blocks;
+    job.input = rap->blocks_buffer;
+
+    if (!rtems_rtl_work_run (rtems_rtl_rap_block_decompress, &job, batch))
+    {
+      rtems_rtl_set_error (EIO, "section decompression failed: %s", sect->name);
+      return false;
+    }
+  }
+
+  rtems_rtl_obj_comp_crc_add (rap->decomp, sect->base, sect->size);
+
+  rtems_rtl_obj_comp_seek (rap->decomp,
+                           rap->blocks_base + last->offset +
+                           RTEMS_RTL_RAP_BLOCK_PREFIX + last->csize);
+
+  return true;
+}
+
 static bool
 rtems_rtl_rap_loader (rtems_rtl_obj_t*      obj,
                       int                   fd,
@@ -211,26 +565,200 @@ rtems_rtl_rap_loader (rtems_rtl_obj_t*      obj,
     printf ("rtl: rap: input %s=%lu\n",
             sect->name, rtems_rtl_obj_comp_input (rap->decomp));
 
-  return rtems_rtl_obj_comp_read (rap->decomp, sect->base, sect->size);
+  if (rap->version < RTEMS_RTL_RAP_VERSION_2)
+    return rtems_rtl_obj_comp_read (rap->decomp, sect->base, sect->size);
+
+  return rtems_rtl_rap_load_blocks (rap, obj, fd, sect);
+}
+
+/*
+ * Find the symbol a relocation references. A name in the string table is
+ * looked up once a load and then found in the symbol cache using the string
+ * table offset. A name appended to a relocation record is always looked up.
+ */
+static rtems_rtl_obj_sym_t*
+rtems_rtl_rap_find_symbol (rtems_rtl_rap_t* rap,
+                           rtems_rtl_obj_t* obj,
+                           const char*      symname,
+                           uint32_t         strtab)
+{
+  rtems_rtl_rap_symcache_t* entry = NULL;
+  rtems_rtl_obj_sym_t*      symbol;
+
+  if (strtab != RTEMS_RTL_RAP_NO_STRTAB)
+  {
+    entry = &rap->symcache[strtab % RTEMS_RTL_RAP_SYMCACHE_SIZE];
+    if (entry->strtab == strtab)
+      return entry->symbol;
+  }
+
+  symbol = rtems_rtl_symbol_obj_find (obj, symname);
+
+  rtems_rtl_batch_resolved (symbol);
+
+  if (symbol && entry)
+  {
+    entry->strtab = strtab;
+    entry->symbol = symbol;
+  }
+
+  return symbol;
 }
 
+/*
+ * Apply a relocation. A section relative relocation has a section index and
+ * the addend is the offset in the section. A relocation against a symbol has
+ * the symbol's name or NULL if the relocation type does not use the symbol.
+ * The string table offset of the name is RTEMS_RTL_RAP_NO_STRTAB if the name
+ * is not in the string table.
+ */
 static bool
-rtems_rtl_rap_relocate (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
+rtems_rtl_rap_relocate_apply (rtems_rtl_rap_t*      rap,
+                              rtems_rtl_obj_t*      obj,
+                              rtems_rtl_obj_sect_t* targetsect,
+                              bool                  is_rela,
+                              int                   r,
+                              Elf_Word              type,
+                              uint32_t              offset,
+                              uint32_t              addend,
+                              int                   section,
+                              const char*           symname,
+                              uint32_t              strtab)
 {
-  #define SYMNAME_BUFFER_SIZE (1024)
-  char*    symname_buffer = NULL;
-  int      section;
+  Elf_Word symtype = 0;
+  Elf_Word symvalue = 0;
 
-  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-    printf ("rtl: relocation\n");
+  /*
+   * A relocation writes at most a word. The checksum is only checked once all
+   * relocations are applied so a bad offset must not write outside the
+   * section.
+   */
+  if ((targetsect->size < sizeof (Elf_Word)) ||
+      (offset > (targetsect->size - sizeof (Elf_Word))))
+  {
+    rtems_rtl_set_error (EINVAL, "reloc offset outside section: %s: %lu",
+                         targetsect->name, offset);
+    return false;
+  }
+
+  if (section >= 0)
+  {
+    rtems_rtl_obj_sect_t* symsect;
+
+    symsect = rtems_rtl_obj_find_section_by_index (obj, section);
+    if (!symsect)
+    {
+      rtems_rtl_set_error (EINVAL, "reloc section not found: %d", section);
+      return false;
+    }
+
+    symvalue = (Elf_Word) symsect->base + addend;
+  }
+  else if (symname)
+  {
+    rtems_rtl_obj_sym_t* symbol;
+
+    symbol = rtems_rtl_rap_find_symbol (rap, obj, symname, strtab);
+
+    if (!symbol)
+    {
+      rtems_rtl_set_error (EINVAL, "global symbol not found: %s", symname);
+      return false;
+    }
+
+    symvalue = (Elf_Word) symbol->value;
+  }
+
+  if (is_rela)
+  {
+    Elf_Rela rela;
+
+    rela.r_offset = offset;
+    rela.r_info = type;
+
+    if (section >= 0)
+      rela.r_addend = 0;
+    else rela.r_addend = addend;
+
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+      printf (" %2d: rela: type:%-2d off:%lu addend:%d" \
+              " symname=%s symtype=%lu symvalue=0x%08lx\n",
+              r, (int) type, offset, (int) addend,
+              symname, symtype, symvalue);
+
+    if (!rtems_rtl_elf_relocate_rela (obj, &rela, targetsect,
+                                      symname, symtype, symvalue))
+      return false;
+  }
+  else
+  {
+    Elf_Rel rel;
+
+    rel.r_offset = offset;
+    rel.r_info = type;
+
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+      printf (" %2d: rel: type:%-2d off:%lu" \
+              " symname=%s symtype=%lu symvalue=0x%08lx\n",
+              r, (int) type, offset,
+              symname, symtype, symvalue);
+
+    if (!rtems_rtl_elf_relocate_rel (obj, &rel, targetsect,
+                                     symname, symtype, symvalue))
+      return false;
+  }
 
-  symname_buffer = malloc (SYMNAME_BUFFER_SIZE);
-  if (!symname_buffer)
+  return true;
+}
+
+/*
+ * Set up the relocator's buffers. A RAP file is read through the symbols
+ * cache so the strings and relocs caches are not used while a RAP file loads.
+ * The relocator borrows their buffers rather than allocating memory for each
+ * load. The caches are flushed so the next ELF load does not use the data.
+ */
+static bool
+rtems_rtl_rap_relocate_buffers (rtems_rtl_rap_t* rap)
+{
+  rtems_rtl_obj_cache_t* strings;
+  rtems_rtl_obj_cache_t* relocs;
+  int                    e;
+
+  rtems_rtl_obj_caches (NULL, &strings, &relocs);
+
+  if (!strings || !relocs ||
+      (strings->size < (RTEMS_RTL_RAP_SYMNAME_SIZE +
+                        (RTEMS_RTL_RAP_SYMCACHE_SIZE *
+                         sizeof (rtems_rtl_rap_symcache_t)))) ||
+      (relocs->size < RTEMS_RTL_RAP_SYMNAME_SIZE))
   {
-    rtems_rtl_set_error (ENOMEM, "no memory for local symbol name buffer");
+    rtems_rtl_set_error (ENOMEM, "no relocation buffers");
     return false;
   }
 
+  rtems_rtl_obj_cache_flush (strings);
+  rtems_rtl_obj_cache_flush (relocs);
+
+  rap->symname = (char*) strings->buffer;
+  rap->symcache = (rtems_rtl_rap_symcache_t*)
+    (strings->buffer + RTEMS_RTL_RAP_SYMNAME_SIZE);
+  rap->relocs = relocs->buffer;
+  rap->relocs_buffer_size = relocs->size;
+
+  for (e = 0; e < RTEMS_RTL_RAP_SYMCACHE_SIZE; ++e)
+    rap->symcache[e].strtab = RTEMS_RTL_RAP_NO_STRTAB;
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_relocate (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
+{
+  int section;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: relocation\n");
+
   for (section = 0; section < RTEMS_RTL_RAP_SECS; ++section)
   {
     rtems_rtl_obj_sect_t*  targetsect;
@@ -244,189 +772,356 @@ rtems_rtl_rap_relocate (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
     if (!targetsect)
     {
       rtems_rtl_set_error (EINVAL, "no target section found");
-      free (symname_buffer);
       return false;
     }
 
     if (!rtems_rtl_rap_read_uint32 (rap->decomp, &header))
-    {
-      free (symname_buffer);
       return false;
-    }
 
     /*
      * Bit 31 of the header indicates if the relocations for this section
      * have a valid addend field.
      */
 
-    is_rela = (header & (1 << 31)) != 0 ? true : false;
-    relocs = header & ~(1 << 31);
+    is_rela = (header & (1 << 31)) != 0 ? true : false;
+    relocs = header & ~(1 << 31);
+
+    if (relocs && rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+      printf ("rtl: relocation: %s: header: %08lx relocs: %d %s\n",
+              rap_sections[section].name,
+              header, relocs, is_rela ? "rela" : "rel");
+
+    for (r = 0; r < relocs; ++r)
+    {
+      uint32_t    info = 0;
+      uint32_t    offset = 0;
+      uint32_t    addend = 0;
+      Elf_Word    type;
+      const char* symname = NULL;
+      uint32_t    symname_size;
+      uint32_t    strtab = RTEMS_RTL_RAP_NO_STRTAB;
+      int         symsect = -1;
+
+      if (!rtems_rtl_rap_read_uint32 (rap->decomp, &info))
+        return false;
+
+      if (!rtems_rtl_rap_read_uint32 (rap->decomp, &offset))
+        return false;
+
+      /*
+       * The types are:
+       *
+       *  0  Section symbol offset in addend.
+       *  1  Symbol appended to the relocation record.
+       *  2  Symbol is in the strtabl.
+       *
+       * If type 2 bits 30:8 is the offset in the strtab. If type 1 the bits
+       * are the size of the string. The lower 8 bits of the info field if the
+       * ELF relocation type field.
+       */
+
+      if (((info & (1 << 31)) == 0) || is_rela)
+      {
+        if (!rtems_rtl_rap_read_uint32 (rap->decomp, &addend))
+          return false;
+      }
+
+      if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+        printf (" %2d: info=%08lx offset=%lu addend=%lu\n",
+                r, info, offset, addend);
+
+      type = info & 0xff;
+
+      if ((info & (1 << 31)) == 0)
+      {
+        symsect = info >> 8;
+      }
+      else if (rtems_rtl_elf_rel_resolve_sym (type))
+      {
+        symname_size = (info & ~(3 << 30)) >> 8;
+
+        if ((info & (1 << 30)) != 0)
+        {
+          if (symname_size >= rap->strtab_size)
+          {
+            rtems_rtl_set_error (EINVAL, "invalid reloc strtab offset");
+            return false;
+          }
+          symname = rap->strtab + symname_size;
+          strtab = symname_size;
+        }
+        else
+        {
+          if (symname_size > (RTEMS_RTL_RAP_SYMNAME_SIZE - 1))
+          {
+            rtems_rtl_set_error (EINVAL, "reloc symbol too big");
+            return false;
+          }
+
+          if (!rtems_rtl_obj_comp_read (rap->decomp, rap->symname, symname_size))
+            return false;
+
+          rap->symname[symname_size] = '\0';
+          symname = rap->symname;
+        }
+      }
+
+      if (!rtems_rtl_rap_relocate_apply (rap, obj, targetsect, is_rela, r,
+                                         type, offset, addend,
+                                         symsect, symname, strtab))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Read an unsigned LEB128 value from the compact relocations.
+ */
+static bool
+rtems_rtl_rap_get_varint (const uint8_t** buffer,
+                          const uint8_t*  end,
+                          uint32_t*       value)
+{
+  const uint8_t* p = *buffer;
+  uint32_t       v = 0;
+  int            shift = 0;
+
+  while (true)
+  {
+    if ((p >= end) || (shift > 28))
+    {
+      rtems_rtl_set_error (EINVAL, "invalid compact relocation");
+      return false;
+    }
+    v |= ((uint32_t) (*p & 0x7f)) << shift;
+    if ((*p++ & 0x80) == 0)
+      break;
+    shift += 7;
+  }
+
+  *buffer = p;
+  *value = v;
+
+  return true;
+}
+
+/*
+ * Read a zigzag encoded signed value from the compact relocations.
+ */
+static bool
+rtems_rtl_rap_get_svarint (const uint8_t** buffer,
+                           const uint8_t*  end,
+                           uint32_t*       value)
+{
+  uint32_t v;
+  if (!rtems_rtl_rap_get_varint (buffer, end, &v))
+    return false;
+  *value = (v >> 1) ^ -(v & 1);
+  return true;
+}
+
+/*
+ * Make sure the relocation buffer holds at least the size of data or the rest
+ * of the relocation table. The data not used is moved to the start of the
+ * buffer and the buffer is filled from the stream.
+ */
+static bool
+rtems_rtl_rap_relocs_fill (rtems_rtl_rap_t* rap,
+                           const uint8_t**  rp,
+                           const uint8_t**  rend,
+                           uint32_t*        remaining,
+                           size_t           size)
+{
+  size_t level = *rend - *rp;
+  size_t length;
+
+  if ((level >= size) || (*remaining == 0))
+    return true;
+
+  memmove (rap->relocs, *rp, level);
+
+  length = rap->relocs_buffer_size - level;
+  if (length > *remaining)
+    length = *remaining;
+
+  if (!rtems_rtl_obj_comp_read (rap->decomp, rap->relocs + level, length))
+    return false;
+
+  *remaining -= length;
+  *rp = rap->relocs;
+  *rend = rap->relocs + level + length;
+
+  return true;
+}
+
+/*
+ * Relocate using the compact relocations of a version 2 file. The relocation
+ * table is read into the relocation buffer a buffer at a time and decoded
+ * from memory. The format for each section is:
+ *
+ *  varint: relocs << 1 | rela
+ *  relocs x { varint: type << 2 | form,
+ *             svarint: offset less the previous offset in the section,
+ *             form 0: varint: section, svarint: addend
+ *             form 1: [svarint: addend], varint: size, size x char: name
+ *             form 2: [svarint: addend], varint: strtab offset }
+ *
+ * The addend of a symbol relocation is only present if the section's
+ * relocations are rela. A name appended in form 1 is always present.
+ */
+static bool
+rtems_rtl_rap_relocate_compact (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
+{
+  const uint8_t* rp;
+  const uint8_t* rend;
+  uint32_t       remaining;
+  int            section;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+    printf ("rtl: relocation: compact: size=%lu\n", rap->relocs_size);
+
+  rp = rend = rap->relocs;
+  remaining = rap->relocs_size;
+
+  for (section = 0; section < RTEMS_RTL_RAP_SECS; ++section)
+  {
+    rtems_rtl_obj_sect_t* targetsect;
+    uint32_t              header;
+    uint32_t              offset = 0;
+    bool                  is_rela;
+    uint32_t              r;
+
+    targetsect = rtems_rtl_obj_find_section (obj, rap_sections[section].name);
+    if (!targetsect)
+    {
+      rtems_rtl_set_error (EINVAL, "no target section found");
+      return false;
+    }
+
+    if (!rtems_rtl_rap_relocs_fill (rap, &rp, &rend, &remaining,
+                                    RTEMS_RTL_RAP_COMPACT_MAX) ||
+        !rtems_rtl_rap_get_varint (&rp, rend, &header))
+      return false;
 
-    if (relocs && rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-      printf ("rtl: relocation: %s: header: %08lx relocs: %d %s\n",
-              rap_sections[section].name,
-              header, relocs, is_rela ? "rela" : "rel");
+    is_rela = (header & 1) != 0;
+    header >>= 1;
 
-    for (r = 0; r < relocs; ++r)
+    if (header && rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
+      printf ("rtl: relocation: %s: relocs: %lu %s\n",
+              rap_sections[section].name, header, is_rela ? "rela" : "rel");
+
+    for (r = 0; r < header; ++r)
     {
-      uint32_t    info = 0;
-      uint32_t    offset = 0;
+      uint32_t    tag;
+      uint32_t    delta;
       uint32_t    addend = 0;
+      uint32_t    value;
       Elf_Word    type;
       const char* symname = NULL;
-      uint32_t    symname_size;
-      Elf_Word    symtype = 0;
-      Elf_Word    symvalue = 0;
-
-      if (!rtems_rtl_rap_read_uint32 (rap->decomp, &info))
-      {
-        free (symname_buffer);
-        return false;
-      }
+      uint32_t    strtab = RTEMS_RTL_RAP_NO_STRTAB;
+      int         symsect = -1;
 
-      if (!rtems_rtl_rap_read_uint32 (rap->decomp, &offset))
-      {
-        free (symname_buffer);
+      if (!rtems_rtl_rap_relocs_fill (rap, &rp, &rend, &remaining,
+                                      RTEMS_RTL_RAP_COMPACT_MAX) ||
+          !rtems_rtl_rap_get_varint (&rp, rend, &tag) ||
+          !rtems_rtl_rap_get_svarint (&rp, rend, &delta))
         return false;
-      }
 
-      /*
-       * The types are:
-       *
-       *  0  Section symbol offset in addend.
-       *  1  Symbol appended to the relocation record.
-       *  2  Symbol is in the strtabl.
-       *
-       * If type 2 bits 30:8 is the offset in the strtab. If type 1 the bits
-       * are the size of the string. The lower 8 bits of the info field if the
-       * ELF relocation type field.
-       */
+      offset += delta;
+      type = tag >> 2;
 
-      if (((info & (1 << 31)) == 0) || is_rela)
+      if ((tag & 3) == 0)
       {
-        if (!rtems_rtl_rap_read_uint32 (rap->decomp, &addend))
-        {
-          free (symname_buffer);
+        if (!rtems_rtl_rap_get_varint (&rp, rend, &value) ||
+            !rtems_rtl_rap_get_svarint (&rp, rend, &addend))
           return false;
-        }
+        symsect = value;
       }
-
-      if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-        printf (" %2d: info=%08lx offset=%lu addend=%lu\n",
-                r, info, offset, addend);
-
-      type = info & 0xff;
-
-      if ((info & (1 << 31)) == 0)
+      else
       {
-        rtems_rtl_obj_sect_t* symsect;
-
-        symsect = rtems_rtl_obj_find_section_by_index (obj, info >> 8);
-        if (!symsect)
-        {
-          free (symname_buffer);
+        if (is_rela && !rtems_rtl_rap_get_svarint (&rp, rend, &addend))
           return false;
-        }
 
-        symvalue = (Elf_Word) symsect->base + addend;
-      }
-      else if (rtems_rtl_elf_rel_resolve_sym (type))
-      {
-        rtems_rtl_obj_sym_t* symbol;
-
-        symname_size = (info & ~(3 << 30)) >> 8;
+        if (!rtems_rtl_rap_get_varint (&rp, rend, &value))
+          return false;
 
-        if ((info & (1 << 30)) != 0)
-        {
-          symname = rap->strtab + symname_size;
-        }
-        else
+        if ((tag & 3) == 1)
         {
-          if (symname_size > (SYMNAME_BUFFER_SIZE - 1))
+          if ((value > (RTEMS_RTL_RAP_SYMNAME_SIZE - 1)) ||
+              !rtems_rtl_rap_relocs_fill (rap, &rp, &rend, &remaining, value))
           {
-            free (symname_buffer);
             rtems_rtl_set_error (EINVAL, "reloc symbol too big");
             return false;
           }
-
-          if (!rtems_rtl_obj_comp_read (rap->decomp, symname_buffer, symname_size))
+          if (value > (rend - rp))
           {
-            free (symname_buffer);
+            rtems_rtl_set_error (EINVAL, "invalid compact relocation");
             return false;
           }
-
-          symname_buffer[symname_size] = '\0';
-          symname = symname_buffer;
+          memcpy (rap->symname, rp, value);
+          rap->symname[value] = '\0';
+          symname = rap->symname;
+          rp += value;
         }
-
-        symbol = rtems_rtl_symbol_obj_find (obj, symname);
-
-        if (!symbol)
+        else
         {
-          rtems_rtl_set_error (EINVAL, "global symbol not found: %s", symname);
-          free (symname_buffer);
-          return false;
+          if (value >= rap->strtab_size)
+          {
+            rtems_rtl_set_error (EINVAL, "invalid reloc strtab offset");
+            return false;
+          }
+          symname = rap->strtab + value;
+          strtab = value;
         }
 
-        symvalue = (Elf_Word) symbol->value;
-      }
-
-      if (is_rela)
-      {
-        Elf_Rela rela;
-
-        rela.r_offset = offset;
-        rela.r_info = type;
-
-        if ((info & (1 << 31)) == 0)
-          rela.r_addend = 0;
-        else rela.r_addend = addend;
-
-        if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-          printf (" %2d: rela: type:%-2d off:%lu addend:%d" \
-                  " symname=%s symtype=%lu symvalue=0x%08lx\n",
-                  r, (int) type, offset, (int) addend,
-                  symname, symtype, symvalue);
-
-        if (!rtems_rtl_elf_relocate_rela (obj, &rela, targetsect,
-                                          symname, symtype, symvalue))
-        {
-          free (symname_buffer);
-          return false;
-        }
+        if (!rtems_rtl_elf_rel_resolve_sym (type))
+          symname = NULL;
       }
-      else
-      {
-        Elf_Rel rel;
 
-        rel.r_offset = offset;
-        rel.r_info = type;
-
-        if (rtems_rtl_trace (RTEMS_RTL_TRACE_RELOC))
-          printf (" %2d: rel: type:%-2d off:%lu" \
-                  " symname=%s symtype=%lu symvalue=0x%08lx\n",
-                  r, (int) type, offset,
-                  symname, symtype, symvalue);
-
-        if (!rtems_rtl_elf_relocate_rel (obj, &rel, targetsect,
-                                         symname, symtype, symvalue))
-        {
-          free (symname_buffer);
-          return false;
-        }
-      }
+      if (!rtems_rtl_rap_relocate_apply (rap, obj, targetsect, is_rela, r,
+                                         type, offset, addend,
+                                         symsect, symname, strtab))
+        return false;
     }
   }
 
-  free (symname_buffer);
+  if ((rp != rend) || (remaining != 0))
+  {
+    rtems_rtl_set_error (EINVAL, "relocation table size mismatch");
+    return false;
+  }
 
   return true;
 }
 
+/*
+ * The size of a symbol record in the file.
+ */
+static size_t
+rtems_rtl_rap_symbol_size (const rtems_rtl_rap_t* rap)
+{
+  if ((rap->flags & RTEMS_RTL_RAP_FLAG_SYMBOL_HASHES) != 0)
+    return 4 * sizeof (uint32_t);
+  return 3 * sizeof (uint32_t);
+}
+
+static void
+rtems_rtl_rap_symbols_free (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_SYMBOL, obj->global_table);
+  obj->global_table = NULL;
+  obj->global_syms = 0;
+  obj->global_size = 0;
+}
+
 static bool
 rtems_rtl_rap_load_symbols (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
 {
   rtems_rtl_obj_sym_t* gsym;
+  const uint8_t*       record;
+  size_t               record_size;
   int                  sym;
 
   obj->global_size =
@@ -447,30 +1142,62 @@ rtems_rtl_rap_load_symbols (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
                  (rap->symbols * sizeof (rtems_rtl_obj_sym_t)));
 
   if (!rtems_rtl_obj_comp_read (rap->decomp, rap->strtab, rap->strtab_size))
+  {
+    rtems_rtl_rap_symbols_free (obj);
+    return false;
+  }
+
+  /*
+   * Read the symbol records with one read into the end of the symbol table.
+   * A record is smaller than a symbol so the records are converted in place
+   * from the start of the table without overwriting a record not yet read.
+   */
+  record_size = rtems_rtl_rap_symbol_size (rap);
+  record = ((const uint8_t*) rap->strtab) - (rap->symbols * record_size);
+
+  if (!rtems_rtl_obj_comp_read (rap->decomp, (void*) record,
+                                rap->symbols * record_size))
+  {
+    rtems_rtl_rap_symbols_free (obj);
     return false;
+  }
 
-  for (sym = 0, gsym = obj->global_table; sym < rap->symbols; ++sym)
+  for (sym = 0, gsym = obj->global_table;
+       sym < rap->symbols;
+       ++sym, record += record_size)
   {
     rtems_rtl_obj_sect_t* symsect;
+    rtems_rtl_obj_sym_t*  global;
     uint32_t              data;
     uint32_t              name;
     uint32_t              value;
+    uint32_t              hash;
 
-    if (!rtems_rtl_rap_read_uint32 (rap->decomp, &data) ||
-        !rtems_rtl_rap_read_uint32 (rap->decomp, &name) ||
-        !rtems_rtl_rap_read_uint32 (rap->decomp, &value))
-    {
-      free (obj->global_table);
-      obj->global_table = NULL;
-      obj->global_syms = 0;
-      obj->global_size = 0;
-      return false;
-    }
+    data = rtems_rtl_rap_get_uint32 (record);
+    name = rtems_rtl_rap_get_uint32 (record + 4);
+    value = rtems_rtl_rap_get_uint32 (record + 8);
 
     if (rtems_rtl_trace (RTEMS_RTL_TRACE_SYMBOL))
       printf ("rtl: sym:load: data=0x%08lx name=0x%08lx value=0x%08lx\n",
               data, name, value);
 
+    if (name >= rap->strtab_size)
+    {
+      rtems_rtl_rap_symbols_free (obj);
+      rtems_rtl_set_error (EINVAL, "symbol name not in string table");
+      return false;
+    }
+
+    /*
+     * The hash in the file saves hashing the name to check for a duplicate
+     * and to add the symbol to the global table. The checksum of the file
+     * covers the hash.
+     */
+    if ((rap->flags & RTEMS_RTL_RAP_FLAG_SYMBOL_HASHES) != 0)
+      hash = rtems_rtl_rap_get_uint32 (record + 12);
+    else
+      hash = rtems_rtl_symbol_hash (rap->strtab + name);
+
     /*
      * If there is a globally exported symbol already present and this
      * symbol is not weak raise an error. If the symbol is weak and present
@@ -478,13 +1205,10 @@ rtems_rtl_rap_load_symbols (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
      * present take this symbol global or weak. We accept the first weak
      * symbol we find and make it globally exported.
      */
-    if (rtems_rtl_symbol_global_find (rap->strtab + name) &&
-        (ELF_ST_BIND (data & 0xffff) != STB_WEAK))
+    global = rtems_rtl_symbol_global_find_hash (rap->strtab + name, hash);
+    if (global && (ELF_ST_BIND (data & 0xffff) != STB_WEAK))
     {
-      free (obj->global_table);
-      obj->global_table = NULL;
-      obj->global_syms = 0;
-      obj->global_size = 0;
+      rtems_rtl_rap_symbols_free (obj);
       rtems_rtl_set_error (EINVAL,
                            "duplicate global symbol: %s", rap->strtab + name);
       return false;
@@ -493,10 +1217,7 @@ rtems_rtl_rap_load_symbols (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
     symsect = rtems_rtl_obj_find_section_by_index (obj, data >> 16);
     if (!symsect)
     {
-      free (obj->global_table);
-      obj->global_table = NULL;
-      obj->global_syms = 0;
-      obj->global_size = 0;
+      rtems_rtl_rap_symbols_free (obj);
       rtems_rtl_set_error (EINVAL, "section index not found: %lu", data >> 16);
       return false;
     }
@@ -505,6 +1226,7 @@ rtems_rtl_rap_load_symbols (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj)
     gsym->name = rap->strtab + name;
     gsym->value = (uint8_t*) (value + symsect->base);
     gsym->data = data & 0xffff;
+    gsym->hash = hash;
 
     if (rtems_rtl_trace (RTEMS_RTL_TRACE_SYMBOL))
       printf ("rtl: sym:add:%-2d name:%-20s bind:%-2d type:%-2d val:%8p sect:%d\n",
@@ -564,7 +1286,7 @@ rtems_rtl_rap_parse_header (uint8_t*  rhdr,
   sptr = eptr + 1;
 
   /*
-   * "NONE," and "LZ77," = 5 bytes, total 23
+   * "NONE,", "LZ77," and "LZ4B," = 5 bytes, total 23
    */
 
   if ((sptr[0] == 'N') &&
@@ -583,6 +1305,14 @@ rtems_rtl_rap_parse_header (uint8_t*  rhdr,
     *compression = RTEMS_RTL_COMP_LZ77;
     eptr = sptr + 4;
   }
+  else if ((sptr[0] == 'L') &&
+           (sptr[1] == 'Z') &&
+           (sptr[2] == '4') &&
+           (sptr[3] == 'B'))
+  {
+    *compression = RTEMS_RTL_COMP_LZ4;
+    eptr = sptr + 4;
+  }
   else
     return false;
 
@@ -607,6 +1337,88 @@ rtems_rtl_rap_parse_header (uint8_t*  rhdr,
   return true;
 }
 
+bool
+rtems_rtl_rap_dictionary (const char* path)
+{
+  rtems_rtl_data_t* rtl;
+  uint8_t*          dict = NULL;
+  off_t             size = 0;
+
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+  {
+    rtems_rtl_set_error (EINVAL, "dictionary cannot lock rtl");
+    return false;
+  }
+
+  if (path)
+  {
+    uint8_t* in;
+    off_t    len;
+    int      fd;
+
+    fd = open (path, O_RDONLY);
+    if (fd < 0)
+    {
+      rtems_rtl_set_error (errno, "dictionary open failed: %s", path);
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    size = lseek (fd, 0, SEEK_END);
+    if ((size <= 0) || (size > RTEMS_RTL_LZ4_DICT_MAX) ||
+        (lseek (fd, 0, SEEK_SET) < 0))
+    {
+      close (fd);
+      rtems_rtl_set_error (EINVAL, "invalid dictionary size: %s", path);
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    dict = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, size, false);
+    if (!dict)
+    {
+      close (fd);
+      rtems_rtl_set_error (ENOMEM, "no memory for dictionary");
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    in = dict;
+    len = size;
+
+    while (len)
+    {
+      ssize_t r = read (fd, in, len);
+      if (r <= 0)
+      {
+        close (fd);
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, dict);
+        rtems_rtl_set_error (errno, "dictionary read failed: %s", path);
+        rtems_rtl_unlock ();
+        return false;
+      }
+      in += r;
+      len -= r;
+    }
+
+    close (fd);
+  }
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, rtl->dict);
+  rtl->dict = dict;
+  rtl->dict_size = size;
+  rtl->dict_crc = dict ? rtems_rtl_crc32 (0, dict, size) : 0;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: rap: dictionary: size=%lu crc=%08lx\n",
+            (unsigned long) rtl->dict_size, (unsigned long) rtl->dict_crc);
+
+  rtems_rtl_unlock ();
+
+  return true;
+}
+
 bool
 rtems_rtl_rap_file_check (rtems_rtl_obj_t* obj, int fd)
 {
@@ -635,35 +1447,170 @@ rtems_rtl_rap_file_check (rtems_rtl_obj_t* obj, int fd)
   return true;
 }
 
-bool
-rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
+/*
+ * Read the version 2 flags and block index that follow the header. The offset
+ * is moved to the first block.
+ */
+static bool
+rtems_rtl_rap_read_index (rtems_rtl_rap_t* rap,
+                          rtems_rtl_obj_t* obj,
+                          int              fd,
+                          off_t*           offset)
+{
+  uint8_t  entry[RTEMS_RTL_RAP_BLOCK_ENTRY];
+  uint32_t section = RTEMS_RTL_RAP_NO_SEC;
+  uint32_t soffset = 0;
+  uint32_t next = 0;
+  uint32_t b;
+
+  if (!rtems_rtl_obj_cache_read_byval (rap->file, fd, *offset,
+                                       entry, 2 * sizeof (uint32_t)))
+    return false;
+
+  rap->flags = rtems_rtl_rap_get_uint32 (entry);
+  rap->blocks = rtems_rtl_rap_get_uint32 (entry + sizeof (uint32_t));
+
+  *offset += 2 * sizeof (uint32_t);
+
+  if ((rap->flags & RTEMS_RTL_RAP_FLAG_DICTIONARY) != 0)
+  {
+    rtems_rtl_data_t* rtl = rtems_rtl_data ();
+    uint32_t          crc;
+
+    if (!rtems_rtl_obj_cache_read_byval (rap->file, fd, *offset,
+                                         entry, sizeof (uint32_t)))
+      return false;
+
+    crc = rtems_rtl_rap_get_uint32 (entry);
+
+    *offset += sizeof (uint32_t);
+
+    if (rap->compression != RTEMS_RTL_COMP_LZ4)
+    {
+      rtems_rtl_set_error (EINVAL, "RAP dictionary needs LZ4 compression");
+      return false;
+    }
+
+    if (!rtl->dict || (rtl->dict_crc != crc))
+    {
+      rtems_rtl_set_error (ENOENT, "RAP dictionary not loaded: %08lx", crc);
+      return false;
+    }
+
+    rap->dict = rtl->dict;
+    rap->dict_size = rtl->dict_size;
+  }
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: rap: flags=%08lx blocks=%lu\n", rap->flags, rap->blocks);
+
+  if ((rap->flags & ~RTEMS_RTL_RAP_FLAGS) != 0)
+  {
+    rtems_rtl_set_error (EINVAL, "unsupported RAP flags: %08lx", rap->flags);
+    return false;
+  }
+
+  if (((obj->flags & RTEMS_RTL_OBJ_STREAM) == 0) &&
+      (((off_t) rap->blocks * RTEMS_RTL_RAP_BLOCK_ENTRY) > obj->fsize))
+  {
+    rtems_rtl_set_error (EINVAL, "invalid RAP block index");
+    return false;
+  }
+
+  rap->block_index = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                          rap->blocks * sizeof (rtems_rtl_rap_block_t),
+                                          false);
+  if (!rap->block_index)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for RAP block index");
+    return false;
+  }
+
+  for (b = 0; b < rap->blocks; ++b)
+  {
+    rtems_rtl_rap_block_t* block = &rap->block_index[b];
+
+    if (!rtems_rtl_obj_cache_read_byval (rap->file, fd, *offset,
+                                         entry, RTEMS_RTL_RAP_BLOCK_ENTRY))
+      return false;
+
+    *offset += RTEMS_RTL_RAP_BLOCK_ENTRY;
+
+    block->offset = rtems_rtl_rap_get_uint32 (entry);
+    block->csize = rtems_rtl_rap_get_uint32 (entry + (1 * sizeof (uint32_t)));
+    block->size = rtems_rtl_rap_get_uint32 (entry + (2 * sizeof (uint32_t)));
+    block->section = rtems_rtl_rap_get_uint32 (entry + (3 * sizeof (uint32_t)));
+
+    /*
+     * The blocks are contiguous in the file.
+     */
+    if ((block->offset != next) ||
+        ((block->section != RTEMS_RTL_RAP_NO_SEC) &&
+         (block->section >= RTEMS_RTL_RAP_SECS)))
+    {
+      rtems_rtl_set_error (EINVAL, "invalid RAP block index entry: %lu", b);
+      return false;
+    }
+
+    if (block->section != section)
+    {
+      section = block->section;
+      soffset = 0;
+    }
+
+    block->soffset = soffset;
+    soffset += block->size;
+
+    next = block->offset + RTEMS_RTL_RAP_BLOCK_PREFIX + block->csize;
+  }
+
+  rap->blocks_base = *offset;
+
+  return true;
+}
+
+static bool
+rtems_rtl_rap_load (rtems_rtl_rap_t* rap, rtems_rtl_obj_t* obj, int fd)
 {
-  rtems_rtl_rap_t rap = { 0 };
   uint8_t*        rhdr = NULL;
   size_t          rlen = 64;
+  off_t           offset;
   int             section;
 
-  rtems_rtl_obj_caches (&rap.file, NULL, NULL);
+  rtems_rtl_obj_caches (&rap->file, NULL, NULL);
 
-  if (!rtems_rtl_obj_cache_read (rap.file, fd, obj->ooffset,
+  if (!rtems_rtl_obj_cache_read (rap->file, fd, obj->ooffset,
                                  (void**) &rhdr, &rlen))
     return false;
 
   if (!rtems_rtl_rap_parse_header (rhdr,
                                    &rlen,
-                                   &rap.length,
-                                   &rap.version,
-                                   &rap.compression,
-                                   &rap.checksum))
+                                   &rap->length,
+                                   &rap->version,
+                                   &rap->compression,
+                                   &rap->checksum))
   {
     rtems_rtl_set_error (EINVAL, "invalid RAP file format");
     return false;
   }
 
+  if (rap->version > RTEMS_RTL_RAP_VERSION_2)
+  {
+    rtems_rtl_set_error (EINVAL, "unsupported RAP version: %lu", rap->version);
+    return false;
+  }
+
+  offset = obj->ooffset + rlen;
+
+  if ((rap->version >= RTEMS_RTL_RAP_VERSION_2) &&
+      !rtems_rtl_rap_read_index (rap, obj, fd, &offset))
+    return false;
+
   /*
    * Set up the decompressor.
    */
-  rtems_rtl_obj_comp (&rap.decomp, rap.file, fd, rap.compression, rlen);
+  rtems_rtl_obj_comp (&rap->decomp, rap->file, fd, rap->compression, offset);
+  rtems_rtl_obj_comp_dictionary (rap->decomp, rap->dict, rap->dict_size);
 
   /*
    * uint32_t: machinetype
@@ -673,39 +1620,39 @@ rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
     printf ("rtl: rap: input machine=%lu\n",
-            rtems_rtl_obj_comp_input (rap.decomp));
+            rtems_rtl_obj_comp_input (rap->decomp));
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.machinetype))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->machinetype))
     return false;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
-    printf ("rtl: rap: machinetype=%lu\n", rap.machinetype);
+    printf ("rtl: rap: machinetype=%lu\n", rap->machinetype);
 
-  if (!rtems_rtl_rap_machine_check (rap.machinetype))
+  if (!rtems_rtl_rap_machine_check (rap->machinetype))
   {
     rtems_rtl_set_error (EINVAL, "invalid machinetype");
     return false;
   }
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.datatype))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->datatype))
     return false;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
-    printf ("rtl: rap: datatype=%lu\n", rap.datatype);
+    printf ("rtl: rap: datatype=%lu\n", rap->datatype);
 
-  if (!rtems_rtl_rap_datatype_check (rap.datatype))
+  if (!rtems_rtl_rap_datatype_check (rap->datatype))
   {
     rtems_rtl_set_error (EINVAL, "invalid datatype");
     return false;
   }
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.class))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->class))
     return false;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
-    printf ("rtl: rap: class=%lu\n", rap.class);
+    printf ("rtl: rap: class=%lu\n", rap->class);
 
-  if (!rtems_rtl_rap_class_check (rap.class))
+  if (!rtems_rtl_rap_class_check (rap->class))
   {
     rtems_rtl_set_error (EINVAL, "invalid class");
     return false;
@@ -721,29 +1668,29 @@ rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
     printf ("rtl: rap: input header=%lu\n",
-            rtems_rtl_obj_comp_input (rap.decomp));
+            rtems_rtl_obj_comp_input (rap->decomp));
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.init))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->init))
     return false;
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.fini))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->fini))
     return false;
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.symtab_size))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->symtab_size))
     return false;
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.strtab_size))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->strtab_size))
     return false;
 
-  if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.relocs_size))
+  if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->relocs_size))
     return false;
 
-  rap.symbols = rap.symtab_size / (3 * sizeof (uint32_t));
+  rap->symbols = rap->symtab_size / rtems_rtl_rap_symbol_size (rap);
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
     printf ("rtl: rap: load: symtab=%lu (%lu) strtab=%lu relocs=%lu\n",
-            rap.symtab_size, rap.symbols,
-            rap.strtab_size, rap.relocs_size);
+            rap->symtab_size, rap->symbols,
+            rap->strtab_size, rap->relocs_size);
 
   /*
    * uint32_t: text_size
@@ -762,24 +1709,24 @@ rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
 
   for (section = 0; section < RTEMS_RTL_RAP_SECS; ++section)
   {
-    if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.secs[section].size))
+    if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->secs[section].size))
       return false;
 
-    if (!rtems_rtl_rap_read_uint32 (rap.decomp, &rap.secs[section].alignment))
+    if (!rtems_rtl_rap_read_uint32 (rap->decomp, &rap->secs[section].alignment))
       return false;
 
     if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD_SECT))
       printf ("rtl: rap: %s: size=%lu align=%lu\n",
               rap_sections[section].name,
-              rap.secs[section].size,
-              rap.secs[section].alignment);
+              rap->secs[section].size,
+              rap->secs[section].alignment);
 
     if (!rtems_rtl_obj_add_section (obj,
                                     section,
                                     rap_sections[section].name,
-                                    rap.secs[section].size,
+                                    rap->secs[section].size,
                                     0,
-                                    rap.secs[section].alignment,
+                                    rap->secs[section].alignment,
                                     0, 0,
                                     rap_sections[section].flags))
       return false;
@@ -787,26 +1734,70 @@ rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
 
   /** obj->entry = (void*)(uintptr_t) ehdr.e_entry; */
 
-  if (!rtems_rtl_obj_load_sections (obj, fd, rtems_rtl_rap_loader, &rap))
+  if (!rtems_rtl_obj_load_sections (obj, fd, rtems_rtl_rap_loader, rap))
     return false;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
     printf ("rtl: rap: input symbols=%lu\n",
-            rtems_rtl_obj_comp_input (rap.decomp));
+            rtems_rtl_obj_comp_input (rap->decomp));
 
-  if (!rtems_rtl_rap_load_symbols (&rap, obj))
+  if (!rtems_rtl_rap_load_symbols (rap, obj))
     return false;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
     printf ("rtl: rap: input relocs=%lu\n",
-            rtems_rtl_obj_comp_input (rap.decomp));
+            rtems_rtl_obj_comp_input (rap->decomp));
+
+  if (!rtems_rtl_rap_relocate_buffers (rap))
+    return false;
+
+  if ((rap->flags & RTEMS_RTL_RAP_FLAG_COMPACT_RELOCS) != 0)
+  {
+    if (!rtems_rtl_rap_relocate_compact (rap, obj))
+      return false;
+  }
+  else
+  {
+    if (!rtems_rtl_rap_relocate (rap, obj))
+      return false;
+  }
 
-  if (!rtems_rtl_rap_relocate (&rap, obj))
+  /*
+   * The checksum is the CRC32 of the decompressed stream. A checksum of 0 is
+   * not checked.
+   */
+  if ((rap->checksum != 0) &&
+      (rap->checksum != rtems_rtl_obj_comp_crc (rap->decomp)))
+  {
+    rtems_rtl_set_error (EIO, "RAP checksum mismatch: %08lx != %08lx",
+                         rtems_rtl_obj_comp_crc (rap->decomp), rap->checksum);
     return false;
+  }
+
+  /*
+   * The symbols are found in the object file's table while relocating and are
+   * only made global once the checksum matches. A file that fails the check
+   * is released without anything it holds being seen.
+   */
+  rtems_rtl_symbol_obj_add (obj);
 
   return true;
 }
 
+bool
+rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd)
+{
+  rtems_rtl_rap_t rap = { 0 };
+  bool            ok;
+
+  ok = rtems_rtl_rap_load (&rap, obj, fd);
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, rap.blocks_buffer);
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, rap.block_index);
+
+  return ok;
+}
+
 rtems_rtl_loader_format_t*
 rtems_rtl_rap_file_sig (void)
 {
@@ -40,6 +40,20 @@ bool rtems_rtl_rap_file_check (rtems_rtl_obj_t* obj, int fd);
  */
 bool rtems_rtl_rap_file_load (rtems_rtl_obj_t* obj, int fd);
 
+/**
+ * Load the dictionary RAP files compressed with a shared dictionary are
+ * decompressed with. The dictionary is held in memory until it is replaced
+ * or unloaded so it can be loaded before a set of modules is loaded and
+ * unloaded once they have loaded. A RAP file records the CRC32 of its
+ * dictionary and does not load if the dictionary is not the one it was
+ * packed with.
+ *
+ * @param path The dictionary file. NULL unloads the dictionary.
+ * @retval true The dictionary has been loaded or unloaded.
+ * @retval false The dictionary could not be loaded. The RTL error is set.
+ */
+bool rtems_rtl_rap_dictionary (const char* path);
+
 /**
  * The RAP format signature handler.
  *
@@ -30,10 +30,12 @@
 //#endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <rtl.h>
 #include <rtl-chain-iterator.h>
+#include <rtl-comp-bench.h>
 #include <rtl-shell.h>
 #include <rtl-trace.h>
 
@@ -302,6 +304,169 @@ rtems_rtl_shell_sym (rtems_rtl_data_t* rtl, int argc, char *argv[])
   return 0;
 }
 
+/**
+ * Print a line of allocator statistics.
+ */
+static void
+rtems_rtl_alloc_stats_print (int                            indent,
+                             const char*                    label,
+                             const rtems_rtl_alloc_stats_t* stats)
+{
+  printf ("%-*c%-10s %10zu %10zu %8" PRIu32 " %6" PRIu32 "\n",
+          indent, ' ', label,
+          stats->current, stats->peak, stats->allocs, stats->failed);
+}
+
+/**
+ * Object memory print iterator.
+ */
+static bool
+rtems_rtl_obj_mem_iterator (rtems_chain_node* node, void* data)
+{
+  rtems_rtl_obj_print_t* print = data;
+  rtems_rtl_obj_t*       obj = (rtems_rtl_obj_t*) node;
+  int                    tag;
+
+  if ((!print->base && (obj == print->rtl->base)) || !obj->alloc)
+      return true;
+
+  printf ("%-*c%s\n", print->indent, ' ', rtems_rtl_obj_oname (obj));
+  for (tag = 0; tag < RTEMS_RTL_ALLOC_TAGS; ++tag)
+  {
+    if (obj->alloc[tag].allocs || obj->alloc[tag].failed)
+      rtems_rtl_alloc_stats_print (print->indent + 2,
+                                   rtems_rtl_alloc_tag_label (tag),
+                                   &obj->alloc[tag]);
+  }
+  return true;
+}
+
+static int
+rtems_rtl_shell_mem (rtems_rtl_data_t* rtl, int argc, char *argv[])
+{
+#if RTEMS_RTL_ALLOC_STATS
+  rtems_rtl_obj_print_t   print;
+  rtems_rtl_alloc_stats_t total;
+  int                     tag;
+
+  memset (&total, 0, sizeof (total));
+
+  printf ("Runtime Linker Memory:\n");
+  printf (" %-10s %10s %10s %8s %6s\n",
+          "tag", "current", "peak", "allocs", "failed");
+  for (tag = 0; tag < RTEMS_RTL_ALLOC_TAGS; ++tag)
+  {
+    const rtems_rtl_alloc_stats_t* stats = &rtl->allocator.stats[tag];
+    rtems_rtl_alloc_stats_print (1, rtems_rtl_alloc_tag_label (tag), stats);
+    total.current += stats->current;
+    total.peak    += stats->peak;
+    total.allocs  += stats->allocs;
+    total.failed  += stats->failed;
+  }
+  rtems_rtl_alloc_stats_print (1, "total", &total);
+
+  print.rtl = rtl;
+  print.indent = 1;
+  print.oname = true;
+  print.names = false;
+  print.memory_map = false;
+  print.symbols = false;
+  print.base = rtems_rtl_base_arg (argc, argv);
+
+  printf ("Objects:\n");
+  rtems_rtl_chain_iterate (&rtl->objects,
+                           rtems_rtl_obj_mem_iterator,
+                           &print);
+
+  if (rtems_rtl_parse_arg ("-r", argc, argv))
+    rtems_rtl_alloc_stats_reset ();
+
+  return 0;
+#else
+  printf ("error: allocator accounting is not enabled\n");
+  return 1;
+#endif
+}
+
+static int
+rtems_rtl_shell_comp (rtems_rtl_data_t* rtl, int argc, char *argv[])
+{
+  const char* name = NULL;
+  size_t      block_size = RTEMS_RTL_COMP_BENCH_BLOCK;
+  int         runs = RTEMS_RTL_COMP_BENCH_RUNS;
+  int         arg;
+
+  for (arg = 1; arg < argc; ++arg)
+  {
+    if (argv[arg][0] == '-')
+    {
+      if ((arg + 1) >= argc)
+      {
+        printf ("error: option needs a value: %s\n", argv[arg]);
+        return 1;
+      }
+      switch (argv[arg][1])
+      {
+        case 'b':
+          block_size = strtoul (argv[++arg], NULL, 0);
+          break;
+        case 'r':
+          runs = strtol (argv[++arg], NULL, 0);
+          break;
+        default:
+          printf ("error: unknown option: %s\n", argv[arg]);
+          return 1;
+      }
+    }
+    else
+      name = argv[arg];
+  }
+
+  if (!name)
+  {
+    printf ("error: no file name\n");
+    return 1;
+  }
+
+  return rtems_rtl_comp_bench (name, block_size, runs) ? 0 : 1;
+}
+
+/**
+ * Object text verifier.
+ */
+static bool
+rtems_rtl_obj_verify_iterator (rtems_chain_node* node, void* data)
+{
+  rtems_rtl_obj_t* obj = (rtems_rtl_obj_t*) node;
+  int*             failed = data;
+  const char*      state;
+
+  if (!obj->text_base || (obj->checksum == 0))
+    state = "no checksum";
+  else if (rtems_rtl_obj_verify_text (obj))
+    state = "ok";
+  else
+  {
+    state = "FAILED";
+    ++(*failed);
+  }
+
+  printf (" %-40s %08lx %s\n",
+          rtems_rtl_obj_oname (obj), (unsigned long) obj->checksum, state);
+
+  return true;
+}
+
+static int
+rtems_rtl_shell_verify (rtems_rtl_data_t* rtl, int argc, char *argv[])
+{
+  int failed = 0;
+  rtems_rtl_chain_iterate (&rtl->objects,
+                           rtems_rtl_obj_verify_iterator,
+                           &failed);
+  return failed ? 1 : 0;
+}
+
 static int
 rtems_rtl_shell_object (rtems_rtl_data_t* rtl, int argc, char *argv[])
 {
@@ -331,7 +496,13 @@ rtems_rtl_shell_command (int argc, char* argv[])
     { "sym", rtems_rtl_shell_sym,
       "\tDisplay the symbols, sym [<name>], sym -o <obj> [<name>]" },
     { "obj", rtems_rtl_shell_object,
-      "\tDisplay the object details, obj <name>" }
+      "\tDisplay the object details, obj <name>" },
+    { "mem", rtems_rtl_shell_mem,
+      "\tDisplay the memory usage by tag and object, mem [-b] [-r]" },
+    { "comp", rtems_rtl_shell_comp,
+      "\tBenchmark the decompressors, comp [-b block] [-r runs] <file>" },
+    { "verify", rtems_rtl_shell_verify,
+      "Verify the text of the object files against their checksums" }
   };
 
   int arg;
@@ -0,0 +1,767 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Linked State Snapshot.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <rtl.h>
+#include <rtl-chain-iterator.h>
+#include "rtl-error.h"
+#include "rtl-snapshot.h"
+#include "rtl-string.h"
+#include "rtl-trace.h"
+
+/**
+ * The snapshot file signature, "RTLS".
+ */
+#define RTEMS_RTL_SNAPSHOT_MAGIC     (0x524c5453UL)
+
+/**
+ * The snapshot object file record signature, "RTLO".
+ */
+#define RTEMS_RTL_SNAPSHOT_OBJ_MAGIC (0x524c544fUL)
+
+/**
+ * The version of the snapshot file format.
+ */
+#define RTEMS_RTL_SNAPSHOT_VERSION   (1)
+
+/**
+ * The maximum length of a name in a snapshot.
+ */
+#define RTEMS_RTL_SNAPSHOT_NAME_MAX  (256)
+
+/**
+ * The snapshot file header. The snapshot is only restored on the target that
+ * recorded it so the records are in the target's byte order.
+ */
+typedef struct rtems_rtl_snapshot_header_s
+{
+  uint32_t magic;     /**< The file signature. */
+  uint32_t version;   /**< The file format version. */
+  uint32_t globals;   /**< The global symbol table's signature when the
+                       *   recording started. */
+} rtems_rtl_snapshot_header_t;
+
+/**
+ * The object file record. The names, sections, section images, global symbols
+ * and unresolved relocations follow.
+ */
+typedef struct rtems_rtl_snapshot_obj_s
+{
+  uint32_t  magic;        /**< The record signature. */
+  uint32_t  flags;        /**< The object file's flags. */
+  uint32_t  ooffset;      /**< The object's offset in its archive. */
+  uint32_t  fsize;        /**< The object's size. */
+  uint32_t  unresolved;   /**< The object's unresolved relocations count. */
+  uint32_t  relocs;       /**< The unresolved relocation records held. */
+  uint32_t  sections;     /**< The number of sections. */
+  uint32_t  global_syms;  /**< The number of global symbols. */
+  uint32_t  global_size;  /**< The size of the global symbol table. */
+  uint32_t  tramp_size;   /**< The size of the trampoline area. */
+  uint32_t  tramp_used;   /**< The size of the trampolines used. */
+  uint32_t  text_size;    /**< The text image size. */
+  uint32_t  const_size;   /**< The const image size. */
+  uint32_t  data_size;    /**< The data image size. */
+  uintptr_t entry;        /**< The entry point. */
+  uintptr_t text_base;    /**< The text load address. */
+  uintptr_t const_base;   /**< The const load address. */
+  uintptr_t data_base;    /**< The data load address. */
+  uintptr_t bss_base;     /**< The bss load address. */
+  uint16_t  fname_len;    /**< The length of the file name. */
+  uint16_t  oname_len;    /**< The length of the object name. */
+  uint16_t  aname_len;    /**< The length of the archive name. */
+  uint16_t  pad;          /**< Reserved. */
+} rtems_rtl_snapshot_obj_t;
+
+/**
+ * A section record. The section's name follows.
+ */
+typedef struct rtems_rtl_snapshot_sect_s
+{
+  int32_t   section;      /**< The section's index. */
+  uint32_t  size;         /**< The size of the section. */
+  uint32_t  offset;       /**< The offset in the object file. */
+  uint32_t  alignment;    /**< The alignment of the section. */
+  int32_t   link;         /**< The section's link. */
+  int32_t   info;         /**< The section's info. */
+  uint32_t  flags;        /**< The section's flags. */
+  uintptr_t base;         /**< The section's load address. */
+  uint32_t  name_len;     /**< The length of the name. */
+} rtems_rtl_snapshot_sect_t;
+
+/**
+ * A global symbol record. The name is the offset of the symbol's name in the
+ * object file's global symbol table. The string space of the table follows
+ * the symbol records.
+ */
+typedef struct rtems_rtl_snapshot_sym_s
+{
+  uint32_t  name;         /**< The name's offset in the symbol table. */
+  uintptr_t value;        /**< The symbol's value. */
+  uint32_t  data;         /**< Format specific data. */
+} rtems_rtl_snapshot_sym_t;
+
+/**
+ * An unresolved relocation record. The symbol's name follows.
+ */
+typedef struct rtems_rtl_snapshot_reloc_s
+{
+  uint16_t         flags;     /**< Format specific flags. */
+  uint16_t         sect;      /**< The target section. */
+  uint32_t         name_len;  /**< The length of the symbol's name. */
+  rtems_rtl_word_t rel[3];    /**< The relocation record. */
+} rtems_rtl_snapshot_reloc_t;
+
+/**
+ * The data passed to the unresolved relocation writer.
+ */
+typedef struct rtems_rtl_snapshot_relocs_s
+{
+  rtems_rtl_obj_t* obj;     /**< The object file being written. */
+  int              fd;      /**< The snapshot file. */
+  uint32_t         count;   /**< The number of records. */
+  bool             write;   /**< Write the records, else count them. */
+  bool             ok;      /**< The records have been written. */
+} rtems_rtl_snapshot_relocs_t;
+
+static bool
+rtems_rtl_snapshot_read (int fd, void* buffer, size_t size)
+{
+  uint8_t* data = buffer;
+  while (size)
+  {
+    ssize_t r = read (fd, data, size);
+    if (r <= 0)
+      return false;
+    data += r;
+    size -= r;
+  }
+  return true;
+}
+
+static bool
+rtems_rtl_snapshot_write (int fd, const void* buffer, size_t size)
+{
+  const uint8_t* data = buffer;
+  while (size)
+  {
+    ssize_t w = write (fd, data, size);
+    if (w <= 0)
+      return false;
+    data += w;
+    size -= w;
+  }
+  return true;
+}
+
+static bool
+rtems_rtl_snapshot_write_name (int fd, const char* name, uint16_t length)
+{
+  return (length == 0) || rtems_rtl_snapshot_write (fd, name, length + 1);
+}
+
+/*
+ * Read a name into a buffer allocated from the RTL allocator. A zero length
+ * is a name that is not set.
+ */
+static bool
+rtems_rtl_snapshot_read_name (int fd, const char** name, uint32_t length)
+{
+  char* buffer;
+  *name = NULL;
+  if (length == 0)
+    return true;
+  if (length >= RTEMS_RTL_SNAPSHOT_NAME_MAX)
+    return false;
+  buffer = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT, length + 1, false);
+  if (!buffer)
+    return false;
+  if (!rtems_rtl_snapshot_read (fd, buffer, length + 1))
+  {
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, buffer);
+    return false;
+  }
+  buffer[length] = '\0';
+  *name = buffer;
+  return true;
+}
+
+static uint16_t
+rtems_rtl_snapshot_name_len (const char* name, bool valid)
+{
+  return valid ? strlen (name) : 0;
+}
+
+static bool
+rtems_rtl_snapshot_relocs_iterator (rtems_rtl_unresolv_rec_t* rec,
+                                    void*                     data)
+{
+  rtems_rtl_snapshot_relocs_t* rd = (rtems_rtl_snapshot_relocs_t*) data;
+
+  if ((rec->type == rtems_rtl_unresolved_reloc) &&
+      (rec->rec.reloc.obj == rd->obj))
+  {
+    if (rd->write)
+    {
+      rtems_rtl_snapshot_reloc_t reloc;
+      const char*                name;
+
+      name = rtems_rtl_unresolved_reloc_name (&rec->rec.reloc);
+      if (!name)
+      {
+        rd->ok = false;
+        return true;
+      }
+
+      reloc.flags = rec->rec.reloc.flags;
+      reloc.sect = rec->rec.reloc.sect;
+      reloc.name_len = strlen (name);
+      memcpy (reloc.rel, rec->rec.reloc.rel, sizeof (reloc.rel));
+
+      if (!rtems_rtl_snapshot_write (rd->fd, &reloc, sizeof (reloc)) ||
+          !rtems_rtl_snapshot_write (rd->fd, name, reloc.name_len + 1))
+      {
+        rd->ok = false;
+        return true;
+      }
+    }
+    ++rd->count;
+  }
+
+  return false;
+}
+
+static bool
+rtems_rtl_snapshot_write_obj (int fd, rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_snapshot_obj_t    header;
+  rtems_rtl_snapshot_relocs_t rd;
+  rtems_chain_node*           node;
+  const uint8_t*              strings;
+  size_t                      s;
+
+  memset (&rd, 0, sizeof (rd));
+  rd.obj = obj;
+  rd.fd = fd;
+  rd.ok = true;
+  rtems_rtl_unresolved_interate (rtems_rtl_snapshot_relocs_iterator, &rd);
+
+  memset (&header, 0, sizeof (header));
+  header.magic = RTEMS_RTL_SNAPSHOT_OBJ_MAGIC;
+  header.flags = obj->flags & RTEMS_RTL_OBJ_UNRESOLVED;
+  header.ooffset = obj->ooffset;
+  header.fsize = obj->fsize;
+  header.unresolved = obj->unresolved;
+  header.relocs = rd.count;
+  header.sections = rtems_rtl_chain_count (&obj->sections);
+  header.global_syms = obj->global_syms;
+  header.global_size = obj->global_size;
+  header.tramp_size = obj->tramp_size;
+  if (obj->tramp_base)
+    header.tramp_used = (uint8_t*) obj->tramp_brk - (uint8_t*) obj->tramp_base;
+  header.text_size = obj->text_size;
+  header.const_size = rtems_rtl_obj_const_size (obj);
+  header.data_size = rtems_rtl_obj_data_size (obj);
+  header.entry = (uintptr_t) obj->entry;
+  header.text_base = (uintptr_t) obj->text_base;
+  header.const_base = (uintptr_t) obj->const_base;
+  header.data_base = (uintptr_t) obj->data_base;
+  header.bss_base = (uintptr_t) obj->bss_base;
+  header.fname_len =
+    rtems_rtl_snapshot_name_len (obj->fname, rtems_rtl_obj_fname_valid (obj));
+  header.oname_len =
+    rtems_rtl_snapshot_name_len (obj->oname, rtems_rtl_obj_oname_valid (obj));
+  header.aname_len =
+    rtems_rtl_snapshot_name_len (obj->aname, rtems_rtl_obj_aname_valid (obj));
+
+  if (!rtems_rtl_snapshot_write (fd, &header, sizeof (header)) ||
+      !rtems_rtl_snapshot_write_name (fd, obj->fname, header.fname_len) ||
+      !rtems_rtl_snapshot_write_name (fd, obj->oname, header.oname_len) ||
+      !rtems_rtl_snapshot_write_name (fd, obj->aname, header.aname_len))
+    return false;
+
+  node = rtems_chain_first (&obj->sections);
+  while (!rtems_chain_is_tail (&obj->sections, node))
+  {
+    rtems_rtl_obj_sect_t*     sect = (rtems_rtl_obj_sect_t*) node;
+    rtems_rtl_snapshot_sect_t record;
+
+    memset (&record, 0, sizeof (record));
+    record.section = sect->section;
+    record.size = sect->size;
+    record.offset = sect->offset;
+    record.alignment = sect->alignment;
+    record.link = sect->link;
+    record.info = sect->info;
+    record.flags = sect->flags;
+    record.base = (uintptr_t) sect->base;
+    record.name_len = strlen (sect->name);
+
+    if (!rtems_rtl_snapshot_write (fd, &record, sizeof (record)) ||
+        !rtems_rtl_snapshot_write (fd, sect->name, record.name_len + 1))
+      return false;
+
+    node = rtems_chain_next (node);
+  }
+
+  if (!rtems_rtl_snapshot_write (fd, obj->text_base, header.text_size) ||
+      !rtems_rtl_snapshot_write (fd, obj->const_base, header.const_size) ||
+      !rtems_rtl_snapshot_write (fd, obj->data_base, header.data_size))
+    return false;
+
+  for (s = 0; s < obj->global_syms; ++s)
+  {
+    const rtems_rtl_obj_sym_t* sym = &obj->global_table[s];
+    rtems_rtl_snapshot_sym_t   record;
+    memset (&record, 0, sizeof (record));
+    record.name = (const uint8_t*) sym->name - (const uint8_t*) obj->global_table;
+    record.value = (uintptr_t) sym->value;
+    record.data = sym->data;
+    if (!rtems_rtl_snapshot_write (fd, &record, sizeof (record)))
+      return false;
+  }
+
+  if (obj->global_syms)
+  {
+    strings = (const uint8_t*) &obj->global_table[obj->global_syms];
+    if (!rtems_rtl_snapshot_write (fd, strings,
+                                   obj->global_size -
+                                   (obj->global_syms * sizeof (rtems_rtl_obj_sym_t))))
+      return false;
+  }
+
+  rd.count = 0;
+  rd.write = true;
+  rtems_rtl_unresolved_interate (rtems_rtl_snapshot_relocs_iterator, &rd);
+
+  return rd.ok;
+}
+
+bool
+rtems_rtl_snapshot_record (const char* path)
+{
+  rtems_rtl_data_t*           rtl;
+  rtems_rtl_snapshot_header_t header;
+  char*                       snapshot = NULL;
+
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+  {
+    rtems_rtl_set_error (EINVAL, "snapshot cannot lock rtl");
+    return false;
+  }
+
+  if (path)
+  {
+    int fd;
+
+    snapshot = rtems_rtl_strdup (path);
+    if (!snapshot)
+    {
+      rtems_rtl_set_error (ENOMEM, "no memory for snapshot path");
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+      rtems_rtl_set_error (errno, "snapshot create failed");
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, snapshot);
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    header.magic = RTEMS_RTL_SNAPSHOT_MAGIC;
+    header.version = RTEMS_RTL_SNAPSHOT_VERSION;
+    header.globals = rtems_rtl_symbol_global_signature ();
+
+    if (!rtems_rtl_snapshot_write (fd, &header, sizeof (header)))
+    {
+      rtems_rtl_set_error (EIO, "snapshot header write failed");
+      close (fd);
+      unlink (path);
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, snapshot);
+      rtems_rtl_unlock ();
+      return false;
+    }
+
+    close (fd);
+  }
+
+  if (rtl->snapshot && rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: snapshot: stop: %s\n", rtl->snapshot);
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) rtl->snapshot);
+  rtl->snapshot = snapshot;
+
+  if (snapshot && rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: snapshot: record: %s\n", snapshot);
+
+  rtems_rtl_unlock ();
+
+  return true;
+}
+
+void
+rtems_rtl_snapshot_obj (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_data_t* rtl = rtems_rtl_data ();
+  int               fd;
+  bool              ok;
+
+  if (!rtl->snapshot)
+    return;
+
+  fd = open (rtl->snapshot, O_WRONLY | O_APPEND);
+  ok = (fd >= 0) && rtems_rtl_snapshot_write_obj (fd, obj);
+  if (fd >= 0)
+    close (fd);
+
+  if (!ok)
+  {
+    /*
+     * The snapshot cannot be restored past this object file so the recording
+     * stops.
+     */
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: snapshot: write failed: %s\n", rtems_rtl_obj_oname (obj));
+    rtems_rtl_snapshot_record (NULL);
+    return;
+  }
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: snapshot: recorded: %s\n", rtems_rtl_obj_oname (obj));
+}
+
+/*
+ * Restore the next object file in the snapshot. A false return stops the
+ * restore. The file is positioned at the object file's record.
+ */
+static bool
+rtems_rtl_snapshot_restore_obj (rtems_rtl_data_t* rtl, int fd)
+{
+  rtems_rtl_snapshot_obj_t header;
+  rtems_rtl_obj_t*         obj;
+  rtems_rtl_alloc_stats_t* owner;
+  uint32_t                 s;
+
+  if (!rtems_rtl_snapshot_read (fd, &header, sizeof (header)))
+    return false;
+
+  if (header.magic != RTEMS_RTL_SNAPSHOT_OBJ_MAGIC)
+  {
+    rtems_rtl_set_error (EINVAL, "invalid snapshot object record");
+    return false;
+  }
+
+  obj = rtems_rtl_obj_alloc ();
+  if (!obj)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for object descriptor");
+    return false;
+  }
+
+  owner = rtems_rtl_alloc_owner (obj->alloc);
+
+  if (!rtems_rtl_snapshot_read_name (fd, &obj->fname, header.fname_len) ||
+      !rtems_rtl_snapshot_read_name (fd, &obj->oname, header.oname_len) ||
+      !rtems_rtl_snapshot_read_name (fd, &obj->aname, header.aname_len))
+  {
+    rtems_rtl_set_error (EIO, "snapshot object name read failed");
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  /*
+   * An object file can only be loaded once.
+   */
+  if (!rtems_rtl_obj_oname_valid (obj) ||
+      rtems_rtl_obj_registry_match (&rtl->registry, obj))
+  {
+    rtems_rtl_set_error (EEXIST, "snapshot object already loaded");
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  obj->ooffset = header.ooffset;
+  obj->fsize = header.fsize;
+  obj->entry = (void*) header.entry;
+  obj->tramp_size = header.tramp_size;
+
+  for (s = 0; s < header.sections; ++s)
+  {
+    rtems_rtl_snapshot_sect_t record;
+    rtems_rtl_obj_sect_t*     sect;
+    const char*               name;
+    bool                      ok;
+
+    if (!rtems_rtl_snapshot_read (fd, &record, sizeof (record)) ||
+        !rtems_rtl_snapshot_read_name (fd, &name, record.name_len))
+    {
+      rtems_rtl_set_error (EIO, "snapshot section read failed");
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+
+    ok = rtems_rtl_obj_add_section (obj, record.section, name ? name : "",
+                                    record.size, record.offset,
+                                    record.alignment, record.link,
+                                    record.info, record.flags);
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, (void*) name);
+
+    if (!ok)
+    {
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+
+    sect = (rtems_rtl_obj_sect_t*) rtems_chain_last (&obj->sections);
+    sect->base = (void*) record.base;
+  }
+
+  /*
+   * Allocate the section memory. The images can only be used if the memory is
+   * at the same addresses as when recorded.
+   */
+  if (!rtems_rtl_obj_alloc_sections (obj))
+  {
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  if (((uintptr_t) obj->text_base != header.text_base) ||
+      ((uintptr_t) obj->const_base != header.const_base) ||
+      ((uintptr_t) obj->data_base != header.data_base) ||
+      ((uintptr_t) obj->bss_base != header.bss_base) ||
+      (obj->text_size != header.text_size) ||
+      (header.tramp_used > obj->tramp_size))
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: snapshot: address mismatch: %s\n", obj->oname);
+    rtems_rtl_set_error (EFAULT, "snapshot object address mismatch");
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  if (!rtems_rtl_snapshot_read (fd, obj->text_base, header.text_size) ||
+      !rtems_rtl_snapshot_read (fd, obj->const_base, header.const_size) ||
+      !rtems_rtl_snapshot_read (fd, obj->data_base, header.data_size))
+  {
+    rtems_rtl_set_error (EIO, "snapshot image read failed");
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  memset (obj->bss_base, 0, rtems_rtl_obj_bss_size (obj));
+
+  if (obj->tramp_base)
+    obj->tramp_brk = ((uint8_t*) obj->tramp_base) + header.tramp_used;
+
+  if (header.global_syms)
+  {
+    rtems_rtl_snapshot_sym_t record;
+    size_t                   table_size;
+
+    table_size = header.global_syms * sizeof (rtems_rtl_obj_sym_t);
+    if (header.global_size < table_size)
+    {
+      rtems_rtl_set_error (EINVAL, "invalid snapshot symbol table");
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+
+    obj->global_table = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_SYMBOL,
+                                             header.global_size, true);
+    if (!obj->global_table)
+    {
+      rtems_rtl_set_error (ENOMEM, "no memory for obj global syms");
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+
+    obj->global_syms = header.global_syms;
+    obj->global_size = header.global_size;
+
+    for (s = 0; s < header.global_syms; ++s)
+    {
+      rtems_rtl_obj_sym_t* sym = &obj->global_table[s];
+      if (!rtems_rtl_snapshot_read (fd, &record, sizeof (record)) ||
+          (record.name < table_size) || (record.name >= header.global_size))
+      {
+        rtems_rtl_set_error (EIO, "snapshot symbol read failed");
+        rtems_rtl_alloc_owner (owner);
+        rtems_rtl_obj_free (obj);
+        return false;
+      }
+      rtems_chain_set_off_chain (&sym->node);
+      sym->name = ((const char*) obj->global_table) + record.name;
+      sym->value = (void*) record.value;
+      sym->data = record.data;
+    }
+
+    if (!rtems_rtl_snapshot_read (fd,
+                                  ((uint8_t*) obj->global_table) + table_size,
+                                  header.global_size - table_size))
+    {
+      rtems_rtl_set_error (EIO, "snapshot symbol read failed");
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+  }
+
+  if (!rtems_rtl_obj_registry_add (&rtl->registry, obj))
+  {
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return false;
+  }
+
+  rtems_chain_append (&rtl->objects, &obj->link);
+
+  rtems_rtl_symbol_obj_add (obj);
+
+  for (s = 0; s < header.relocs; ++s)
+  {
+    rtems_rtl_snapshot_reloc_t record;
+    char                       name[RTEMS_RTL_SNAPSHOT_NAME_MAX];
+
+    if (!rtems_rtl_snapshot_read (fd, &record, sizeof (record)) ||
+        (record.name_len >= sizeof (name)) ||
+        !rtems_rtl_snapshot_read (fd, name, record.name_len + 1))
+    {
+      rtems_rtl_set_error (EIO, "snapshot unresolved read failed");
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_unresolved_erase_obj (obj);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+
+    name[record.name_len] = '\0';
+
+    if (!rtems_rtl_unresolved_add (obj, record.flags, name,
+                                   record.sect, record.rel))
+    {
+      rtems_rtl_alloc_owner (owner);
+      rtems_rtl_unresolved_erase_obj (obj);
+      rtems_rtl_obj_free (obj);
+      return false;
+    }
+  }
+
+  obj->unresolved = header.unresolved;
+  obj->flags |= header.flags;
+
+  rtems_rtl_obj_synchronize_cache (obj);
+
+  rtems_rtl_alloc_owner (owner);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: snapshot: restored: %s\n", obj->oname);
+
+  /*
+   * Perform the fix ups the load of this object file performed when it was
+   * recorded.
+   */
+  rtems_rtl_unresolved_resolve ();
+
+  return true;
+}
+
+int
+rtems_rtl_snapshot_restore (const char* path)
+{
+  rtems_rtl_data_t*           rtl;
+  rtems_rtl_snapshot_header_t header;
+  struct stat                 sb;
+  int                         restored = 0;
+  int                         fd;
+
+  rtl = rtems_rtl_lock ();
+  if (!rtl)
+  {
+    rtems_rtl_set_error (EINVAL, "snapshot cannot lock rtl");
+    return -1;
+  }
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+  {
+    rtems_rtl_set_error (errno, "snapshot open failed");
+    rtems_rtl_unlock ();
+    return -1;
+  }
+
+  if (!rtems_rtl_snapshot_read (fd, &header, sizeof (header)) ||
+      (header.magic != RTEMS_RTL_SNAPSHOT_MAGIC) ||
+      (header.version != RTEMS_RTL_SNAPSHOT_VERSION))
+  {
+    rtems_rtl_set_error (EINVAL, "invalid snapshot header");
+    close (fd);
+    rtems_rtl_unlock ();
+    return -1;
+  }
+
+  if (header.globals != rtems_rtl_symbol_global_signature ())
+  {
+    rtems_rtl_set_error (EINVAL, "snapshot does not match the global symbols");
+    close (fd);
+    rtems_rtl_unlock ();
+    return -1;
+  }
+
+  if (fstat (fd, &sb) < 0)
+  {
+    rtems_rtl_set_error (errno, "snapshot stat failed");
+    close (fd);
+    rtems_rtl_unlock ();
+    return -1;
+  }
+
+  while (lseek (fd, 0, SEEK_CUR) < sb.st_size)
+  {
+    if (!rtems_rtl_snapshot_restore_obj (rtl, fd))
+      break;
+    ++restored;
+  }
+
+  close (fd);
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: snapshot: %d object files restored from %s\n", restored, path);
+
+  rtems_rtl_unlock ();
+
+  return restored;
+}
@@ -0,0 +1,78 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Linked State Snapshot.
+ *
+ * A snapshot holds the linked state of the object files loaded after recording
+ * starts. Each object file is appended to the snapshot once it has been loaded
+ * and relocated and before its constructors are run. The record holds the
+ * object file's names, sections, relocated section images, global symbols and
+ * unresolved relocations.
+ *
+ * Restoring a snapshot at the next boot recreates the object files in the
+ * recorded order without reading or relocating the object files. The section
+ * memory is allocated the same way it was when recorded and a system that
+ * boots the same way allocates the same addresses. The restore stops at the
+ * first object file whose addresses differ and the remaining object files are
+ * loaded from the file system as normal. The relocation records are not held
+ * so an image cannot be moved to a different address.
+ *
+ * A restored object file has no users and its constructors have not been run.
+ * The first load of the object file finds the restored object file and runs
+ * the constructors.
+ */
+
+#if !defined (_RTEMS_RTL_SNAPSHOT_H_)
+#define _RTEMS_RTL_SNAPSHOT_H_
+
+#include <stdbool.h>
+
+#include <rtl-obj-fwd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Start recording a snapshot to the file. Any existing file is replaced. A
+ * NULL path stops the recording. Unloading an object file stops the recording
+ * because the snapshot can no longer be restored.
+ *
+ * @param path The snapshot file path.
+ * @retval true Recording has started or stopped.
+ * @retval false The file could not be created. The RTL error is set.
+ */
+bool rtems_rtl_snapshot_record (const char* path);
+
+/**
+ * Append a loaded object file to the snapshot being recorded. Nothing is done
+ * if no snapshot is being recorded. An error stops the recording.
+ *
+ * @param obj The object file's descriptor.
+ */
+void rtems_rtl_snapshot_obj (rtems_rtl_obj_t* obj);
+
+/**
+ * Restore the object files in a snapshot.
+ *
+ * @param path The snapshot file path.
+ * @return int The number of object files restored. A value of -1 means the
+ *             snapshot cannot be read or does not match the base image and
+ *             the RTL error is set.
+ */
+int rtems_rtl_snapshot_restore (const char* path);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -37,7 +37,7 @@ static rtems_rtl_obj_sym_t global_sym_add =
   .value = (void*) rtems_rtl_base_sym_global_add
 };
 
-static uint_fast32_t
+uint32_t
 rtems_rtl_symbol_hash (const char *s)
 {
   uint_fast32_t h = 5381;
@@ -47,13 +47,39 @@ rtems_rtl_symbol_hash (const char *s)
   return h & 0xffffffff;
 }
 
+/*
+ * The signature of a symbol. Signatures are combined with an exclusive-or so
+ * the table's signature does not depend on the order symbols are added and a
+ * symbol can be removed. The hash and value are mixed with the murmur3
+ * finaliser before the exclusive-or so swapping the values of two symbols
+ * changes the table's signature.
+ */
+static uint32_t
+rtems_rtl_symbol_signature (const rtems_rtl_obj_sym_t* symbol)
+{
+  uint32_t value = (uint32_t) (uintptr_t) symbol->value;
+  uint32_t mix = symbol->hash ^ ((value << 16) | (value >> 16));
+  mix ^= mix >> 16;
+  mix *= 0x85ebca6bUL;
+  mix ^= mix >> 13;
+  mix *= 0xc2b2ae35UL;
+  mix ^= mix >> 16;
+  return mix;
+}
+
+/*
+ * Insert a symbol into the table. The symbol's hash is computed if the
+ * symbol does not have one. A RAP file provides the hashes.
+ */
 static void
 rtems_rtl_symbol_global_insert (rtems_rtl_symbols_t* symbols,
                                 rtems_rtl_obj_sym_t* symbol)
 {
-  uint_fast32_t hash = rtems_rtl_symbol_hash (symbol->name);
-  rtems_chain_append (&symbols->buckets[hash % symbols->nbuckets],
+  if (symbol->hash == 0)
+    symbol->hash = rtems_rtl_symbol_hash (symbol->name);
+  rtems_chain_append (&symbols->buckets[symbol->hash % symbols->nbuckets],
                       &symbol->node);
+  symbols->signature ^= rtems_rtl_symbol_signature (symbol);
 }
 
 bool
@@ -69,6 +95,7 @@ rtems_rtl_symbol_table_open (rtems_rtl_symbols_t* symbols,
     return false;
   }
   symbols->nbuckets = buckets;
+  symbols->signature = 0;
   for (buckets = 0; buckets < symbols->nbuckets; ++buckets)
     rtems_chain_initialize_empty (&symbols->buckets[buckets]);
   rtems_rtl_symbol_global_insert (symbols, &global_sym_add);
@@ -171,17 +198,21 @@ rtems_rtl_symbol_global_add (rtems_rtl_obj_t*     obj,
   return true;
 }
 
+uint32_t
+rtems_rtl_symbol_global_signature (void)
+{
+  return rtems_rtl_global_symbols ()->signature;
+}
+
 rtems_rtl_obj_sym_t*
-rtems_rtl_symbol_global_find (const char* name)
+rtems_rtl_symbol_global_find_hash (const char* name, uint32_t hash)
 {
   rtems_rtl_symbols_t* symbols;
-  uint_fast32_t        hash;
   rtems_chain_control* bucket;
   rtems_chain_node*    node;
 
   symbols = rtems_rtl_global_symbols ();
 
-  hash = rtems_rtl_symbol_hash (name);
   bucket = &symbols->buckets[hash % symbols->nbuckets];
   node = rtems_chain_first (bucket);
 
@@ -189,9 +220,10 @@ rtems_rtl_symbol_global_find (const char* name)
   {
     rtems_rtl_obj_sym_t* sym = (rtems_rtl_obj_sym_t*) node;
     /*
-     * Use the hash. I could add this to the symbol but it uses more memory.
+     * A bucket holds symbols with different hashes. Only compare the names
+     * of the symbols with the same hash.
      */
-    if (strcmp (name, sym->name) == 0)
+    if ((sym->hash == hash) && (strcmp (name, sym->name) == 0))
       return sym;
     node = rtems_chain_next (node);
   }
@@ -199,19 +231,29 @@ rtems_rtl_symbol_global_find (const char* name)
   return NULL;
 }
 
+rtems_rtl_obj_sym_t*
+rtems_rtl_symbol_global_find (const char* name)
+{
+  return rtems_rtl_symbol_global_find_hash (name, rtems_rtl_symbol_hash (name));
+}
+
 rtems_rtl_obj_sym_t*
 rtems_rtl_symbol_obj_find (rtems_rtl_obj_t* obj, const char* name)
 {
   rtems_rtl_obj_sym_t* sym;
+  uint32_t             hash;
   size_t               s;
   /*
    * Check the object file's symbols first. If not found search the
-   * global symbol table.
+   * global symbol table. A symbol without a hash has not been added to the
+   * global table yet so compare the name.
    */
+  hash = rtems_rtl_symbol_hash (name);
   for (s = 0, sym = obj->global_table; s < obj->global_syms; ++s, ++sym)
-    if (strcmp (name, sym->name) == 0)
+    if (((sym->hash == hash) || (sym->hash == 0)) &&
+        (strcmp (name, sym->name) == 0))
       return sym;
-  return rtems_rtl_symbol_global_find (name);
+  return rtems_rtl_symbol_global_find_hash (name, hash);
 }
 
 void
@@ -232,11 +274,17 @@ rtems_rtl_symbol_obj_erase (rtems_rtl_obj_t* obj)
 {
   if (obj->global_table)
   {
+    rtems_rtl_symbols_t* symbols = rtems_rtl_global_symbols ();
     rtems_rtl_obj_sym_t* sym;
     size_t               s;
     for (s = 0, sym = obj->global_table; s < obj->global_syms; ++s, ++sym)
-        if (!rtems_chain_is_node_off_chain (&sym->node))
-          rtems_chain_extract (&sym->node);
+    {
+      if (!rtems_chain_is_node_off_chain (&sym->node))
+      {
+        rtems_chain_extract (&sym->node);
+        symbols->signature ^= rtems_rtl_symbol_signature (sym);
+      }
+    }
     rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_SYMBOL, obj->global_table);
     obj->global_table = NULL;
     obj->global_size = 0;
@@ -32,6 +32,9 @@ typedef struct rtems_rtl_obj_sym_s
   const char*      name;    /**< The symbol's name. */
   void*            value;   /**< The value of the symbol. */
   uint32_t         data;    /**< Format specific data. */
+  uint32_t         hash;    /**< The hash of the name. If 0 the hash is
+                             *   computed when the symbol is added to the
+                             *   global table. */
 } rtems_rtl_obj_sym_t;
 
 /**
@@ -41,6 +44,9 @@ typedef struct rtems_rtl_symbols_s
 {
   rtems_chain_control* buckets;
   size_t               nbuckets;
+  uint32_t             signature; /**< The signature of the symbols in the
+                                   *   table. Any symbol added or removed
+                                   *   changes the signature. */
 } rtems_rtl_symbols_t;
 
 /**
@@ -87,6 +93,14 @@ bool rtems_rtl_symbol_global_add (rtems_rtl_obj_t*     obj,
                                   const unsigned char* esyms,
                                   unsigned int         size);
 
+/**
+ * The signature of the global symbol table. The signature is the same if the
+ * same set of symbols with the same values is held in the table.
+ *
+ * @return uint32_t The global symbol table's signature.
+ */
+uint32_t rtems_rtl_symbol_global_signature (void);
+
 /**
  * Find a symbol given the symbol label in the global symbol table.
  *
@@ -96,6 +110,27 @@ bool rtems_rtl_symbol_global_add (rtems_rtl_obj_t*     obj,
  */
 rtems_rtl_obj_sym_t* rtems_rtl_symbol_global_find (const char* name);
 
+/**
+ * Find a symbol given the symbol label and the hash of the label in the global
+ * symbol table. Only symbols with the same hash have their labels compared.
+ *
+ * @param name The name as an ASCIIZ string.
+ * @param hash The hash of the name.
+ * @retval NULL No symbol found.
+ * @return rtems_rtl_obj_sym_t* Reference to the symbol.
+ */
+rtems_rtl_obj_sym_t* rtems_rtl_symbol_global_find_hash (const char* name,
+                                                        uint32_t    hash);
+
+/**
+ * Return the hash of a symbol's label. This is the hash a RAP file holds for
+ * each symbol.
+ *
+ * @param name The name as an ASCIIZ string.
+ * @return uint32_t The hash of the name.
+ */
+uint32_t rtems_rtl_symbol_hash (const char* name);
+
 /**
  * Find a symbol given the symbol label in the local object file.
  *
@@ -108,7 +143,8 @@ rtems_rtl_obj_sym_t* rtems_rtl_symbol_obj_find (rtems_rtl_obj_t* obj,
                                                 const char*      name);
 
 /**
- * Add the object file's symbols to the global table.
+ * Add the object file's symbols to the global table. A symbol without a hash
+ * has its hash computed.
  *
  * @param obj The object file the symbols are to be added.
  */
@@ -23,6 +23,7 @@
 #include <stdio.h>
 
 #include <rtl.h>
+#include <rtl-chain-iterator.h>
 #include <rtl-error.h>
 #include <rtl-unresolved.h>
 #include <rtl-trace.h>
@@ -221,6 +222,52 @@ rtems_rtl_unresolved_resolve_iterator (rtems_rtl_unresolv_rec_t* rec,
   return false;
 }
 
+/**
+ * Struct to pass the lookup handler in the iterator.
+ */
+typedef struct rtems_rtl_unresolved_lookup_data_s
+{
+  uint16_t                       name;    /**< Name index. */
+  rtems_rtl_obj_sym_t*           sym;     /**< The symbol record. */
+  rtems_rtl_unresolved_lookup_t* handler; /**< The user's handler. */
+  void*                          data;    /**< The user's data. */
+} rtems_rtl_unresolved_lookup_data_t;
+
+static bool
+rtems_rtl_unresolved_lookup_reloc (rtems_rtl_unresolv_rec_t* rec,
+                                   void*                     data)
+{
+  if (rec->type == rtems_rtl_unresolved_reloc)
+  {
+    rtems_rtl_unresolved_lookup_data_t* ld;
+    ld = (rtems_rtl_unresolved_lookup_data_t*) data;
+    if (rec->rec.reloc.obj && (rec->rec.reloc.name == ld->name))
+      ld->handler (&rec->rec.reloc, ld->sym, ld->data);
+  }
+  return false;
+}
+
+static bool
+rtems_rtl_unresolved_lookup_iterator (rtems_rtl_unresolv_rec_t* rec,
+                                      void*                     data)
+{
+  if (rec->type == rtems_rtl_unresolved_name)
+  {
+    rtems_rtl_unresolved_lookup_data_t* ld;
+    ld = (rtems_rtl_unresolved_lookup_data_t*) data;
+
+    ++ld->name;
+
+    ld->sym = rtems_rtl_symbol_global_find (rec->rec.name.name);
+
+    rtems_rtl_unresolved_interate (rtems_rtl_unresolved_lookup_reloc, ld);
+
+    ld->sym = NULL;
+  }
+
+  return false;
+}
+
 static void
 rtems_rtl_unresolved_clean_block (rtems_rtl_unresolv_block_t* block,
                                   rtems_rtl_unresolv_rec_t* rec,
@@ -285,7 +332,7 @@ rtems_rtl_unresolved_compact (void)
       if (block->recs == 0)
       {
         rtems_chain_extract (node);
-        free (block);
+        rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_EXTERNAL, block);
       }
 
       node = prev;
@@ -310,7 +357,7 @@ rtems_rtl_unresolved_table_close (rtems_rtl_unresolved_t* unresolved)
   while (!rtems_chain_is_tail (&unresolved->blocks, node))
   {
     rtems_chain_node* next = rtems_chain_next (node);
-    free (node);
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_EXTERNAL, node);
     node = next;
   }
 }
@@ -443,6 +490,81 @@ rtems_rtl_unresolved_add (rtems_rtl_obj_t*        obj,
   return true;
 }
 
+/**
+ * Struct to pass the name index and name record to the name iterator.
+ */
+typedef struct rtems_rtl_unresolved_name_data_s
+{
+  uint16_t                  index;  /**< The index of the name to find. */
+  uint16_t                  name;   /**< The index of the current name. */
+  rtems_rtl_unresolv_rec_t* found;  /**< The name record if found. */
+} rtems_rtl_unresolved_name_data_t;
+
+static bool
+rtems_rtl_unresolved_name_iterator (rtems_rtl_unresolv_rec_t* rec,
+                                    void*                     data)
+{
+  if (rec->type == rtems_rtl_unresolved_name)
+  {
+    rtems_rtl_unresolved_name_data_t* nd;
+    nd = (rtems_rtl_unresolved_name_data_t*) data;
+    ++nd->name;
+    if (nd->name == nd->index)
+    {
+      nd->found = rec;
+      return true;
+    }
+  }
+  return false;
+}
+
+static rtems_rtl_unresolv_rec_t*
+rtems_rtl_unresolved_name_rec (uint16_t index)
+{
+  rtems_rtl_unresolved_name_data_t nd;
+  nd.index = index;
+  nd.name = 0;
+  nd.found = NULL;
+  rtems_rtl_unresolved_interate (rtems_rtl_unresolved_name_iterator, &nd);
+  return nd.found;
+}
+
+const char*
+rtems_rtl_unresolved_reloc_name (const rtems_rtl_unresolv_reloc_t* reloc)
+{
+  rtems_rtl_unresolv_rec_t* rec = rtems_rtl_unresolved_name_rec (reloc->name);
+  return rec ? rec->rec.name.name : NULL;
+}
+
+static bool
+rtems_rtl_unresolved_erase_iterator (rtems_rtl_unresolv_rec_t* rec,
+                                     void*                     data)
+{
+  if ((rec->type == rtems_rtl_unresolved_reloc) && (rec->rec.reloc.obj == data))
+  {
+    rtems_rtl_unresolv_rec_t* name_rec;
+    name_rec = rtems_rtl_unresolved_name_rec (rec->rec.reloc.name);
+    if (name_rec && name_rec->rec.name.refs)
+      --name_rec->rec.name.refs;
+    rec->rec.reloc.obj = NULL;
+  }
+  return false;
+}
+
+void
+rtems_rtl_unresolved_erase_obj (rtems_rtl_obj_t* obj)
+{
+  rtems_rtl_unresolved_interate (rtems_rtl_unresolved_erase_iterator, obj);
+  rtems_rtl_unresolved_compact ();
+}
+
+static bool
+rtems_rtl_unresolved_sync_iterator (rtems_chain_node* node, void* data)
+{
+  rtems_rtl_obj_synchronize_cache ((rtems_rtl_obj_t*) node);
+  return true;
+}
+
 void
 rtems_rtl_unresolved_resolve (void)
 {
@@ -454,6 +576,21 @@ rtems_rtl_unresolved_resolve (void)
   rd.sym = NULL;
   rtems_rtl_unresolved_interate (rtems_rtl_unresolved_resolve_iterator, &rd);
   rtems_rtl_unresolved_compact ();
+  rtems_rtl_chain_iterate (&rtems_rtl_data ()->objects,
+                           rtems_rtl_unresolved_sync_iterator,
+                           NULL);
+}
+
+void
+rtems_rtl_unresolved_lookup (rtems_rtl_unresolved_lookup_t handler,
+                             void*                         data)
+{
+  rtems_rtl_unresolved_lookup_data_t ld;
+  ld.name = 0;
+  ld.sym = NULL;
+  ld.handler = handler;
+  ld.data = data;
+  rtems_rtl_unresolved_interate (rtems_rtl_unresolved_lookup_iterator, &ld);
 }
 
 bool
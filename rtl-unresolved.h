@@ -54,6 +54,7 @@
 
 #include <rtems.h>
 #include <rtl-obj-fwd.h>
+#include <rtl-sym.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -192,6 +193,47 @@ bool rtems_rtl_unresolved_add (rtems_rtl_obj_t*        obj,
  */
 void rtems_rtl_unresolved_resolve (void);
 
+/**
+ * The handler called for each unresolved relocation by
+ * rtems_rtl_unresolved_lookup.
+ *
+ * @param reloc The unresolved relocation record.
+ * @param sym The global symbol the relocation would resolve to. NULL if the
+ *            symbol is not in the global symbol table.
+ * @param data The user data.
+ */
+typedef void rtems_rtl_unresolved_lookup_t (rtems_rtl_unresolv_reloc_t* reloc,
+                                            rtems_rtl_obj_sym_t*        sym,
+                                            void*                       data);
+
+/**
+ * Look up the symbols the unresolved relocations reference without resolving
+ * them. Each name is looked up once. This lets a loader check the symbols can
+ * be resolved and see which object files provide them before any relocation
+ * is made.
+ *
+ * @param handler The handler called for each relocation.
+ * @param data The user data passed to the handler.
+ */
+void rtems_rtl_unresolved_lookup (rtems_rtl_unresolved_lookup_t handler,
+                                  void*                         data);
+
+/**
+ * Find the name of the symbol an unresolved relocation record references.
+ *
+ * @param reloc The unresolved relocation record.
+ * @retval NULL The name is not in the table.
+ * @return const char* The symbol's name.
+ */
+const char* rtems_rtl_unresolved_reloc_name (const rtems_rtl_unresolv_reloc_t* reloc);
+
+/**
+ * Erase all the unresolved relocations of an object file.
+ *
+ * @param obj The object file.
+ */
+void rtems_rtl_unresolved_erase_obj (rtems_rtl_obj_t* obj);
+
 /**
  * Remove a relocation from the list of unresolved relocations.
  *
@@ -0,0 +1,246 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Work Pool.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <rtems.h>
+
+#include "rtl-trace.h"
+#include "rtl-work.h"
+
+/**
+ * The work pool. The pool is created the first time it is run and is not
+ * deleted. The job fields are protected by the lock semaphore.
+ */
+typedef struct rtems_rtl_work_pool_s
+{
+  bool                     open;      /**< The pool has been opened. */
+  size_t                   workers;   /**< The number of workers. */
+  rtems_task_priority      priority;  /**< The workers' priority. */
+  rtems_id                 tasks[RTEMS_RTL_WORK_MAX_WORKERS]; /**< The tasks. */
+  rtems_id                 start;     /**< Workers wait here for a job. */
+  rtems_id                 done;      /**< Workers signal the job is done. */
+  rtems_id                 lock;      /**< The job lock. */
+  rtems_rtl_work_handler_t handler;   /**< The job's handler. */
+  void*                    data;      /**< The job's user data. */
+  size_t                   items;     /**< The number of items in the job. */
+  size_t                   next;      /**< The next item to run. */
+  bool                     failed;    /**< An item failed. */
+} rtems_rtl_work_pool_t;
+
+static rtems_rtl_work_pool_t pool;
+
+/*
+ * Run items until there are none left.
+ */
+static void
+rtems_rtl_work_items (void)
+{
+  while (true)
+  {
+    size_t item;
+    bool   more;
+
+    rtems_semaphore_obtain (pool.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+    item = pool.next;
+    more = item < pool.items;
+    if (more)
+      ++pool.next;
+    rtems_semaphore_release (pool.lock);
+
+    if (!more)
+      break;
+
+    if (!pool.handler (pool.data, item))
+    {
+      rtems_semaphore_obtain (pool.lock, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+      pool.failed = true;
+      rtems_semaphore_release (pool.lock);
+    }
+  }
+}
+
+static rtems_task
+rtems_rtl_work_worker (rtems_task_argument arg)
+{
+  while (true)
+  {
+    if (rtems_semaphore_obtain (pool.start,
+                                RTEMS_WAIT,
+                                RTEMS_NO_TIMEOUT) == RTEMS_SUCCESSFUL)
+    {
+      rtems_rtl_work_items ();
+      rtems_semaphore_release (pool.done);
+    }
+  }
+}
+
+/*
+ * Run the workers at the caller's priority so a job for a high priority
+ * loader is not run by low priority workers.
+ */
+static void
+rtems_rtl_work_priority (void)
+{
+  rtems_task_priority priority;
+  rtems_task_priority old;
+  size_t              w;
+
+  if (rtems_task_set_priority (RTEMS_SELF, RTEMS_CURRENT_PRIORITY,
+                               &priority) != RTEMS_SUCCESSFUL)
+    return;
+
+  if (priority == pool.priority)
+    return;
+
+  for (w = 0; w < pool.workers; ++w)
+    rtems_task_set_priority (pool.tasks[w], priority, &old);
+
+  pool.priority = priority;
+}
+
+/*
+ * Create the workers. A single processor target has no workers. Any failure
+ * leaves the pool with the workers created so far.
+ */
+static void
+rtems_rtl_work_open (void)
+{
+  rtems_task_priority priority;
+  rtems_status_code   sc;
+  size_t              workers;
+
+  pool.open = true;
+  pool.workers = 0;
+
+  workers = rtems_get_processor_count () - 1;
+  if (workers > RTEMS_RTL_WORK_MAX_WORKERS)
+    workers = RTEMS_RTL_WORK_MAX_WORKERS;
+
+  if (workers == 0)
+    return;
+
+  sc = rtems_task_set_priority (RTEMS_SELF, RTEMS_CURRENT_PRIORITY, &priority);
+  if (sc != RTEMS_SUCCESSFUL)
+    return;
+
+  sc = rtems_semaphore_create (rtems_build_name ('R', 'T', 'W', 'L'),
+                               1, RTEMS_BINARY_SEMAPHORE | RTEMS_PRIORITY |
+                               RTEMS_INHERIT_PRIORITY,
+                               RTEMS_NO_PRIORITY, &pool.lock);
+  if (sc != RTEMS_SUCCESSFUL)
+    return;
+
+  sc = rtems_semaphore_create (rtems_build_name ('R', 'T', 'W', 'S'),
+                               0, RTEMS_COUNTING_SEMAPHORE | RTEMS_PRIORITY,
+                               RTEMS_NO_PRIORITY, &pool.start);
+  if (sc != RTEMS_SUCCESSFUL)
+  {
+    rtems_semaphore_delete (pool.lock);
+    return;
+  }
+
+  sc = rtems_semaphore_create (rtems_build_name ('R', 'T', 'W', 'D'),
+                               0, RTEMS_COUNTING_SEMAPHORE | RTEMS_PRIORITY,
+                               RTEMS_NO_PRIORITY, &pool.done);
+  if (sc != RTEMS_SUCCESSFUL)
+  {
+    rtems_semaphore_delete (pool.start);
+    rtems_semaphore_delete (pool.lock);
+    return;
+  }
+
+  while (pool.workers < workers)
+  {
+    rtems_id task;
+
+    sc = rtems_task_create (rtems_build_name ('R', 'T', 'W', '0' + pool.workers),
+                            priority,
+                            RTEMS_MINIMUM_STACK_SIZE * 2,
+                            RTEMS_DEFAULT_MODES,
+                            RTEMS_DEFAULT_ATTRIBUTES,
+                            &task);
+    if (sc != RTEMS_SUCCESSFUL)
+      break;
+
+    sc = rtems_task_start (task, rtems_rtl_work_worker, 0);
+    if (sc != RTEMS_SUCCESSFUL)
+    {
+      rtems_task_delete (task);
+      break;
+    }
+
+    pool.tasks[pool.workers] = task;
+    ++pool.workers;
+  }
+
+  pool.priority = priority;
+
+  if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+    printf ("rtl: work: workers=%zu\n", pool.workers);
+}
+
+bool
+rtems_rtl_work_run (rtems_rtl_work_handler_t handler,
+                    void*                    data,
+                    size_t                   items)
+{
+  size_t workers;
+  size_t w;
+
+  if (!items)
+    return true;
+
+  if (!pool.open)
+    rtems_rtl_work_open ();
+
+  workers = pool.workers;
+  if (workers > (items - 1))
+    workers = items - 1;
+
+  if (workers == 0)
+  {
+    bool   ok = true;
+    size_t item;
+    for (item = 0; item < items; ++item)
+    {
+      if (!handler (data, item))
+        ok = false;
+    }
+    return ok;
+  }
+
+  rtems_rtl_work_priority ();
+
+  pool.handler = handler;
+  pool.data = data;
+  pool.items = items;
+  pool.next = 0;
+  pool.failed = false;
+
+  for (w = 0; w < workers; ++w)
+    rtems_semaphore_release (pool.start);
+
+  rtems_rtl_work_items ();
+
+  for (w = 0; w < workers; ++w)
+    rtems_semaphore_obtain (pool.done, RTEMS_WAIT, RTEMS_NO_TIMEOUT);
+
+  return !pool.failed;
+}
@@ -0,0 +1,71 @@
+/*
+ *  COPYRIGHT (c) 2012 Chris Johns <chrisj@rtems.org>
+ *
+ *  The license and distribution terms for this file may be
+ *  found in the file LICENSE in this distribution or at
+ *  http://www.rtems.org/license/LICENSE.
+ */
+/**
+ * @file
+ *
+ * @ingroup rtems_rtl
+ *
+ * @brief RTEMS Run-Time Linker Work Pool.
+ *
+ * The work pool runs a number of independent items of work across the
+ * processors of an SMP target. The caller takes part in the work and returns
+ * once all items have been run. On a single processor target or if the
+ * workers cannot be created the items are run by the caller one after the
+ * other.
+ *
+ * The workers run at the priority of the task running the pool.
+ *
+ * The pool is shared and must only be run with the RTL lock held. The work
+ * handler is run by tasks that do not hold the RTL lock so it must not call
+ * the RTL, which includes setting the RTL error.
+ */
+
+#if !defined (_RTEMS_RTL_WORK_H_)
+#define _RTEMS_RTL_WORK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The maximum number of worker tasks.
+ */
+#define RTEMS_RTL_WORK_MAX_WORKERS (8)
+
+/**
+ * The work handler is called once for each item.
+ *
+ * @param data The user data passed to the run call.
+ * @param item The item of work to perform.
+ * @retval true The item was done.
+ * @retval false The item failed.
+ */
+typedef bool (*rtems_rtl_work_handler_t) (void* data, size_t item);
+
+/**
+ * Run the items of work across the worker pool. All items are run even if
+ * some fail.
+ *
+ * @param handler The work handler.
+ * @param data User data passed to the handler.
+ * @param items The number of items of work.
+ * @retval true All items were done.
+ * @retval false One or more items failed.
+ */
+bool rtems_rtl_work_run (rtems_rtl_work_handler_t handler,
+                         void*                    data,
+                         size_t                   items);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
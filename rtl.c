@@ -22,14 +22,19 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <dlfcn.h>
 
 #include <rtems/libio_.h>
 
 #include <rtl.h>
 #include "rtl-allocator.h"
+#include "rtl-crc.h"
 #include "rtl-error.h"
+#include "rtl-find-file.h"
+#include "rtl-snapshot.h"
 #include "rtl-string.h"
 #include "rtl-trace.h"
+#include "rtl-work.h"
 
 /**
  * Semaphore configuration to create a mutex.
@@ -111,6 +116,11 @@ rtems_rtl_data_init (void)
        */
       rtems_rtl_alloc_initialise (&rtl->allocator);
 
+      /*
+       * Create the CRC32 tables before any task can calculate a CRC.
+       */
+      rtems_rtl_crc32_init ();
+
       /*
        * Create the RTL lock.
        */
@@ -137,10 +147,21 @@ rtems_rtl_data_init (void)
        * Initialise the objects list and create any required services.
        */
       rtems_chain_initialize_empty (&rtl->objects);
+      rtems_chain_initialize_empty (&rtl->find_dirs);
+
+      if (!rtems_rtl_obj_registry_open (&rtl->registry,
+                                        RTEMS_RTL_OBJ_REGISTRY_BUCKETS,
+                                        RTEMS_RTL_OBJ_REGISTRY_SLOTS))
+      {
+        rtems_semaphore_delete (lock);
+        free (rtl);
+        return false;
+      }
 
       if (!rtems_rtl_symbol_table_open (&rtl->globals,
                                         RTEMS_RTL_SYMS_GLOBAL_BUCKETS))
       {
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -150,6 +171,7 @@ rtems_rtl_data_init (void)
                                             RTEMS_RTL_UNRESOLVED_BLOCK_SIZE))
       {
         rtems_rtl_symbol_table_close (&rtl->globals);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -160,6 +182,7 @@ rtems_rtl_data_init (void)
       {
         rtems_rtl_symbol_table_close (&rtl->globals);
         rtems_rtl_unresolved_table_close (&rtl->unresolved);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -171,6 +194,7 @@ rtems_rtl_data_init (void)
         rtems_rtl_obj_cache_close (&rtl->symbols);
         rtems_rtl_unresolved_table_close (&rtl->unresolved);
         rtems_rtl_symbol_table_close (&rtl->globals);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -183,6 +207,7 @@ rtems_rtl_data_init (void)
         rtems_rtl_obj_cache_close (&rtl->symbols);
         rtems_rtl_unresolved_table_close (&rtl->unresolved);
         rtems_rtl_symbol_table_close (&rtl->globals);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -196,6 +221,7 @@ rtems_rtl_data_init (void)
         rtems_rtl_obj_cache_close (&rtl->symbols);
         rtems_rtl_unresolved_table_close (&rtl->unresolved);
         rtems_rtl_symbol_table_close (&rtl->globals);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -210,6 +236,7 @@ rtems_rtl_data_init (void)
         rtems_rtl_obj_cache_close (&rtl->symbols);
         rtems_rtl_unresolved_table_close (&rtl->unresolved);
         rtems_rtl_symbol_table_close (&rtl->globals);
+        rtems_rtl_obj_registry_close (&rtl->registry);
         rtems_semaphore_delete (lock);
         free (rtl);
         return false;
@@ -221,6 +248,7 @@ rtems_rtl_data_init (void)
       rtl->base->oname = rtems_rtl_strdup ("rtems-kernel");
 
       rtems_chain_append (&rtl->objects, &rtl->base->link);
+      rtems_rtl_obj_registry_add (&rtl->registry, rtl->base);
     }
 
     rtems_libio_unlock ();
@@ -354,83 +382,126 @@ rtems_rtl_unlock (void)
 rtems_rtl_obj_t*
 rtems_rtl_check_handle (void* handle)
 {
-  rtems_rtl_obj_t*    obj;
-  rtems_chain_node* node;
-
-  obj = handle;
-  node = rtems_chain_first (&rtl->objects);
-
-  while (!rtems_chain_is_tail (&rtl->objects, node))
-  {
-    rtems_rtl_obj_t* check = (rtems_rtl_obj_t*) node;
-    if (check == obj)
-      return obj;
-    node = rtems_chain_next (node);
-  }
-
-  return NULL;
+  return rtems_rtl_obj_registry_handle (&rtl->registry, handle);
 }
 
 rtems_rtl_obj_t*
 rtems_rtl_find_obj (const char* name)
 {
-  rtems_chain_node* node;
-
-  node = rtems_chain_first (&rtl->objects);
-
-  while (!rtems_chain_is_tail (&rtl->objects, node))
-  {
-    rtems_rtl_obj_t* obj = (rtems_rtl_obj_t*) node;
-    if (rtems_rtl_match_name (obj, name))
-      return obj;
-    node = rtems_chain_next (node);
-  }
-
-  return NULL;
+  return rtems_rtl_obj_registry_find (&rtl->registry, name);
 }
 
-rtems_rtl_obj_t*
-rtems_rtl_load_object (const char* name, int mode)
+/*
+ * Load an object file from the file system or a stream if the file
+ * descriptor is valid. The object file is relocated against the global symbols
+ * it can find. Unresolved externals are not resolved, the object file is not
+ * recorded in a snapshot and its constructors are not run. If the object file
+ * is already loaded it is returned and loaded is false. A staged load is only
+ * begun and the caller reads the sections and ends it.
+ */
+static rtems_rtl_obj_t*
+rtems_rtl_load_object_file (const char* name,
+                            int         fd,
+                            int         mode,
+                            bool        staged,
+                            bool*       loaded)
 {
-  rtems_rtl_obj_t* obj;
+  rtems_rtl_obj_t*         obj;
+  rtems_rtl_alloc_stats_t* owner;
 
   if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
-    printf ("rtl: loading '%s'\n", name);
+    printf ("rtl: loading '%s'%s\n", name, fd >= 0 ? " (stream)" : "");
+
+  *loaded = false;
 
   /*
    * See if the object module has already been loaded.
    */
   obj = rtems_rtl_find_obj (name);
-  if (!obj)
+  if (obj)
+    return obj;
+
+  /*
+   * Allocate a new object file descriptor and attempt to load it.
+   */
+  obj = rtems_rtl_obj_alloc ();
+  if (obj == NULL)
   {
-    /*
-     * Allocate a new object file descriptor and attempt to load it.
-     */
-    obj = rtems_rtl_obj_alloc ();
-    if (obj == NULL)
-    {
-      rtems_rtl_set_error (ENOMEM, "no memory for object descriptor");
-      return NULL;
-    }
+    rtems_rtl_set_error (ENOMEM, "no memory for object descriptor");
+    return NULL;
+  }
 
-    /*
-     * Find the file in the file system using the search path. The fname field
-     * will point to a valid file name if found.
-     */
-    if (!rtems_rtl_obj_find_file (obj, name))
-    {
-      rtems_rtl_obj_free (obj);
-      return NULL;
-    }
+  /*
+   * Charge the memory allocated while loading to the object file.
+   */
+  owner = rtems_rtl_alloc_owner (obj->alloc);
 
-    rtems_chain_append (&rtl->objects, &obj->link);
+  /*
+   * Find the file in the file system using the search path. The fname field
+   * will point to a valid file name if found. A stream is named for the
+   * object it holds.
+   */
+  if ((fd >= 0) ?
+      !rtems_rtl_obj_stream_file (obj, name) :
+      !rtems_rtl_obj_find_file (obj, name))
+  {
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return NULL;
+  }
 
-    if (!rtems_rtl_obj_load (obj))
-    {
-      rtems_rtl_obj_free (obj);
-      return NULL;
-    }
+  if (!rtems_rtl_obj_registry_add (&rtl->registry, obj))
+  {
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_obj_free (obj);
+    return NULL;
+  }
+
+  rtems_chain_append (&rtl->objects, &obj->link);
+
+  /*
+   * Calls to external functions are bound on the first call if asked for. The
+   * prelink cache and snapshots record the relocated image so every call has
+   * to be bound when they are enabled.
+   */
+  if (((mode & (RTLD_LAZY | RTLD_NOW)) == RTLD_LAZY) &&
+      !rtl->prelink && !rtl->snapshot)
+    obj->flags |= RTEMS_RTL_OBJ_LAZY;
+
+  if ((fd >= 0) ? !rtems_rtl_obj_load_stream (obj, fd) :
+      staged ? !rtems_rtl_obj_load_begin (obj) :
+      !rtems_rtl_obj_load (obj))
+  {
+    rtems_rtl_alloc_owner (owner);
+    rtems_rtl_unresolved_erase_obj (obj);
+    rtems_rtl_obj_free (obj);
+    return NULL;
+  }
+
+  rtems_rtl_alloc_owner (owner);
+
+  *loaded = true;
+
+  return obj;
+}
 
+/*
+ * Load an object file from the file system or a stream if the file
+ * descriptor is valid.
+ */
+static rtems_rtl_obj_t*
+rtems_rtl_load_object_source (const char* name, int fd, int mode)
+{
+  rtems_rtl_obj_t* obj;
+  bool             loaded;
+
+  obj = rtems_rtl_load_object_file (name, fd, mode, false, &loaded);
+  if (!obj)
+    return NULL;
+
+  if (loaded)
+  {
+    rtems_rtl_snapshot_obj (obj);
     rtems_rtl_unresolved_resolve ();
   }
 
@@ -463,6 +534,365 @@ rtems_rtl_load_object (const char* name, int mode)
   return obj;
 }
 
+/**
+ * A batch of object files being loaded together.
+ */
+typedef struct rtems_rtl_batch_s
+{
+  size_t            count;      /**< The number of object files. */
+  rtems_rtl_obj_t** objs;       /**< The object files in the order loaded. */
+  bool*             loaded;     /**< The object file was loaded by the
+                                 *   batch. */
+  uint8_t*          deps;       /**< A count by count table. The entry at
+                                 *   [d * count + p] is set if object file d
+                                 *   references a symbol in object file p. */
+  size_t*           order;      /**< The order the constructors are run. */
+  size_t*           providers;  /**< The number of providers not yet ordered
+                                 *   per object file. */
+  size_t            current;    /**< The object file being loaded. */
+  int*              errors;     /**< The errno of each object file's
+                                 *   section read. */
+  bool              unresolved; /**< A batch object file references a symbol
+                                 *   that cannot be found. */
+} rtems_rtl_batch_t;
+
+static int
+rtems_rtl_batch_index (rtems_rtl_batch_t* batch, rtems_rtl_obj_t* obj)
+{
+  size_t i;
+  for (i = 0; i < batch->count; ++i)
+    if (batch->loaded[i] && (batch->objs[i] == obj))
+      return i;
+  return -1;
+}
+
+static int
+rtems_rtl_batch_provider (rtems_rtl_batch_t*         batch,
+                          const rtems_rtl_obj_sym_t* sym)
+{
+  size_t i;
+  for (i = 0; i < batch->count; ++i)
+  {
+    rtems_rtl_obj_t* obj = batch->objs[i];
+    if (batch->loaded[i] &&
+        (sym >= obj->global_table) &&
+        (sym < (obj->global_table + obj->global_syms)))
+      return i;
+  }
+  return -1;
+}
+
+void
+rtems_rtl_batch_resolved (const rtems_rtl_obj_sym_t* sym)
+{
+  rtems_rtl_batch_t* batch = rtl ? rtl->batch : NULL;
+  if (batch && sym)
+  {
+    int p = rtems_rtl_batch_provider (batch, sym);
+    if ((p >= 0) && (p != (int) batch->current))
+      batch->deps[(batch->current * batch->count) + p] = 1;
+  }
+}
+
+/*
+ * Record which batch object file provides each symbol a batch object file has
+ * not resolved. These are the forward references. A reference to an object
+ * file loaded earlier in the batch is resolved when the object file is
+ * relocated and is recorded by rtems_rtl_batch_resolved.
+ */
+static void
+rtems_rtl_batch_lookup (rtems_rtl_unresolv_reloc_t* reloc,
+                        rtems_rtl_obj_sym_t*        sym,
+                        void*                       data)
+{
+  rtems_rtl_batch_t* batch = data;
+  int                d = rtems_rtl_batch_index (batch, reloc->obj);
+  if (d >= 0)
+  {
+    if (!sym)
+      batch->unresolved = true;
+    else
+    {
+      int p = rtems_rtl_batch_provider (batch, sym);
+      if ((p >= 0) && (p != d))
+        batch->deps[(d * batch->count) + p] = 1;
+    }
+  }
+}
+
+/*
+ * Order the constructors so an object file's providers run first. The
+ * earliest object file loaded that is ready runs next. A dependency loop is
+ * broken by running the earliest object file loaded in the loop.
+ */
+static size_t
+rtems_rtl_batch_order (rtems_rtl_batch_t* batch)
+{
+  size_t count = batch->count;
+  size_t ordered = 0;
+  size_t d;
+  size_t p;
+
+  for (d = 0; d < count; ++d)
+  {
+    batch->providers[d] = 0;
+    for (p = 0; p < count; ++p)
+      batch->providers[d] += batch->deps[(d * count) + p];
+  }
+
+  while (true)
+  {
+    size_t next = count;
+    size_t first = count;
+
+    for (d = 0; d < count; ++d)
+    {
+      if (batch->loaded[d] && (batch->providers[d] != (size_t) -1))
+      {
+        if (first == count)
+          first = d;
+        if (batch->providers[d] == 0)
+        {
+          next = d;
+          break;
+        }
+      }
+    }
+
+    if (next == count)
+      next = first;
+
+    if (next == count)
+      break;
+
+    batch->order[ordered++] = next;
+    batch->providers[next] = (size_t) -1;
+
+    for (d = 0; d < count; ++d)
+      if (batch->deps[(d * count) + next] &&
+          (batch->providers[d] != (size_t) -1))
+        --batch->providers[d];
+  }
+
+  return ordered;
+}
+
+/*
+ * Read the sections of a batch object file. This is a work handler so it can
+ * be run by a worker and cannot call the RTL.
+ */
+static bool
+rtems_rtl_batch_read (void* data, size_t item)
+{
+  rtems_rtl_batch_t* batch = data;
+  if (!batch->loaded[item])
+    return true;
+  return rtems_rtl_obj_load_read (batch->objs[item], &batch->errors[item]);
+}
+
+static void
+rtems_rtl_batch_rollback (rtems_rtl_batch_t* batch)
+{
+  size_t i = batch->count;
+  while (i-- > 0)
+  {
+    if (batch->loaded[i])
+    {
+      if (rtems_rtl_trace (RTEMS_RTL_TRACE_UNLOAD))
+        printf ("rtl: batch: rollback '%s'\n",
+                rtems_rtl_obj_oname (batch->objs[i]));
+      rtems_rtl_unresolved_erase_obj (batch->objs[i]);
+      rtems_rtl_obj_unload (batch->objs[i]);
+    }
+  }
+}
+
+bool
+rtems_rtl_load_objects (const char*      names[],
+                        size_t           count,
+                        int              mode,
+                        rtems_rtl_obj_t* objs[])
+{
+  rtems_rtl_batch_t batch;
+  bool              staged;
+  size_t            ordered;
+  size_t            i;
+
+  if (count == 0)
+    return true;
+
+  /*
+   * One allocation holds the batch's tables. The pointers, sizes and errors
+   * are first so they are aligned.
+   */
+  batch.objs = rtems_rtl_alloc_new (RTEMS_RTL_ALLOC_OBJECT,
+                                    (count * sizeof (rtems_rtl_obj_t*)) +
+                                    (count * 2 * sizeof (size_t)) +
+                                    (count * sizeof (int)) +
+                                    (count * sizeof (bool)) +
+                                    (count * count),
+                                    true);
+  if (!batch.objs)
+  {
+    rtems_rtl_set_error (ENOMEM, "no memory for batch load");
+    return false;
+  }
+
+  batch.count = count;
+  batch.order = (size_t*) (batch.objs + count);
+  batch.providers = batch.order + count;
+  batch.errors = (int*) (batch.providers + count);
+  batch.loaded = (bool*) (batch.errors + count);
+  batch.deps = (uint8_t*) (batch.loaded + count);
+  batch.unresolved = false;
+
+  /*
+   * Load each object file. The unresolved externals are resolved once all the
+   * object files are loaded. The references to object files loaded earlier
+   * are recorded as each object file is relocated.
+   *
+   * The load is staged. Each object file is parsed and its sections are
+   * allocated, then the sections of all the object files are read in the work
+   * pool, then each object file is linked in order. Parsing and linking use
+   * the RTL's caches, allocator and global symbols so they are not run in
+   * parallel. A format that cannot defer reading its sections is loaded in
+   * the first stage. The prelink cache is keyed by the global symbols when an
+   * object file is parsed so a prelinked load is not staged.
+   */
+  staged = rtl->prelink == NULL;
+
+  rtl->batch = &batch;
+
+  for (i = 0; i < count; ++i)
+  {
+    batch.current = i;
+    batch.objs[i] = rtems_rtl_load_object_file (names[i], -1, mode, staged,
+                                                &batch.loaded[i]);
+    if (!batch.objs[i])
+    {
+      rtl->batch = NULL;
+      batch.count = i;
+      rtems_rtl_batch_rollback (&batch);
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, batch.objs);
+      return false;
+    }
+  }
+
+  if (staged)
+  {
+    if (!rtems_rtl_work_run (rtems_rtl_batch_read, &batch, count))
+    {
+      i = 0;
+      while ((i < (count - 1)) && (batch.errors[i] == 0))
+        ++i;
+      rtems_rtl_set_error (batch.errors[i] ? batch.errors[i] : EIO,
+                           "section load read failed: %s",
+                           rtems_rtl_obj_oname (batch.objs[i]));
+      rtl->batch = NULL;
+      rtems_rtl_batch_rollback (&batch);
+      rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, batch.objs);
+      return false;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+      if (batch.loaded[i])
+      {
+        rtems_rtl_alloc_stats_t* owner;
+        bool                     ok;
+
+        batch.current = i;
+        owner = rtems_rtl_alloc_owner (batch.objs[i]->alloc);
+        ok = rtems_rtl_obj_load_end (batch.objs[i]);
+        rtems_rtl_alloc_owner (owner);
+
+        if (!ok)
+        {
+          rtl->batch = NULL;
+          rtems_rtl_batch_rollback (&batch);
+          rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, batch.objs);
+          return false;
+        }
+      }
+    }
+  }
+
+  rtl->batch = NULL;
+
+  /*
+   * Find the object files that provide the symbols the batch references before
+   * anything is resolved. Resolving relocates object files loaded before the
+   * batch and after that the batch cannot be rolled back.
+   */
+  rtems_rtl_unresolved_lookup (rtems_rtl_batch_lookup, &batch);
+
+  if (batch.unresolved && ((mode & RTLD_NOW) != 0))
+  {
+    rtems_rtl_set_error (ENOENT, "batch has unresolved externals");
+    rtems_rtl_batch_rollback (&batch);
+    rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, batch.objs);
+    return false;
+  }
+
+  for (i = 0; i < count; ++i)
+    if (batch.loaded[i])
+      rtems_rtl_snapshot_obj (batch.objs[i]);
+
+  rtems_rtl_unresolved_resolve ();
+
+  for (i = 0; i < count; ++i)
+  {
+    ++batch.objs[i]->users;
+    if (objs)
+      objs[i] = batch.objs[i];
+  }
+
+  /*
+   * Run the constructors with the linker unlocked once everything is linked.
+   * The object files are locked so a constructor cannot unload them.
+   */
+  ordered = rtems_rtl_batch_order (&batch);
+
+  for (i = 0; i < ordered; ++i)
+    batch.objs[batch.order[i]]->flags |= RTEMS_RTL_OBJ_LOCKED;
+
+  rtems_rtl_unlock ();
+
+  for (i = 0; i < ordered; ++i)
+  {
+    if (rtems_rtl_trace (RTEMS_RTL_TRACE_LOAD))
+      printf ("rtl: batch: ctors '%s'\n",
+              rtems_rtl_obj_oname (batch.objs[batch.order[i]]));
+    rtems_rtl_obj_run_ctors (batch.objs[batch.order[i]]);
+  }
+
+  rtems_rtl_lock ();
+
+  for (i = 0; i < ordered; ++i)
+    batch.objs[batch.order[i]]->flags &= ~RTEMS_RTL_OBJ_LOCKED;
+
+  rtems_rtl_alloc_del (RTEMS_RTL_ALLOC_OBJECT, batch.objs);
+
+  return true;
+}
+
+rtems_rtl_obj_t*
+rtems_rtl_load_object (const char* name, int mode)
+{
+  return rtems_rtl_load_object_source (name, -1, mode);
+}
+
+rtems_rtl_obj_t*
+rtems_rtl_load_object_stream (const char* name, int fd, int mode)
+{
+  if (fd < 0)
+  {
+    rtems_rtl_set_error (EBADF, "invalid stream");
+    return NULL;
+  }
+  return rtems_rtl_load_object_source (name, fd, mode);
+}
+
 bool
 rtems_rtl_unload_object (rtems_rtl_obj_t* obj)
 {
@@ -496,6 +926,35 @@ rtems_rtl_unload_object (rtems_rtl_obj_t* obj)
     obj->flags &= ~RTEMS_RTL_OBJ_LOCKED;
 
     ok = rtems_rtl_obj_unload (obj);
+
+    /*
+     * A snapshot cannot restore the unloaded object file's fix ups.
+     */
+    rtems_rtl_snapshot_record (NULL);
+  }
+
+  return ok;
+}
+
+bool
+rtems_rtl_verify_object (rtems_rtl_obj_t* obj)
+{
+  rtems_chain_node* node;
+  bool              ok = true;
+
+  node = rtems_chain_first (&rtl->objects);
+
+  while (!rtems_chain_is_tail (&rtl->objects, node))
+  {
+    rtems_rtl_obj_t* check = (rtems_rtl_obj_t*) node;
+    if ((!obj || (check == obj)) && !rtems_rtl_obj_verify_text (check))
+    {
+      if (ok)
+        rtems_rtl_set_error (EIO, "text checksum mismatch: %s",
+                             rtems_rtl_obj_oname (check));
+      ok = false;
+    }
+    node = rtems_chain_next (node);
   }
 
   return ok;
@@ -578,6 +1037,8 @@ rtems_rtl_path_update (bool prepend, const char* path)
 
   rtl->paths = paths;
 
+  rtems_rtl_find_file_flush ();
+
   rtems_rtl_unlock ();
   return false;
 }
@@ -594,6 +1055,16 @@ rtems_rtl_path_prepend (const char* path)
   return rtems_rtl_path_update (true, path);
 }
 
+bool
+rtems_rtl_gc_sections (bool enable)
+{
+  if (!rtems_rtl_lock ())
+    return false;
+  rtl->gc_sections = enable;
+  rtems_rtl_unlock ();
+  return true;
+}
+
 void
 rtems_rtl_base_sym_global_add (const unsigned char* esyms,
                                unsigned int         size)
@@ -27,6 +27,7 @@
 #include <rtl-obj.h>
 #include <rtl-obj-cache.h>
 #include <rtl-obj-comp.h>
+#include <rtl-obj-registry.h>
 #include <rtl-unresolved.h>
 
 #ifdef __cplusplus
@@ -58,6 +59,21 @@ extern "C" {
  */
 #define RTEMS_RTL_UNRESOLVED_BLOCK_SIZE (64)
 
+/**
+ * The initial number of buckets in the object registry.
+ */
+#define RTEMS_RTL_OBJ_REGISTRY_BUCKETS (32)
+
+/**
+ * The initial number of object file handles.
+ */
+#define RTEMS_RTL_OBJ_REGISTRY_SLOTS (32)
+
+/**
+ * The size of the last error string.
+ */
+#define RTEMS_RTL_ERROR_MAX (64)
+
 /**
  * The global debugger interface variable.
  */
@@ -87,7 +103,18 @@ struct rtems_rtl_data_s
   rtems_id               lock;           /**< The RTL lock id */
   rtems_rtl_alloc_data_t allocator;      /**< The allocator data. */
   rtems_chain_control    objects;        /**< List if loaded object files. */
+  rtems_rtl_obj_registry_t registry;     /**< The loaded object files by name
+                                          *   and handle. */
   const char*            paths;          /**< Search paths for archives. */
+  rtems_chain_control    find_dirs;      /**< Cached search path directory
+                                          *   listings. */
+  struct rtems_rtl_batch_s* batch;       /**< The set of object files being
+                                          *   loaded. */
+  const char*            prelink;        /**< The prelink cache directory. */
+  const char*            digest;         /**< The digest cache directory. */
+  const char*            snapshot;       /**< The snapshot being recorded. */
+  bool                   gc_sections;    /**< Do not load unreferenced
+                                          *   sections. */
   rtems_rtl_symbols_t    globals;        /**< Global symbol table. */
   rtems_rtl_unresolved_t unresolved;     /**< Unresolved symbols. */
   rtems_rtl_obj_t*       base;           /**< Base object file. */
@@ -95,8 +122,12 @@ struct rtems_rtl_data_s
   rtems_rtl_obj_cache_t  strings;        /**< Strings object file cache. */
   rtems_rtl_obj_cache_t  relocs;         /**< Relocations object file cache. */
   rtems_rtl_obj_comp_t   decomp;         /**< The decompression compressor. */
+  uint8_t*               dict;           /**< The RAP dictionary. */
+  size_t                 dict_size;      /**< The RAP dictionary's size. */
+  uint32_t               dict_crc;       /**< The RAP dictionary's CRC32. */
   int                    last_errno;     /**< Last error number. */
-  char                   last_error[64]; /**< Last error string. */
+  char                   last_error[RTEMS_RTL_ERROR_MAX]; /**< Last error
+                                                          *   string. */
 };
 
 /**
@@ -178,12 +209,13 @@ rtems_rtl_data_t* rtems_rtl_lock (void);
 bool rtems_rtl_unlock (void);
 
 /**
- * Check a pointer is a valid object file descriptor returning the pointer as
- * that type.
+ * Check a handle returned by dlopen is valid returning the object file
+ * descriptor it refers to. A handle of an object file that has been unloaded
+ * is not valid.
  *
  * Assumes the RTL has been locked.
  *
- * @param handle Pointer to the object file to be validated.
+ * @param handle The object file's handle to be validated.
  * @return rtl_obj* The object file descriptor. NULL is returned if invalid.
  */
 rtems_rtl_obj_t* rtems_rtl_check_handle (void* handle);
@@ -222,6 +254,15 @@ rtems_rtl_obj_t* rtems_rtl_find_obj (const char* name);
  *  4. Relative archive and file in the search path. The encoding is the same
  *     as described in item 3 of this list.
  *
+ * If the mode is RTLD_LAZY an architecture with lazy binding stubs binds the
+ * calls to external functions on the first call. Lazy binding is not used if
+ * the prelink cache is enabled or a snapshot is being recorded. Only ARM has
+ * lazy binding stubs. On other architectures RTLD_LAZY does nothing and calls
+ * are bound when the object file loads. The first call to a function binds it
+ * with the RTL locked so the call can block on the lock. An object file with
+ * functions called from an interrupt handler or a task with real-time
+ * deadlines must be loaded with RTLD_NOW.
+ *
  * Assumes the RTL has been locked.
  *
  * @param name The name of the object file.
@@ -230,6 +271,69 @@ rtems_rtl_obj_t* rtems_rtl_find_obj (const char* name);
  */
 rtems_rtl_obj_t* rtems_rtl_load_object (const char* name, int mode);
 
+/**
+ * Load an object file from a stream such as a pipe or a socket. The stream is
+ * read forward only and the file is not staged on the file system. The object
+ * file must be a RAP file. If an object with the name is already loaded its
+ * user count is increased and the stream is not read. The stream is not
+ * closed.
+ *
+ * Assumes the RTL has been locked.
+ *
+ * @param name The name the object file is loaded as.
+ * @param fd The file descriptor of the stream.
+ * @param mode The mode of the load as defined by the dlopen call.
+ * @return rtl_obj* The object file descriptor. NULL is returned if the load fails.
+ */
+rtems_rtl_obj_t* rtems_rtl_load_object_stream (const char* name,
+                                               int         fd,
+                                               int         mode);
+
+/**
+ * Load a set of object files together. The object files are loaded and
+ * relocated then the unresolved externals are resolved in a single pass. The
+ * constructors are run once all the object files are linked and an object
+ * file's constructors run after the constructors of the object files in the
+ * set it references. An object file that is already loaded has its user count
+ * increased.
+ *
+ * The ELF object files are parsed and their sections allocated in turn, then
+ * their sections are read in parallel by the work pool, then they are linked
+ * in turn. The prelink cache disables the parallel read.
+ *
+ * The load succeeds or fails as a whole. If an object file fails to load, or
+ * the mode has RTLD_NOW and a symbol cannot be found, the object files loaded
+ * by the call are unloaded and nothing else is changed.
+ *
+ * Assumes the RTL has been locked.
+ *
+ * @param names The names of the object files. The name format is the same as
+ *              rtems_rtl_load_object.
+ * @param count The number of names.
+ * @param mode The mode of the load as defined by the dlopen call.
+ * @param objs The object file descriptors are returned in this table in the
+ *             order of the names. Can be NULL.
+ * @retval true The object files are loaded.
+ * @retval false The load failed. The RTL error is set.
+ */
+bool rtems_rtl_load_objects (const char*      names[],
+                             size_t           count,
+                             int              mode,
+                             rtems_rtl_obj_t* objs[]);
+
+/**
+ * Note the object file being loaded resolved a reference against a global
+ * symbol. If a set of object files is being loaded and the symbol is in an
+ * object file loaded earlier in the set the reference orders the
+ * constructors. The relocators call this for every symbol they find in the
+ * global symbol table.
+ *
+ * Assumes the RTL has been locked.
+ *
+ * @param sym The global symbol. Can be NULL.
+ */
+void rtems_rtl_batch_resolved (const rtems_rtl_obj_sym_t* sym);
+
 /**
  * Unload an object file. This only happens when the user count is 0.
  *
@@ -241,6 +345,21 @@ rtems_rtl_obj_t* rtems_rtl_load_object (const char* name, int mode);
  */
 bool rtems_rtl_unload_object (rtems_rtl_obj_t* obj);
 
+/**
+ * Verify the text of a loaded object file has not changed since it was
+ * loaded and relocated. The text is checked against the CRC32 taken when the
+ * caches were last synchronized. The error is set if the text does not
+ * match.
+ *
+ * Assumes the RTL has been locked.
+ *
+ * @param obj The object file descriptor. If NULL all object files are
+ *            verified.
+ * @retval true The text matches.
+ * @retval false The text of an object file does not match.
+ */
+bool rtems_rtl_verify_object (rtems_rtl_obj_t* obj);
+
 /**
  * Run any constructor functions the object file may contain. This call
  * assumes the linker is unlocked.
@@ -280,6 +399,19 @@ bool rtems_rtl_path_append (const char* path);
 
 bool rtems_rtl_path_prepend (const char* path);
 
+/**
+ * Enable or disable section garbage collection. When enabled the ELF loader
+ * does not load the sections the compiler creates per function or object,
+ * such as '.text.name', that cannot be reached from the object file's
+ * exported symbols, its constructors, destructors or its other sections. The
+ * collection is disabled by default.
+ *
+ * @param enable True to collect unreferenced sections.
+ * @retval true The setting has been changed.
+ * @retval false The RTL could not be locked.
+ */
+bool rtems_rtl_gc_sections (bool enable);
+
 /**
  * Add an exported symbol table to the global symbol table. This call is
  * normally used by an object file when loaded that contains a global symbol